@@ -44,13 +44,312 @@
 enum meshgen_type {
    HIERARCHICAL_MESHGEN = 0,
    SPARSE_MESHGEN,
-   ADAPT_MESHGEN };
+   ADAPT_MESHGEN,
+   PLOTFILE_MESHGEN,
+   STREAM_MESHGEN };
+
+enum cell_order_type {
+   ROW_MAJOR_ORDER = 0,
+   MORTON_ORDER,
+   SHUFFLED_ORDER,
+   NUM_CELL_ORDERS };
+
+static const char *cell_order_name[NUM_CELL_ORDERS] = {"Row-major", "Morton", "Shuffled"};
+
+enum probe_cache_variant {
+   PC_SINGLEWRITE = 0,
+   PC_HIERARCHICAL,
+   PC_COMPACT_HIERARCHICAL,
+#ifdef _OPENMP
+   PC_SINGLEWRITE_OPENMP,
+   PC_HIERARCHICAL_OPENMP,
+   PC_COMPACT_HIERARCHICAL_OPENMP,
+#endif
+   NUM_PC_VARIANTS };
+
+enum reduce_op_type {
+   REDUCE_SUM = 0,
+   REDUCE_MIN,
+   REDUCE_MAX,
+   REDUCE_VOLUME_WEIGHTED,
+   NUM_REDUCE_OPS };
+
+static const char *reduce_op_name[NUM_REDUCE_OPS] = {"Sum", "Min", "Max", "Volume-weighted"};
+
+enum reduce_kernel_type {
+   RK_BRUTE = 0,
+   RK_FULL_PERFECT,
+   RK_SINGLEWRITE,
+   RK_COMPACT_SINGLEWRITE,
+   RK_HIERARCHICAL,
+   RK_COMPACT_HIERARCHICAL,
+#ifdef _OPENMP
+   RK_FULL_PERFECT_OPENMP,
+   RK_SINGLEWRITE_OPENMP,
+   RK_COMPACT_SINGLEWRITE_OPENMP,
+   RK_HIERARCHICAL_OPENMP,
+   RK_COMPACT_HIERARCHICAL_OPENMP,
+#endif
+   NUM_REDUCE_KERNELS };
+
+static const char *reduce_kernel_name[NUM_REDUCE_KERNELS] = {
+   "Brute Force", "Full Perfect Remap", "Singlewrite Remap", "Compact Singlewrite Remap",
+   "Hierarchical Remap", "Compact Hierarchical Remap",
+#ifdef _OPENMP
+   "OpenMP Full Perfect Remap", "OpenMP Singlewrite Remap", "OpenMP Compact Singlewrite Remap",
+   "OpenMP Hierarchical Remap", "OpenMP Compact Hierarchical Remap",
+#endif
+};
+
+enum packed_variant {
+   PK_FULL_PERFECT = 0,
+   PK_SINGLEWRITE,
+   PK_COMPACT_SINGLEWRITE,
+   PK_HIERARCHICAL,
+   PK_COMPACT_HIERARCHICAL,
+#ifdef _OPENMP
+   PK_FULL_PERFECT_OPENMP,
+   PK_SINGLEWRITE_OPENMP,
+   PK_COMPACT_SINGLEWRITE_OPENMP,
+   PK_HIERARCHICAL_OPENMP,
+   PK_COMPACT_HIERARCHICAL_OPENMP,
+#endif
+   NUM_PK_VARIANTS };
+
+static const char *packed_name[NUM_PK_VARIANTS] = {
+   "Packed Full Perfect Remap", "Packed Singlewrite Remap", "Packed Compact Singlewrite Remap",
+   "Packed Hierarchical Remap", "Packed Compact Hierarchical Remap",
+#ifdef _OPENMP
+   "OpenMP Packed Full Perfect Remap", "OpenMP Packed Singlewrite Remap",
+   "OpenMP Packed Compact Singlewrite Remap", "OpenMP Packed Hierarchical Remap",
+   "OpenMP Packed Compact Hierarchical Remap",
+#endif
+};
+
+// Packed variants on the compact tables, which take int keys
+static const int packed_compact[NUM_PK_VARIANTS] = {
+   0, 0, 1, 0, 1,
+#ifdef _OPENMP
+   0, 0, 1, 0, 1,
+#endif
+};
+
+enum value_type_variant {
+   VT_DOUBLE_MEAN = 0,
+   VT_FLOAT_MEAN,
+   VT_INT32_MAJORITY,
+   VT_INT32_NEAREST,
+   NUM_VALUE_TYPES };
+
+static const char *value_type_name[NUM_VALUE_TYPES] = {"double mean", "float mean", "int32 majority", "int32 nearest"};
+
+enum diag_variant {
+   DG_FULL_PERFECT = 0,
+   DG_SINGLEWRITE,
+   DG_HIERARCHICAL,
+   DG_COMPACT_HIERARCHICAL,
+#ifdef _OPENMP
+   DG_FULL_PERFECT_OPENMP,
+   DG_SINGLEWRITE_OPENMP,
+   DG_HIERARCHICAL_OPENMP,
+   DG_COMPACT_HIERARCHICAL_OPENMP,
+#endif
+   NUM_DG_VARIANTS };
+
+static const char *diag_name[NUM_DG_VARIANTS] = {
+   "Full Perfect Remap", "Singlewrite Remap", "Hierarchical Remap", "Compact Hierarchical Remap",
+#ifdef _OPENMP
+   "OpenMP Full Perfect Remap", "OpenMP Singlewrite Remap", "OpenMP Hierarchical Remap",
+   "OpenMP Compact Hierarchical Remap",
+#endif
+};
+
+enum locate_variant {
+   PL_WALK = 0,
+   PL_KDTREE,
+   PL_SORTED_WALK,
+   PL_COMPACT_WALK,
+   PL_COMPACT_BISECT,
+#ifdef _OPENMP
+   PL_KDTREE_OPENMP,
+   PL_SORTED_WALK_OPENMP,
+   PL_COMPACT_BISECT_OPENMP,
+#endif
+   NUM_PL_VARIANTS };
+
+static const char *locate_name[NUM_PL_VARIANTS] = {
+   "Hierarchical walk", "KD-tree point boxes", "Hierarchical walk sorted",
+   "Compact walk sorted", "Compact bisect sorted",
+#ifdef _OPENMP
+   "OpenMP KD-tree point boxes", "OpenMP Hierarchical walk sorted", "OpenMP Compact bisect sorted",
+#endif
+};
+
+// Remaps onto an output mesh with its own base size and origin
+enum mapped_remap_variant {
+   MR_MAPPED = 0,
+   MR_COMPACT,
+#ifdef _OPENMP
+   MR_MAPPED_OPENMP,
+   MR_COMPACT_OPENMP,
+#endif
+   NUM_MR_VARIANTS };
+
+static const char *mapped_name[NUM_MR_VARIANTS] = {
+   "Mapped Hierarchical Remap", "Mapped Compact Hierarchical Remap",
+#ifdef _OPENMP
+   "OpenMP Mapped Hierarchical Remap", "OpenMP Mapped Compact Hierarchical Remap",
+#endif
+};
+
+// Compact hierarchical remaps chained back and forth between the meshes
+enum chain_remap_variant {
+   CH_COMPACT = 0,
+   CH_COMPACT_FUSED,
+#ifdef _OPENMP
+   CH_COMPACT_OPENMP,
+   CH_COMPACT_FUSED_OPENMP,
+#endif
+   NUM_CH_VARIANTS };
+
+static const char *chain_name[NUM_CH_VARIANTS] = {
+   "Chained Compact Hierarchical Remap",
+   "Fused Chained Compact Hierarchical Remap",
+#ifdef _OPENMP
+   "OpenMP Chained Compact Hierarchical Remap",
+   "OpenMP Fused Chained Compact Hierarchical",
+#endif
+};
+
+// Remaps in each chain, alternating input to output and output to input
+#define CHAIN_STEPS 4
+
+// Compact hierarchical remaps onto a box of the output mesh
+enum region_remap_variant {
+   RI_REGION = 0,
+#ifdef _OPENMP
+   RI_REGION_OPENMP,
+#endif
+   NUM_RI_VARIANTS };
+
+static const char *region_name[NUM_RI_VARIANTS] = {
+   "Region Compact Hierarchical Remap",
+#ifdef _OPENMP
+   "OpenMP Region Compact Hierarchical Remap",
+#endif
+};
+
+// Remaps as tasks against the flat parallel loops they replace, the flat
+// loops first and then each task backend over the same remaps
+enum task_remap_kind {
+   TK_FULL_PERFECT = 0,
+   TK_SINGLEWRITE,
+   TK_COMPACT_SINGLEWRITE,
+   TK_HIERARCHICAL,
+   TK_COMPACT_HIERARCHICAL,
+   NUM_TK_REMAPS };
+
+enum task_remap_backend {
+   TK_FLAT = 0,
+   TK_POOL,
+#ifdef _OPENMP
+   TK_OPENMP,
+#endif
+   NUM_TK_BACKENDS };
+
+#define NUM_TK_VARIANTS (NUM_TK_REMAPS*NUM_TK_BACKENDS)
+
+static const char *task_name[NUM_TK_VARIANTS] = {
+#ifdef _OPENMP
+   "OpenMP Full Perfect Remap", "OpenMP Singlewrite Remap", "OpenMP Compact Singlewrite Remap",
+   "OpenMP Hierarchical Remap", "OpenMP Compact Hierarchical Remap",
+#else
+   "Full Perfect Remap", "Singlewrite Remap", "Compact Singlewrite Remap",
+   "Hierarchical Remap", "Compact Hierarchical Remap",
+#endif
+   "Task Pool Full Perfect Remap", "Task Pool Singlewrite Remap", "Task Pool Compact Singlewrite Remap",
+   "Task Pool Hierarchical Remap", "Task Pool Compact Hierarchical Remap",
+#ifdef _OPENMP
+   "OpenMP Task Full Perfect Remap", "OpenMP Task Singlewrite Remap", "OpenMP Task Compact Singlewrite Remap",
+   "OpenMP Task Hierarchical Remap", "OpenMP Task Compact Hierarchical Remap",
+#endif
+};
+
+// The flat loop each variant is compared with
+#define task_base(v) ((v) % NUM_TK_REMAPS)
+
+// Thread counts in the scaling runs, doubling up to the maximum
+#define TASK_MAX_STEPS 16
+
+// Tile by tile hierarchical remaps against the two phase ones, on the
+// meshes as generated and sorted into Morton order
+enum tiled_remap_variant {
+   TL_HIERARCHICAL = 0,
+   TL_TILED,
+#ifdef _OPENMP
+   TL_HIERARCHICAL_OPENMP,
+   TL_TILED_OPENMP,
+#endif
+   NUM_TL_VARIANTS };
+
+static const char *tiled_name[NUM_TL_VARIANTS] = {
+   "Hierarchical Remap", "Tiled Hierarchical Remap",
+#ifdef _OPENMP
+   "OpenMP Hierarchical Remap", "OpenMP Tiled Hierarchical Remap",
+#endif
+};
+
+#define NUM_TILED_ORDERS 2
+static const char *tiled_order_name[NUM_TILED_ORDERS] = {"As generated", "Morton"};
+
+// A series of plotfile dumps remapped one after another on the calling
+// thread and pipelined with reader and writer threads
+enum stream_remap_variant {
+   SR_SEQUENTIAL = 0,
+   SR_PIPELINED,
+#ifdef _OPENMP
+   SR_SEQUENTIAL_OPENMP,
+   SR_PIPELINED_OPENMP,
+#endif
+   NUM_SR_VARIANTS };
+
+static const char *stream_name[NUM_SR_VARIANTS] = {
+   "Sequential Series", "Pipelined Series",
+#ifdef _OPENMP
+   "OpenMP Sequential Series", "OpenMP Pipelined Series",
+#endif
+};
+
+// Number of distinct material ids in the integer test field
+#define NUM_MATERIAL_IDS 6
+
+static const char *probe_cache_name[NUM_PC_VARIANTS] = {
+   "Singlewrite Remap", "Hierarchical Remap", "Compact Hierarchical Remap",
+#ifdef _OPENMP
+   "OpenMP Singlewrite Remap", "OpenMP Hierarchical Remap", "OpenMP Compact Hierarchical Remap",
+#endif
+};
 
 #include "brute_force_remap.h"
 #include "kdtree_remap.h"
 #include "full_perfect_remap.h"
 #include "singlewrite_remap.h"
 #include "hierarchical_remap.h"
+#include "packed_remap.h"
+#include "async_remap.h"
+#include "remap_matrix.h"
+#include "remap_diag.h"
+#include "regrid.h"
+#include "amrex_plotfile.h"
+#include "point_locate.h"
+#include "ray_traverse.h"
+#include "mapped_remap.h"
+#include "inline_hash_remap.h"
+#include "region_remap.h"
+#include "task_remap.h"
+#include "tiled_remap.h"
+#include "stream_remap.h"
+#include "genmalloc/first_touch.h"
 
 #ifdef HAVE_OPENCL
 #include "ezcl/ezcl.h"
@@ -66,6 +365,19 @@ enum meshgen_type {
 void handle_signal(int signal);
 #endif
 
+double stream_copy_bandwidth(void);
+double solver_work(cell_list cells);
+double sine_cell_average(uint i, uint j, uint lev, uint ibasesize);
+double l1_error_sine(cell_list cells);
+uint regrid_balance_violations(cell_list cells);
+void task_remap_variant(int v, cell_list icells, cell_list ocells, task_pool *pool);
+void stream_remap_series(const char *list_file, const char *component, float threshold, int target_ncells,
+                         uint num_rep, const char *outdir, int run_tests);
+
+template <class Op>
+void remap_reduce_op(const char *name, cell_list icells, const typename Op::value_type *ivalues, cell_list ocells,
+                     int run_brute, int run_tests, double tol, double *kernel_time);
+
 int TILE_SIZE = 128;
 intintHash_Factory *factory;
 intintHash_Factory *OpenMPfactory;
@@ -73,6 +385,7 @@ intintHash_Factory *CLFactory;
 
 double sparsity = 0.1;
 uint min_base_size = 2;
+int solver_sweeps = 20;
 
 struct timeval timer;
 
@@ -102,17 +415,57 @@ int main (int argc, char** argv) {
     int run_brute = 1;
     int run_tree = 1;
     int run_tests = 1;
+    int run_probe_cache = 0;
+    int run_lazy_zero = 0;
+    int run_rowfill = 0;
+    int run_reduce_ops = 0;
+    int run_packed = 0;
+    int run_value_types = 0;
+    int run_async = 0;
+    int run_matrix = 0;
+    int run_diag = 0;
+    int run_second_order = 0;
+    int run_regrid = 0;
+    int run_locate = 0;
+    uint locate_npoints = 1000000;
+    int run_rays = 0;
+    uint ray_count = 100000;
+    int run_mapped = 0;
+    int run_inline = 0;
+    int run_chain = 0;
+    int run_region = 0;
+    int run_task = 0;
+    int run_tiled = 0;
+    int numa_policy = FIRST_TOUCH_BLOCK;
+    int huge_pages = 0;
+    double region_percent = 5.0;
+    uint mapped_base = 0;
+    double mapped_offset_i = 0.0, mapped_offset_j = 0.0;
+    int run_inline_large = 0;
+    uint inline_large_cells = 0;
+    uint batch_npatches = 0;
+    uint batch_patch_cells = 1000;
+    uint matrix_nfields = 4;
     int plot_file_bool = 0;
     char *plot_file;
     int meshgen = HIERARCHICAL_MESHGEN;
+    char *stream_outdir = NULL;
     if (argc < 6) {
-       printf("Usage -- ./AMR_remap <i_level_diff> <ilength> <o_level_diff> <olength> <num_rep> [-no-brute,-no-test,-no-tree,-plot-file]\n");
+       printf("Usage -- ./AMR_remap <i_level_diff> <ilength> <o_level_diff> <olength> <num_rep> [-no-brute,-no-test,-no-tree,-plot-file,-probe-cache,-lazy-zero,-rowfill,-reduce-ops,-packed,-value-types,-async-pipeline,-remap-matrix,-batch-patches,-diagnostics,-second-order,-regrid,-point-locate,-ray-trace,-mapped-remap,-inline-hash,-inline-cells,-chain-remap,-region-remap,-numa-policy,-huge-pages,-task-remap,-tiled-remap,-stream-remap,-stream-output]\n");
        printf("   or\n");
-       printf("Usage -- ./AMR_remap_openMP <i_level_diff> <ilength> <o_level_diff> <olength> <num_rep> [-no-brute,-no-test,-no-tree,-plot-file]\n");
+       printf("Usage -- ./AMR_remap_openMP <i_level_diff> <ilength> <o_level_diff> <olength> <num_rep> [-no-brute,-no-test,-no-tree,-plot-file,-probe-cache,-lazy-zero,-rowfill,-reduce-ops,-packed,-value-types,-async-pipeline,-remap-matrix,-batch-patches,-diagnostics,-second-order,-regrid,-point-locate,-ray-trace,-mapped-remap,-inline-hash,-inline-cells,-chain-remap,-region-remap,-numa-policy,-huge-pages,-task-remap,-tiled-remap,-stream-remap,-stream-output]\n");
        printf("   Alternate mesh generation usage:\n");
-       printf("Usage -- ./AMR_remap <size_base_mesh> <levmax> <refine_threshold> 0 <num_rep> -adapt-meshgen [-no-brute,-no-test,-no-tree,-plot-file]\n");
+       printf("Usage -- ./AMR_remap <size_base_mesh> <levmax> <refine_threshold> 0 <num_rep> -adapt-meshgen [-no-brute,-no-test,-no-tree,-plot-file,-probe-cache,-lazy-zero,-rowfill,-reduce-ops,-packed,-value-types,-async-pipeline,-remap-matrix,-batch-patches,-diagnostics,-second-order,-regrid,-point-locate,-ray-trace,-mapped-remap,-inline-hash,-inline-cells,-chain-remap,-region-remap,-numa-policy,-huge-pages,-task-remap,-tiled-remap,-stream-remap,-stream-output]\n");
+       printf("   or\n");
+       printf("Usage -- ./AMR_remap_openMP <size_base_mesh> <levmax> <refine_threshold> 0 <num_rep> -adapt-meshgen [-no-brute,-no-test,-no-tree,-plot-file,-probe-cache,-lazy-zero,-rowfill,-reduce-ops,-packed,-value-types,-async-pipeline,-remap-matrix,-batch-patches,-diagnostics,-second-order,-regrid,-point-locate,-ray-trace,-mapped-remap,-inline-hash,-inline-cells,-chain-remap,-region-remap,-numa-policy,-huge-pages,-task-remap,-tiled-remap,-stream-remap,-stream-output]\n");
+       printf("   Input mesh from an AMReX plotfile, output mesh from the adaptive mesh generator:\n");
+       printf("Usage -- ./AMR_remap <plotfile_dir> <component> <refine_threshold> 0 <num_rep> -amrex-plotfile [-no-brute,-no-test,-no-tree,-plot-file,-probe-cache,-lazy-zero,-rowfill,-reduce-ops,-packed,-value-types,-async-pipeline,-remap-matrix,-batch-patches,-diagnostics,-second-order,-regrid,-point-locate,-ray-trace,-mapped-remap,-inline-hash,-inline-cells,-chain-remap,-region-remap,-numa-policy,-huge-pages,-task-remap,-tiled-remap,-stream-remap,-stream-output]\n");
        printf("   or\n");
-       printf("Usage -- ./AMR_remap_openMP <size_base_mesh> <levmax> <refine_threshold> 0 <num_rep> -adapt-meshgen [-no-brute,-no-test,-no-tree,-plot-file]\n");
+       printf("Usage -- ./AMR_remap_openMP <plotfile_dir> <component> <refine_threshold> 0 <num_rep> -amrex-plotfile [-no-brute,-no-test,-no-tree,-plot-file,-probe-cache,-lazy-zero,-rowfill,-reduce-ops,-packed,-value-types,-async-pipeline,-remap-matrix,-batch-patches,-diagnostics,-second-order,-regrid,-point-locate,-ray-trace,-mapped-remap,-inline-hash,-inline-cells,-chain-remap,-region-remap,-numa-policy,-huge-pages,-task-remap,-tiled-remap,-stream-remap,-stream-output]\n");
+       printf("   Series of AMReX plotfiles, one per line of the list file, remapped onto one generated output mesh:\n");
+       printf("Usage -- ./AMR_remap <list_file> <component> <refine_threshold> 0 <num_rep> -stream-remap [-no-test,-stream-output <dir>]\n");
+       printf("   or\n");
+       printf("Usage -- ./AMR_remap_openMP <list_file> <component> <refine_threshold> 0 <num_rep> -stream-remap [-no-test,-stream-output <dir>]\n");
        exit(-1);
     }
     if (argc>6){
@@ -135,6 +488,16 @@ int main (int argc, char** argv) {
             if (strcmp(arg,"-adapt-meshgen")==0){
                 meshgen = ADAPT_MESHGEN;
             } else
+            if (strcmp(arg,"-amrex-plotfile")==0){
+                meshgen = PLOTFILE_MESHGEN;
+            } else
+            if (strcmp(arg,"-stream-remap")==0){
+                meshgen = STREAM_MESHGEN;
+            } else
+            if (strcmp(arg,"-stream-output")==0){
+                i++;
+                stream_outdir = argv[i];
+            } else
             if (strcmp(arg,"-sparsity")==0){
                 i++;
                 sparsity = atof(argv[i]);
@@ -143,10 +506,128 @@ int main (int argc, char** argv) {
                 i++;
                 min_base_size = atof(argv[i]);
             } else
+            if (strcmp(arg,"-probe-cache")==0){
+                run_probe_cache = 1;
+            } else
+            if (strcmp(arg,"-lazy-zero")==0){
+                run_lazy_zero = 1;
+            } else
+            if (strcmp(arg,"-rowfill")==0){
+                run_rowfill = 1;
+            } else
+            if (strcmp(arg,"-reduce-ops")==0){
+                run_reduce_ops = 1;
+            } else
+            if (strcmp(arg,"-packed")==0){
+                run_packed = 1;
+            } else
+            if (strcmp(arg,"-value-types")==0){
+                run_value_types = 1;
+            } else
+            if (strcmp(arg,"-async-pipeline")==0){
+                run_async = 1;
+            } else
+            if (strcmp(arg,"-remap-matrix")==0){
+                run_matrix = 1;
+            } else
+            if (strcmp(arg,"-second-order")==0){
+                run_second_order = 1;
+            } else
+            if (strcmp(arg,"-regrid")==0){
+                run_regrid = 1;
+            } else
+            if (strcmp(arg,"-point-locate")==0){
+                run_locate = 1;
+            } else
+            if (strcmp(arg,"-locate-points")==0){
+                i++;
+                locate_npoints = atoi(argv[i]);
+            } else
+            if (strcmp(arg,"-ray-trace")==0){
+                run_rays = 1;
+            } else
+            if (strcmp(arg,"-rays")==0){
+                i++;
+                ray_count = atoi(argv[i]);
+            } else
+            if (strcmp(arg,"-inline-hash")==0){
+                run_inline = 1;
+            } else
+            if (strcmp(arg,"-inline-cells")==0){
+                i++;
+                run_inline_large = 1;
+                inline_large_cells = atoi(argv[i]);
+            } else
+            if (strcmp(arg,"-chain-remap")==0){
+                run_chain = 1;
+            } else
+            if (strcmp(arg,"-region-remap")==0){
+                run_region = 1;
+            } else
+            if (strcmp(arg,"-task-remap")==0){
+                run_task = 1;
+            } else
+            if (strcmp(arg,"-tiled-remap")==0){
+                run_tiled = 1;
+            } else
+            if (strcmp(arg,"-region-percent")==0){
+                i++;
+                region_percent = atof(argv[i]);
+            } else
+            if (strcmp(arg,"-mapped-remap")==0){
+                run_mapped = 1;
+            } else
+            if (strcmp(arg,"-mapped-base")==0){
+                i++;
+                mapped_base = atoi(argv[i]);
+            } else
+            if (strcmp(arg,"-mapped-offset")==0){
+                mapped_offset_i = atof(argv[i+1]);
+                mapped_offset_j = atof(argv[i+2]);
+                i += 2;
+            } else
+            if (strcmp(arg,"-diagnostics")==0){
+                run_diag = 1;
+            } else
+            if (strcmp(arg,"-matrix-fields")==0){
+                i++;
+                matrix_nfields = atoi(argv[i]);
+            } else
+            if (strcmp(arg,"-batch-patches")==0){
+                i++;
+                batch_npatches = atoi(argv[i]);
+            } else
+            if (strcmp(arg,"-patch-cells")==0){
+                i++;
+                batch_patch_cells = atoi(argv[i]);
+            } else
+            if (strcmp(arg,"-solver-sweeps")==0){
+                i++;
+                solver_sweeps = atoi(argv[i]);
+            } else
+            if (strcmp(arg,"-numa-policy")==0){
+                i++;
+                if (strcmp(argv[i],"none")==0) {
+                    numa_policy = FIRST_TOUCH_NONE;
+                } else if (strcmp(argv[i],"interleave")==0) {
+                    numa_policy = FIRST_TOUCH_INTERLEAVE;
+                } else {
+                    numa_policy = FIRST_TOUCH_BLOCK;
+                }
+            } else
+            if (strcmp(arg,"-huge-pages")==0){
+                huge_pages = 1;
+            } else
             printf ("Invalid Argument: %s\n", arg);
         }
     }
 
+#ifndef _OPENMP
+    // the placement is only for the OpenMP copies of the meshes
+    (void)numa_policy;
+    (void)huge_pages;
+#endif
+
 #ifdef _OPENMP
    int nt = 0;
    int tid = 0;
@@ -164,31 +645,189 @@ int main (int argc, char** argv) {
 #pragma omp master
       printf("--- num openmp threads in parallel region: %d\n", nt);
    }
+   printf("--- first touch policy: %s%s\n", first_touch_policy_name(numa_policy), huge_pages ? " with huge pages" : "");
 #endif
 
     //uint num_divisions1 = atoi (argv[1]);
     //uint num_divisions2 = atoi (argv[2]);
     uint num_rep = atoi (argv[5]);
+
+    // The series mode sets up its own meshes and has its own report
+    if (meshgen == STREAM_MESHGEN) {
+        stream_remap_series(argv[1], argv[2], atof(argv[3]), atoi(argv[4]), num_rep, stream_outdir, run_tests);
+        return 0;
+    }
     //uint num_divisions1 = 3;
     //uint num_divisions2 = 3;
     //int num_rep = 1;
     //int target_level;
 
     double full_perfect_remap_time = 0.0;
+    double rowfill_perfect_remap_time = 0.0;
+    double rowfill_fill_time = 0.0;
+    double rowfill_fill_bytes = 0.0;
     double singlewrite_remap_time = 0.0;
+    double lazy_singlewrite_remap_time = 0.0;
     double compact_singlewrite_remap_time = 0.0;
     double h_remap_time = 0.0;
     double compact_h_remap_time = 0.0;
+    double inline_remap_time = 0.0;
+    size_t inline_ncells = 0;
 #ifdef _OPENMP
     double full_perfect_remap_openMP_time = 0.0;
+    double rowfill_perfect_remap_openMP_time = 0.0;
+    double rowfill_fill_openMP_time = 0.0;
     double singlewrite_remap_openMP_time = 0.0;
+    double lazy_singlewrite_remap_openMP_time = 0.0;
     double compact_singlewrite_remap_openMP_time = 0.0;
     double h_remap_openMP_time = 0.0;
     double compact_h_remap_openMP_time = 0.0;
+    double inline_remap_openMP_time = 0.0;
 #endif
     double brute_force_time = 0.0;
     double kd_tree_time = 0.0;
 
+    double probe_cache_time[NUM_CELL_ORDERS][NUM_PC_VARIANTS];
+    double probe_nocache_time[NUM_CELL_ORDERS][NUM_PC_VARIANTS];
+    size_t probe_cache_hits[NUM_CELL_ORDERS][NUM_PC_VARIANTS];
+    size_t probe_cache_queries = 0;
+
+    double reduce_op_time[NUM_REDUCE_OPS][NUM_REDUCE_KERNELS];
+    for (int op = 0; op < NUM_REDUCE_OPS; op++) {
+        for (int k = 0; k < NUM_REDUCE_KERNELS; k++) {
+            reduce_op_time[op][k] = 0.0;
+        }
+    }
+    double value_type_time[NUM_VALUE_TYPES][NUM_REDUCE_KERNELS];
+    for (int vt = 0; vt < NUM_VALUE_TYPES; vt++) {
+        for (int k = 0; k < NUM_REDUCE_KERNELS; k++) {
+            value_type_time[vt][k] = 0.0;
+        }
+    }
+    double pack_time = 0.0;
+    double matrix_build_time = 0.0;
+    double matrix_apply_time = 0.0;
+#ifdef _OPENMP
+    double matrix_apply_openMP_time = 0.0;
+#endif
+    size_t matrix_nnz = 0;
+    double first_order_time = 0.0;
+    double second_order_time = 0.0;
+#ifdef _OPENMP
+    double first_order_openMP_time = 0.0;
+    double second_order_openMP_time = 0.0;
+#endif
+    double first_order_l1 = 0.0;
+    double second_order_l1 = 0.0;
+    double plotfile_read_time = 0.0;
+    size_t plotfile_ncells = 0;
+#ifdef _OPENMP
+    double plotfile_read_openMP_time = 0.0;
+#endif
+    double locate_time[NUM_PL_VARIANTS];
+    for (int v = 0; v < NUM_PL_VARIANTS; v++) {
+        locate_time[v] = 0.0;
+    }
+    double locate_hash_build_time = 0.0;
+    double locate_compact_build_time = 0.0;
+    double locate_tree_build_time = 0.0;
+    double ray_time = 0.0;
+    double ray_fresh_time = 0.0;
+#ifdef _OPENMP
+    double ray_openMP_time = 0.0;
+#endif
+    size_t ray_nsegments = 0;
+    double mapped_aligned_time = 0.0;
+    double mapped_identity_time = 0.0;
+    double mapped_time[NUM_MR_VARIANTS];
+    for (int v = 0; v < NUM_MR_VARIANTS; v++) {
+        mapped_time[v] = 0.0;
+    }
+    size_t mapped_ncells = 0;
+    uint mapped_obase = 0;
+    // the first step of a chain, which builds its input tables, is timed
+    // apart from the later ones
+    double chain_first_time[NUM_CH_VARIANTS];
+    double chain_time[NUM_CH_VARIANTS];
+    double chain_rebuild_first_time[NUM_CH_VARIANTS];
+    double chain_rebuild_time[NUM_CH_VARIANTS];
+    for (int v = 0; v < NUM_CH_VARIANTS; v++) {
+        chain_first_time[v] = 0.0;
+        chain_time[v] = 0.0;
+        chain_rebuild_first_time[v] = 0.0;
+        chain_rebuild_time[v] = 0.0;
+    }
+    double region_full_time = 0.0;
+    double region_time[NUM_RI_VARIANTS];
+    double region_index_time[NUM_RI_VARIANTS];
+    for (int v = 0; v < NUM_RI_VARIANTS; v++) {
+        region_time[v] = 0.0;
+        region_index_time[v] = 0.0;
+    }
+    size_t region_ncells = 0;
+    size_t region_total_ncells = 0;
+    uint task_max_threads = (uint)sysconf(_SC_NPROCESSORS_ONLN);
+#ifdef _OPENMP
+    task_max_threads = omp_get_max_threads();
+#endif
+    uint task_threads[TASK_MAX_STEPS];
+    int task_nsteps = 0;
+    for (uint nt = 1; nt < task_max_threads && task_nsteps < TASK_MAX_STEPS-1; nt *= 2) {
+        task_threads[task_nsteps++] = nt;
+    }
+    task_threads[task_nsteps++] = task_max_threads;
+    double task_time[TASK_MAX_STEPS][NUM_TK_VARIANTS];
+#ifdef _OPENMP
+    double task_nested_time[NUM_TK_VARIANTS];
+#endif
+    double tiled_time[NUM_TILED_ORDERS][NUM_TL_VARIANTS];
+    for (int order = 0; order < NUM_TILED_ORDERS; order++) {
+        for (int v = 0; v < NUM_TL_VARIANTS; v++) {
+            tiled_time[order][v] = 0.0;
+        }
+    }
+    for (int v = 0; v < NUM_TK_VARIANTS; v++) {
+        for (int s = 0; s < TASK_MAX_STEPS; s++) {
+            task_time[s][v] = 0.0;
+        }
+#ifdef _OPENMP
+        task_nested_time[v] = 0.0;
+#endif
+    }
+    double regrid_time = 0.0;
+#ifdef _OPENMP
+    double regrid_openMP_time = 0.0;
+#endif
+    size_t regrid_ncells = 0;
+    uint regrid_sweeps = 0;
+    double diag_plain_time[NUM_DG_VARIANTS];
+    double diag_fused_time[NUM_DG_VARIANTS];
+    double diag_sweep_time[NUM_DG_VARIANTS];
+    double diag_max_error[NUM_DG_VARIANTS];
+    for (int v = 0; v < NUM_DG_VARIANTS; v++) {
+        diag_plain_time[v] = 0.0;
+        diag_fused_time[v] = 0.0;
+        diag_sweep_time[v] = 0.0;
+        diag_max_error[v]  = 0.0;
+    }
+
+    // Meshes saved from each run for the asynchronous pipeline benchmark
+    uint pipe_nsteps = 0;
+    cell_list *pipe_icells = (cell_list *)malloc(num_rep*sizeof(cell_list));
+    cell_list *pipe_ocells = (cell_list *)malloc(num_rep*sizeof(cell_list));
+    double **pipe_answer   = (double **)  malloc(num_rep*sizeof(double *));
+    double packed_time[NUM_PK_VARIANTS];
+    for (int v = 0; v < NUM_PK_VARIANTS; v++) {
+        packed_time[v] = 0.0;
+    }
+    for (int order = 0; order < NUM_CELL_ORDERS; order++) {
+        for (int v = 0; v < NUM_PC_VARIANTS; v++) {
+            probe_cache_time[order][v] = 0.0;
+            probe_nocache_time[order][v] = 0.0;
+            probe_cache_hits[order][v] = 0;
+        }
+    }
+
 #ifdef HAVE_OPENCL
     double gpu_full_perfect_remap_time = 0.0; 
     double gpu_singlewrite_remap_time = 0.0; 
@@ -377,6 +1016,60 @@ int main (int argc, char** argv) {
            ocells_openmp.levmax    = levmax;
 #endif
 
+        } else if (meshgen == PLOTFILE_MESHGEN){
+           // The input mesh and its values come from the plotfile; the
+           // output mesh is generated on the same base mesh and levels
+           float threshold = atof (argv[3]);
+           int target_ncells = atoi (argv[4]);
+
+           cpu_timer_start(&timer);
+           icells = read_amrex_plotfile(argv[1], argv[2]);
+           plotfile_read_time += cpu_timer_stop(timer);
+           if (icells.ncells == 0) {
+                printf("Could not read AMReX plotfile %s. Exiting.\n", argv[1]);
+                exit(-1);
+           }
+#ifdef _OPENMP
+           cpu_timer_start(&timer);
+           cell_list pcells = read_amrex_plotfile_openMP(argv[1], argv[2]);
+           plotfile_read_openMP_time += cpu_timer_stop(timer);
+           if (run_tests) {
+                if (pcells.ncells != icells.ncells) {
+                    printf("OpenMP AMReX Plotfile Read failed\nExpected %u cells, but found %u\n", icells.ncells, pcells.ncells);
+                } else {
+                    check_output("OpenMP AMReX Plotfile Read", icells.ncells, pcells.values, icells.values);
+                }
+           }
+           destroy(pcells);
+           free(pcells.dist);
+#endif
+           mesh_size = icells.ibasesize;
+           levmax = icells.levmax;
+           sum_ncells += icells.ncells;
+           plotfile_ncells += icells.ncells;
+
+           ocells = adaptiveMeshConstructorWij(ocells, mesh_size, levmax, threshold, target_ncells);
+           sum_ncells += ocells.ncells;
+
+           size_t num_fine_cells = (size_t)mesh_size*(size_t)two_to_the(levmax)*(size_t)mesh_size*(size_t)two_to_the(levmax);;
+           save_num_fine_cells = num_fine_cells;
+
+           printf("         %f",(float)(num_fine_cells-icells.ncells)/(float)num_fine_cells*100.0);
+           printf("         %f",(float)num_fine_cells/(float)icells.ncells);
+
+           printf("         %f",(float)(num_fine_cells-ocells.ncells)/(float)num_fine_cells*100.0);
+           printf("         %f",(float)num_fine_cells/(float)ocells.ncells);
+           printf("\n");
+
+#ifdef _OPENMP
+           icells_openmp.ncells    = icells.ncells;
+           icells_openmp.ibasesize = mesh_size;
+           icells_openmp.levmax    = levmax;
+
+           ocells_openmp.ncells    = ocells.ncells;
+           ocells_openmp.ibasesize = mesh_size;
+           ocells_openmp.levmax    = levmax;
+#endif
         }
         
         double *val_test         = NULL;
@@ -386,8 +1079,10 @@ int main (int argc, char** argv) {
 
         double *val_test_answer  = NULL;
     
-        for (uint n = 0; n < icells.ncells; n++) {
-            icells.values[n] = rand () % 100;
+        if (meshgen != PLOTFILE_MESHGEN) {
+            for (uint n = 0; n < icells.ncells; n++) {
+                icells.values[n] = rand () % 100;
+            }
         }
 /*        print_cell_list(icells, ilength);*/
 /*        printf("\n\n");*/
@@ -450,6 +1145,21 @@ int main (int argc, char** argv) {
             check_output("Full Perfect Remap", olength, ocells.values, val_test_answer);
         }
 
+// Row-fill Full Perfect Remap
+
+        if (run_rowfill) {
+            double fill_time = 0.0;
+            memset(ocells.values, 0xFFFFFFFF, olength*sizeof(double));
+
+            cpu_timer_start(&timer);
+            full_perfect_remap_rowfill (icells, ocells, &fill_time);
+            rowfill_perfect_remap_time += cpu_timer_stop(timer);
+            rowfill_fill_time += fill_time;
+            rowfill_fill_bytes += (double)icells.ibasesize*icells.ibasesize*four_to_the(icells.levmax)*sizeof(uint);
+
+            if (run_tests) check_output("Row-fill Full Perfect Remap", olength, ocells.values, val_test_answer);
+        }
+
         ocells.values = val_test;
 
 // Single-write Remap
@@ -461,6 +1171,18 @@ int main (int argc, char** argv) {
         singlewrite_remap_time += cpu_timer_stop(timer);
 
         if (run_tests) check_output("Single-write Remap", olength, ocells.values, val_test_answer);
+
+// Lazy-zero Single-write Remap
+
+        if (run_lazy_zero) {
+            memset(ocells.values,  0xFFFFFFFF, olength*sizeof(double));
+
+            cpu_timer_start(&timer);
+            singlewrite_remap_lazy (icells, ocells);
+            lazy_singlewrite_remap_time += cpu_timer_stop(timer);
+
+            if (run_tests) check_output("Lazy-zero Single-write Remap", olength, ocells.values, val_test_answer);
+        }
         
 // Hierarchical Remap
         
@@ -492,21 +1214,31 @@ int main (int argc, char** argv) {
         compact_h_remap_time += cpu_timer_stop(timer);
 
         if (run_tests) check_output("Compact Hierarchical Remap", olength, ocells.values, val_test_answer);
+
+// Value-inlined Compact Single-write Remap
+
+        if (run_inline && ! inline_hash_keys_fit(icells.ibasesize, icells.levmax)) {
+            printf("Skipping the value-inlined remap, the keys of the input mesh do not fit a uint\n");
+        } else if (run_inline) {
+            memset(ocells.values,  0xFFFFFFFF, olength*sizeof(double));
+
+            cpu_timer_start(&timer);
+            singlewrite_remap_inline (icells, ocells);
+            inline_remap_time += cpu_timer_stop(timer);
+            inline_ncells += icells.ncells;
+
+            if (run_tests) check_output("Value-inlined Single-write Remap", olength, ocells.values, val_test_answer);
+        }
         
 
 #ifdef _OPENMP
 
-// Setup for OpenMP to get memory aligned with processors
+// Setup for OpenMP, the copies are placed with the -numa-policy for the
+// static split of the remap loops
 
-        icells_openmp.i      = (uint *)  malloc(ilength*sizeof(uint));
-        icells_openmp.j      = (uint *)  malloc(ilength*sizeof(uint));
-        icells_openmp.level  = (uint *)  malloc(ilength*sizeof(uint));
-        icells_openmp.values = (double *)malloc(ilength*sizeof(double));
-
-        ocells_openmp.i      = (uint *)  malloc(olength*sizeof(uint));
-        ocells_openmp.j      = (uint *)  malloc(olength*sizeof(uint));
-        ocells_openmp.level  = (uint *)  malloc(olength*sizeof(uint));
-        ocells_openmp.values = (double *)malloc(olength*sizeof(double));
+        int placement = numa_policy | (huge_pages ? FIRST_TOUCH_HUGE_PAGES : 0);
+        icells_openmp = create_cell_list_placed(icells_openmp, ilength, placement);
+        ocells_openmp = create_cell_list_placed(ocells_openmp, olength, placement);
 
 #pragma omp parallel default(none) firstprivate(ilength, olength) shared(icells_openmp, ocells_openmp, icells, ocells)
         {
@@ -543,6 +1275,27 @@ int main (int argc, char** argv) {
         full_perfect_remap_openMP_time += cpu_timer_stop(timer);
 
         if (run_tests) check_output("Full Perfect Remap OpenMP", ocells.ncells, ocells_openmp.values, val_test_answer);
+
+// Row-fill Full Perfect Remap OpenMP
+
+        if (run_rowfill) {
+           double fill_time = 0.0;
+#pragma omp parallel default(none) firstprivate(ilength, olength) shared(icells_openmp, ocells_openmp, icells, ocells)
+           {
+
+#pragma omp for
+              for (uint ic=0; ic < olength; ic++){
+                 ocells_openmp.values[ic] = -1;
+              }
+           }
+
+           cpu_timer_start(&timer);
+           full_perfect_remap_rowfill_openMP (icells_openmp, ocells_openmp, &fill_time);
+           rowfill_perfect_remap_openMP_time += cpu_timer_stop(timer);
+           rowfill_fill_openMP_time += fill_time;
+
+           if (run_tests) check_output("Row-fill Full Perfect Remap OpenMP", ocells.ncells, ocells_openmp.values, val_test_answer);
+        }
         
 // Single-write Remap OpenMP
 
@@ -560,6 +1313,25 @@ int main (int argc, char** argv) {
         singlewrite_remap_openMP_time += cpu_timer_stop(timer);
 
         if (run_tests) check_output("Single-write Remap OpenMP", ocells.ncells, ocells_openmp.values, val_test_answer);
+
+// Lazy-zero Single-write Remap OpenMP
+
+        if (run_lazy_zero) {
+#pragma omp parallel default(none) firstprivate(ilength, olength) shared(icells_openmp, ocells_openmp, icells, ocells)
+           {
+
+#pragma omp for
+              for (uint ic=0; ic < olength; ic++){
+                 ocells_openmp.values[ic] = -1;
+              }
+           }
+
+           cpu_timer_start(&timer);
+           singlewrite_remap_lazy_openMP (icells_openmp, ocells_openmp);
+           lazy_singlewrite_remap_openMP_time += cpu_timer_stop(timer);
+
+           if (run_tests) check_output("Lazy-zero Single-write Remap OpenMP", ocells.ncells, ocells_openmp.values, val_test_answer);
+        }
         
 // Hierarchical Remap OpenMP
 
@@ -612,6 +1384,21 @@ int main (int argc, char** argv) {
 
         if (run_tests) check_output("Compact Hierarchical Remap OpenMP", olength, ocells_openmp.values, val_test_answer);
 
+// Value-inlined Compact Single-write Remap OpenMP
+
+        if (run_inline && inline_hash_keys_fit(icells.ibasesize, icells.levmax)) {
+#pragma omp parallel for
+           for (uint ic=0; ic < olength; ic++){
+              ocells_openmp.values[ic] = -1;
+           }
+
+           cpu_timer_start(&timer);
+           singlewrite_remap_inline_openMP (icells_openmp, ocells_openmp);
+           inline_remap_openMP_time += cpu_timer_stop(timer);
+
+           if (run_tests) check_output("Value-inlined Single-write Remap OpenMP", olength, ocells_openmp.values, val_test_answer);
+        }
+
         free(icells_openmp.i);
         free(icells_openmp.j);
         free(icells_openmp.level);
@@ -671,22 +1458,1169 @@ int main (int argc, char** argv) {
         
 #endif
 
-        if (run_brute)  free(val_test_brute);
-        if (run_tree)   free(val_test_kdtree);
-        free(val_test_perfect);
+// Probe Cache Remaps on row-major, Morton and shuffled output orderings
+
+        if (run_probe_cache) {
+            cell_list ocells_order;
+            ocells_order.ibasesize = ocells.ibasesize;
+            ocells_order.levmax    = ocells.levmax;
+            ocells_order = create_cell_list(ocells_order, olength);
+            memcpy(ocells_order.i,     ocells.i,     olength*sizeof(uint));
+            memcpy(ocells_order.j,     ocells.j,     olength*sizeof(uint));
+            memcpy(ocells_order.level, ocells.level, olength*sizeof(uint));
+            double *val_order_test   = ocells_order.values;
+            double *val_order_answer = (double *)malloc(olength*sizeof(double));
+            probe_cache_queries += olength;
+
+            for (int order = 0; order < NUM_CELL_ORDERS; order++) {
+                if (order == ROW_MAJOR_ORDER) {
+                    sort_cell_list_rowmajor(ocells_order);
+                } else if (order == MORTON_ORDER) {
+                    sort_cell_list_morton(ocells_order);
+                } else {
+                    shuffle_cell_list(ocells_order, olength);
+                }
+
+                for (int v = 0; v < NUM_PC_VARIANTS; v++) {
+                    uint nhits = 0;
+
+                    ocells_order.values = val_order_answer;
+                    memset(ocells_order.values, 0xFFFFFFFF, olength*sizeof(double));
+                    cpu_timer_start(&timer);
+                    switch (v) {
+                    case PC_SINGLEWRITE:          singlewrite_remap(icells, ocells_order);                    break;
+                    case PC_HIERARCHICAL:         h_remap(icells, ocells_order);                              break;
+                    case PC_COMPACT_HIERARCHICAL: h_remap_compact(icells, ocells_order, factory);             break;
+#ifdef _OPENMP
+                    case PC_SINGLEWRITE_OPENMP:   singlewrite_remap_openMP(icells, ocells_order);             break;
+                    case PC_HIERARCHICAL_OPENMP:  h_remap_openMP(icells, ocells_order);                       break;
+                    case PC_COMPACT_HIERARCHICAL_OPENMP: h_remap_compact_openMP(icells, ocells_order, OpenMPfactory); break;
+#endif
+                    }
+                    probe_nocache_time[order][v] += cpu_timer_stop(timer);
+
+                    ocells_order.values = val_order_test;
+                    memset(ocells_order.values, 0xFFFFFFFF, olength*sizeof(double));
+                    cpu_timer_start(&timer);
+                    switch (v) {
+                    case PC_SINGLEWRITE:          singlewrite_remap_cached(icells, ocells_order, &nhits);        break;
+                    case PC_HIERARCHICAL:         h_remap_cached(icells, ocells_order, &nhits);                  break;
+                    case PC_COMPACT_HIERARCHICAL: h_remap_compact_cached(icells, ocells_order, factory, &nhits); break;
+#ifdef _OPENMP
+                    case PC_SINGLEWRITE_OPENMP:   singlewrite_remap_cached_openMP(icells, ocells_order, &nhits); break;
+                    case PC_HIERARCHICAL_OPENMP:  h_remap_cached_openMP(icells, ocells_order, &nhits);           break;
+                    case PC_COMPACT_HIERARCHICAL_OPENMP: h_remap_compact_cached_openMP(icells, ocells_order, OpenMPfactory, &nhits); break;
+#endif
+                    }
+                    probe_cache_time[order][v] += cpu_timer_stop(timer);
+                    probe_cache_hits[order][v] += nhits;
 
-        destroy(icells);  
-        destroy(ocells);
-    }
+                    if (run_tests) check_output(probe_cache_name[v], olength, val_order_test, val_order_answer);
+                }
+            }
 
-    intintHash_DestroyFactory(factory);
-    intintHash_DestroyFactory(OpenMPfactory);
-    
-    printf("~~~~~~~~~~~~~~~~Averages~~ ~~~~~~~~~~~~~~\n");
-    size_t average_ncells = sum_ncells/num_rep/2;
+            free(val_order_answer);
+            destroy(ocells_order);
+        }
 
-    printf("sparsity percent compressibility    cells in fine mesh average ncells\n");
-    printf("---------------- ---------------      --------------     ----------  \n");
+// Reduction Operator Remaps
+
+        if (run_reduce_ops) {
+            remap_reduce_op<ReduceSum>(reduce_op_name[REDUCE_SUM], icells, icells.values, ocells,
+                run_brute, run_tests, 1.0e-12, reduce_op_time[REDUCE_SUM]);
+            remap_reduce_op<ReduceMin>(reduce_op_name[REDUCE_MIN], icells, icells.values, ocells,
+                run_brute, run_tests, 1.0e-12, reduce_op_time[REDUCE_MIN]);
+            remap_reduce_op<ReduceMax>(reduce_op_name[REDUCE_MAX], icells, icells.values, ocells,
+                run_brute, run_tests, 1.0e-12, reduce_op_time[REDUCE_MAX]);
+            remap_reduce_op<ReduceVolumeWeighted>(reduce_op_name[REDUCE_VOLUME_WEIGHTED], icells, icells.values, ocells,
+                run_brute, run_tests, 1.0e-12, reduce_op_time[REDUCE_VOLUME_WEIGHTED]);
+        }
+
+// Remaps templated on the field value type. The float field is taken to
+// be stored as float already, so only the remap itself is timed.
+
+        if (run_value_types) {
+            float   *ivalues_float = (float *)  malloc(icells.ncells*sizeof(float));
+            int32_t *ivalues_id    = (int32_t *)malloc(icells.ncells*sizeof(int32_t));
+            for (uint ic = 0; ic < icells.ncells; ic++) {
+                ivalues_float[ic] = (float)icells.values[ic];
+                ivalues_id[ic]    = (int32_t)icells.values[ic] % NUM_MATERIAL_IDS;
+            }
+
+            remap_reduce_op<ReduceMean>(value_type_name[VT_DOUBLE_MEAN], icells, icells.values, ocells,
+                run_brute, run_tests, 1.0e-12, value_type_time[VT_DOUBLE_MEAN]);
+            remap_reduce_op<ReduceMeanFloat>(value_type_name[VT_FLOAT_MEAN], icells, ivalues_float, ocells,
+                run_brute, run_tests, 1.0e-6, value_type_time[VT_FLOAT_MEAN]);
+            remap_reduce_op<ReduceMajority>(value_type_name[VT_INT32_MAJORITY], icells, ivalues_id, ocells,
+                run_brute, run_tests, 0.0, value_type_time[VT_INT32_MAJORITY]);
+            remap_reduce_op<ReduceNearest>(value_type_name[VT_INT32_NEAREST], icells, ivalues_id, ocells,
+                run_brute, run_tests, 0.0, value_type_time[VT_INT32_NEAREST]);
+
+            free(ivalues_float);
+            free(ivalues_id);
+        }
+
+// Remaps on the packed level+Morton key encoding
+
+        if (run_packed) {
+            cpu_timer_start(&timer);
+            packed_cell_list ipacked = pack_cell_list(icells);
+            packed_cell_list opacked = pack_cell_list(ocells);
+            pack_time += cpu_timer_stop(timer);
+            int compact_fits = packed_compact_keys_fit(ipacked.ibasesize, ipacked.levmax);
+            if (! compact_fits) {
+                printf("Skipping the compact packed remaps, the padded Morton keys do not fit an int\n");
+            }
+
+            for (int v = 0; v < NUM_PK_VARIANTS; v++) {
+                if (packed_compact[v] && ! compact_fits) continue;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+                for (uint ic = 0; ic < olength; ic++) {
+                    opacked.values[ic] = -1.0;
+                }
+                cpu_timer_start(&timer);
+                switch (v) {
+                case PK_FULL_PERFECT:         full_perfect_remap_packed(ipacked, opacked);            break;
+                case PK_SINGLEWRITE:          singlewrite_remap_packed(ipacked, opacked);             break;
+                case PK_COMPACT_SINGLEWRITE:  singlewrite_remap_compact_packed(ipacked, opacked);     break;
+                case PK_HIERARCHICAL:         h_remap_packed(ipacked, opacked);                       break;
+                case PK_COMPACT_HIERARCHICAL: h_remap_compact_packed(ipacked, opacked, factory);      break;
+#ifdef _OPENMP
+                case PK_FULL_PERFECT_OPENMP:  full_perfect_remap_packed_openMP(ipacked, opacked);     break;
+                case PK_SINGLEWRITE_OPENMP:   singlewrite_remap_packed_openMP(ipacked, opacked);      break;
+                case PK_COMPACT_SINGLEWRITE_OPENMP: singlewrite_remap_compact_packed_openMP(ipacked, opacked); break;
+                case PK_HIERARCHICAL_OPENMP:  h_remap_packed_openMP(ipacked, opacked);                break;
+                case PK_COMPACT_HIERARCHICAL_OPENMP: h_remap_compact_packed_openMP(ipacked, opacked, OpenMPfactory); break;
+#endif
+                }
+                packed_time[v] += cpu_timer_stop(timer);
+
+                if (run_tests) check_output(packed_name[v], olength, opacked.values, val_test_answer);
+            }
+
+            destroy_packed(ipacked);
+            destroy_packed(opacked);
+        }
+
+// Remap as a sparse matrix, built once and applied to several fields. The
+// fields are the input values shifted by the field number, so the answer
+// for field f is the reference answer plus f.
+
+        if (run_matrix) {
+            uint nf = matrix_nfields;
+            double *ifields = (double *)malloc((size_t)icells.ncells*nf*sizeof(double));
+            double *ofields = (double *)malloc((size_t)olength*nf*sizeof(double));
+            double *ocheck  = (double *)malloc(olength*sizeof(double));
+            double *acheck  = (double *)malloc(olength*sizeof(double));
+            for (uint ic = 0; ic < icells.ncells; ic++) {
+                for (uint f = 0; f < nf; f++) {
+                    ifields[(size_t)ic*nf + f] = icells.values[ic] + f;
+                }
+            }
+
+            cpu_timer_start(&timer);
+            remap_matrix rm = remap_matrix_build(icells, ocells);
+            matrix_build_time += cpu_timer_stop(timer);
+            matrix_nnz += rm.nnz;
+
+            for (int v = 0; v < 2; v++) {
+#ifndef _OPENMP
+                if (v == 1) break;
+#endif
+                memset(ofields, 0xFFFFFFFF, (size_t)olength*nf*sizeof(double));
+                cpu_timer_start(&timer);
+                if (v == 0) {
+                    remap_matrix_apply(rm, nf, ifields, ofields);
+                    matrix_apply_time += cpu_timer_stop(timer);
+                } else {
+#ifdef _OPENMP
+                    remap_matrix_apply_openMP(rm, nf, ifields, ofields);
+                    matrix_apply_openMP_time += cpu_timer_stop(timer);
+#endif
+                }
+
+                if (run_tests) {
+                    for (uint f = 0; f < nf; f++) {
+                        for (uint ic = 0; ic < olength; ic++) {
+                            ocheck[ic] = ofields[(size_t)ic*nf + f];
+                            acheck[ic] = val_test_answer[ic] + f;
+                        }
+                        check_output(v == 0 ? "Remap Matrix Apply" : "OpenMP Remap Matrix Apply", olength, ocheck, acheck);
+                    }
+                }
+            }
+
+            remap_matrix_destroy(rm);
+            free(ifields);
+            free(ofields);
+            free(ocheck);
+            free(acheck);
+        }
+
+// Second order remap against the first order hierarchical remap. On the
+// random field it must be conservative; on the cell averages of a smooth
+// field its error must be below first order.
+
+        if (run_second_order) {
+            remap_diag swept;
+
+            cpu_timer_start(&timer);
+            h_remap(icells, ocells);
+            first_order_time += cpu_timer_stop(timer);
+
+            cpu_timer_start(&timer);
+            h_remap_2nd_order(icells, ocells);
+            second_order_time += cpu_timer_stop(timer);
+            remap_diag_sweep(icells, icells.values, ocells, ocells.values, &swept);
+            if (run_tests && remap_diag_rel_error(&swept) > 1.0e-12) {
+                printf("Second Order Hierarchical Remap failed conservation\nRelative error %9.3e\n",
+                    remap_diag_rel_error(&swept));
+            }
+
+#ifdef _OPENMP
+            double *ocheck = (double *)malloc(olength*sizeof(double));
+            memcpy(ocheck, ocells.values, olength*sizeof(double));
+
+            cpu_timer_start(&timer);
+            h_remap_openMP(icells, ocells);
+            first_order_openMP_time += cpu_timer_stop(timer);
+
+            cpu_timer_start(&timer);
+            h_remap_2nd_order_openMP(icells, ocells);
+            second_order_openMP_time += cpu_timer_stop(timer);
+            if (run_tests) check_output("OpenMP Second Order Hierarchical Remap", olength, ocells.values, ocheck);
+            free(ocheck);
+#endif
+
+            double *ivalues_save = icells.values;
+            icells.values = (double *)malloc(icells.ncells*sizeof(double));
+            for (uint ic = 0; ic < icells.ncells; ic++) {
+                icells.values[ic] = sine_cell_average(icells.i[ic], icells.j[ic], icells.level[ic], icells.ibasesize);
+            }
+            h_remap(icells, ocells);
+            double l1_first = l1_error_sine(ocells);
+            h_remap_2nd_order(icells, ocells);
+            double l1_second = l1_error_sine(ocells);
+            first_order_l1  += l1_first;
+            second_order_l1 += l1_second;
+            if (run_tests && l1_second > l1_first) {
+                printf("Second Order Hierarchical Remap failed accuracy\nL1 error %9.3e, first order %9.3e\n",
+                    l1_second, l1_first);
+            }
+            free(icells.values);
+            icells.values = ivalues_save;
+        }
+
+// Point location in the input mesh for random points, through the built
+// hierarchical tables and through a KD-tree queried with point boxes. The
+// walk must land each point in a cell that holds it and every other
+// variant must find the same cells.
+
+        if (run_locate) {
+            double *px = (double *)malloc(locate_npoints*sizeof(double));
+            double *py = (double *)malloc(locate_npoints*sizeof(double));
+            int *pcell     = (int *)malloc(locate_npoints*sizeof(int));
+            int *pcell_ref = (int *)malloc(locate_npoints*sizeof(int));
+            for (uint p = 0; p < locate_npoints; p++) {
+                px[p] = (double)rand()/((double)RAND_MAX + 1.0)*icells.ibasesize;
+                py[p] = (double)rand()/((double)RAND_MAX + 1.0)*icells.ibasesize;
+            }
+
+            cpu_timer_start(&timer);
+            int **h_hash = h_hash_alloc(icells.ibasesize, icells.levmax);
+            h_remap_build(icells, h_hash);
+            locate_hash_build_time += cpu_timer_stop(timer);
+
+            cpu_timer_start(&timer);
+            intintHash_Table **h_hashTable = h_hash_compact_build(icells, factory, LCG_QUADRATIC_OPEN_COMPACT_HASH_ID, 0.3333333);
+            locate_compact_build_time += cpu_timer_stop(timer);
+
+            TKDTree2d tree;
+            if (run_tree) {
+                cpu_timer_start(&timer);
+                kdtree_cell_tree2d(icells, &tree);
+                locate_tree_build_time += cpu_timer_stop(timer);
+            }
+
+            for (int v = 0; v < NUM_PL_VARIANTS; v++) {
+                int *out = (v == PL_WALK) ? pcell_ref : pcell;
+                if (! run_tree && (v == PL_KDTREE
+#ifdef _OPENMP
+                                   || v == PL_KDTREE_OPENMP
+#endif
+                                   )) continue;
+
+                cpu_timer_start(&timer);
+                switch (v) {
+                case PL_KDTREE:                kdtree_locate2d(&tree, icells, locate_npoints, px, py, out);                                  break;
+                case PL_WALK:                  h_locate(icells, h_hash, locate_npoints, px, py, out, 0);                                     break;
+                case PL_SORTED_WALK:           h_locate(icells, h_hash, locate_npoints, px, py, out, H_LOCATE_SORTED);                       break;
+                case PL_COMPACT_WALK:          h_locate_compact(icells, h_hashTable, locate_npoints, px, py, out, H_LOCATE_SORTED);          break;
+                case PL_COMPACT_BISECT:        h_locate_compact(icells, h_hashTable, locate_npoints, px, py, out,
+                                                                H_LOCATE_SORTED | H_LOCATE_BISECT);                                         break;
+#ifdef _OPENMP
+                case PL_KDTREE_OPENMP:         kdtree_locate2d_openMP(&tree, icells, locate_npoints, px, py, out);                           break;
+                case PL_SORTED_WALK_OPENMP:    h_locate_openMP(icells, h_hash, locate_npoints, px, py, out, H_LOCATE_SORTED);                break;
+                case PL_COMPACT_BISECT_OPENMP: h_locate_compact_openMP(icells, h_hashTable, locate_npoints, px, py, out,
+                                                                       H_LOCATE_SORTED | H_LOCATE_BISECT);                                  break;
+#endif
+                }
+                locate_time[v] += cpu_timer_stop(timer);
+
+                if (! run_tests) continue;
+                uint nbad = 0;
+                for (uint p = 0; p < locate_npoints; p++) {
+                    int c = out[p];
+                    if (v == PL_WALK) {
+                        double size = (c < 0) ? 0.0 : 1.0/two_to_the(icells.level[c]);
+                        if (c < 0 || px[p] < icells.i[c]*size || px[p] >= (icells.i[c]+1)*size ||
+                                     py[p] < icells.j[c]*size || py[p] >= (icells.j[c]+1)*size) nbad++;
+                    } else if (c != pcell_ref[p]) {
+                        nbad++;
+                    }
+                }
+                if (nbad > 0) printf("%s Point Location failed for %u of %u points\n", locate_name[v], nbad, locate_npoints);
+            }
+
+            if (run_tree) KDTree_Destroy2d(&tree);
+            h_hash_compact_free(h_hashTable, icells.levmax);
+            h_hash_free(h_hash, icells.levmax);
+            free(px);
+            free(py);
+            free(pcell);
+            free(pcell_ref);
+        }
+
+// Ray traversal through the input mesh for rays from random points in
+// random directions, starting the probe walk for each next cell at the
+// first level it does not share with the current one, against a fresh
+// walk from level 0 at each step. The segments of a ray must be contiguous with the middle of each
+// inside its cell, and every variant must cross the same cells.
+
+        if (run_rays) {
+            double *rox = (double *)malloc(ray_count*sizeof(double));
+            double *roy = (double *)malloc(ray_count*sizeof(double));
+            double *rdx = (double *)malloc(ray_count*sizeof(double));
+            double *rdy = (double *)malloc(ray_count*sizeof(double));
+            for (uint r = 0; r < ray_count; r++) {
+                double angle = 2.0*M_PI*rand()/((double)RAND_MAX + 1.0);
+                rox[r] = (double)rand()/((double)RAND_MAX + 1.0)*icells.ibasesize;
+                roy[r] = (double)rand()/((double)RAND_MAX + 1.0)*icells.ibasesize;
+                rdx[r] = cos(angle);
+                rdy[r] = sin(angle);
+            }
+            double tmax = 2.0*icells.ibasesize;
+
+            int **h_hash = h_hash_alloc(icells.ibasesize, icells.levmax);
+            h_remap_build(icells, h_hash);
+
+            cpu_timer_start(&timer);
+            ray_segments rs = h_ray_traverse(icells, h_hash, ray_count, rox, roy, rdx, rdy, tmax, 0);
+            ray_time += cpu_timer_stop(timer);
+            ray_nsegments += rs.start[ray_count];
+
+            cpu_timer_start(&timer);
+            ray_segments rs_fresh = h_ray_traverse(icells, h_hash, ray_count, rox, roy, rdx, rdy, tmax, H_RAY_FRESH_SEARCH);
+            ray_fresh_time += cpu_timer_stop(timer);
+
+#ifdef _OPENMP
+            cpu_timer_start(&timer);
+            ray_segments rs_openMP = h_ray_traverse_openMP(icells, h_hash, ray_count, rox, roy, rdx, rdy, tmax, 0);
+            ray_openMP_time += cpu_timer_stop(timer);
+#endif
+
+            if (run_tests) {
+                uint nbad = 0;
+                for (uint r = 0; r < ray_count; r++) {
+                    for (uint k = rs.start[r]; k < rs.start[r+1]; k++) {
+                        int c = rs.cell[k];
+                        double size = 1.0/two_to_the(icells.level[c]);
+                        double tmid = 0.5*(rs.t_in[k] + rs.t_out[k]);
+                        double mx = rox[r] + tmid*rdx[r], my = roy[r] + tmid*rdy[r];
+                        double eps = 1.0e-9*icells.ibasesize;
+                        if (rs.t_out[k] < rs.t_in[k] ||
+                            (k > rs.start[r] && rs.t_in[k] != rs.t_out[k-1]) ||
+                            mx < icells.i[c]*size - eps || mx > (icells.i[c]+1)*size + eps ||
+                            my < icells.j[c]*size - eps || my > (icells.j[c]+1)*size + eps) nbad++;
+                    }
+                }
+                if (nbad > 0) printf("Ray Traversal failed for %u segments\n", nbad);
+
+                ray_segments check[2] = {rs_fresh,
+#ifdef _OPENMP
+                                         rs_openMP
+#else
+                                         rs_fresh
+#endif
+                                        };
+                const char *check_name[2] = {"Fresh Search Ray Traversal", "OpenMP Ray Traversal"};
+                for (int v = 0; v < 2; v++) {
+                    if (memcmp(check[v].start, rs.start, (ray_count+1)*sizeof(uint)) != 0 ||
+                        memcmp(check[v].cell, rs.cell, rs.start[ray_count]*sizeof(int)) != 0) {
+                        printf("%s failed\nDifferent cells crossed than the serial traversal\n", check_name[v]);
+                    }
+                }
+            }
+
+#ifdef _OPENMP
+            ray_segments_destroy(rs_openMP);
+#endif
+            ray_segments_destroy(rs_fresh);
+            ray_segments_destroy(rs);
+            h_hash_free(h_hash, icells.levmax);
+            free(rox);
+            free(roy);
+            free(rdx);
+            free(rdy);
+        }
+
+// Remap onto an output mesh with its own base size, 5/4 of the input one
+// unless given, and an optional offset origin. With the identity map it
+// must match the aligned hierarchical remap; onto the mapped mesh it must
+// be conservative when the domains coincide, match the overlap weighted
+// average over all input cells for a sample of output cells, and every
+// variant must give the same values.
+
+        if (run_mapped) {
+            mapped_obase = (mapped_base > 0) ? mapped_base : (5*icells.ibasesize + 3)/4;
+            cell_list mcells;
+            mcells = adaptiveMeshConstructorWij(mcells, mapped_obase, ocells.levmax, 20.0, 0);
+            mapped_ncells += mcells.ncells;
+            h_remap_mapping map = h_remap_mapping_bases(icells.ibasesize, mapped_obase,
+                                                        mapped_offset_i, mapped_offset_j);
+            h_remap_mapping identity = h_remap_mapping_bases(icells.ibasesize, icells.ibasesize, 0.0, 0.0);
+
+            double *ocheck = (double *)malloc(ocells.ncells*sizeof(double));
+            cpu_timer_start(&timer);
+            h_remap(icells, ocells);
+            mapped_aligned_time += cpu_timer_stop(timer);
+            memcpy(ocheck, ocells.values, ocells.ncells*sizeof(double));
+
+            cpu_timer_start(&timer);
+            h_remap_mapped(icells, ocells, identity);
+            mapped_identity_time += cpu_timer_stop(timer);
+            if (run_tests) check_output_rel("Identity Mapped Hierarchical Remap", olength, ocells.values, ocheck, 1.0e-12);
+            free(ocheck);
+
+            double *mcheck = (double *)malloc(mcells.ncells*sizeof(double));
+            for (int v = 0; v < NUM_MR_VARIANTS; v++) {
+                cpu_timer_start(&timer);
+                switch (v) {
+                case MR_MAPPED:         h_remap_mapped(icells, mcells, map);                        break;
+                case MR_COMPACT:        h_remap_mapped_compact(icells, mcells, map, factory);       break;
+#ifdef _OPENMP
+                case MR_MAPPED_OPENMP:  h_remap_mapped_openMP(icells, mcells, map);                 break;
+                case MR_COMPACT_OPENMP: h_remap_mapped_compact_openMP(icells, mcells, map, factory); break;
+#endif
+                }
+                mapped_time[v] += cpu_timer_stop(timer);
+
+                if (v == MR_MAPPED) {
+                    memcpy(mcheck, mcells.values, mcells.ncells*sizeof(double));
+                } else if (run_tests) {
+                    check_output(mapped_name[v], mcells.ncells, mcells.values, mcheck);
+                }
+            }
+
+            if (run_tests && mapped_offset_i == 0.0 && mapped_offset_j == 0.0) {
+                double in_sum = 0.0, out_sum = 0.0;
+                for (uint ic = 0; ic < icells.ncells; ic++) {
+                    in_sum += icells.values[ic]*remap_diag_area(icells.level[ic]);
+                }
+                for (uint ic = 0; ic < mcells.ncells; ic++) {
+                    out_sum += mcheck[ic]*remap_diag_area(mcells.level[ic])*map.scale_i*map.scale_j;
+                }
+                if (fabs(out_sum - in_sum) > 1.0e-10*fabs(in_sum)) {
+                    printf("Mapped Hierarchical Remap failed conservation\nInput integral %lf, output integral %lf\n",
+                        in_sum, out_sum);
+                }
+            }
+
+            if (run_tests) {
+                // overlap weighted average against every input cell for a
+                // sample of the output cells
+                uint nbad = 0;
+                uint stride = (mcells.ncells > 256) ? mcells.ncells/256 : 1;
+                for (uint oc = 0; oc < mcells.ncells; oc += stride) {
+                    double size = 1.0/two_to_the(mcells.level[oc]);
+                    double x0 = map.offset_i + map.scale_i*mcells.i[oc]*size;
+                    double y0 = map.offset_j + map.scale_j*mcells.j[oc]*size;
+                    double x1 = map.offset_i + map.scale_i*(mcells.i[oc]+1)*size;
+                    double y1 = map.offset_j + map.scale_j*(mcells.j[oc]+1)*size;
+                    double sum = 0.0, area = 0.0;
+                    for (uint ic = 0; ic < icells.ncells; ic++) {
+                        double isize = 1.0/two_to_the(icells.level[ic]);
+                        double wx = fmin(x1, (icells.i[ic]+1)*isize) - fmax(x0, icells.i[ic]*isize);
+                        double wy = fmin(y1, (icells.j[ic]+1)*isize) - fmax(y0, icells.j[ic]*isize);
+                        if (wx <= 0.0 || wy <= 0.0) continue;
+                        sum  += icells.values[ic]*wx*wy;
+                        area += wx*wy;
+                    }
+                    double expected = (area > 0.0) ? sum/area : 0.0;
+                    if (fabs(mcheck[oc] - expected) > 1.0e-10*fabs(expected)) nbad++;
+                }
+                if (nbad > 0) printf("Mapped Hierarchical Remap failed overlap average for %u sampled cells\n", nbad);
+            }
+
+            free(mcheck);
+            destroy(mcells);
+        }
+
+// Chain of remaps back and forth between the input and output meshes. Each
+// chained step takes the tables the one before returned instead of building
+// its own, and must give the same values as the compact hierarchical remap,
+// which builds its tables every step.
+
+        if (run_chain) {
+            cell_list chain_mesh[2] = {icells, ocells};
+            double *chain_values[2], *chain_check[2];
+            for (int k = 0; k < 2; k++) {
+                chain_values[k] = (double *)malloc(chain_mesh[k].ncells*sizeof(double));
+                chain_check[k]  = (double *)malloc(chain_mesh[k].ncells*sizeof(double));
+            }
+
+            for (int v = 0; v < NUM_CH_VARIANTS; v++) {
+                memcpy(chain_values[0], icells.values, icells.ncells*sizeof(double));
+                memcpy(chain_check[0],  icells.values, icells.ncells*sizeof(double));
+                intintHash_Table **chain_tables = NULL;
+
+                for (uint step = 0; step < CHAIN_STEPS; step++) {
+                    cell_list src = chain_mesh[step%2];
+                    cell_list dst = chain_mesh[(step+1)%2];
+
+                    src.values = chain_check[step%2];
+                    dst.values = chain_check[(step+1)%2];
+                    cpu_timer_start(&timer);
+                    switch (v) {
+                    case CH_COMPACT:
+                    case CH_COMPACT_FUSED:        h_remap_compact(src, dst, factory);              break;
+#ifdef _OPENMP
+                    case CH_COMPACT_OPENMP:
+                    case CH_COMPACT_FUSED_OPENMP: h_remap_compact_openMP(src, dst, OpenMPfactory); break;
+#endif
+                    }
+                    if (step == 0) {
+                        chain_rebuild_first_time[v] += cpu_timer_stop(timer);
+                    } else {
+                        chain_rebuild_time[v] += cpu_timer_stop(timer);
+                    }
+
+                    src.values = chain_values[step%2];
+                    dst.values = chain_values[(step+1)%2];
+                    cpu_timer_start(&timer);
+                    switch (v) {
+                    case CH_COMPACT:              chain_tables = h_remap_compact_chain(src, chain_tables, dst, factory);                    break;
+                    case CH_COMPACT_FUSED:        chain_tables = h_remap_compact_chain_fused(src, chain_tables, dst, factory);              break;
+#ifdef _OPENMP
+                    case CH_COMPACT_OPENMP:       chain_tables = h_remap_compact_chain_openMP(src, chain_tables, dst, OpenMPfactory);       break;
+                    case CH_COMPACT_FUSED_OPENMP: chain_tables = h_remap_compact_chain_fused_openMP(src, chain_tables, dst, OpenMPfactory); break;
+#endif
+                    }
+                    if (step == 0) {
+                        chain_first_time[v] += cpu_timer_stop(timer);
+                    } else {
+                        chain_time[v] += cpu_timer_stop(timer);
+                    }
+
+                    if (run_tests) check_output(chain_name[v], dst.ncells, dst.values, chain_check[(step+1)%2]);
+                }
+                h_hash_compact_free(chain_tables, chain_mesh[CHAIN_STEPS%2].levmax);
+            }
+
+            for (int k = 0; k < 2; k++) {
+                free(chain_values[k]);
+                free(chain_check[k]);
+            }
+        }
+
+// Remap onto the output cells in a centered box covering region_percent of
+// the domain. The region values must match the compact hierarchical remap
+// of the whole mesh, and the cells outside the box must be left alone. The
+// base cell indexes of the meshes are timed apart, since they are built
+// once for a mesh and reused by the region remaps on it.
+
+        if (run_region) {
+            double half = 0.5*sqrt(region_percent/100.0)*icells.ibasesize;
+            region_box box;
+            box.xmin = 0.5*icells.ibasesize - half;
+            box.xmax = 0.5*icells.ibasesize + half;
+            box.ymin = box.xmin;
+            box.ymax = box.xmax;
+
+            cpu_timer_start(&timer);
+            h_remap_compact(icells, ocells, factory);
+            region_full_time += cpu_timer_stop(timer);
+            double *rcheck = (double *)malloc(ocells.ncells*sizeof(double));
+            memcpy(rcheck, ocells.values, ocells.ncells*sizeof(double));
+
+            uint nlist = 0;
+            char *in_region = (char *)calloc(ocells.ncells, sizeof(char));
+            for (uint n = 0; n < ocells.ncells; n++) {
+                double size = 1.0/two_to_the(ocells.level[n]);
+                if (ocells.i[n]*size < box.xmax && (ocells.i[n]+1)*size > box.xmin &&
+                    ocells.j[n]*size < box.ymax && (ocells.j[n]+1)*size > box.ymin) {
+                    in_region[n] = 1;
+                    nlist++;
+                }
+            }
+            region_ncells += nlist;
+            region_total_ncells += ocells.ncells;
+
+            for (int v = 0; v < NUM_RI_VARIANTS; v++) {
+                for (uint n = 0; n < ocells.ncells; n++) {
+                    ocells.values[n] = -1.0;
+                }
+                region_index *iindex = NULL, *oindex = NULL;
+                cpu_timer_start(&timer);
+                switch (v) {
+                case RI_REGION:
+                    iindex = region_index_create(icells);
+                    oindex = region_index_create(ocells);
+                    break;
+#ifdef _OPENMP
+                case RI_REGION_OPENMP:
+                    iindex = region_index_create_openMP(icells);
+                    oindex = region_index_create_openMP(ocells);
+                    break;
+#endif
+                }
+                region_index_time[v] += cpu_timer_stop(timer);
+
+                uint nremapped = 0;
+                cpu_timer_start(&timer);
+                switch (v) {
+                case RI_REGION:        nremapped = h_remap_region_box(icells, iindex, ocells, oindex, box, factory); break;
+#ifdef _OPENMP
+                case RI_REGION_OPENMP: nremapped = h_remap_region_box_openMP(icells, iindex, ocells, oindex, box, OpenMPfactory); break;
+#endif
+                }
+                region_time[v] += cpu_timer_stop(timer);
+                region_index_destroy(iindex);
+                region_index_destroy(oindex);
+
+                if (run_tests) {
+                    if (nremapped != nlist) {
+                        printf("%s failed, remapped %u cells of the %u in the box\n", region_name[v], nremapped, nlist);
+                    }
+                    int icount = 0;
+                    for (uint n = 0; n < ocells.ncells && icount <= 6; n++) {
+                        double expected = in_region[n] ? rcheck[n] : -1.0;
+                        if (ocells.values[n] != expected) {
+                            printf("%s failed at cell %u\nExpected %f, but found %f\n",
+                                region_name[v], n, expected, ocells.values[n]);
+                            icount++;
+                        }
+                    }
+                }
+            }
+
+            memcpy(ocells.values, rcheck, ocells.ncells*sizeof(double));
+            free(in_region);
+            free(rcheck);
+        }
+
+// Task remaps on the work-stealing pool and on OpenMP tasks, timed against
+// the flat parallel loops at each thread count of the scaling runs. The
+// pool has one worker less than the thread count since the calling thread
+// works in it. The nested runs call each remap from one thread of an
+// enclosing parallel region with the others waiting at its barrier, as an
+// application driving the remap from its own threads would.
+
+        if (run_task) {
+            double *tcheck = (double *)malloc(ocells.ncells*sizeof(double));
+            memcpy(tcheck, ocells.values, ocells.ncells*sizeof(double));
+
+            for (int s = 0; s < task_nsteps; s++) {
+                task_pool *pool = task_pool_create(task_threads[s]-1);
+#ifdef _OPENMP
+                omp_set_num_threads(task_threads[s]);
+#endif
+                for (int v = 0; v < NUM_TK_VARIANTS; v++) {
+                    for (uint n = 0; n < ocells.ncells; n++) {
+                        ocells.values[n] = -1.0;
+                    }
+                    cpu_timer_start(&timer);
+                    task_remap_variant(v, icells, ocells, pool);
+                    task_time[s][v] += cpu_timer_stop(timer);
+
+                    if (run_tests) check_output_rel(task_name[v], olength, ocells.values, val_test_answer, 1.0e-12);
+                }
+                task_pool_destroy(pool);
+            }
+#ifdef _OPENMP
+            omp_set_num_threads(task_max_threads);
+            task_pool *pool = task_pool_create(task_max_threads-1);
+            for (int v = 0; v < NUM_TK_VARIANTS; v++) {
+                for (uint n = 0; n < ocells.ncells; n++) {
+                    ocells.values[n] = -1.0;
+                }
+                cpu_timer_start(&timer);
+#pragma omp parallel
+#pragma omp single
+                task_remap_variant(v, icells, ocells, pool);
+                task_nested_time[v] += cpu_timer_stop(timer);
+
+                if (run_tests) check_output_rel(task_name[v], olength, ocells.values, val_test_answer, 1.0e-12);
+            }
+            task_pool_destroy(pool);
+#endif
+            memcpy(ocells.values, tcheck, ocells.ncells*sizeof(double));
+            free(tcheck);
+        }
+
+// Tiled remaps, which build and query one tile of base cells at a time,
+// against the hierarchical remaps that build the whole input mesh first.
+// The Morton ordered copies of the meshes are in tile order, so the tiled
+// remaps skip their bucketing pass on them.
+
+        if (run_tiled) {
+            for (int order = 0; order < NUM_TILED_ORDERS; order++) {
+                cell_list icells_tiled = icells;
+                cell_list ocells_tiled = ocells;
+                if (order == 1) {
+                    icells_tiled = sort_cell_list_morton(copy_cell_list(icells));
+                    ocells_tiled = sort_cell_list_morton(copy_cell_list(ocells));
+                }
+                double *tiled_answer = (double *)malloc(ocells_tiled.ncells*sizeof(double));
+                double *tiled_values = ocells_tiled.values;
+
+                for (int v = 0; v < NUM_TL_VARIANTS; v++) {
+                    ocells_tiled.values = (v == TL_HIERARCHICAL) ? tiled_answer : tiled_values;
+                    memset(ocells_tiled.values, 0xFFFFFFFF, ocells_tiled.ncells*sizeof(double));
+                    cpu_timer_start(&timer);
+                    switch (v) {
+                    case TL_HIERARCHICAL:        h_remap(icells_tiled, ocells_tiled);              break;
+                    case TL_TILED:               h_remap_tiled(icells_tiled, ocells_tiled);        break;
+#ifdef _OPENMP
+                    case TL_HIERARCHICAL_OPENMP: h_remap_openMP(icells_tiled, ocells_tiled);       break;
+                    case TL_TILED_OPENMP:        h_remap_tiled_openMP(icells_tiled, ocells_tiled); break;
+#endif
+                    }
+                    tiled_time[order][v] += cpu_timer_stop(timer);
+
+                    if (run_tests && v != TL_HIERARCHICAL) {
+                        check_output(tiled_name[v], ocells_tiled.ncells, ocells_tiled.values, tiled_answer);
+                    }
+                }
+                ocells_tiled.values = tiled_values;
+
+                if (order == 0) {
+                    // the output values of the mesh as generated are checked again below
+                    memcpy(ocells.values, tiled_answer, ocells.ncells*sizeof(double));
+                } else {
+                    destroy(icells_tiled);
+                    destroy(ocells_tiled);
+                }
+                free(tiled_answer);
+            }
+        }
+
+// Regrid of the input mesh from deterministic refine and coarsen flags.
+// The new mesh must cover the domain, be 2:1 balanced and conserve the
+// integral, and the OpenMP regrid must give the same mesh and values.
+
+        if (run_regrid) {
+            int *flags = (int *)malloc(icells.ncells*sizeof(int));
+            // hashed on the parent so that sibling quartets share a flag
+            for (uint ic = 0; ic < icells.ncells; ic++) {
+                uint hash = ((icells.i[ic]>>1)*73856093u ^ (icells.j[ic]>>1)*19349663u ^ icells.level[ic]*83492791u) >> 8;
+                flags[ic] = (hash%10 < 2) ? REGRID_REFINE : (hash%10 < 6) ? REGRID_COARSEN : REGRID_KEEP;
+            }
+            uint max_level = icells.levmax + 1;
+
+            cpu_timer_start(&timer);
+            regrid_result rg = regrid(icells, flags, max_level, 1);
+            regrid_time += cpu_timer_stop(timer);
+            regrid_ncells += rg.cells.ncells;
+            regrid_sweeps = rg.balance_sweeps;
+
+            if (run_tests) {
+                remap_diag swept;
+                remap_diag_sweep(icells, icells.values, rg.cells, rg.cells.values, &swept);
+                double area = 0.0;
+                for (uint ic = 0; ic < rg.cells.ncells; ic++) {
+                    area += remap_diag_area(rg.cells.level[ic]);
+                }
+                if (area != (double)icells.ibasesize*icells.ibasesize) {
+                    printf("Regrid failed coverage\nArea %lf, expected %u\n", area, icells.ibasesize*icells.ibasesize);
+                }
+                if (remap_diag_rel_error(&swept) > 1.0e-12) {
+                    printf("Regrid failed conservation\nRelative error %9.3e\n", remap_diag_rel_error(&swept));
+                }
+                uint violations = regrid_balance_violations(rg.cells);
+                if (violations > 0) {
+                    printf("Regrid failed 2:1 balance at %u cells\n", violations);
+                }
+            }
+
+#ifdef _OPENMP
+            cpu_timer_start(&timer);
+            regrid_result rg_openMP = regrid_openMP(icells, flags, max_level, 1);
+            regrid_openMP_time += cpu_timer_stop(timer);
+
+            if (run_tests) {
+                if (rg_openMP.cells.ncells != rg.cells.ncells) {
+                    printf("OpenMP Regrid failed\nExpected %u cells, but found %u\n", rg.cells.ncells, rg_openMP.cells.ncells);
+                } else {
+                    uint mismatch = 0;
+                    for (uint ic = 0; ic < rg.cells.ncells; ic++) {
+                        if (rg.cells.i[ic] != rg_openMP.cells.i[ic] || rg.cells.j[ic] != rg_openMP.cells.j[ic] ||
+                            rg.cells.level[ic] != rg_openMP.cells.level[ic]) mismatch++;
+                    }
+                    if (mismatch > 0) printf("OpenMP Regrid failed mesh at %u cells\n", mismatch);
+                    check_output("OpenMP Regrid", rg.cells.ncells, rg_openMP.cells.values, rg.cells.values);
+                }
+            }
+            regrid_destroy(rg_openMP);
+#endif
+
+            regrid_destroy(rg);
+            free(flags);
+        }
+
+// Conservation diagnostics fused into the remap, against the plain remap
+// followed by a separate sweep over both meshes. The fused and the swept
+// diagnostics must agree.
+
+        if (run_diag) {
+            for (int v = 0; v < NUM_DG_VARIANTS; v++) {
+                remap_diag fused, swept;
+
+                cpu_timer_start(&timer);
+                switch (v) {
+                case DG_FULL_PERFECT:                full_perfect_remap(icells, ocells);                                                    break;
+                case DG_SINGLEWRITE:                 singlewrite_remap_op<ReduceMean>(icells, icells.values, ocells, ocells.values);        break;
+                case DG_HIERARCHICAL:                h_remap_op<ReduceMean>(icells, icells.values, ocells, ocells.values);                  break;
+                case DG_COMPACT_HIERARCHICAL:        h_remap_compact(icells, ocells, factory);                                              break;
+#ifdef _OPENMP
+                case DG_FULL_PERFECT_OPENMP:         full_perfect_remap_openMP(icells, ocells);                                             break;
+                case DG_SINGLEWRITE_OPENMP:          singlewrite_remap_op_openMP<ReduceMean>(icells, icells.values, ocells, ocells.values); break;
+                case DG_HIERARCHICAL_OPENMP:         h_remap_op_openMP<ReduceMean>(icells, icells.values, ocells, ocells.values);           break;
+                case DG_COMPACT_HIERARCHICAL_OPENMP: h_remap_compact_openMP(icells, ocells, OpenMPfactory);                                 break;
+#endif
+                }
+                diag_plain_time[v] += cpu_timer_stop(timer);
+
+                cpu_timer_start(&timer);
+#ifdef _OPENMP
+                if (v >= DG_FULL_PERFECT_OPENMP) {
+                    remap_diag_sweep_openMP(icells, icells.values, ocells, ocells.values, &swept);
+                } else
+#endif
+                remap_diag_sweep(icells, icells.values, ocells, ocells.values, &swept);
+                diag_sweep_time[v] += cpu_timer_stop(timer);
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+                for (uint ic = 0; ic < olength; ic++) {
+                    ocells.values[ic] = -1.0;
+                }
+                cpu_timer_start(&timer);
+                switch (v) {
+                case DG_FULL_PERFECT:                full_perfect_remap(icells, ocells, &fused);                                                    break;
+                case DG_SINGLEWRITE:                 singlewrite_remap_op<ReduceMean>(icells, icells.values, ocells, ocells.values, &fused);        break;
+                case DG_HIERARCHICAL:                h_remap_op<ReduceMean>(icells, icells.values, ocells, ocells.values, &fused);                  break;
+                case DG_COMPACT_HIERARCHICAL:        h_remap_compact(icells, ocells, factory, &fused);                                              break;
+#ifdef _OPENMP
+                case DG_FULL_PERFECT_OPENMP:         full_perfect_remap_openMP(icells, ocells, &fused);                                             break;
+                case DG_SINGLEWRITE_OPENMP:          singlewrite_remap_op_openMP<ReduceMean>(icells, icells.values, ocells, ocells.values, &fused); break;
+                case DG_HIERARCHICAL_OPENMP:         h_remap_op_openMP<ReduceMean>(icells, icells.values, ocells, ocells.values, &fused);           break;
+                case DG_COMPACT_HIERARCHICAL_OPENMP: h_remap_compact_openMP(icells, ocells, OpenMPfactory, &fused);                                 break;
+#endif
+                }
+                diag_fused_time[v] += cpu_timer_stop(timer);
+
+                double rel_error = remap_diag_rel_error(&fused);
+                if (rel_error > diag_max_error[v]) diag_max_error[v] = rel_error;
+
+                if (run_tests) {
+                    check_output(diag_name[v], olength, ocells.values, val_test_answer);
+                    if (fabs(fused.in_integral  - swept.in_integral)  > 1.0e-12*fabs(swept.in_integral)  ||
+                        fabs(fused.out_integral - swept.out_integral) > 1.0e-12*fabs(swept.out_integral) ||
+                        fused.in_min  != swept.in_min  || fused.in_max  != swept.in_max ||
+                        fused.out_min != swept.out_min || fused.out_max != swept.out_max) {
+                        printf("%s diagnostics failed\nExpected integrals %.15g %.15g, but found %.15g %.15g\n",
+                            diag_name[v], swept.in_integral, swept.out_integral, fused.in_integral, fused.out_integral);
+                    }
+                }
+            }
+        }
+
+        if (run_async) {
+            pipe_icells[pipe_nsteps] = copy_cell_list(icells);
+            pipe_ocells[pipe_nsteps] = copy_cell_list(ocells);
+            pipe_answer[pipe_nsteps] = (double *)malloc(olength*sizeof(double));
+            memcpy(pipe_answer[pipe_nsteps], val_test_answer, olength*sizeof(double));
+            pipe_nsteps++;
+        }
+
+        if (run_brute)  free(val_test_brute);
+        if (run_tree)   free(val_test_kdtree);
+        free(val_test_perfect);
+
+        destroy(icells);  
+        destroy(ocells);
+    }
+
+// Asynchronous pipeline over the saved meshes. Each step is a remap
+// followed by solver work on its output. The synchronous pipeline runs them
+// back to back; the asynchronous one submits the remap for the next step
+// before doing the solver work for the current one.
+
+    double pipe_sync_time = 0.0;
+    double pipe_async_time = 0.0;
+    double pipe_checksum = 0.0;
+    uint pipe_nthreads = (uint)sysconf(_SC_NPROCESSORS_ONLN);
+    if (pipe_nthreads < 2) pipe_nthreads = 2;
+
+    if (run_async && pipe_nsteps > 0) {
+        cpu_timer_start(&timer);
+        for (uint n = 0; n < pipe_nsteps; n++) {
+            h_remap(pipe_icells[n], pipe_ocells[n]);
+            pipe_checksum += solver_work(pipe_ocells[n]);
+        }
+        pipe_sync_time = cpu_timer_stop(timer);
+
+        for (uint n = 0; n < pipe_nsteps; n++) {
+            if (run_tests) check_output("Synchronous Pipeline Remap", pipe_ocells[n].ncells, pipe_ocells[n].values, pipe_answer[n]);
+            memset(pipe_ocells[n].values, 0xFFFFFFFF, pipe_ocells[n].ncells*sizeof(double));
+        }
+
+        remap_pool *pool = remap_pool_create(pipe_nthreads);
+        remap_handle **handle = (remap_handle **)malloc(pipe_nsteps*sizeof(remap_handle *));
+
+        cpu_timer_start(&timer);
+        handle[0] = remap_submit(pool, pipe_icells[0], pipe_ocells[0]);
+        for (uint n = 0; n < pipe_nsteps; n++) {
+            if (n+1 < pipe_nsteps) handle[n+1] = remap_submit(pool, pipe_icells[n+1], pipe_ocells[n+1]);
+            remap_wait(handle[n]);
+            pipe_checksum -= solver_work(pipe_ocells[n]);
+        }
+        pipe_async_time = cpu_timer_stop(timer);
+
+        remap_pool_destroy(pool);
+        free(handle);
+
+        for (uint n = 0; n < pipe_nsteps; n++) {
+            if (run_tests) check_output("Asynchronous Pipeline Remap", pipe_ocells[n].ncells, pipe_ocells[n].values, pipe_answer[n]);
+        }
+    }
+
+// Batched remap of many small patch meshes. The baseline is a call to
+// h_remap_compact per patch, which creates and destroys its tables each
+// time; the batched calls keep a pool of tables across the patches.
+
+    double batch_single_time = 0.0;
+    double batch_time = 0.0;
+#ifdef _OPENMP
+    double batch_openMP_time = 0.0;
+#endif
+
+    if (batch_npatches > 0) {
+        uint npatches = batch_npatches;
+        uint patch_levels = 3;
+        cell_list *patch_icells = (cell_list *)malloc(npatches*sizeof(cell_list));
+        cell_list *patch_ocells = (cell_list *)malloc(npatches*sizeof(cell_list));
+        double **patch_answer   = (double **)  malloc(npatches*sizeof(double *));
+
+        // Round the cell count down until mesh_maker accepts it as is, so
+        // that it does not print a note for every patch
+        uint patch_cells = batch_patch_cells;
+        for (;;) {
+            uint patch_base = sqrt(patch_cells/(sparsity*four_to_the(patch_levels-1))) + 1;
+            if (patch_base < min_base_size) patch_base = min_base_size;
+            uint remainder = (patch_cells - patch_base*patch_base) % 3;
+            if (remainder == 0) break;
+            patch_cells -= remainder;
+        }
+
+        for (uint p = 0; p < npatches; p++) {
+            uint plength = patch_cells;
+            uint pmax_level;
+            patch_icells[p] = mesh_maker(patch_icells[p], patch_levels, &plength, &pmax_level, sparsity, min_base_size);
+            plength = patch_cells;
+            patch_ocells[p] = mesh_maker(patch_ocells[p], patch_levels, &plength, &pmax_level, sparsity, min_base_size);
+            for (uint ic = 0; ic < patch_icells[p].ncells; ic++) {
+                patch_icells[p].values[ic] = rand () % 100;
+            }
+            patch_answer[p] = (double *)malloc(patch_ocells[p].ncells*sizeof(double));
+        }
+
+        cpu_timer_start(&timer);
+        for (uint p = 0; p < npatches; p++) {
+            h_remap_compact(patch_icells[p], patch_ocells[p], factory);
+        }
+        batch_single_time = cpu_timer_stop(timer);
+
+        for (uint p = 0; p < npatches; p++) {
+            memcpy(patch_answer[p], patch_ocells[p].values, patch_ocells[p].ncells*sizeof(double));
+        }
+
+        h_table_pool *pool = h_table_pool_create(factory);
+        for (int v = 0; v < 2; v++) {
+#ifndef _OPENMP
+            if (v == 1) break;
+#endif
+            for (uint p = 0; p < npatches; p++) {
+                memset(patch_ocells[p].values, 0xFFFFFFFF, patch_ocells[p].ncells*sizeof(double));
+            }
+            cpu_timer_start(&timer);
+            if (v == 0) {
+                h_remap_compact_batch(npatches, patch_icells, patch_ocells, pool);
+                batch_time = cpu_timer_stop(timer);
+            } else {
+#ifdef _OPENMP
+                h_remap_compact_batch_openMP(npatches, patch_icells, patch_ocells, pool);
+                batch_openMP_time = cpu_timer_stop(timer);
+#endif
+            }
+            if (run_tests) {
+                for (uint p = 0; p < npatches; p++) {
+                    check_output(v == 0 ? "Batched Compact Hierarchical Remap" : "OpenMP Batched Compact Hierarchical Remap",
+                        patch_ocells[p].ncells, patch_ocells[p].values, patch_answer[p]);
+                }
+            }
+        }
+        h_table_pool_destroy(pool);
+
+        for (uint p = 0; p < npatches; p++) {
+            destroy(patch_icells[p]);
+            destroy(patch_ocells[p]);
+            free(patch_answer[p]);
+        }
+        free(patch_icells);
+        free(patch_ocells);
+        free(patch_answer);
+    }
+
+// Value-inlined remap on an input mesh whose values do not fit in the last
+// level cache, where the second load of the compact remaps goes to memory.
+// The meshes of the main loop are usually small enough to stay in L3.
+
+    double inline_l3_mb = 0.0;
+    size_t inline_large_ncells = 0;
+    double inline_large_time = 0.0;
+    double inline_large_singlewrite_time = 0.0;
+    double inline_large_compact_h_time = 0.0;
+#ifdef _OPENMP
+    double inline_large_openMP_time = 0.0;
+    double inline_large_singlewrite_openMP_time = 0.0;
+    double inline_large_compact_h_openMP_time = 0.0;
+#endif
+
+    if (run_inline_large) {
+        long l3_size = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+        l3_size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+        if (l3_size <= 0) l3_size = 32*1048576;
+        inline_l3_mb = l3_size/1048576.0;
+
+        // twice the cache in input values unless a count is given
+        uint large_cells = inline_large_cells;
+        if (large_cells == 0) large_cells = 2*(size_t)l3_size/sizeof(double);
+        uint large_levels = 4;
+
+        cell_list large_icells, large_ocells;
+        uint large_length = large_cells;
+        uint large_max_level;
+        large_icells = mesh_maker(large_icells, large_levels, &large_length, &large_max_level, sparsity, min_base_size);
+        large_length = large_cells;
+        large_ocells = mesh_maker(large_ocells, large_levels, &large_length, &large_max_level, sparsity, min_base_size);
+        for (uint ic = 0; ic < large_icells.ncells; ic++) {
+            large_icells.values[ic] = rand () % 100;
+        }
+        uint large_olength = large_ocells.ncells;
+        double *large_answer = (double *)malloc(large_olength*sizeof(double));
+
+        if (! inline_hash_keys_fit(large_icells.ibasesize, large_icells.levmax)) {
+            printf("Skipping the large value-inlined remap, the keys of the input mesh do not fit a uint\n");
+        } else {
+            inline_large_ncells = large_icells.ncells;
+
+            for (int v = 0; v < 2; v++) {
+#ifndef _OPENMP
+                if (v == 1) break;
+#endif
+                double *remap_time = &inline_large_compact_h_time;
+                memset(large_ocells.values, 0xFFFFFFFF, large_olength*sizeof(double));
+                cpu_timer_start(&timer);
+                if (v == 0) {
+                    h_remap_compact (large_icells, large_ocells, factory);
+                } else {
+#ifdef _OPENMP
+                    h_remap_compact_openMP (large_icells, large_ocells, OpenMPfactory);
+                    remap_time = &inline_large_compact_h_openMP_time;
+#endif
+                }
+                *remap_time = cpu_timer_stop(timer);
+                if (v == 0) {
+                    memcpy(large_answer, large_ocells.values, large_olength*sizeof(double));
+                } else if (run_tests) {
+                    check_output("Large Compact Hierarchical Remap OpenMP", large_olength, large_ocells.values, large_answer);
+                }
+
+                remap_time = &inline_large_singlewrite_time;
+                memset(large_ocells.values, 0xFFFFFFFF, large_olength*sizeof(double));
+                cpu_timer_start(&timer);
+                if (v == 0) {
+                    singlewrite_remap_compact (large_icells, large_ocells);
+                } else {
+#ifdef _OPENMP
+                    singlewrite_remap_compact_openMP (large_icells, large_ocells);
+                    remap_time = &inline_large_singlewrite_openMP_time;
+#endif
+                }
+                *remap_time = cpu_timer_stop(timer);
+                if (run_tests) {
+                    check_output(v == 0 ? "Large Compact Single-write Remap" : "Large Compact Single-write Remap OpenMP",
+                        large_olength, large_ocells.values, large_answer);
+                }
+
+                remap_time = &inline_large_time;
+                memset(large_ocells.values, 0xFFFFFFFF, large_olength*sizeof(double));
+                cpu_timer_start(&timer);
+                if (v == 0) {
+                    singlewrite_remap_inline (large_icells, large_ocells);
+                } else {
+#ifdef _OPENMP
+                    singlewrite_remap_inline_openMP (large_icells, large_ocells);
+                    remap_time = &inline_large_openMP_time;
+#endif
+                }
+                *remap_time = cpu_timer_stop(timer);
+                if (run_tests) {
+                    check_output(v == 0 ? "Large Value-inlined Single-write Remap" : "Large Value-inlined Single-write Remap OpenMP",
+                        large_olength, large_ocells.values, large_answer);
+                }
+            }
+        }
+
+        free(large_answer);
+        destroy(large_icells);
+        destroy(large_ocells);
+    }
+
+    for (uint n = 0; n < pipe_nsteps; n++) {
+        destroy(pipe_icells[n]);
+        destroy(pipe_ocells[n]);
+        free(pipe_answer[n]);
+    }
+    free(pipe_icells);
+    free(pipe_ocells);
+    free(pipe_answer);
+
+    intintHash_DestroyFactory(factory);
+    intintHash_DestroyFactory(OpenMPfactory);
+    
+    printf("~~~~~~~~~~~~~~~~Averages~~ ~~~~~~~~~~~~~~\n");
+    size_t average_ncells = sum_ncells/num_rep/2;
+
+    printf("sparsity percent compressibility    cells in fine mesh average ncells\n");
+    printf("---------------- ---------------      --------------     ----------  \n");
     printf("     %f",(float)(save_num_fine_cells-average_ncells)/(float)save_num_fine_cells*100.0);
     printf("     %f",(float)save_num_fine_cells/(float)average_ncells);
     printf("            %ld                %ld",save_num_fine_cells,average_ncells);
@@ -737,17 +2671,41 @@ int main (int argc, char** argv) {
        printf("KD Tree Remap:\t\t\t\t%10.4f ms\n", kd_tree_time/num_rep*1000);
 
     printf("Full Perfect Remap:\t\t\t%10.4f ms\n", full_perfect_remap_time/num_rep*1000);
+    double stream_bw = 0.0;
+    if (run_rowfill) {
+       stream_bw = stream_copy_bandwidth();
+       printf("Row-fill Full Perfect Remap:\t\t%10.4f ms Speedup relative to full hash %8.2lf\n",
+              rowfill_perfect_remap_time/num_rep*1000, full_perfect_remap_time/rowfill_perfect_remap_time);
+       printf("   fill %10.4f ms %8.3f GB/s %6.1f%% of STREAM copy %8.3f GB/s\n",
+              rowfill_fill_time/num_rep*1000, rowfill_fill_bytes/rowfill_fill_time*1.0e-9,
+              rowfill_fill_bytes/rowfill_fill_time/stream_bw*100.0, stream_bw*1.0e-9);
+    }
     printf("Singlewrite Remap:\t\t\t%10.4f ms Speedup relative to full hash %8.2lf\n",
            singlewrite_remap_time/num_rep*1000, full_perfect_remap_time/singlewrite_remap_time);
     printf("Hierarchical Remap:\t\t\t%10.4f ms Speedup relative to full hash %8.2lf\n",
            h_remap_time/num_rep*1000, full_perfect_remap_time/h_remap_time);
+    if (run_lazy_zero)
+       printf("Lazy-zero Singlewrite Remap:\t\t%10.4f ms Speedup relative to singlewrite %8.2lf\n",
+              lazy_singlewrite_remap_time/num_rep*1000, singlewrite_remap_time/lazy_singlewrite_remap_time);
     printf("Compact Singlewrite Remap:\t\t%10.4f ms\n", compact_singlewrite_remap_time/num_rep*1000);
     printf("Compact Hierarchical Remap:\t\t%10.4f ms\n", compact_h_remap_time/num_rep*1000);
 #ifdef _OPENMP
     printf("\nOpenMP Full Perfect Remap:\t\t%10.4f ms speedup \t%8.2lf\n",
            full_perfect_remap_openMP_time/num_rep*1000, full_perfect_remap_time/full_perfect_remap_openMP_time);
+    if (run_rowfill) {
+       printf("OpenMP Row-fill Full Perfect Remap:\t%10.4f ms speedup \t%8.2lf relative to OpenMP full perfect %8.2lf\n",
+              rowfill_perfect_remap_openMP_time/num_rep*1000, rowfill_perfect_remap_time/rowfill_perfect_remap_openMP_time,
+              full_perfect_remap_openMP_time/rowfill_perfect_remap_openMP_time);
+       printf("   fill %10.4f ms %8.3f GB/s %6.1f%% of STREAM copy %8.3f GB/s\n",
+              rowfill_fill_openMP_time/num_rep*1000, rowfill_fill_bytes/rowfill_fill_openMP_time*1.0e-9,
+              rowfill_fill_bytes/rowfill_fill_openMP_time/stream_bw*100.0, stream_bw*1.0e-9);
+    }
     printf("OpenMP Singlewrite Remap:\t\t%10.4f ms speedup \t%8.2lf\n",
            singlewrite_remap_openMP_time/num_rep*1000,singlewrite_remap_time/singlewrite_remap_openMP_time);
+    if (run_lazy_zero)
+       printf("OpenMP Lazy-zero Singlewrite Remap:\t%10.4f ms speedup \t%8.2lf relative to OpenMP singlewrite %8.2lf\n",
+              lazy_singlewrite_remap_openMP_time/num_rep*1000, lazy_singlewrite_remap_time/lazy_singlewrite_remap_openMP_time,
+              singlewrite_remap_openMP_time/lazy_singlewrite_remap_openMP_time);
     printf("OpenMP Hierarchical Remap:\t\t%10.4f ms speedup \t%8.2lf\n",
            h_remap_openMP_time/num_rep*1000, h_remap_time/h_remap_openMP_time);
     printf("OpenMP Compact Singlewrite Remap:\t%10.4f ms speedup \t%8.2lf\n",
@@ -755,6 +2713,253 @@ int main (int argc, char** argv) {
     printf("OpenMP Compact Hierarchical Remap:\t%10.4f ms speedup \t%8.2lf\n",
            compact_h_remap_openMP_time/num_rep*1000, compact_h_remap_time/compact_h_remap_openMP_time);
 #endif
+    if (run_reduce_ops) {
+       printf("\nReduction operator remaps\n");
+       for (int op = 0; op < NUM_REDUCE_OPS; op++) {
+          for (int k = 0; k < NUM_REDUCE_KERNELS; k++) {
+             if (k == RK_BRUTE && ! run_brute) continue;
+             printf("%-16s %-33s %10.4f ms\n", reduce_op_name[op], reduce_kernel_name[k],
+                    reduce_op_time[op][k]/num_rep*1000);
+          }
+       }
+    }
+
+    if (run_value_types) {
+       printf("\nValue type remaps\n");
+       for (int vt = 0; vt < NUM_VALUE_TYPES; vt++) {
+          for (int k = 0; k < NUM_REDUCE_KERNELS; k++) {
+             if (k == RK_BRUTE && ! run_brute) continue;
+             printf("%-16s %-33s %10.4f ms", value_type_name[vt], reduce_kernel_name[k],
+                    value_type_time[vt][k]/num_rep*1000);
+             if (vt != VT_DOUBLE_MEAN)
+                printf(" Speedup relative to double %8.2lf", value_type_time[VT_DOUBLE_MEAN][k]/value_type_time[vt][k]);
+             printf("\n");
+          }
+       }
+    }
+
+    if (batch_npatches > 0) {
+       printf("\nBatched remap of %u patches of about %u cells\n", batch_npatches, batch_patch_cells);
+       printf("Per-patch Compact Hierarchical:\t\t%10.4f ms %8.3f us per patch\n",
+              batch_single_time*1000, batch_single_time/batch_npatches*1.0e6);
+       printf("Batched Compact Hierarchical:\t\t%10.4f ms %8.3f us per patch Speedup %8.2lf\n",
+              batch_time*1000, batch_time/batch_npatches*1.0e6, batch_single_time/batch_time);
+#ifdef _OPENMP
+       printf("OpenMP Batched Compact Hierarchical:\t%10.4f ms %8.3f us per patch Speedup %8.2lf\n",
+              batch_openMP_time*1000, batch_openMP_time/batch_npatches*1.0e6, batch_single_time/batch_openMP_time);
+#endif
+    }
+
+    if (run_second_order) {
+       printf("\nSecond order remap, L1 error on a smooth field first order %9.3e second order %9.3e\n",
+              first_order_l1/num_rep, second_order_l1/num_rep);
+       printf("First Order Hierarchical Remap:\t\t%10.4f ms\n", first_order_time/num_rep*1000);
+       printf("Second Order Hierarchical Remap:\t%10.4f ms Cost relative to first order %8.2lf\n",
+              second_order_time/num_rep*1000, second_order_time/first_order_time);
+#ifdef _OPENMP
+       printf("OpenMP First Order Hierarchical Remap:\t%10.4f ms\n", first_order_openMP_time/num_rep*1000);
+       printf("OpenMP Second Order Hierarchical Remap:\t%10.4f ms Cost relative to first order %8.2lf\n",
+              second_order_openMP_time/num_rep*1000, second_order_openMP_time/first_order_openMP_time);
+#endif
+    }
+
+    if (meshgen == PLOTFILE_MESHGEN) {
+       printf("\nAMReX plotfile %s, %lu average input cells\n", argv[1], plotfile_ncells/num_rep);
+       printf("AMReX Plotfile Read:\t\t\t%10.4f ms\n", plotfile_read_time/num_rep*1000);
+#ifdef _OPENMP
+       printf("OpenMP AMReX Plotfile Read:\t\t%10.4f ms Speedup %8.2lf\n",
+              plotfile_read_openMP_time/num_rep*1000, plotfile_read_time/plotfile_read_openMP_time);
+#endif
+    }
+
+    if (run_locate) {
+       printf("\nPoint location, %u points, table and tree builds %8.4f ms hash %8.4f ms compact %8.4f ms KD-tree\n",
+              locate_npoints, locate_hash_build_time/num_rep*1000, locate_compact_build_time/num_rep*1000,
+              locate_tree_build_time/num_rep*1000);
+       for (int v = 0; v < NUM_PL_VARIANTS; v++) {
+          if (locate_time[v] == 0.0) continue;
+          printf("%-32s %10.4f ms %8.2f ns per point", locate_name[v],
+                 locate_time[v]/num_rep*1000, locate_time[v]/num_rep/locate_npoints*1.0e9);
+          if (locate_time[PL_KDTREE] > 0.0) printf(" speedup over KD-tree %8.2lf", locate_time[PL_KDTREE]/locate_time[v]);
+          printf("\n");
+       }
+    }
+
+    if (run_rays) {
+       printf("\nRay traversal, %u rays, %lu average cells crossed per ray\n", ray_count, ray_nsegments/num_rep/ray_count);
+       printf("Fresh Search Ray Traversal:\t\t%10.4f ms %8.3f Mcells per second\n",
+              ray_fresh_time/num_rep*1000, ray_nsegments/ray_fresh_time*1.0e-6);
+       printf("Ray Traversal:\t\t\t\t%10.4f ms %8.3f Mcells per second Speedup %8.2lf\n",
+              ray_time/num_rep*1000, ray_nsegments/ray_time*1.0e-6, ray_fresh_time/ray_time);
+#ifdef _OPENMP
+       printf("OpenMP Ray Traversal:\t\t\t%10.4f ms %8.3f Mcells per second Speedup %8.2lf\n",
+              ray_openMP_time/num_rep*1000, ray_nsegments/ray_openMP_time*1.0e-6, ray_fresh_time/ray_openMP_time);
+#endif
+    }
+
+    if (run_inline && inline_ncells > 0) {
+       printf("\nValue-inlined compact hash, %lu average input cells, %.1f MB of input values\n",
+              inline_ncells/num_rep, inline_ncells/num_rep*sizeof(double)/1048576.0);
+       printf("Value-inlined Single-write Remap:\t%10.4f ms speedup over compact single-write %8.2lf compact hierarchical %8.2lf\n",
+              inline_remap_time/num_rep*1000, compact_singlewrite_remap_time/inline_remap_time,
+              compact_h_remap_time/inline_remap_time);
+#ifdef _OPENMP
+       printf("OpenMP Value-inlined Single-write Remap:%10.4f ms speedup over compact single-write %8.2lf compact hierarchical %8.2lf\n",
+              inline_remap_openMP_time/num_rep*1000, compact_singlewrite_remap_openMP_time/inline_remap_openMP_time,
+              compact_h_remap_openMP_time/inline_remap_openMP_time);
+#endif
+    }
+
+    if (inline_large_ncells > 0) {
+       printf("\nValue-inlined compact hash, %lu input cells, %.1f MB of input values against %.1f MB of L3\n",
+              inline_large_ncells, inline_large_ncells*sizeof(double)/1048576.0, inline_l3_mb);
+       printf("Large Value-inlined Single-write Remap:\t%10.4f ms speedup over compact single-write %8.2lf compact hierarchical %8.2lf\n",
+              inline_large_time*1000, inline_large_singlewrite_time/inline_large_time,
+              inline_large_compact_h_time/inline_large_time);
+#ifdef _OPENMP
+       printf("OpenMP Large Value-inlined Remap:\t%10.4f ms speedup over compact single-write %8.2lf compact hierarchical %8.2lf\n",
+              inline_large_openMP_time*1000, inline_large_singlewrite_openMP_time/inline_large_openMP_time,
+              inline_large_compact_h_openMP_time/inline_large_openMP_time);
+#endif
+    }
+
+    if (run_mapped) {
+       printf("\nMapped remap onto base %u from base %u, offset %g %g, %lu average output cells\n",
+              mapped_obase, icells.ibasesize, mapped_offset_i, mapped_offset_j, mapped_ncells/num_rep);
+       printf("Hierarchical Remap aligned:\t\t%10.4f ms\n", mapped_aligned_time/num_rep*1000);
+       printf("Mapped Hierarchical Remap identity:\t%10.4f ms cost over aligned %8.2lf\n",
+              mapped_identity_time/num_rep*1000, mapped_identity_time/mapped_aligned_time);
+       for (int v = 0; v < NUM_MR_VARIANTS; v++) {
+          printf("%-40s %10.4f ms %8.2f ns per output cell\n", mapped_name[v],
+                 mapped_time[v]/num_rep*1000, mapped_time[v]/mapped_ncells*1.0e9);
+       }
+    }
+
+    if (run_chain) {
+       printf("\nChained remaps, %d steps between the input and output meshes (first step, later steps)\n", CHAIN_STEPS);
+       for (int v = 0; v < NUM_CH_VARIANTS; v++) {
+          printf("%-42s %10.4f ms %10.4f ms per step, rebuilt every step %10.4f ms %10.4f ms Speedup %8.2lf\n",
+                 chain_name[v], chain_first_time[v]/num_rep*1000,
+                 chain_time[v]/num_rep/(CHAIN_STEPS-1)*1000,
+                 chain_rebuild_first_time[v]/num_rep*1000,
+                 chain_rebuild_time[v]/num_rep/(CHAIN_STEPS-1)*1000,
+                 chain_rebuild_time[v]/chain_time[v]);
+       }
+    }
+
+    if (run_region) {
+       printf("\nRegion remap onto %.1f%% of the domain, %lu average region cells of %lu output cells\n",
+              region_percent, region_ncells/num_rep, region_total_ncells/num_rep);
+       printf("Compact Hierarchical Remap whole mesh:\t%10.4f ms\n", region_full_time/num_rep*1000);
+       for (int v = 0; v < NUM_RI_VARIANTS; v++) {
+          printf("%-42s %10.4f ms Speedup %8.2lf %8.2f ns per region cell, index of both meshes %10.4f ms\n",
+                 region_name[v], region_time[v]/num_rep*1000, region_full_time/region_time[v],
+                 region_time[v]/region_ncells*1.0e9, region_index_time[v]/num_rep*1000);
+       }
+    }
+
+    if (run_task) {
+       printf("\nTask remaps against the flat parallel loops, speedup over the flat loop at the same thread count\n");
+       for (int s = 0; s < task_nsteps; s++) {
+          printf("%u threads\n", task_threads[s]);
+          for (int v = 0; v < NUM_TK_VARIANTS; v++) {
+             printf("   %-42s %10.4f ms Speedup %8.2lf Scaling %8.2lf\n", task_name[v],
+                    task_time[s][v]/num_rep*1000, task_time[s][task_base(v)]/task_time[s][v],
+                    task_time[0][v]/task_time[s][v]);
+          }
+       }
+#ifdef _OPENMP
+       printf("Called from one thread of a parallel region of %u threads\n", task_max_threads);
+       for (int v = 0; v < NUM_TK_VARIANTS; v++) {
+          printf("   %-42s %10.4f ms Speedup %8.2lf\n", task_name[v],
+                 task_nested_time[v]/num_rep*1000, task_nested_time[task_base(v)]/task_nested_time[v]);
+       }
+#endif
+    }
+
+    if (run_tiled) {
+       printf("\nTiled remaps, speedup over the hierarchical remap with the same threading\n");
+       for (int order = 0; order < NUM_TILED_ORDERS; order++) {
+          printf("%s cell order\n", tiled_order_name[order]);
+          for (int v = 0; v < NUM_TL_VARIANTS; v++) {
+             int base = v - (v % 2);
+             printf("   %-42s %10.4f ms Speedup %8.2lf\n", tiled_name[v],
+                    tiled_time[order][v]/num_rep*1000, tiled_time[order][base]/tiled_time[order][v]);
+          }
+       }
+    }
+
+    if (run_regrid) {
+       printf("\nRegrid from flags, %lu average cells, %u balance sweeps\n", regrid_ncells/num_rep, regrid_sweeps);
+       printf("Regrid:\t\t\t\t\t%10.4f ms\n", regrid_time/num_rep*1000);
+#ifdef _OPENMP
+       printf("OpenMP Regrid:\t\t\t\t%10.4f ms Speedup %8.2lf\n",
+              regrid_openMP_time/num_rep*1000, regrid_time/regrid_openMP_time);
+#endif
+    }
+
+    if (run_diag) {
+       printf("\nConservation diagnostics, fused into the remap against a separate sweep\n");
+       for (int v = 0; v < NUM_DG_VARIANTS; v++) {
+          printf("%-33s %10.4f ms fused overhead %8.4f ms separate sweep %8.4f ms max relative conservation error %9.3e\n",
+                 diag_name[v], diag_plain_time[v]/num_rep*1000,
+                 (diag_fused_time[v] - diag_plain_time[v])/num_rep*1000,
+                 diag_sweep_time[v]/num_rep*1000, diag_max_error[v]);
+       }
+    }
+
+    if (run_matrix) {
+       printf("\nRemap matrix, %lu average nonzeros, %u fields per apply\n", matrix_nnz/num_rep, matrix_nfields);
+       printf("Remap Matrix Build:\t\t\t%10.4f ms\n", matrix_build_time/num_rep*1000);
+       printf("Remap Matrix Apply:\t\t\t%10.4f ms per field Speedup relative to hierarchical %8.2lf singlewrite %8.2lf\n",
+              matrix_apply_time/num_rep/matrix_nfields*1000,
+              h_remap_time*matrix_nfields/matrix_apply_time, singlewrite_remap_time*matrix_nfields/matrix_apply_time);
+#ifdef _OPENMP
+       printf("OpenMP Remap Matrix Apply:\t\t%10.4f ms per field Speedup relative to hierarchical %8.2lf singlewrite %8.2lf\n",
+              matrix_apply_openMP_time/num_rep/matrix_nfields*1000,
+              h_remap_openMP_time*matrix_nfields/matrix_apply_openMP_time,
+              singlewrite_remap_openMP_time*matrix_nfields/matrix_apply_openMP_time);
+#endif
+    }
+
+    if (run_async && pipe_nsteps > 0) {
+       printf("\nRemap pipeline over %u meshes with %d solver sweeps (%u pool threads, checksum %g)\n",
+              pipe_nsteps, solver_sweeps, pipe_nthreads, pipe_checksum);
+       printf("Synchronous Pipeline:\t\t\t%10.4f ms per step %10.2f steps/s\n",
+              pipe_sync_time/pipe_nsteps*1000, pipe_nsteps/pipe_sync_time);
+       printf("Asynchronous Pipeline:\t\t\t%10.4f ms per step %10.2f steps/s Speedup %8.2lf\n",
+              pipe_async_time/pipe_nsteps*1000, pipe_nsteps/pipe_async_time, pipe_sync_time/pipe_async_time);
+    }
+
+    if (run_packed) {
+       double unpacked_time[NUM_PK_VARIANTS] = {
+          full_perfect_remap_time, singlewrite_remap_time, compact_singlewrite_remap_time, h_remap_time,
+          compact_h_remap_time,
+#ifdef _OPENMP
+          full_perfect_remap_openMP_time, singlewrite_remap_openMP_time, compact_singlewrite_remap_openMP_time,
+          h_remap_openMP_time, compact_h_remap_openMP_time,
+#endif
+       };
+       printf("\nPacked key remaps (conversion of both meshes %10.4f ms)\n", pack_time/num_rep*1000);
+       for (int v = 0; v < NUM_PK_VARIANTS; v++) {
+          if (packed_time[v] == 0.0) continue;   // skipped
+          printf("%-42s %10.4f ms Speedup relative to unpacked %8.2lf\n", packed_name[v],
+                 packed_time[v]/num_rep*1000, unpacked_time[v]/packed_time[v]);
+       }
+    }
+
+    if (run_probe_cache) {
+       printf("\nProbe cache remaps (uncached ms, cached ms, speedup, hit rate)\n");
+       for (int order = 0; order < NUM_CELL_ORDERS; order++) {
+          for (int v = 0; v < NUM_PC_VARIANTS; v++) {
+             printf("%-10s %-34s %10.4f ms %10.4f ms %8.2lf %7.2f%%\n",
+                    cell_order_name[order], probe_cache_name[v],
+                    probe_nocache_time[order][v]/num_rep*1000, probe_cache_time[order][v]/num_rep*1000,
+                    probe_nocache_time[order][v]/probe_cache_time[order][v],
+                    (double)probe_cache_hits[order][v]/(double)probe_cache_queries*100.0);
+          }
+       }
+    }
 #ifdef HAVE_OPENCL
     printf("\nGPU Full Perfect Remap:\t\t\t%10.4f ms\n", gpu_full_perfect_remap_time/num_rep*1000);
     printf("GPU Singlewrite Remap:\t\t\t%10.4f ms\n", gpu_singlewrite_remap_time/num_rep*1000);
@@ -779,6 +2984,303 @@ void handle_signal(int signal){
 }
 #endif
 
+// Stand-in for the solver's work on a remapped field. It only reads the
+// values so that the output can still be checked afterwards.
+double solver_work(cell_list cells){
+    double sum = 0.0;
+    for (int s = 0; s < solver_sweeps; s++) {
+        for (uint ic = 0; ic < cells.ncells; ic++) {
+            sum += sqrt(fabs(cells.values[ic]) + (double)s);
+        }
+    }
+    return sum;
+}
+
+// One run of a variant of the task remap comparison
+void task_remap_variant(int v, cell_list icells, cell_list ocells, task_pool *pool){
+    int kind = v % NUM_TK_REMAPS;
+    int backend = v / NUM_TK_REMAPS;
+#ifdef _OPENMP
+    intintHash_Factory *hfactory = OpenMPfactory;
+    if (backend == TK_OPENMP) pool = TASK_OPENMP;
+#else
+    intintHash_Factory *hfactory = factory;
+#endif
+
+    if (backend == TK_FLAT) {
+        switch (kind) {
+#ifdef _OPENMP
+        case TK_FULL_PERFECT:         full_perfect_remap_openMP(icells, ocells);            break;
+        case TK_SINGLEWRITE:          singlewrite_remap_openMP(icells, ocells);             break;
+        case TK_COMPACT_SINGLEWRITE:  singlewrite_remap_compact_openMP(icells, ocells);     break;
+        case TK_HIERARCHICAL:         h_remap_openMP(icells, ocells);                       break;
+        case TK_COMPACT_HIERARCHICAL: h_remap_compact_openMP(icells, ocells, hfactory);     break;
+#else
+        case TK_FULL_PERFECT:         full_perfect_remap(icells, ocells);                   break;
+        case TK_SINGLEWRITE:          singlewrite_remap(icells, ocells);                    break;
+        case TK_COMPACT_SINGLEWRITE:  singlewrite_remap_compact(icells, ocells);            break;
+        case TK_HIERARCHICAL:         h_remap(icells, ocells);                              break;
+        case TK_COMPACT_HIERARCHICAL: h_remap_compact(icells, ocells, hfactory);            break;
+#endif
+        }
+        return;
+    }
+
+    switch (kind) {
+    case TK_FULL_PERFECT:         full_perfect_remap_task(icells, ocells, pool);              break;
+    case TK_SINGLEWRITE:          singlewrite_remap_task(icells, ocells, pool);               break;
+    case TK_COMPACT_SINGLEWRITE:  singlewrite_remap_compact_task(icells, ocells, pool);       break;
+    case TK_HIERARCHICAL:         h_remap_task(icells, ocells, pool);                         break;
+    case TK_COMPACT_HIERARCHICAL: h_remap_compact_task(icells, ocells, hfactory, pool);       break;
+    }
+}
+
+// Remaps the plotfile dumps listed one per line in list_file onto an output
+// mesh generated on the base mesh and levels of the first dump, each way
+// num_rep times, and reports the time per dump with the time in each stage
+void stream_remap_series(const char *list_file, const char *component, float threshold, int target_ncells,
+                         uint num_rep, const char *outdir, int run_tests){
+    FILE *fp = fopen(list_file, "r");
+    if (fp == NULL) {
+        printf("Could not open dump list %s. Exiting.\n", list_file);
+        exit(-1);
+    }
+    uint nfiles = 0, nalloc = 16;
+    char **files = (char **)malloc(nalloc*sizeof(char *));
+    char line[4096];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        size_t len = strlen(line);
+        while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r' || line[len-1] == ' ')) line[--len] = '\0';
+        if (len == 0 || line[0] == '#') continue;
+        if (nfiles == nalloc) {
+            nalloc *= 2;
+            files = (char **)realloc(files, nalloc*sizeof(char *));
+        }
+        files[nfiles++] = strdup(line);
+    }
+    fclose(fp);
+    if (nfiles == 0) {
+        printf("No dumps in list %s. Exiting.\n", list_file);
+        exit(-1);
+    }
+
+    cell_list icells = read_amrex_plotfile(files[0], component);
+    if (icells.ncells == 0) {
+        printf("Could not read AMReX plotfile %s. Exiting.\n", files[0]);
+        exit(-1);
+    }
+    cell_list ocells;
+    ocells = adaptiveMeshConstructorWij(ocells, icells.ibasesize, icells.levmax, threshold, target_ncells);
+    printf("\nStreaming remap of %u dumps of %u input cells onto %u output cells\n", nfiles, icells.ncells, ocells.ncells);
+
+    // The series values against h_remap on the first dump
+    if (run_tests) {
+        double *answer = (double *)malloc(ocells.ncells*sizeof(double));
+        h_remap(icells, ocells);
+        memcpy(answer, ocells.values, ocells.ncells*sizeof(double));
+        stream_stats check_stats;
+        for (int v = 0; v < NUM_SR_VARIANTS; v++) {
+            memset(ocells.values, 0xFFFFFFFF, ocells.ncells*sizeof(double));
+#ifdef _OPENMP
+            if (v >= SR_SEQUENTIAL_OPENMP) {
+                stream_remap_openMP((const char **)files, 1, component, ocells, NULL, v % 2, &check_stats);
+            } else
+#endif
+            stream_remap((const char **)files, 1, component, ocells, NULL, v % 2, &check_stats);
+            check_output(stream_name[v], ocells.ncells, ocells.values, answer);
+        }
+        free(answer);
+    }
+    destroy(icells);
+    free(icells.dist);
+
+    stream_stats sum[NUM_SR_VARIANTS];
+    memset(sum, 0, sizeof(sum));
+    uint ndumps = 0, nskipped = 0;
+    double checksum = 0.0;
+    for (uint rep = 0; rep < num_rep; rep++) {
+        for (int v = 0; v < NUM_SR_VARIANTS; v++) {
+            stream_stats stats;
+#ifdef _OPENMP
+            if (v >= SR_SEQUENTIAL_OPENMP) {
+                stream_remap_openMP((const char **)files, nfiles, component, ocells, outdir, v % 2, &stats);
+            } else
+#endif
+            stream_remap((const char **)files, nfiles, component, ocells, outdir, v % 2, &stats);
+
+            if (v == 0) {
+                ndumps   = stats.ndumps;
+                nskipped = stats.nskipped;
+                checksum = stats.checksum;
+            } else if (run_tests && (stats.ndumps != ndumps || stats.checksum != checksum)) {
+                printf("%s failed\nRemapped %u dumps with checksum %lf, expected %u dumps with checksum %lf\n",
+                       stream_name[v], stats.ndumps, stats.checksum, ndumps, checksum);
+            }
+            sum[v].read_time  += stats.read_time;
+            sum[v].remap_time += stats.remap_time;
+            sum[v].write_time += stats.write_time;
+            sum[v].read_wait  += stats.read_wait;
+            sum[v].write_wait += stats.write_wait;
+            sum[v].total_time += stats.total_time;
+        }
+    }
+
+    printf("\nStreaming remap, %u dumps remapped and %u skipped, times per dump%s\n", ndumps, nskipped,
+           outdir != NULL ? " with the results written" : "");
+    double per_dump = 1000.0/((double)num_rep*(ndumps > 0 ? ndumps : 1));
+    for (int v = 0; v < NUM_SR_VARIANTS; v++) {
+        int base = v - (v % 2);
+        printf("%-26s %10.4f ms read %8.4f remap %8.4f write %8.4f waits read %8.4f write %8.4f Speedup %8.2lf\n",
+               stream_name[v], sum[v].total_time*per_dump, sum[v].read_time*per_dump, sum[v].remap_time*per_dump,
+               sum[v].write_time*per_dump, sum[v].read_wait*per_dump, sum[v].write_wait*per_dump,
+               sum[base].total_time/sum[v].total_time);
+    }
+
+    destroy(ocells);
+    for (uint d = 0; d < nfiles; d++) {
+        free(files[d]);
+    }
+    free(files);
+}
+
+// Exact average of sin(pi x) sin(pi y) over a cell, with the mesh covering
+// the unit square
+double sine_cell_average(uint i, uint j, uint lev, uint ibasesize){
+    double h = 1.0/(ibasesize*two_to_the(lev));
+    double avg_x = (cos(M_PI*i*h) - cos(M_PI*(i+1)*h))/(M_PI*h);
+    double avg_y = (cos(M_PI*j*h) - cos(M_PI*(j+1)*h))/(M_PI*h);
+    return avg_x*avg_y;
+}
+
+// Area weighted L1 error of a remapped sine field
+double l1_error_sine(cell_list cells){
+    double err = 0.0;
+    for (uint ic = 0; ic < cells.ncells; ic++) {
+        double exact = sine_cell_average(cells.i[ic], cells.j[ic], cells.level[ic], cells.ibasesize);
+        err += fabs(cells.values[ic] - exact)/four_to_the(cells.level[ic]);
+    }
+    return err/(cells.ibasesize*cells.ibasesize);
+}
+
+// Number of cells with a face neighbor more than one level finer, found
+// by painting the cell levels onto the finest grid. Skipped (returns 0)
+// when the finest grid would be too large.
+uint regrid_balance_violations(cell_list cells){
+    size_t fine_size = (size_t)cells.ibasesize*two_to_the(cells.levmax);
+    if (fine_size*fine_size > (1ul << 26)) return 0;
+
+    unsigned char *fine_level = (unsigned char *)malloc(fine_size*fine_size);
+    for (uint ic = 0; ic < cells.ncells; ic++) {
+        uint lev_mod = two_to_the(cells.levmax - cells.level[ic]);
+        for (uint jj = cells.j[ic]*lev_mod; jj < (cells.j[ic]+1)*lev_mod; jj++) {
+            for (uint ii = cells.i[ic]*lev_mod; ii < (cells.i[ic]+1)*lev_mod; ii++) {
+                fine_level[jj*fine_size + ii] = cells.level[ic];
+            }
+        }
+    }
+
+    uint violations = 0;
+    for (size_t jj = 0; jj < fine_size; jj++) {
+        for (size_t ii = 0; ii < fine_size; ii++) {
+            int lev = fine_level[jj*fine_size + ii];
+            if (ii+1 < fine_size && abs(lev - fine_level[jj*fine_size + ii+1]) > 1) violations++;
+            if (jj+1 < fine_size && abs(lev - fine_level[(jj+1)*fine_size + ii]) > 1) violations++;
+        }
+    }
+    free(fine_level);
+    return violations;
+}
+
+// STREAM style copy bandwidth in bytes per second on arrays well beyond the
+// size of the last level cache. Both the read and the write are counted as
+// in STREAM. Best of several trials.
+
+double stream_copy_bandwidth(void){
+    size_t n = 1 << 23;
+    double *a = (double *)malloc(n*sizeof(double));
+    double *c = (double *)malloc(n*sizeof(double));
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (size_t k = 0; k < n; k++){
+        a[k] = 1.0;
+        c[k] = 0.0;
+    }
+
+    double best_time = 1.0e30;
+    for (int trial = 0; trial < 5; trial++){
+        struct timeval tstart;
+        cpu_timer_start(&tstart);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (size_t k = 0; k < n; k++){
+            c[k] = a[k];
+        }
+        double time = cpu_timer_stop(tstart);
+        if (time < best_time) best_time = time;
+    }
+
+    free(a);
+    free(c);
+    return 2.0*n*sizeof(double)/best_time;
+}
+
+// Runs every templated remap kernel with the reduction Op and checks each
+// against brute force, or against the singlewrite remap with -no-brute
+template <class Op>
+void remap_reduce_op(const char *name, cell_list icells, const typename Op::value_type *ivalues, cell_list ocells,
+                     int run_brute, int run_tests, double tol, double *kernel_time){
+    typedef typename Op::value_type value_type;
+    struct timeval tstart;
+    char label[128];
+    uint olength = ocells.ncells;
+    value_type *val_answer = (value_type *)malloc(olength*sizeof(value_type));
+    value_type *val_test   = (value_type *)malloc(olength*sizeof(value_type));
+    double *check_answer   = (double *)malloc(olength*sizeof(double));
+    double *check_test     = (double *)malloc(olength*sizeof(double));
+
+    for (int k = 0; k < NUM_REDUCE_KERNELS; k++) {
+        if (k == RK_BRUTE && ! run_brute) continue;
+
+        value_type *ovalues = (k == RK_BRUTE || (k == RK_SINGLEWRITE && ! run_brute)) ? val_answer : val_test;
+        memset(ovalues, 0xFFFFFFFF, olength*sizeof(value_type));
+
+        cpu_timer_start(&tstart);
+        switch (k) {
+        case RK_BRUTE:                       brute_force_remap_op<Op>(icells, ivalues, ocells, ovalues);                       break;
+        case RK_FULL_PERFECT:                full_perfect_remap_op<Op>(icells, ivalues, ocells, ovalues);                      break;
+        case RK_SINGLEWRITE:                 singlewrite_remap_op<Op>(icells, ivalues, ocells, ovalues);                       break;
+        case RK_COMPACT_SINGLEWRITE:         singlewrite_remap_compact_op<Op>(icells, ivalues, ocells, ovalues);               break;
+        case RK_HIERARCHICAL:                h_remap_op<Op>(icells, ivalues, ocells, ovalues);                                 break;
+        case RK_COMPACT_HIERARCHICAL:        h_remap_compact_op<Op>(icells, ivalues, ocells, ovalues, factory);                break;
+#ifdef _OPENMP
+        case RK_FULL_PERFECT_OPENMP:         full_perfect_remap_op_openMP<Op>(icells, ivalues, ocells, ovalues);               break;
+        case RK_SINGLEWRITE_OPENMP:          singlewrite_remap_op_openMP<Op>(icells, ivalues, ocells, ovalues);                break;
+        case RK_COMPACT_SINGLEWRITE_OPENMP:  singlewrite_remap_compact_op_openMP<Op>(icells, ivalues, ocells, ovalues);        break;
+        case RK_HIERARCHICAL_OPENMP:         h_remap_op_openMP<Op>(icells, ivalues, ocells, ovalues);                          break;
+        case RK_COMPACT_HIERARCHICAL_OPENMP: h_remap_compact_op_openMP<Op>(icells, ivalues, ocells, ovalues, OpenMPfactory);   break;
+#endif
+        }
+        kernel_time[k] += cpu_timer_stop(tstart);
+
+        if (run_tests && ovalues == val_test) {
+            for (uint m = 0; m < olength; m++) {
+                check_answer[m] = val_answer[m];
+                check_test[m]   = val_test[m];
+            }
+            sprintf(label, "%s %s", name, reduce_kernel_name[k]);
+            check_output_rel(label, olength, check_test, check_answer, tol);
+        }
+    }
+
+    free(val_answer);
+    free(val_test);
+    free(check_answer);
+    free(check_test);
+}
+
 void check_output(const char *string, uint olength, double *output_val, double *val_test_answer){
     //printf("Checking %s\n",string);
     int icount = 0;
@@ -791,3 +3293,17 @@ void check_output(const char *string, uint olength, double *output_val, double *
         }
     }
 }
+
+// Like check_output, but allows a relative difference of tol for
+// reductions whose summation order differs between algorithms
+void check_output_rel(const char *string, uint olength, double *output_val, double *val_test_answer, double tol){
+    int icount = 0;
+    for (uint m = 0; m < olength; m++) {
+        if (fabs(output_val[m] - val_test_answer[m]) > tol*fabs(val_test_answer[m])) {
+            printf ("%s failed at cell %u\nExpected %f, but found %f\n",
+                string, m, val_test_answer[m], output_val[m]);
+            icount++;
+            if (icount > 6) return;
+        }
+    }
+}
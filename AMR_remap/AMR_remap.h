@@ -54,6 +54,7 @@ typedef unsigned int uint;
 #endif
 
 void check_output(const char *string, uint olength, double *output_val, double *val_test_answer);
+void check_output_rel(const char *string, uint olength, double *output_val, double *val_test_answer, double tol);
 
 #endif
 
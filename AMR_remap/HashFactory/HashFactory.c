@@ -904,8 +904,7 @@ int intintHash_GetTableType(intintHash_Table * table) {
 	return (0);
 }
 int intintHash_QuerySingle(intintHash_Table * table, int key, int *valueOutput) {
-	table->querySingleFunc(table, key, valueOutput);
-	return (0);
+	return table->querySingleFunc(table, key, valueOutput);
 }
 int intintHash_Insert(intintHash_Table * table, size_t numEntries, int *keys,
 		      int *values) {
@@ -0,0 +1,459 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "meshgen/meshgen.h"
+#include "amrex_plotfile.h"
+
+// The reader makes two passes over the FABs of all levels. The first only
+// uses the box lists to count the valid cells of each FAB, which gives each
+// FAB its place in the output. The second reads the chosen component of
+// each FAB straight into its place. Each thread keeps one FAB component
+// buffer and its own open data file, so no level is held in memory twice.
+
+#define PLOTFILE_LINE 4096
+
+typedef struct {
+    int lo[2], hi[2];
+} pf_box;
+
+typedef struct {
+    uint   level;
+    pf_box box;           // valid box, without ghost cells
+    char   file[PLOTFILE_LINE];
+    long   offset;        // start of the FAB in the data file
+    uint   nvalid;        // cells not covered by level+1
+    uint   out;           // index of the first valid cell in the output
+} pf_fab;
+
+typedef struct {
+    pf_box *box;
+    uint    nbox;
+} pf_level_boxes;
+
+static cell_list plotfile_empty(void) {
+    cell_list c;
+    memset(&c, 0, sizeof(c));
+    return c;
+}
+
+static int read_line(FILE *fp, char *line) {
+    if (fgets(line, PLOTFILE_LINE, fp) == NULL) return 0;
+    line[strcspn(line, "\r\n")] = '\0';
+    return 1;
+}
+
+// Parses "((lo0,lo1) (hi0,hi1) (t0,t1))" and returns the characters used,
+// or 0 if there is no box
+static int parse_box(const char *s, pf_box *b) {
+    int t0, t1, used = 0;
+    if (sscanf(s, " ((%d,%d) (%d,%d) (%d,%d))%n", &b->lo[0], &b->lo[1], &b->hi[0], &b->hi[1], &t0, &t1, &used) < 6) return 0;
+    return used;
+}
+
+// Marks the cells of coarse box cb that lie under any of the fine boxes,
+// with a refinement ratio of 2. Returns the number of uncovered cells.
+static uint covered_mask(pf_box cb, pf_level_boxes fine, unsigned char *mask) {
+    uint nx = cb.hi[0] - cb.lo[0] + 1;
+    uint ny = cb.hi[1] - cb.lo[1] + 1;
+    memset(mask, 0, nx*ny);
+    for (uint b = 0; b < fine.nbox; b++) {
+        int ilo = fine.box[b].lo[0] >> 1, ihi = fine.box[b].hi[0] >> 1;
+        int jlo = fine.box[b].lo[1] >> 1, jhi = fine.box[b].hi[1] >> 1;
+        if (ilo < cb.lo[0]) ilo = cb.lo[0];
+        if (jlo < cb.lo[1]) jlo = cb.lo[1];
+        if (ihi > cb.hi[0]) ihi = cb.hi[0];
+        if (jhi > cb.hi[1]) jhi = cb.hi[1];
+        for (int j = jlo; j <= jhi; j++) {
+            for (int i = ilo; i <= ihi; i++) {
+                mask[(j-cb.lo[1])*nx + (i-cb.lo[0])] = 1;
+            }
+        }
+    }
+    uint nvalid = 0;
+    for (uint n = 0; n < nx*ny; n++) {
+        nvalid += (mask[n] == 0);
+    }
+    return nvalid;
+}
+
+// Reads the chosen component of one FAB into buf and copies its valid,
+// uncovered cells to the output. fp, cur_file and buf carry the open data
+// file and the buffer from one FAB to the next on the same thread; the
+// buffer grows to the FAB box, which includes any ghost cells.
+static int read_fab(const char *dir, pf_fab *fab, pf_level_boxes fine, int comp, const int *domain_lo,
+                    FILE **fp, char *cur_file, double **buf_ptr, size_t *buf_npts, unsigned char *mask, cell_list c) {
+
+    if (*fp == NULL || strcmp(cur_file, fab->file) != 0) {
+        char path[2*PLOTFILE_LINE];
+        if (*fp != NULL) fclose(*fp);
+        snprintf(path, sizeof(path), "%s/%s", dir, fab->file);
+        *fp = fopen(path, "rb");
+        if (*fp == NULL) {
+            fprintf(stderr, "AMReX plotfile: cannot open %s\n", path);
+            return 0;
+        }
+        strcpy(cur_file, fab->file);
+    }
+
+    // FAB ((8, (64 11 52 0 1 12 0 1023)),(8, (8 7 6 5 4 3 2 1)))((0,0) (15,15) (0,0)) 1
+    char header[PLOTFILE_LINE];
+    int nbytes, order[8], nbytes_order, nfabcomp, used;
+    pf_box fb;
+    if (fseek(*fp, fab->offset, SEEK_SET) != 0 || fgets(header, PLOTFILE_LINE, *fp) == NULL ||
+        sscanf(header, "FAB ((%d, (%*d %*d %*d %*d %*d %*d %*d %*d)),(%d, (%n", &nbytes, &nbytes_order, &used) < 2) {
+        fprintf(stderr, "AMReX plotfile: bad FAB header in %s\n", fab->file);
+        return 0;
+    }
+    const char *s = header + used;
+    for (int k = 0; k < nbytes_order && k < 8; k++) {
+        int n;
+        sscanf(s, "%d%n", &order[k], &n);
+        s += n;
+    }
+    s = strstr(s, ")))");
+    if (s == NULL || (used = parse_box(s+3, &fb)) == 0 || sscanf(s+3+used, "%d", &nfabcomp) < 1 ||
+        (nbytes != 4 && nbytes != 8) || comp >= nfabcomp) {
+        fprintf(stderr, "AMReX plotfile: unsupported FAB header in %s\n", fab->file);
+        return 0;
+    }
+
+    uint fnx = fb.hi[0] - fb.lo[0] + 1;
+    uint fny = fb.hi[1] - fb.lo[1] + 1;
+    size_t npts = (size_t)fnx*fny;
+    if (npts > *buf_npts) {
+        free(*buf_ptr);
+        *buf_ptr = (double *)malloc(npts*sizeof(double));
+        *buf_npts = npts;
+    }
+    double *buf = *buf_ptr;
+    if (fseek(*fp, (long)(comp*npts*nbytes), SEEK_CUR) != 0 || fread(buf, nbytes, npts, *fp) != npts) {
+        fprintf(stderr, "AMReX plotfile: short read in %s\n", fab->file);
+        return 0;
+    }
+
+    // The byte order lists the significance of each byte, 1 the most
+    // significant, so a little endian file starts with nbytes
+    const uint16_t one = 1;
+    int host_little = *(const unsigned char *)&one == 1;
+    int file_little = order[0] == nbytes;
+    if (host_little != file_little) {
+        unsigned char *p = (unsigned char *)buf;
+        for (size_t n = 0; n < npts; n++, p += nbytes) {
+            for (int k = 0; k < nbytes/2; k++) {
+                unsigned char t = p[k];
+                p[k] = p[nbytes-1-k];
+                p[nbytes-1-k] = t;
+            }
+        }
+    }
+    if (nbytes == 4) {
+        float *fbuf = (float *)buf;
+        for (size_t n = npts; n > 0; n--) {
+            buf[n-1] = fbuf[n-1];
+        }
+    }
+
+    pf_box vb = fab->box;
+    uint nx = vb.hi[0] - vb.lo[0] + 1;
+    covered_mask(vb, fine, mask);
+    uint o = fab->out;
+    for (int j = vb.lo[1]; j <= vb.hi[1]; j++) {
+        for (int i = vb.lo[0]; i <= vb.hi[0]; i++) {
+            if (mask[(j-vb.lo[1])*nx + (i-vb.lo[0])]) continue;
+            c.i[o]      = i - domain_lo[0];
+            c.j[o]      = j - domain_lo[1];
+            c.level[o]  = fab->level;
+            c.values[o] = buf[(size_t)(j-fb.lo[1])*fnx + (i-fb.lo[0])];
+            o++;
+        }
+    }
+    return 1;
+}
+
+static cell_list read_amrex_plotfile_run (const char *dir, const char *component, int threaded) {
+
+    (void)threaded;
+    char line[PLOTFILE_LINE];
+    char path[2*PLOTFILE_LINE];
+
+    snprintf(path, sizeof(path), "%s/Header", dir);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "AMReX plotfile: cannot open %s\n", path);
+        return plotfile_empty();
+    }
+
+    int ncomp = 0, spacedim = 0, finest_level = -1, comp = -1;
+    read_line(fp, line);
+    if (strncmp(line, "HyperCLaw", 9) != 0) {
+        fprintf(stderr, "AMReX plotfile: %s is not a HyperCLaw plotfile header\n", path);
+        fclose(fp);
+        return plotfile_empty();
+    }
+    read_line(fp, line);
+    ncomp = atoi(line);
+    for (int c = 0; c < ncomp; c++) {
+        read_line(fp, line);
+        if (component != NULL && strcmp(line, component) == 0) comp = c;
+    }
+    if (component == NULL) {
+        comp = 0;
+    } else if (comp < 0) {
+        char *end;
+        long c = strtol(component, &end, 10);
+        if (*end == '\0' && c >= 0 && c < ncomp) comp = c;
+    }
+    if (comp < 0) {
+        fprintf(stderr, "AMReX plotfile: no component %s in %s\n", component, path);
+        fclose(fp);
+        return plotfile_empty();
+    }
+
+    read_line(fp, line);
+    spacedim = atoi(line);
+    read_line(fp, line);                       // time
+    read_line(fp, line);
+    finest_level = atoi(line);
+    read_line(fp, line);                       // prob_lo
+    read_line(fp, line);                       // prob_hi
+    if (spacedim != 2 || finest_level < 0) {
+        fprintf(stderr, "AMReX plotfile: only 2D plotfiles are supported\n");
+        fclose(fp);
+        return plotfile_empty();
+    }
+    uint nlev = finest_level + 1;
+
+    read_line(fp, line);                       // refinement ratios
+    const char *s = line;
+    for (uint lev = 0; lev < nlev-1; lev++) {
+        int ratio, n;
+        if (sscanf(s, "%d%n", &ratio, &n) < 1 || ratio != 2) {
+            fprintf(stderr, "AMReX plotfile: only a refinement ratio of 2 is supported\n");
+            fclose(fp);
+            return plotfile_empty();
+        }
+        s += n;
+    }
+
+    read_line(fp, line);                       // level domains
+    pf_box *domain = (pf_box *)malloc(nlev*sizeof(pf_box));
+    s = line;
+    for (uint lev = 0; lev < nlev; lev++) {
+        int used = parse_box(s, &domain[lev]);
+        s += used;
+        if (used == 0) {
+            fprintf(stderr, "AMReX plotfile: bad level domain in %s\n", path);
+            free(domain);
+            fclose(fp);
+            return plotfile_empty();
+        }
+    }
+    int ibasesize = domain[0].hi[0] - domain[0].lo[0] + 1;
+    if (domain[0].hi[1] - domain[0].lo[1] + 1 != ibasesize) {
+        fprintf(stderr, "AMReX plotfile: level 0 domain is not square\n");
+        free(domain);
+        fclose(fp);
+        return plotfile_empty();
+    }
+
+    read_line(fp, line);                       // level steps
+    for (uint lev = 0; lev < nlev; lev++) {
+        read_line(fp, line);                   // cell sizes
+    }
+    read_line(fp, line);                       // coordinate system
+    read_line(fp, line);                       // boundary width
+
+    char (*level_path)[PLOTFILE_LINE] = (char (*)[PLOTFILE_LINE])malloc(nlev*PLOTFILE_LINE);
+    for (uint lev = 0; lev < nlev; lev++) {
+        int ngrids = 0;
+        read_line(fp, line);
+        sscanf(line, "%*d %d", &ngrids);
+        read_line(fp, line);                   // step
+        for (int g = 0; g < ngrids*spacedim; g++) {
+            read_line(fp, line);               // physical box bounds
+        }
+        read_line(fp, level_path[lev]);
+    }
+    fclose(fp);
+
+    // Box lists and FAB locations from each level's Cell_H
+    pf_level_boxes *boxes = (pf_level_boxes *)calloc(nlev+1, sizeof(pf_level_boxes));
+    pf_fab *fab = NULL;
+    uint nfab = 0;
+    int ok = 1;
+    for (uint lev = 0; lev < nlev && ok; lev++) {
+        snprintf(path, sizeof(path), "%s/%s_H", dir, level_path[lev]);
+        fp = fopen(path, "r");
+        if (fp == NULL) {
+            fprintf(stderr, "AMReX plotfile: cannot open %s\n", path);
+            ok = 0;
+            break;
+        }
+        for (int k = 0; k < 4; k++) {
+            read_line(fp, line);               // version, how, ncomp, nghost
+        }
+        read_line(fp, line);
+        uint nbox = 0;
+        sscanf(line, "(%u", &nbox);
+        boxes[lev].nbox = nbox;
+        boxes[lev].box = (pf_box *)malloc(nbox*sizeof(pf_box));
+        for (uint b = 0; b < nbox; b++) {
+            read_line(fp, line);
+            if (parse_box(line, &boxes[lev].box[b]) == 0) ok = 0;
+        }
+        read_line(fp, line);                   // )
+        read_line(fp, line);
+        if ((uint)atoi(line) != nbox) ok = 0;
+
+        // the directory of the Cell_H file holds its data files
+        char level_dir[PLOTFILE_LINE];
+        strcpy(level_dir, level_path[lev]);
+        char *slash = strrchr(level_dir, '/');
+        if (slash != NULL) slash[1] = '\0'; else level_dir[0] = '\0';
+
+        fab = (pf_fab *)realloc(fab, (nfab+nbox)*sizeof(pf_fab));
+        for (uint b = 0; b < nbox && ok; b++) {
+            char name[PLOTFILE_LINE];
+            read_line(fp, line);
+            if (sscanf(line, "FabOnDisk: %s %ld", name, &fab[nfab].offset) < 2) {
+                ok = 0;
+                break;
+            }
+            if (snprintf(fab[nfab].file, PLOTFILE_LINE, "%s%s", level_dir, name) >= PLOTFILE_LINE) {
+                fprintf(stderr, "AMReX plotfile: path of %s in %s is too long\n", name, path);
+                ok = 0;
+                break;
+            }
+            fab[nfab].level = lev;
+            fab[nfab].box = boxes[lev].box[b];
+            nfab++;
+        }
+        fclose(fp);
+        if (! ok) fprintf(stderr, "AMReX plotfile: bad box list in %s\n", path);
+    }
+
+    cell_list c = plotfile_empty();
+    if (ok) {
+        // Valid cells of each FAB, then their place in the output
+        size_t max_npts = 0;
+        for (uint f = 0; f < nfab; f++) {
+            size_t npts = (size_t)(fab[f].box.hi[0] - fab[f].box.lo[0] + 1)*(fab[f].box.hi[1] - fab[f].box.lo[1] + 1);
+            if (npts > max_npts) max_npts = npts;
+        }
+
+#ifdef _OPENMP
+#pragma omp parallel if(threaded)
+#endif
+        {
+            unsigned char *mask = (unsigned char *)malloc(max_npts);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+            for (uint f = 0; f < nfab; f++) {
+                fab[f].nvalid = covered_mask(fab[f].box, boxes[fab[f].level+1], mask);
+            }
+            free(mask);
+        }
+
+        uint ncells = 0;
+        for (uint f = 0; f < nfab; f++) {
+            fab[f].out = ncells;
+            ncells += fab[f].nvalid;
+        }
+
+        c.ibasesize = ibasesize;
+        c.levmax = finest_level;
+        c = create_cell_list(c, ncells);
+
+#ifdef _OPENMP
+#pragma omp parallel if(threaded) reduction(&&:ok)
+#endif
+        {
+            unsigned char *mask = (unsigned char *)malloc(max_npts);
+            size_t buf_npts = 0;
+            double *buf = NULL;
+            FILE *dfp = NULL;
+            char cur_file[PLOTFILE_LINE] = "";
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+            for (uint f = 0; f < nfab; f++) {
+                if (! ok) continue;
+                pf_box *d = &domain[fab[f].level];
+                if (fab[f].box.lo[0] < d->lo[0] || fab[f].box.lo[1] < d->lo[1] ||
+                    fab[f].box.hi[0] > d->hi[0] || fab[f].box.hi[1] > d->hi[1] ||
+                    d->hi[0] < d->lo[0] ||
+                    (uint)(d->hi[0] - d->lo[0] + 1) != ibasesize*two_to_the(fab[f].level) ||
+                    ! read_fab(dir, &fab[f], boxes[fab[f].level+1], comp, d->lo, &dfp, cur_file, &buf, &buf_npts, mask, c)) {
+                    ok = 0;
+                }
+            }
+            if (dfp != NULL) fclose(dfp);
+            free(buf);
+            free(mask);
+        }
+
+        if (ok) {
+            c.dist = (uint *)calloc(nlev, sizeof(uint));
+            for (uint n = 0; n < c.ncells; n++) {
+                c.dist[c.level[n]]++;
+            }
+        } else {
+            fprintf(stderr, "AMReX plotfile: failed reading the FAB data of %s\n", dir);
+            destroy(c);
+            c = plotfile_empty();
+        }
+    }
+
+    for (uint lev = 0; lev < nlev; lev++) {
+        free(boxes[lev].box);
+    }
+    free(boxes);
+    free(fab);
+    free(level_path);
+    free(domain);
+    return c;
+}
+
+cell_list read_amrex_plotfile (const char *dir, const char *component) {
+    return read_amrex_plotfile_run(dir, component, 0);
+}
+
+#ifdef _OPENMP
+cell_list read_amrex_plotfile_openMP (const char *dir, const char *component) {
+    return read_amrex_plotfile_run(dir, component, 1);
+}
+#endif
@@ -0,0 +1,46 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#ifndef AMREX_PLOTFILE_H
+#define AMREX_PLOTFILE_H
+
+#include "meshgen/meshgen.h"
+
+// Reads a 2D AMReX plotfile directory (HyperCLaw-V1.1 Header, Level_<n>/Cell_H
+// and the Cell_D FAB files) into a cell_list holding the valid cells, those
+// not covered by a finer level, with values from the named component. The
+// component is a name from the Header or a component number; NULL means the
+// first one. The level 0 domain must be square and every refinement ratio 2.
+// On error a message is printed and a cell_list with ncells 0 is returned.
+cell_list read_amrex_plotfile (const char *dir, const char *component);
+cell_list read_amrex_plotfile_openMP (const char *dir, const char *component);
+
+#endif
@@ -0,0 +1,198 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#include <sys/time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "amrremap.h"
+#include "brute_force_remap.h"
+#include "full_perfect_remap.h"
+#include "singlewrite_remap.h"
+#include "hierarchical_remap.h"
+#include "HashFactory/HashFactory.h"
+#include "timer.h"
+
+#define AMRREMAP_LOAD_FACTOR 0.3333333
+
+static const char *const algorithm_name[AMRREMAP_NUM_ALGORITHMS] = {
+   "Brute Force", "Full Perfect Remap", "Singlewrite Remap", "Hierarchical Remap",
+   "Compact Hierarchical Remap",
+};
+
+void amrremap_options_init(amrremap_options *opts) {
+    opts->algorithm   = AMRREMAP_HIERARCHICAL;
+    opts->nthreads    = 0;
+    opts->hash_type   = AMRREMAP_HASH_DEFAULT;
+    opts->load_factor = 0.0f;
+    opts->diagnostics = 0;
+}
+
+const char *amrremap_algorithm_name(amrremap_algorithm algorithm) {
+    if (algorithm < 0 || algorithm >= AMRREMAP_NUM_ALGORITHMS) return "Unknown";
+    return algorithm_name[algorithm];
+}
+
+// Hash factory ids for the requested table type, from either the C or the
+// OpenMP family of tables
+static int hash_type_ids(amrremap_hash_type hash_type, int threaded) {
+    switch (hash_type) {
+    case AMRREMAP_HASH_DEFAULT:
+        return threaded ? (LCG_QUADRATIC_OPEN_COMPACT_OPENMP_HASH_ID | IDENTITY_SENTINEL_PERFECT_OPENMP_HASH_ID)
+                        : LCG_QUADRATIC_OPEN_COMPACT_HASH_ID;
+    case AMRREMAP_HASH_PERFECT:
+        return threaded ? IDENTITY_SENTINEL_PERFECT_OPENMP_HASH_ID : IDENTITY_SENTINEL_PERFECT_HASH_ID;
+    case AMRREMAP_HASH_LINEAR:
+        return threaded ? LCG_LINEAR_OPEN_COMPACT_OPENMP_HASH_ID : LCG_LINEAR_OPEN_COMPACT_HASH_ID;
+    case AMRREMAP_HASH_QUADRATIC:
+        return threaded ? LCG_QUADRATIC_OPEN_COMPACT_OPENMP_HASH_ID : LCG_QUADRATIC_OPEN_COMPACT_HASH_ID;
+    case AMRREMAP_HASH_ANY:
+        return threaded ? HASH_ALL_OPENMP_HASHES : HASH_ALL_C_HASHES;
+    }
+    return 0;
+}
+
+int amrremap_remap(cell_list icells, cell_list ocells, const amrremap_options *opts, amrremap_stats *stats) {
+
+    amrremap_options defaults;
+    if (opts == NULL) {
+        amrremap_options_init(&defaults);
+        opts = &defaults;
+    }
+
+    if (opts->algorithm < 0 || opts->algorithm >= AMRREMAP_NUM_ALGORITHMS) return AMRREMAP_ERROR_ALGORITHM;
+    if (icells.ibasesize != ocells.ibasesize) return AMRREMAP_ERROR_MESH;
+
+    // The thread count is set on the calling thread's own OpenMP data
+    // environment and put back afterwards, so other application threads
+    // are not affected
+    int threaded = 0;
+    int nthreads = 1;
+#ifdef _OPENMP
+    int saved_nthreads = omp_get_max_threads();
+    if (opts->nthreads != 1 && opts->algorithm != AMRREMAP_BRUTE_FORCE) {
+        threaded = 1;
+        if (opts->nthreads > 1) omp_set_num_threads(opts->nthreads);
+        nthreads = omp_get_max_threads();
+    }
+#endif
+
+    intintHash_Factory *factory = NULL;
+    int hash_ids = 0;
+    if (opts->algorithm == AMRREMAP_COMPACT_HIERARCHICAL) {
+        hash_ids = hash_type_ids(opts->hash_type, threaded);
+        if (hash_ids == 0) {
+#ifdef _OPENMP
+            omp_set_num_threads(saved_nthreads);
+#endif
+            return AMRREMAP_ERROR_HASH_TYPE;
+        }
+        int empty_value = -5;
+        factory = intintHash_CreateFactory(hash_ids, &empty_value, 0, NULL, NULL);
+    }
+    float load_factor = opts->load_factor > 0.0f ? opts->load_factor : AMRREMAP_LOAD_FACTOR;
+
+    remap_diag fused;
+    remap_diag *diag = opts->diagnostics ? &fused : NULL;
+    int diag_fused = 0;
+
+    struct timeval timer;
+    cpu_timer_start(&timer);
+
+    switch (opts->algorithm) {
+    case AMRREMAP_BRUTE_FORCE:
+        brute_force_remap(icells, ocells);
+        break;
+    case AMRREMAP_FULL_PERFECT:
+#ifdef _OPENMP
+        if (threaded) { full_perfect_remap_openMP(icells, ocells, diag); }
+        else
+#endif
+        full_perfect_remap(icells, ocells, diag);
+        diag_fused = 1;
+        break;
+    case AMRREMAP_SINGLEWRITE:
+#ifdef _OPENMP
+        if (threaded) { singlewrite_remap_op_openMP<ReduceMean>(icells, icells.values, ocells, ocells.values, diag); }
+        else
+#endif
+        singlewrite_remap_op<ReduceMean>(icells, icells.values, ocells, ocells.values, diag);
+        diag_fused = 1;
+        break;
+    case AMRREMAP_HIERARCHICAL:
+#ifdef _OPENMP
+        if (threaded) { h_remap_op_openMP<ReduceMean>(icells, icells.values, ocells, ocells.values, diag); }
+        else
+#endif
+        h_remap_op<ReduceMean>(icells, icells.values, ocells, ocells.values, diag);
+        diag_fused = 1;
+        break;
+    case AMRREMAP_COMPACT_HIERARCHICAL:
+#ifdef _OPENMP
+        if (threaded) { h_remap_compact_config_openMP(icells, ocells, factory, hash_ids, load_factor, diag); }
+        else
+#endif
+        h_remap_compact_config(icells, ocells, factory, hash_ids, load_factor, diag);
+        diag_fused = 1;
+        break;
+    default:
+        break;
+    }
+
+    double time = cpu_timer_stop(timer);
+
+    // The brute force remap has no fused accumulation and gets a separate sweep
+    if (diag != NULL && ! diag_fused) {
+#ifdef _OPENMP
+        if (threaded) remap_diag_sweep_openMP(icells, icells.values, ocells, ocells.values, diag);
+        else
+#endif
+        remap_diag_sweep(icells, icells.values, ocells, ocells.values, diag);
+    }
+
+    if (factory != NULL) intintHash_DestroyFactory(factory);
+#ifdef _OPENMP
+    omp_set_num_threads(saved_nthreads);
+#endif
+
+    if (stats != NULL) {
+        stats->time     = time;
+        stats->nthreads = nthreads;
+        stats->ninput   = icells.ncells;
+        stats->noutput  = ocells.ncells;
+        if (diag != NULL) stats->diag = fused;
+        else remap_diag_reset(&stats->diag);
+    }
+
+    return AMRREMAP_SUCCESS;
+}
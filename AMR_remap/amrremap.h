@@ -0,0 +1,100 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#ifndef AMRREMAP_H
+#define AMRREMAP_H
+
+// Public interface of libamrremap. Everything a remap needs is passed in
+// the call, and the library keeps no mutable state between calls, so
+// separate application threads may remap concurrently.
+
+#include "meshgen/meshgen.h"
+#include "remap_diag.h"
+
+#define AMRREMAP_VERSION_MAJOR 1
+#define AMRREMAP_VERSION_MINOR 0
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    AMRREMAP_BRUTE_FORCE = 0,
+    AMRREMAP_FULL_PERFECT,
+    AMRREMAP_SINGLEWRITE,
+    AMRREMAP_HIERARCHICAL,
+    AMRREMAP_COMPACT_HIERARCHICAL,
+    AMRREMAP_NUM_ALGORITHMS
+} amrremap_algorithm;
+
+// Hash tables the compact hierarchical remap may use for each level
+typedef enum {
+    AMRREMAP_HASH_DEFAULT = 0,   // what the AMR_remap driver uses
+    AMRREMAP_HASH_PERFECT,       // sentinel perfect hash
+    AMRREMAP_HASH_LINEAR,        // compact hash with linear probing
+    AMRREMAP_HASH_QUADRATIC,     // compact hash with quadratic probing
+    AMRREMAP_HASH_ANY            // let the hash factory pick per level
+} amrremap_hash_type;
+
+#define AMRREMAP_SUCCESS            0
+#define AMRREMAP_ERROR_ALGORITHM   -1
+#define AMRREMAP_ERROR_HASH_TYPE   -2
+#define AMRREMAP_ERROR_MESH        -3
+
+typedef struct {
+    amrremap_algorithm algorithm;
+    int nthreads;                // 0 for the OpenMP default, 1 for the serial kernels
+    amrremap_hash_type hash_type;
+    float load_factor;           // 0.0 for the default
+    int diagnostics;             // fill in the conservation diagnostics, accumulated
+                                 // inside the remap except for brute force, which
+                                 // takes a separate sweep over both meshes
+} amrremap_options;
+
+typedef struct {
+    double time;                 // wall time of the remap in seconds
+    int nthreads;                // threads the remap ran on
+    uint ninput, noutput;
+    remap_diag diag;             // only set when diagnostics are requested
+} amrremap_stats;
+
+void amrremap_options_init(amrremap_options *opts);
+const char *amrremap_algorithm_name(amrremap_algorithm algorithm);
+
+// Remaps icells.values onto ocells.values. Both meshes must share the
+// same base size. stats may be NULL.
+int amrremap_remap(cell_list icells, cell_list ocells, const amrremap_options *opts, amrremap_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
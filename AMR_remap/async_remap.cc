@@ -0,0 +1,264 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "async_remap.h"
+#include "hierarchical_remap.h"
+
+#define NUM_HASH_BUFFERS 2
+
+typedef struct {
+    int **h_hash;
+    uint ibasesize;
+    uint levmax;
+    int  busy;
+} hash_buffer;
+
+struct remap_handle {
+    struct remap_pool *pool;
+    cell_list icells;
+    cell_list ocells;
+    hash_buffer *buf;
+    uint chunks_left;
+    int  done;
+};
+
+typedef struct remap_task {
+    remap_handle *handle;
+    int  is_build;
+    uint ostart, oend;
+    struct remap_task *next;
+} remap_task;
+
+struct remap_pool {
+    pthread_t *threads;
+    uint nthreads;
+    pthread_mutex_t lock;
+    pthread_cond_t  work_ready;  // a task was queued or the pool is closing
+    pthread_cond_t  remap_done;  // a remap finished and released its buffer
+    remap_task *head, *tail;
+    int shutdown;
+    hash_buffer buf[NUM_HASH_BUFFERS];
+};
+
+// Private functions to this file
+static void enqueue_task(remap_pool *pool, remap_task *task);
+static void run_task(remap_pool *pool, remap_task *task);
+static void *worker_main(void *arg);
+static int buffers_busy(remap_pool *pool);
+
+// Called with the pool lock held
+static void enqueue_task(remap_pool *pool, remap_task *task) {
+    task->next = NULL;
+    if (pool->tail == NULL) {
+        pool->head = task;
+    } else {
+        pool->tail->next = task;
+    }
+    pool->tail = task;
+}
+
+static void run_task(remap_pool *pool, remap_task *task) {
+    remap_handle *h = task->handle;
+
+    if (task->is_build) {
+        h_remap_build(h->icells, h->buf->h_hash);
+
+        // Split the queries so the idle workers can share them
+        uint olength = h->ocells.ncells;
+        uint nchunks = pool->nthreads;
+        if (nchunks > olength) nchunks = olength;
+        if (nchunks == 0) nchunks = 1;
+
+        pthread_mutex_lock(&pool->lock);
+        h->chunks_left = nchunks;
+        for (uint c = 0; c < nchunks; c++) {
+            remap_task *query = (remap_task *)malloc(sizeof(remap_task));
+            query->handle   = h;
+            query->is_build = 0;
+            query->ostart   = (uint)((size_t)olength*c/nchunks);
+            query->oend     = (uint)((size_t)olength*(c+1)/nchunks);
+            enqueue_task(pool, query);
+        }
+        pthread_cond_broadcast(&pool->work_ready);
+        pthread_mutex_unlock(&pool->lock);
+    } else {
+        h_remap_query(h->icells, h->buf->h_hash, h->ocells, task->ostart, task->oend);
+
+        pthread_mutex_lock(&pool->lock);
+        h->chunks_left--;
+        if (h->chunks_left == 0) {
+            h->buf->busy = 0;
+            h->done = 1;
+            pthread_cond_broadcast(&pool->remap_done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// Called with the pool lock held
+static int buffers_busy(remap_pool *pool) {
+    for (int b = 0; b < NUM_HASH_BUFFERS; b++) {
+        if (pool->buf[b].busy) return 1;
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg) {
+    remap_pool *pool = (remap_pool *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->head == NULL && ! pool->shutdown) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->head == NULL) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        remap_task *task = pool->head;
+        pool->head = task->next;
+        if (pool->head == NULL) pool->tail = NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_task(pool, task);
+        free(task);
+    }
+    return NULL;
+}
+
+remap_pool *remap_pool_create(uint nthreads) {
+    remap_pool *pool = (remap_pool *)malloc(sizeof(remap_pool));
+
+    if (nthreads < 1) nthreads = 1;
+    pool->nthreads = nthreads;
+    pool->head     = NULL;
+    pool->tail     = NULL;
+    pool->shutdown = 0;
+    for (int b = 0; b < NUM_HASH_BUFFERS; b++) {
+        pool->buf[b].h_hash    = NULL;
+        pool->buf[b].ibasesize = 0;
+        pool->buf[b].levmax    = 0;
+        pool->buf[b].busy      = 0;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->remap_done, NULL);
+
+    pool->threads = (pthread_t *)malloc(nthreads*sizeof(pthread_t));
+    for (uint t = 0; t < nthreads; t++) {
+        pthread_create(&pool->threads[t], NULL, worker_main, pool);
+    }
+    return pool;
+}
+
+// Outstanding remaps are finished before the workers exit
+void remap_pool_destroy(remap_pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (buffers_busy(pool)) {
+        pthread_cond_wait(&pool->remap_done, &pool->lock);
+    }
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (uint t = 0; t < pool->nthreads; t++) {
+        pthread_join(pool->threads[t], NULL);
+    }
+    free(pool->threads);
+
+    for (int b = 0; b < NUM_HASH_BUFFERS; b++) {
+        if (pool->buf[b].h_hash != NULL) h_hash_free(pool->buf[b].h_hash, pool->buf[b].levmax);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->remap_done);
+    free(pool);
+}
+
+remap_handle *remap_submit(remap_pool *pool, cell_list icells, cell_list ocells) {
+    hash_buffer *buf = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    while (buf == NULL) {
+        for (int b = 0; b < NUM_HASH_BUFFERS; b++) {
+            if (! pool->buf[b].busy) {
+                buf = &pool->buf[b];
+                break;
+            }
+        }
+        if (buf == NULL) pthread_cond_wait(&pool->remap_done, &pool->lock);
+    }
+    buf->busy = 1;
+    pthread_mutex_unlock(&pool->lock);
+
+    // The buffer is ours now, so it can be resized outside the lock
+    if (buf->h_hash == NULL || buf->ibasesize != icells.ibasesize || buf->levmax != icells.levmax) {
+        if (buf->h_hash != NULL) h_hash_free(buf->h_hash, buf->levmax);
+        buf->h_hash    = h_hash_alloc(icells.ibasesize, icells.levmax);
+        buf->ibasesize = icells.ibasesize;
+        buf->levmax    = icells.levmax;
+    }
+
+    remap_handle *h = (remap_handle *)malloc(sizeof(remap_handle));
+    h->pool        = pool;
+    h->icells      = icells;
+    h->ocells      = ocells;
+    h->buf         = buf;
+    h->chunks_left = 0;
+    h->done        = 0;
+
+    remap_task *build = (remap_task *)malloc(sizeof(remap_task));
+    build->handle   = h;
+    build->is_build = 1;
+    build->ostart   = 0;
+    build->oend     = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    enqueue_task(pool, build);
+    pthread_cond_signal(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    return h;
+}
+
+void remap_wait(remap_handle *handle) {
+    remap_pool *pool = handle->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    while (! handle->done) {
+        pthread_cond_wait(&pool->remap_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    free(handle);
+}
@@ -0,0 +1,54 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+#ifndef ASYNC_REMAP_H
+#define ASYNC_REMAP_H
+
+#include "meshgen/meshgen.h"
+
+// Asynchronous hierarchical remap on a small pthread pool. A submitted
+// remap first builds the input hash as one task and then queries the
+// output cells in chunks, so the build for the next mesh can run while
+// the queries for the current one finish. The pool owns two sets of hash
+// tables (double buffering); a third submit blocks until one is released.
+//
+// The cell lists handed to remap_submit must stay alive and unmodified
+// until remap_wait returns for that handle.
+
+typedef struct remap_pool remap_pool;
+typedef struct remap_handle remap_handle;
+
+remap_pool *remap_pool_create (uint nthreads);
+void remap_pool_destroy (remap_pool *pool);
+remap_handle *remap_submit (remap_pool *pool, cell_list icells, cell_list ocells);
+// Blocks until the remap is done and frees the handle
+void remap_wait (remap_handle *handle);
+
+#endif
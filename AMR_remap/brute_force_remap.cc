@@ -51,13 +51,17 @@ uint translate_cell (uint i, uint j, uint lev, uint new_lev, uint ibasesize) {
     return key;
 }
 
-void brute_force_remap (cell_list icells, cell_list ocells) {
+template <class Op>
+void brute_force_remap_op (cell_list icells, const typename Op::value_type *ivalues,
+                           cell_list ocells, typename Op::value_type *ovalues) {
     
     for(uint o = 0; o<ocells.ncells; o++){
-        ocells.values[o] = 0;
+        ovalues[o] = 0;
     }
     
     for (uint o = 0; o < ocells.ncells; o++){
+        typename Op::acc_type sum = Op::identity();
+        bool covered = false;
         for (uint i = 0; i < icells.ncells; i++){
             uint lev_out = ocells.level[o];
             uint lev_in = icells.level[i];
@@ -69,17 +73,44 @@ void brute_force_remap (cell_list icells, cell_list ocells) {
                 uint key_in = j_in * icells.ibasesize*two_to_the(lev_in) + i_in;
                 uint key_out = translate_cell(i_out, j_out, lev_out, lev_in, ocells.ibasesize);
                 if (key_in == key_out){
-                    ocells.values[o] = icells.values[i];
+                    ovalues[o] = Op::split(ivalues[i], lev_out - lev_in);
+                    covered = true;
                     continue;
                 }
             }else{
                 uint key_out = j_out * ocells.ibasesize*two_to_the(lev_out) + i_out;
                 uint key_in = translate_cell(i_in, j_in, lev_in, lev_out, icells.ibasesize);
                 if (key_out == key_in){
-                    ocells.values[o] += (icells.values[i] / four_to_the(lev_in - lev_out));
+                    if (Op::point_sample) {
+                        // keep only the cell holding the output cell center
+                        uint shift = lev_in - lev_out;
+                        if (shift == 0 || (i_in == (2*i_out + 1) << (shift - 1) &&
+                                           j_in == (2*j_out + 1) << (shift - 1))) {
+                            sum = Op::load(icells, ivalues, i);
+                        }
+                    } else {
+                        sum = Op::combine(sum, Op::scale(Op::load(icells, ivalues, i), lev_in - lev_out));
+                    }
                 }
             }
         }
+        if (! covered) ovalues[o] = Op::result(sum);
     }
 }
 
+void brute_force_remap (cell_list icells, cell_list ocells) {
+    brute_force_remap_op<ReduceMean>(icells, icells.values, ocells, ocells.values);
+}
+
+#define INSTANTIATE_BRUTE_FORCE_OP(Op) \
+template void brute_force_remap_op<Op> (cell_list icells, const Op::value_type *ivalues, \
+                                        cell_list ocells, Op::value_type *ovalues);
+
+INSTANTIATE_BRUTE_FORCE_OP(ReduceMean)
+INSTANTIATE_BRUTE_FORCE_OP(ReduceMeanFloat)
+INSTANTIATE_BRUTE_FORCE_OP(ReduceSum)
+INSTANTIATE_BRUTE_FORCE_OP(ReduceMin)
+INSTANTIATE_BRUTE_FORCE_OP(ReduceMax)
+INSTANTIATE_BRUTE_FORCE_OP(ReduceVolumeWeighted)
+INSTANTIATE_BRUTE_FORCE_OP(ReduceMajority)
+INSTANTIATE_BRUTE_FORCE_OP(ReduceNearest)
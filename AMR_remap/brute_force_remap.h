@@ -32,7 +32,10 @@
 #define BRUTE_FORCE_REMAP_H
 
 #include "meshgen/meshgen.h"
+#include "reduction_ops.h"
 
 void brute_force_remap (cell_list icells, cell_list ocells);
+template <class Op> void brute_force_remap_op (cell_list icells, const typename Op::value_type *ivalues,
+                                               cell_list ocells, typename Op::value_type *ovalues);
 
 #endif
@@ -30,15 +30,54 @@
 
 #include "meshgen/meshgen.h"
 #include "genmalloc/genmalloc.h"
+#include "genmalloc/first_touch.h"
 #include "full_perfect_remap.h"
+#include <sys/time.h>
+#include "timer.h"
 #include "stdio.h"
 #include <assert.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
+// Spans at least this many entries long are written with non-temporal
+// stores so the fill does not read the destination lines into cache
+#define STREAM_SPAN_MIN 256
+
+// Fills n entries of a hash row with the same cell index
+static inline void fill_span(uint *dst, uint val, uint n) {
+#ifdef __SSE2__
+    if (n >= STREAM_SPAN_MIN) {
+        // Scalar head up to a 16 byte boundary, streaming body, scalar tail
+        while (((size_t)dst & 15) && n > 0) {
+            *dst++ = val;
+            n--;
+        }
+        __m128i vval = _mm_set1_epi32((int)val);
+        for (; n >= 4; n -= 4, dst += 4) {
+            _mm_stream_si128((__m128i *)dst, vval);
+        }
+    }
+#endif
+    for (uint k = 0; k < n; k++) {
+        dst[k] = val;
+    }
+}
+
+static inline void fill_fence(void) {
+#ifdef __SSE2__
+    _mm_sfence();
+#endif
+}
 
-double avg_sub_cells (cell_list icells, uint ji, uint ii, uint level, uint *hash) {
+
+template <class Op>
+static typename Op::acc_type avg_sub_cells_op (cell_list icells, const typename Op::value_type *values,
+    uint ji, uint ii, uint level, uint *hash) {
 
     uint key, i_max, jump;
-    double sum = 0.0;
+    typename Op::acc_type sum = Op::identity();
     i_max = icells.ibasesize*two_to_the(icells.levmax);
     jump = two_to_the(icells.levmax - level - 1);
     
@@ -47,17 +86,44 @@ double avg_sub_cells (cell_list icells, uint ji, uint ii, uint level, uint *hash
             key = ((ji + (j*jump)) * i_max) + (ii + (i*jump));
             uint probe = hash[key];
             if (icells.level[probe] == (level + 1)) {
-                sum += icells.values[probe];
+                sum = Op::combine(sum, Op::load(icells, values, probe));
             } else {
-                sum += avg_sub_cells(icells, ji + (j*jump), ii + (i*jump), level + 1, hash);
+                sum = Op::combine(sum, avg_sub_cells_op<Op>(icells, values, ji + (j*jump), ii + (i*jump), level + 1, hash));
             }
         }
     }
     
-    return sum/4.0;
+    return Op::quad(sum);
+}
+
+double avg_sub_cells (cell_list icells, uint ji, uint ii, uint level, uint *hash) {
+    return avg_sub_cells_op<ReduceMean>(icells, icells.values, ji, ii, level, hash);
 }
 
-void full_perfect_remap (cell_list icells, cell_list ocells) {
+// Output value of the cell at fine point (ii, jj) and level lev. Every fine
+// point of the table holds its input cell, so a point sample reads the one
+// under the center of the output cell directly.
+template <class Op>
+static inline typename Op::value_type full_perfect_query_op (cell_list icells, const typename Op::value_type *ivalues,
+    uint *hash, uint i_max, uint ii, uint jj, uint lev) {
+
+    uint key = hash[(jj*i_max)+ii];
+
+    if (lev >= icells.level[key]) {
+        return Op::split(ivalues[key], lev - icells.level[key]);
+    } else if (Op::point_sample) {
+        uint half = two_to_the(icells.levmax - lev - 1);
+        return ivalues[hash[((jj+half)*i_max)+ii+half]];
+    }
+    return Op::result(avg_sub_cells_op<Op>(icells, ivalues, jj, ii, lev, hash));
+}
+
+template <class Op>
+void full_perfect_remap_op (cell_list icells, const typename Op::value_type *ivalues,
+                            cell_list ocells, typename Op::value_type *ovalues, remap_diag *diag) {
+
+    double in_sum = 0.0, in_min = DBL_MAX, in_max = -DBL_MAX;
+    double out_sum = 0.0, out_min = DBL_MAX, out_max = -DBL_MAX;
 
     // Allocate a hash table the size of the finest level of the grid
     size_t hash_size = icells.ibasesize*icells.ibasesize*four_to_the(icells.levmax);
@@ -76,6 +142,7 @@ void full_perfect_remap (cell_list icells, cell_list ocells) {
         uint lev = icells.level[ic];
         uint i = icells.i[ic];
         uint j = icells.j[ic];
+        if (diag != NULL) remap_diag_accum(ivalues[ic], lev, &in_sum, &in_min, &in_max);
         // If at the maximum level just set the one cell
         if (lev == icells.levmax) {
             hash[(j*i_max)+i] = ic;
@@ -102,8 +169,53 @@ void full_perfect_remap (cell_list icells, cell_list ocells) {
         ii = i*lev_mod;
         jj = j*lev_mod;
 
+        ovalues[ic] = full_perfect_query_op<Op>(icells, ivalues, hash, i_max, ii, jj, lev);
+        if (diag != NULL) remap_diag_accum(ovalues[ic], lev, &out_sum, &out_min, &out_max);
+    }
+
+    // Deallocate hash table
+    free(hash);
+
+    if (diag != NULL) remap_diag_set(diag, in_sum, in_min, in_max, out_sum, out_min, out_max);
+}
+
+void full_perfect_remap (cell_list icells, cell_list ocells, remap_diag *diag) {
+    full_perfect_remap_op<ReduceMean>(icells, icells.values, ocells, ocells.values, diag);
+}
+
+// Block fill version of the full perfect remap. Each coarse input cell is
+// written as lev_mod row spans with fill_span instead of scalar stores.
+// The time spent filling the table is returned in fill_time.
+void full_perfect_remap_rowfill (cell_list icells, cell_list ocells, double *fill_time) {
+
+    struct timeval timer;
+
+    size_t hash_size = (size_t)icells.ibasesize*icells.ibasesize*four_to_the(icells.levmax);
+    uint *hash = (uint *) malloc(hash_size * sizeof(uint));
+    uint i_max = icells.ibasesize*two_to_the(icells.levmax);
+
+    cpu_timer_start(&timer);
+
+    for (uint ic = 0; ic < icells.ncells; ic++){
+        uint lev_mod = two_to_the(icells.levmax - icells.level[ic]);
+        uint ii = icells.i[ic]*lev_mod;
+        uint jj = icells.j[ic]*lev_mod;
+        for (uint jrow = jj; jrow < jj+lev_mod; jrow++) {
+            fill_span(&hash[(size_t)jrow*i_max + ii], ic, lev_mod);
+        }
+    }
+    fill_fence();
+
+    if (fill_time != NULL) *fill_time = cpu_timer_stop(timer);
+
+    for (uint ic = 0; ic < ocells.ncells; ic++){
+        uint lev = ocells.level[ic];
+        uint lev_mod = two_to_the(ocells.levmax - lev);
+        uint ii = ocells.i[ic]*lev_mod;
+        uint jj = ocells.j[ic]*lev_mod;
+
         uint key = hash[(jj*i_max)+ii];
-        
+
         if (lev >= icells.level[key]) {
             ocells.values[ic] = icells.values[key];
         } else {
@@ -111,19 +223,24 @@ void full_perfect_remap (cell_list icells, cell_list ocells) {
         }
     }
 
-    // Deallocate hash table
     free(hash);
 }
 
 #ifdef _OPENMP
-void full_perfect_remap_openMP (cell_list icells, cell_list ocells) {
+template <class Op>
+void full_perfect_remap_op_openMP (cell_list icells, const typename Op::value_type *ivalues,
+                                   cell_list ocells, typename Op::value_type *ovalues, remap_diag *diag) {
+
+    double in_sum = 0.0, in_min = DBL_MAX, in_max = -DBL_MAX;
+    double out_sum = 0.0, out_min = DBL_MAX, out_max = -DBL_MAX;
 
     // Allocate a hash table the size of the finest level of the grid
     uint i_max = icells.ibasesize*two_to_the(icells.levmax);
     uint j_max = icells.ibasesize*two_to_the(icells.levmax);
-    uint *hash = (uint *)malloc(i_max*j_max*sizeof(uint));
+    uint *hash = (uint *)first_touch_malloc((size_t)i_max*j_max, sizeof(uint), FIRST_TOUCH_BLOCK);
 
-#pragma omp parallel default(none) shared(icells, ocells, hash, i_max)
+#pragma omp parallel default(none) shared(icells, ocells, hash, i_max, diag, ivalues, ovalues) \
+    shared(in_sum, in_min, in_max, out_sum, out_min, out_max)
     {
         uint ilength = icells.ncells;
         uint olength = ocells.ncells;
@@ -131,11 +248,12 @@ void full_perfect_remap_openMP (cell_list icells, cell_list ocells) {
         uint lev_mod;
 
         // Fill Hash Table from Input mesh
-#pragma omp for
+#pragma omp for reduction(+:in_sum) reduction(min:in_min) reduction(max:in_max)
         for (uint ic = 0; ic < ilength; ic++){
             uint lev = icells.level[ic];
             uint i = icells.i[ic];
             uint j = icells.j[ic];
+            if (diag != NULL) remap_diag_accum(ivalues[ic], lev, &in_sum, &in_min, &in_max);
             // If at the maximum level just set the one cell
             if (lev == max_lev) {
                 //printf("%u\t%u\n", i, j);
@@ -154,7 +272,7 @@ void full_perfect_remap_openMP (cell_list icells, cell_list ocells) {
         }
 
     // Use Hash Table to Perform Remap
-#pragma omp for
+#pragma omp for reduction(+:out_sum) reduction(min:out_min) reduction(max:out_max)
         for (uint ic = 0; ic < olength; ic++){
             uint lev = ocells.level[ic];
             uint i = ocells.i[ic];
@@ -165,18 +283,129 @@ void full_perfect_remap_openMP (cell_list icells, cell_list ocells) {
             ii = i*lev_mod;
             jj = j*lev_mod;
             
-            uint key = hash[(jj*i_max)+ii];
-        
-            if (lev >= icells.level[key]) {
-                ocells.values[ic] = icells.values[key];
-            } else {
-                ocells.values[ic] = avg_sub_cells(icells, jj, ii, lev, hash);
-            }
-            
+            ovalues[ic] = full_perfect_query_op<Op>(icells, ivalues, hash, i_max, ii, jj, lev);
+            if (diag != NULL) remap_diag_accum(ovalues[ic], lev, &out_sum, &out_min, &out_max);
         }
     }
 
     // Deallocate hash table
     free(hash);
+
+    if (diag != NULL) remap_diag_set(diag, in_sum, in_min, in_max, out_sum, out_min, out_max);
+}
+
+void full_perfect_remap_openMP (cell_list icells, cell_list ocells, remap_diag *diag) {
+    full_perfect_remap_op_openMP<ReduceMean>(icells, icells.values, ocells, ocells.values, diag);
+}
+
+// OpenMP version of the block fill. Instead of dividing the input cells,
+// which makes each coarse cell a large serial chunk and has threads writing
+// into the same cache lines, the threads split the rows of the finest
+// level. The input cells are binned by level and row, so the cells
+// crossing a fine row are the ones in its row on each level. Every fine
+// row is written once in full, so the static split gives each thread the
+// same number of stores, on the pages it touched first.
+void full_perfect_remap_rowfill_openMP (cell_list icells, cell_list ocells, double *fill_time) {
+
+    struct timeval timer;
+
+    uint ibasesize = icells.ibasesize;
+    uint max_lev = icells.levmax;
+    uint i_max = ibasesize*two_to_the(max_lev);
+    size_t hash_size = (size_t)i_max*i_max;
+    uint *hash = (uint *)first_touch_malloc(hash_size, sizeof(uint), FIRST_TOUCH_BLOCK);
+
+    cpu_timer_start(&timer);
+
+    // Counting sort of the input cells by row within their level, with
+    // the rows of each level following those of the coarser ones
+    uint *lev_row = (uint *)malloc((max_lev+1)*sizeof(uint));
+    uint nrows = 0;
+    for (uint lev = 0; lev <= max_lev; lev++){
+        lev_row[lev] = nrows;
+        nrows += ibasesize*two_to_the(lev);
+    }
+    uint *row_start = (uint *)calloc(nrows+1, sizeof(uint));
+    uint *row_cells = (uint *)malloc(icells.ncells*sizeof(uint));
+    for (uint ic = 0; ic < icells.ncells; ic++){
+        row_start[lev_row[icells.level[ic]] + icells.j[ic] + 1]++;
+    }
+    for (uint r = 0; r < nrows; r++){
+        row_start[r+1] += row_start[r];
+    }
+    uint *row_fill = (uint *)malloc(nrows*sizeof(uint));
+    memcpy(row_fill, row_start, nrows*sizeof(uint));
+    for (uint ic = 0; ic < icells.ncells; ic++){
+        row_cells[row_fill[lev_row[icells.level[ic]] + icells.j[ic]]++] = ic;
+    }
+    free(row_fill);
+
+#pragma omp parallel default(none) shared(icells, hash, lev_row, row_start, row_cells) firstprivate(max_lev, i_max)
+    {
+#pragma omp for schedule(static)
+        for (uint jrow = 0; jrow < i_max; jrow++){
+            uint *hrow = &hash[(size_t)jrow*i_max];
+            for (uint lev = 0; lev <= max_lev; lev++){
+                uint levdiff = max_lev - lev;
+                uint lev_mod = two_to_the(levdiff);
+                uint r = lev_row[lev] + (jrow >> levdiff);
+                for (uint n = row_start[r]; n < row_start[r+1]; n++){
+                    uint ic = row_cells[n];
+                    fill_span(&hrow[icells.i[ic]*lev_mod], ic, lev_mod);
+                }
+            }
+        }
+        fill_fence();
+    }
+
+    free(lev_row);
+    free(row_start);
+    free(row_cells);
+
+    if (fill_time != NULL) *fill_time = cpu_timer_stop(timer);
+
+#pragma omp parallel for default(none) shared(icells, ocells, hash) firstprivate(i_max)
+    for (uint ic = 0; ic < ocells.ncells; ic++){
+        uint lev = ocells.level[ic];
+        uint lev_mod = two_to_the(ocells.levmax - lev);
+        uint ii = ocells.i[ic]*lev_mod;
+        uint jj = ocells.j[ic]*lev_mod;
+
+        uint key = hash[(jj*i_max)+ii];
+
+        if (lev >= icells.level[key]) {
+            ocells.values[ic] = icells.values[key];
+        } else {
+            ocells.values[ic] = avg_sub_cells(icells, jj, ii, lev, hash);
+        }
+    }
+
+    free(hash);
 }
 #endif
+
+#define INSTANTIATE_FULL_PERFECT_OP(Op) \
+template void full_perfect_remap_op<Op> (cell_list icells, const Op::value_type *ivalues, \
+                                         cell_list ocells, Op::value_type *ovalues, remap_diag *diag);
+#define INSTANTIATE_FULL_PERFECT_OP_OPENMP(Op) \
+template void full_perfect_remap_op_openMP<Op> (cell_list icells, const Op::value_type *ivalues, \
+                                                cell_list ocells, Op::value_type *ovalues, remap_diag *diag);
+
+INSTANTIATE_FULL_PERFECT_OP(ReduceMean)
+INSTANTIATE_FULL_PERFECT_OP(ReduceMeanFloat)
+INSTANTIATE_FULL_PERFECT_OP(ReduceSum)
+INSTANTIATE_FULL_PERFECT_OP(ReduceMin)
+INSTANTIATE_FULL_PERFECT_OP(ReduceMax)
+INSTANTIATE_FULL_PERFECT_OP(ReduceVolumeWeighted)
+INSTANTIATE_FULL_PERFECT_OP(ReduceMajority)
+INSTANTIATE_FULL_PERFECT_OP(ReduceNearest)
+#ifdef _OPENMP
+INSTANTIATE_FULL_PERFECT_OP_OPENMP(ReduceMean)
+INSTANTIATE_FULL_PERFECT_OP_OPENMP(ReduceMeanFloat)
+INSTANTIATE_FULL_PERFECT_OP_OPENMP(ReduceSum)
+INSTANTIATE_FULL_PERFECT_OP_OPENMP(ReduceMin)
+INSTANTIATE_FULL_PERFECT_OP_OPENMP(ReduceMax)
+INSTANTIATE_FULL_PERFECT_OP_OPENMP(ReduceVolumeWeighted)
+INSTANTIATE_FULL_PERFECT_OP_OPENMP(ReduceMajority)
+INSTANTIATE_FULL_PERFECT_OP_OPENMP(ReduceNearest)
+#endif
@@ -32,10 +32,20 @@
 #define FULL_PERFECT_REMAP_H
 
 #include "meshgen/meshgen.h"
+#include "reduction_ops.h"
+#include "remap_diag.h"
 
-void full_perfect_remap (cell_list icells, cell_list ocells);
+void full_perfect_remap (cell_list icells, cell_list ocells, remap_diag *diag = NULL);
+template <class Op> void full_perfect_remap_op (cell_list icells, const typename Op::value_type *ivalues,
+                                                cell_list ocells, typename Op::value_type *ovalues,
+                                                remap_diag *diag = NULL);
+void full_perfect_remap_rowfill (cell_list icells, cell_list ocells, double *fill_time);
 #ifdef _OPENMP
-void full_perfect_remap_openMP (cell_list icells, cell_list ocells);
+void full_perfect_remap_openMP (cell_list icells, cell_list ocells, remap_diag *diag = NULL);
+template <class Op> void full_perfect_remap_op_openMP (cell_list icells, const typename Op::value_type *ivalues,
+                                                       cell_list ocells, typename Op::value_type *ovalues,
+                                                       remap_diag *diag = NULL);
+void full_perfect_remap_rowfill_openMP (cell_list icells, cell_list ocells, double *fill_time);
 #endif
 
 #endif
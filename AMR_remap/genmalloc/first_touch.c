@@ -0,0 +1,154 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+/* for posix_memalign, madvise and syscall under -std=c99 */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "first_touch.h"
+
+#define HUGE_PAGE_SIZE (2*1024*1024)
+#define MPOL_INTERLEAVE_MODE 3
+
+const char *first_touch_policy_name(int policy)
+{
+   switch (policy & ~FIRST_TOUCH_HUGE_PAGES) {
+   case FIRST_TOUCH_NONE:       return("none");
+   case FIRST_TOUCH_BLOCK:      return("block");
+   case FIRST_TOUCH_INTERLEAVE: return("interleave");
+   }
+   return("unknown");
+}
+
+/* Binds the range to round robin placement over the online nodes with the
+ * raw mbind call, so there is no dependence on libnuma. Any failure leaves
+ * the default local placement. */
+static void interleave_range(char *start, size_t len)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+   unsigned long nodemask = 0;
+   FILE *fp = fopen("/sys/devices/system/node/online", "r");
+   if (fp == NULL) return;
+
+   /* a list of ranges such as 0-1 or 0,2-3 */
+   int lo, hi;
+   char sep;
+   while (fscanf(fp, "%d", &lo) == 1) {
+      hi = lo;
+      sep = (char)fgetc(fp);
+      if (sep == '-') {
+         if (fscanf(fp, "%d", &hi) != 1) break;
+         sep = (char)fgetc(fp);
+      }
+      for (int node = lo; node <= hi && node < (int)(8*sizeof(nodemask)); node++) {
+         nodemask |= 1UL << node;
+      }
+      if (sep != ',') break;
+   }
+   fclose(fp);
+
+   if (nodemask != 0) {
+      syscall(SYS_mbind, start, len, MPOL_INTERLEAVE_MODE, &nodemask, 8*sizeof(nodemask), 0);
+   }
+#else
+   (void)start;
+   (void)len;
+#endif
+}
+
+void *first_touch_malloc(size_t nelem, size_t elsize, int policy)
+{
+   size_t size = nelem*elsize;
+   size_t page = (size_t)sysconf(_SC_PAGESIZE);
+   int huge = (policy & FIRST_TOUCH_HUGE_PAGES) && size >= HUGE_PAGE_SIZE;
+   int placement = policy & ~FIRST_TOUCH_HUGE_PAGES;
+
+   size_t align = 64;
+   if (size >= page) align = page;
+   if (huge) align = HUGE_PAGE_SIZE;
+
+   void *ptr = NULL;
+   if (posix_memalign(&ptr, align, (size > 0) ? size : 1) != 0) return(NULL);
+   if (size < page || placement == FIRST_TOUCH_NONE) return(ptr);
+
+   char *base = (char *)ptr;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+   if (huge) madvise(base, size & ~((size_t)HUGE_PAGE_SIZE-1), MADV_HUGEPAGE);
+#endif
+   if (placement == FIRST_TOUCH_INTERLEAVE) {
+      /* the kernel spreads the pages at the first write, wherever it is */
+      interleave_range(base, size & ~(page-1));
+      return(ptr);
+   }
+
+#ifdef _OPENMP
+   /* a team started from inside another one would not be the team that
+    * loops over the array, so the pages are left to the first write */
+   if (omp_in_parallel()) return(ptr);
+#endif
+
+   /* One write per page is enough to fault it in. The thread blocks are the
+    * split the OpenMP runtimes use for schedule(static) without a chunk
+    * size: nelem/nthreads each, with the first nelem%nthreads threads
+    * taking one more. */
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+   {
+#ifdef _OPENMP
+      size_t t  = (size_t)omp_get_thread_num();
+      size_t nt = (size_t)omp_get_num_threads();
+#else
+      size_t t  = 0;
+      size_t nt = 1;
+#endif
+      size_t q = nelem/nt, r = nelem%nt;
+      size_t lo = t*q + ((t < r) ? t : r);
+      size_t hi = lo + q + ((t < r) ? 1 : 0);
+
+      size_t off = (lo*elsize + page - 1) & ~(page-1);
+      for (; off < hi*elsize; off += page) {
+         base[off] = 0;
+      }
+   }
+
+   return(ptr);
+}
@@ -0,0 +1,71 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#ifndef FIRST_TOUCH_H
+#define FIRST_TOUCH_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Page placement policies for first_touch_malloc */
+enum first_touch_policy {
+   FIRST_TOUCH_NONE = 0,      /* pages land wherever the first later write is  */
+   FIRST_TOUCH_BLOCK,         /* pages follow the static omp for split          */
+   FIRST_TOUCH_INTERLEAVE     /* pages round robin over the NUMA nodes          */
+};
+
+/* Or-ed into the policy to make the arrays of 2 MB or more 2 MB aligned and
+ * advise them for transparent huge pages */
+#define FIRST_TOUCH_HUGE_PAGES 0x100
+
+const char *first_touch_policy_name(int policy);
+
+/* Allocates nelem elements of elsize bytes, uninitialized as with malloc,
+ * and places the pages as the policy given for this call asks. Under
+ * FIRST_TOUCH_BLOCK each thread of a new parallel region writes the pages
+ * that start within the elements a "#pragma omp for schedule(static)"
+ * over nelem gives it, so a later loop with that schedule over the array
+ * finds its part on the local node. That needs the caller to be where it
+ * will open the parallel loops itself: inside a parallel region the pages
+ * are left unplaced, and threads outside OpenMP, such as pthread workers,
+ * should ask for FIRST_TOUCH_NONE. There is no process-wide state, so
+ * calls with different policies may run concurrently. Free with free(). */
+void *first_touch_malloc(size_t nelem, size_t elsize, int policy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -29,9 +29,15 @@
  */
 
 #include <stdio.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "simplehash/simplehash.h"
+#include "genmalloc/first_touch.h"
 #include "hierarchical_remap.h"
+#include "probe_cache.h"
 #include "meshgen/meshgen.h"
 //
 //#define DETAILED_TIMING
@@ -43,14 +49,12 @@
 #define DEBUG 0
 #endif
 
-// Private functions to this routine
-double avg_sub_cells_h (cell_list icells, uint i, uint j, uint lev, int **h_hash, uint ibasesize);
-double avg_sub_cells_h_compact (cell_list icells, uint i, uint j, uint lev, intintHash_Table** h_hashTable, uint ibasesize);
-
-double avg_sub_cells_h (cell_list icells, uint i, uint j, uint lev, int **h_hash, uint ibasesize) {
+template <class Op>
+typename Op::value_type avg_sub_cells_h_op (cell_list icells, const typename Op::value_type *values,
+    uint i, uint j, uint lev, int **h_hash, uint ibasesize) {
 
     int probe;
-    double sum = 0.0;
+    typename Op::acc_type sum = Op::identity();
     
     uint key_new[4];
     
@@ -107,7 +111,7 @@ double avg_sub_cells_h (cell_list icells, uint i, uint j, uint lev, int **h_hash
             probe = h_hash[lev][key];
             if (probe >= 0) {
                 //TODO: try to move this division so we have fewer computations
-                sum += icells.values[probe]/four_to_the(lev-startlev);
+                sum = Op::combine(sum, Op::scale(Op::load(icells, values, probe), lev-startlev));
             } else {
                 // When the sentinal value is set, setup the queue for our
                 // return and move down a level.
@@ -129,13 +133,37 @@ double avg_sub_cells_h (cell_list icells, uint i, uint j, uint lev, int **h_hash
         }
     }
 
-    return sum;
+    return Op::result(sum);
 }
 
-double avg_sub_cells_h_compact (cell_list icells, uint i, uint j, uint lev, intintHash_Table** h_hashTable, uint ibasesize) {
+double avg_sub_cells_h (cell_list icells, uint i, uint j, uint lev, int **h_hash, uint ibasesize) {
+    return avg_sub_cells_h_op<ReduceMean>(icells, icells.values, i, j, lev, h_hash, ibasesize);
+}
+
+// Input cell holding the center point of the refined cell (i, j, lev). The
+// center is the lower left corner of the upper right child, and from there
+// on down every level has either the cell or a breadcrumb at that point.
+static inline int probe_center_h (int **h_hash, uint i, uint j, uint lev, uint ibasesize) {
+
+    i = 2*i + 1;
+    j = 2*j + 1;
+    lev++;
+    int probe = h_hash[lev][j*ibasesize*two_to_the(lev) + i];
+    while (probe < 0) {
+        i *= 2;
+        j *= 2;
+        lev++;
+        probe = h_hash[lev][j*ibasesize*two_to_the(lev) + i];
+    }
+    return probe;
+}
+
+template <class Op>
+typename Op::value_type avg_sub_cells_h_compact_op (cell_list icells, const typename Op::value_type *values,
+    uint i, uint j, uint lev, intintHash_Table** h_hashTable, uint ibasesize) {
     
     int probe;
-    double sum = 0.0;
+    typename Op::acc_type sum = Op::identity();
     
     uint key_new[4];
     
@@ -192,7 +220,7 @@ double avg_sub_cells_h_compact (cell_list icells, uint i, uint j, uint lev, inti
             intintHash_QuerySingle(h_hashTable[lev], key, &probe);
             if (probe >= 0) {
                 //TODO: try to move this division so we have fewer computations
-                sum += icells.values[probe]/four_to_the(lev-startlev);
+                sum = Op::combine(sum, Op::scale(Op::load(icells, values, probe), lev-startlev));
             } else {
                 // When the sentinal value is set, setup the queue for our
                 // return and move down a level.
@@ -213,11 +241,37 @@ double avg_sub_cells_h_compact (cell_list icells, uint i, uint j, uint lev, inti
             }
         }
     }
-    return sum;
+    return Op::result(sum);
 }
 
-void h_remap (cell_list icells, cell_list ocells) {
+double avg_sub_cells_h_compact (cell_list icells, uint i, uint j, uint lev, intintHash_Table** h_hashTable, uint ibasesize) {
+    return avg_sub_cells_h_compact_op<ReduceMean>(icells, icells.values, i, j, lev, h_hashTable, ibasesize);
+}
+
+// probe_center_h through the compact tables
+static inline int probe_center_h_compact (intintHash_Table **h_hashTable, uint i, uint j, uint lev, uint ibasesize) {
+
+    int probe;
+    i = 2*i + 1;
+    j = 2*j + 1;
+    lev++;
+    intintHash_QuerySingle(h_hashTable[lev], j*ibasesize*two_to_the(lev) + i, &probe);
+    while (probe < 0) {
+        i *= 2;
+        j *= 2;
+        lev++;
+        intintHash_QuerySingle(h_hashTable[lev], j*ibasesize*two_to_the(lev) + i, &probe);
+    }
+    return probe;
+}
+
+template <class Op>
+void h_remap_op (cell_list icells, const typename Op::value_type *ivalues,
+                 cell_list ocells, typename Op::value_type *ovalues, remap_diag *diag) {
     
+    double in_sum = 0.0, in_min = DBL_MAX, in_max = -DBL_MAX;
+    double out_sum = 0.0, out_min = DBL_MAX, out_max = -DBL_MAX;
+
     int** h_hash = (int **) malloc((icells.levmax+1)*sizeof(uint *));
     
     //initialize 2d array
@@ -234,6 +288,7 @@ void h_remap (cell_list icells, cell_list ocells) {
         int lev = icells.level[n];
         uint key = j * icells.ibasesize*two_to_the(lev) + i;
         h_hash[lev][key] = n;
+        if (diag != NULL) remap_diag_accum(ivalues[n], lev, &in_sum, &in_min, &in_max);
         
         while (i%2 == 0 && j%2 == 0 && lev > 0) {
             //i /= 2;
@@ -258,18 +313,22 @@ void h_remap (cell_list icells, cell_list ocells) {
         //printf("probe: %d\n", probe);
         
         int probe = -1;
+        uint probe_lev;
         // loop until either we find a valid hash value or the probelev is the output cell level
-        for (uint probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+        for (probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
             //uint key = translate_cell(oi, oj, olev, probe_lev);
             int levdiff = olev - probe_lev;
             uint key = (oj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
             probe = h_hash[probe_lev][key];
         }
         if (probe >= 0) {
-            ocells.values[n] = icells.values[probe];
+            ovalues[n] = Op::split(ivalues[probe], olev - (probe_lev-1));
+        } else if (Op::point_sample) {
+            ovalues[n] = ivalues[probe_center_h(h_hash, oi, oj, olev, icells.ibasesize)];
         } else {
-            ocells.values[n] = avg_sub_cells_h (icells, oi, oj, olev, h_hash, icells.ibasesize);
+            ovalues[n] = avg_sub_cells_h_op<Op> (icells, ivalues, oi, oj, olev, h_hash, icells.ibasesize);
         }
+        if (diag != NULL) remap_diag_accum(ovalues[n], olev, &out_sum, &out_min, &out_max);
         
         //printf ("#%d:\t", n);
         //printCell(ocells[n]);
@@ -280,6 +339,372 @@ void h_remap (cell_list icells, cell_list ocells) {
     }
     free(h_hash);
     
+    if (diag != NULL) remap_diag_set(diag, in_sum, in_min, in_max, out_sum, out_min, out_max);
+}
+
+void h_remap (cell_list icells, cell_list ocells) {
+    h_remap_op<ReduceMean>(icells, icells.values, ocells, ocells.values);
+}
+
+// The build and query phases of h_remap as separate calls, so that a caller
+// can overlap the build for one mesh with the queries against another. The
+// tables come from h_hash_alloc and can be reused for any input mesh with
+// the same base size and levmax.
+int **h_hash_alloc (uint ibasesize, uint levmax) {
+
+    int** h_hash = (int **) malloc((levmax+1)*sizeof(int *));
+    for (uint i = 0; i <= levmax; i++) {
+        size_t hash_size = (size_t)ibasesize*ibasesize*four_to_the(i);
+        h_hash[i] = (int *) malloc(hash_size*sizeof(int));
+    }
+    return h_hash;
+}
+
+void h_hash_free (int **h_hash, uint levmax) {
+
+    for (uint i = 0; i <= levmax; i++) {
+        free(h_hash[i]);
+    }
+    free(h_hash);
+}
+
+// Places cell n and its breadcrumbs in the full tables
+static inline void h_hash_place (cell_list icells, int **h_hash, uint n) {
+
+    uint i = icells.i[n];
+    uint j = icells.j[n];
+    int lev = icells.level[n];
+    uint key = j * icells.ibasesize*two_to_the(lev) + i;
+    h_hash[lev][key] = n;
+
+    while (i%2 == 0 && j%2 == 0 && lev > 0) {
+        i >>= 1;
+        j >>= 1;
+        lev--;
+        key = j * icells.ibasesize*two_to_the(lev) + i;
+        h_hash[lev][key] = -1;
+    }
+}
+
+void h_remap_build (cell_list icells, int **h_hash) {
+
+    //place the cells and their breadcrumbs
+    for (uint n = 0; n < icells.ncells; n++) {
+        h_hash_place(icells, h_hash, n);
+    }
+}
+
+#ifdef _OPENMP
+// Tables first touched by the threads of the static split of their rows
+int **h_hash_alloc_openMP (uint ibasesize, uint levmax) {
+
+    int** h_hash = (int **) malloc((levmax+1)*sizeof(int *));
+    for (uint i = 0; i <= levmax; i++) {
+        size_t hash_size = (size_t)ibasesize*ibasesize*four_to_the(i);
+        h_hash[i] = (int *) first_touch_malloc(hash_size, sizeof(int), FIRST_TOUCH_BLOCK);
+    }
+    return h_hash;
+}
+
+void h_remap_build_openMP (cell_list icells, int **h_hash) {
+
+#pragma omp parallel for default(none) shared(icells, h_hash)
+    for (uint n = 0; n < icells.ncells; n++) {
+        h_hash_place(icells, h_hash, n);
+    }
+}
+#endif
+
+// Entries each compact per-level table needs for the cells of a mesh and
+// their breadcrumbs
+static void h_hash_compact_count (cell_list cells, uint *num_at_level) {
+
+    for (uint i = 0; i <= cells.levmax; i++) {
+       num_at_level[i] = 0;
+    }
+    for (uint n = 0; n < cells.ncells; n++) {
+       num_at_level[cells.level[n]]++;
+    }
+    // lev must be int (not uint) to allow -1 for exit
+    for (int lev = cells.levmax-1; lev >= 0; lev--) {
+       num_at_level[lev] += num_at_level[lev+1]/4;
+    }
+}
+
+// Empty compact per-level tables sized for the cells and breadcrumbs of a mesh
+static intintHash_Table **h_hash_compact_create (cell_list cells, intintHash_Factory *factory,
+                                                 int hash_type, float load_factor) {
+
+    intintHash_Table** h_hashTable = (intintHash_Table **) malloc((cells.levmax+1)*sizeof(intintHash_Table *));
+
+    uint *num_at_level = (uint *)malloc((cells.levmax+1)*sizeof(uint));
+    h_hash_compact_count(cells, num_at_level);
+
+    for (uint i = 0; i <= cells.levmax; i++) {
+        size_t hash_size = cells.ibasesize*two_to_the(i)*cells.ibasesize*two_to_the(i);
+        h_hashTable[i] = intintHash_CreateTable(factory, hash_type, hash_size, num_at_level[i], load_factor);
+        intintHash_SetupTable(h_hashTable[i]);
+    }
+    free(num_at_level);
+
+    return h_hashTable;
+}
+
+// Places cell n and its breadcrumbs in the compact tables
+static inline void h_hash_compact_insert (cell_list cells, intintHash_Table **h_hashTable, uint n) {
+
+    uint i = cells.i[n];
+    uint j = cells.j[n];
+    int lev = cells.level[n];
+
+    uint key = j * cells.ibasesize*two_to_the(lev) + i;
+    intintHash_InsertSingle(h_hashTable[lev], key, n);
+
+    while (i%2 == 0 && j%2 == 0 && lev > 0) {
+        i /= 2;
+        j /= 2;
+        lev--;
+        key = j * cells.ibasesize*two_to_the(lev) + i;
+        intintHash_InsertSingle(h_hashTable[lev], key, -1);
+    }
+}
+
+// Value of output cell (oi, oj, olev) from the compact tables of icells:
+// the input cell covering it, or the reduction of the ones under it
+template <class Op>
+static inline typename Op::value_type h_compact_query_op (cell_list icells, const typename Op::value_type *ivalues,
+    intintHash_Table **h_hashTable, uint oi, uint oj, uint olev) {
+
+    int probe = -1;
+    uint probe_lev;
+    for (probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+        int levdiff = olev - probe_lev;
+        uint key = (oj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
+        intintHash_QuerySingle(h_hashTable[probe_lev], key, &probe);
+    }
+
+    if (probe >= 0) return Op::split(ivalues[probe], olev - (probe_lev-1));
+    if (Op::point_sample) return ivalues[probe_center_h_compact(h_hashTable, oi, oj, olev, icells.ibasesize)];
+    return avg_sub_cells_h_compact_op<Op> (icells, ivalues, oi, oj, olev, h_hashTable, icells.ibasesize);
+}
+
+static inline double h_compact_query (cell_list icells, intintHash_Table **h_hashTable, uint oi, uint oj, uint olev) {
+    return h_compact_query_op<ReduceMean>(icells, icells.values, h_hashTable, oi, oj, olev);
+}
+
+// Compact per-level tables holding the cells and their breadcrumbs, for
+// queries made outside the remap such as point location
+intintHash_Table **h_hash_compact_build (cell_list icells, intintHash_Factory *factory,
+                                         int hash_type, float load_factor) {
+
+    intintHash_Table** h_hashTable = h_hash_compact_create(icells, factory, hash_type, load_factor);
+    for (uint n = 0; n < icells.ncells; n++) {
+        h_hash_compact_insert(icells, h_hashTable, n);
+    }
+    return h_hashTable;
+}
+
+#ifdef _OPENMP
+// h_hash_compact_build with the inserts split over the threads, for hash
+// types that take concurrent inserts
+intintHash_Table **h_hash_compact_build_openMP (cell_list icells, intintHash_Factory *factory,
+                                                int hash_type, float load_factor) {
+
+    intintHash_Table** h_hashTable = h_hash_compact_create(icells, factory, hash_type, load_factor);
+#pragma omp parallel for default(none) shared(icells, h_hashTable)
+    for (uint n = 0; n < icells.ncells; n++) {
+        h_hash_compact_insert(icells, h_hashTable, n);
+    }
+    return h_hashTable;
+}
+#endif
+
+void h_hash_compact_free (intintHash_Table **h_hashTable, uint levmax) {
+
+    for (uint i = 0; i <= levmax; i++) {
+        intintHash_DestroyTable(h_hashTable[i]);
+    }
+    free(h_hashTable);
+}
+
+// Queries output cells ostart through oend-1
+void h_remap_query (cell_list icells, int **h_hash, cell_list ocells, uint ostart, uint oend) {
+
+    for (uint n = ostart; n < oend; n++) {
+        uint oi = ocells.i[n];
+        uint oj = ocells.j[n];
+        uint olev = ocells.level[n];
+
+        int probe = -1;
+        uint probe_lev;
+        for (probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+            int levdiff = olev - probe_lev;
+            uint key = (oj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
+            probe = h_hash[probe_lev][key];
+        }
+        if (probe >= 0) {
+            ocells.values[n] = icells.values[probe];
+        } else {
+            ocells.values[n] = avg_sub_cells_h (icells, oi, oj, olev, h_hash, icells.ibasesize);
+        }
+    }
+}
+
+// Second order remap. Output cells finer than the input cell covering them
+// get the input value plus a limited linear correction, with the slopes
+// found from the face neighbors of the input cell located through the same
+// per-level tables. Equal and coarser output cells take the same values as
+// the first order remap, so restriction stays conservative, and the linear
+// correction averages to zero over the children of an input cell, so
+// prolongation is conservative as well.
+
+static inline double minmod (double a, double b) {
+    if (a*b <= 0.0) return 0.0;
+    return fabs(a) < fabs(b) ? a : b;
+}
+
+// Mean input value over the level lev cell (ni, nj) next to a cell whose
+// center is at center along the axis, and the distance between the two
+// centers in units of the cell width. Neighbors at the same or a coarser
+// level are a single probe walk; finer neighbors are averaged down to the
+// cell size. Returns 0 for a neighbor outside the mesh.
+static inline int face_neighbor_h (cell_list icells, int **h_hash, int ni, int nj, uint lev, int axis,
+                                   double center, double *val, double *dist) {
+
+    int size = icells.ibasesize*two_to_the(lev);
+    if (ni < 0 || nj < 0 || ni >= size || nj >= size) return 0;
+
+    int probe = -1;
+    uint probe_lev;
+    for (probe_lev = 0; probe < 0 && probe_lev <= lev; probe_lev++){
+        int levdiff = lev - probe_lev;
+        uint key = (nj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (ni >> levdiff);
+        probe = h_hash[probe_lev][key];
+    }
+    if (probe >= 0) {
+        uint n = (axis == 0) ? icells.i[probe] : icells.j[probe];
+        *val  = icells.values[probe];
+        *dist = fabs((n + 0.5)*two_to_the(lev - (probe_lev-1)) - center);
+    } else {
+        *val  = avg_sub_cells_h (icells, ni, nj, lev, h_hash, icells.ibasesize);
+        *dist = 1.0;
+    }
+    return 1;
+}
+
+// Minmod limited slopes of input cell ic, per cell width
+static inline void limited_slopes_h (cell_list icells, int **h_hash, int ic, double *sx, double *sy) {
+
+    int i = icells.i[ic];
+    int j = icells.j[ic];
+    uint lev = icells.level[ic];
+    double val = icells.values[ic];
+    double vl, vr, dl, dr;
+
+    *sx = 0.0;
+    *sy = 0.0;
+    if (face_neighbor_h(icells, h_hash, i-1, j, lev, 0, i + 0.5, &vl, &dl) &&
+        face_neighbor_h(icells, h_hash, i+1, j, lev, 0, i + 0.5, &vr, &dr)) {
+        *sx = minmod((val - vl)/dl, (vr - val)/dr);
+    }
+    if (face_neighbor_h(icells, h_hash, i, j-1, lev, 1, j + 0.5, &vl, &dl) &&
+        face_neighbor_h(icells, h_hash, i, j+1, lev, 1, j + 0.5, &vr, &dr)) {
+        *sy = minmod((val - vl)/dl, (vr - val)/dr);
+    }
+}
+
+// Value of the output cell (oi, oj, olev) inside input cell probe, which is
+// levdiff levels coarser and has slopes sx, sy
+static inline double prolong_h (cell_list icells, int probe, double sx, double sy, uint oi, uint oj, uint levdiff) {
+
+    double scale = 1.0/two_to_the(levdiff);
+    double xo = (oi + 0.5)*scale - (icells.i[probe] + 0.5);
+    double yo = (oj + 0.5)*scale - (icells.j[probe] + 0.5);
+    return icells.values[probe] + sx*xo + sy*yo;
+}
+
+// The slopes of an input cell are found the first time one of its finer
+// output cells is reached and kept for the rest of them
+void h_remap_2nd_order (cell_list icells, cell_list ocells) {
+
+    int **h_hash = h_hash_alloc(icells.ibasesize, icells.levmax);
+    h_remap_build(icells, h_hash);
+
+    double *sx = (double *)malloc(icells.ncells*sizeof(double));
+    double *sy = (double *)malloc(icells.ncells*sizeof(double));
+    char *have_slope = (char *)calloc(icells.ncells, sizeof(char));
+
+    for (uint n = 0; n < ocells.ncells; n++) {
+        uint oi = ocells.i[n];
+        uint oj = ocells.j[n];
+        uint olev = ocells.level[n];
+
+        int probe = -1;
+        uint probe_lev;
+        for (probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+            int levdiff = olev - probe_lev;
+            uint key = (oj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
+            probe = h_hash[probe_lev][key];
+        }
+        uint levdiff = olev - (probe_lev-1);
+        if (probe >= 0 && levdiff == 0) {
+            ocells.values[n] = icells.values[probe];
+        } else if (probe >= 0) {
+            if (! have_slope[probe]) {
+                limited_slopes_h(icells, h_hash, probe, &sx[probe], &sy[probe]);
+                have_slope[probe] = 1;
+            }
+            ocells.values[n] = prolong_h(icells, probe, sx[probe], sy[probe], oi, oj, levdiff);
+        } else {
+            ocells.values[n] = avg_sub_cells_h (icells, oi, oj, olev, h_hash, icells.ibasesize);
+        }
+    }
+
+    free(sx);
+    free(sy);
+    free(have_slope);
+    h_hash_free(h_hash, icells.levmax);
+}
+
+void h_remap_cached (cell_list icells, cell_list ocells, uint *nhits) {
+
+    int **h_hash = h_hash_alloc(icells.ibasesize, icells.levmax);
+    h_remap_build(icells, h_hash);
+
+    probe_cache pc;
+    probe_cache_reset(&pc);
+    uint hits = 0;
+
+    for (uint n = 0; n < ocells.ncells; n++) {
+        uint oi = ocells.i[n];
+        uint oj = ocells.j[n];
+        uint olev = ocells.level[n];
+
+        int probe = probe_cache_lookup(&pc, oi, oj, olev);
+        if (probe >= 0) {
+            ocells.values[n] = icells.values[probe];
+            hits++;
+            continue;
+        }
+
+        uint probe_lev;
+        for (probe_lev = 0; probe_lev <= olev; probe_lev++){
+            int levdiff = olev - probe_lev;
+            uint key = (oj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
+            probe = h_hash[probe_lev][key];
+            if (probe >= 0) break;
+        }
+        if (probe >= 0) {
+            ocells.values[n] = icells.values[probe];
+            probe_cache_set(&pc, probe, oi >> (olev - probe_lev), oj >> (olev - probe_lev), probe_lev);
+        } else {
+            ocells.values[n] = avg_sub_cells_h (icells, oi, oj, olev, h_hash, icells.ibasesize);
+        }
+    }
+
+    h_hash_free(h_hash, icells.levmax);
+
+    if (nhits != NULL) *nhits = hits;
 }
 
 //#define HASH_TYPE HASH_ALL_C_HASHES
@@ -287,8 +712,16 @@ void h_remap (cell_list icells, cell_list ocells) {
 //#define HASH_TYPE LCG_QUADRATIC_OPEN_COMPACT_HASH_ID
 #define HASH_LOAD_FACTOR 0.3333333
 
-void h_remap_compact (cell_list icells, cell_list ocells, intintHash_Factory *factory) {
+// Compact hierarchical remap with the hash types offered to the factory and
+// the load factor of the per-level tables given by the caller
+template <class Op>
+static void h_remap_compact_run (cell_list icells, const typename Op::value_type *ivalues,
+                                 cell_list ocells, typename Op::value_type *ovalues, intintHash_Factory *factory,
+                                 int hash_type, float load_factor, remap_diag *diag) {
     
+    double in_sum = 0.0, in_min = DBL_MAX, in_max = -DBL_MAX;
+    double out_sum = 0.0, out_min = DBL_MAX, out_max = -DBL_MAX;
+
 #ifdef DETAILED_TIMING
     struct timeval timer;
 
@@ -321,7 +754,7 @@ void h_remap_compact (cell_list icells, cell_list ocells, intintHash_Factory *fa
     //worth checking for an empty level?
     for (uint i = 0; i <= icells.levmax; i++) {
         size_t hash_size = icells.ibasesize*two_to_the(i)*icells.ibasesize*two_to_the(i);
-        h_hashTable[i] = intintHash_CreateTable(factory, HASH_TYPE, hash_size, num_at_level[i], HASH_LOAD_FACTOR);
+        h_hashTable[i] = intintHash_CreateTable(factory, hash_type, hash_size, num_at_level[i], load_factor);
         if (DEBUG >= 2) {
            h_hashtype[i] = intintHash_GetTableType(h_hashTable[i]);
            if (h_hashtype[i] == IDENTITY_PERFECT_HASH_ID) {
@@ -362,6 +795,7 @@ void h_remap_compact (cell_list icells, cell_list ocells, intintHash_Factory *fa
         uint key = j * icells.ibasesize*two_to_the(lev) + i;
         intintHash_InsertSingle(h_hashTable[lev], key, n);
         //write_hash(n, key, h_hash[lev]);
+        if (diag != NULL) remap_diag_accum(ivalues[n], lev, &in_sum, &in_min, &in_max);
 
         while (i%2 == 0 && j%2 == 0 && lev > 0) {
             i /= 2;
@@ -380,23 +814,9 @@ void h_remap_compact (cell_list icells, cell_list ocells, intintHash_Factory *fa
 #endif
 
     for (uint n = 0; n < ocells.ncells; n++) {
-        uint oi = ocells.i[n];
-        uint oj = ocells.j[n];
         uint olev = ocells.level[n];
-        
-        int probe = -1;
-        for (uint probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
-            int levdiff = olev - probe_lev;
-            uint key = (oj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
-            //probe = read_hash(key, h_hash[probe_lev]);
-            intintHash_QuerySingle(h_hashTable[probe_lev], key, &probe);
-        }
-
-        if (probe >= 0) {
-            ocells.values[n] = icells.values[probe];
-        } else {
-            ocells.values[n] = avg_sub_cells_h_compact (icells, oi, oj, olev, h_hashTable, icells.ibasesize);
-        }
+        ovalues[n] = h_compact_query_op<Op>(icells, ivalues, h_hashTable, ocells.i[n], ocells.j[n], olev);
+        if (diag != NULL) remap_diag_accum(ovalues[n], olev, &out_sum, &out_min, &out_max);
     }
     
 #ifdef DETAILED_TIMING
@@ -415,35 +835,207 @@ void h_remap_compact (cell_list icells, cell_list ocells, intintHash_Factory *fa
     double cleanup_time = cpu_timer_stop(timer);
     printf("cleanup time is %8.4f ms\n",cleanup_time*1000.0);
 #endif
+
+    if (diag != NULL) remap_diag_set(diag, in_sum, in_min, in_max, out_sum, out_min, out_max);
+}
+
+void h_remap_compact (cell_list icells, cell_list ocells, intintHash_Factory *factory, remap_diag *diag) {
+    h_remap_compact_run<ReduceMean>(icells, icells.values, ocells, ocells.values, factory, HASH_TYPE, HASH_LOAD_FACTOR, diag);
+}
+
+void h_remap_compact_config (cell_list icells, cell_list ocells, intintHash_Factory *factory,
+                             int hash_type, float load_factor, remap_diag *diag) {
+    h_remap_compact_run<ReduceMean>(icells, icells.values, ocells, ocells.values, factory, hash_type, load_factor, diag);
+}
+
+template <class Op>
+void h_remap_compact_op (cell_list icells, const typename Op::value_type *ivalues,
+                         cell_list ocells, typename Op::value_type *ovalues, intintHash_Factory *factory,
+                         remap_diag *diag) {
+    h_remap_compact_run<Op>(icells, ivalues, ocells, ovalues, factory, HASH_TYPE, HASH_LOAD_FACTOR, diag);
+}
+
+void h_remap_compact_cached (cell_list icells, cell_list ocells, intintHash_Factory *factory, uint *nhits) {
+
+    intintHash_Table **h_hashTable = h_hash_compact_build(icells, factory, HASH_TYPE, HASH_LOAD_FACTOR);
+
+    probe_cache pc;
+    probe_cache_reset(&pc);
+    uint hits = 0;
+
+    for (uint n = 0; n < ocells.ncells; n++) {
+        uint oi = ocells.i[n];
+        uint oj = ocells.j[n];
+        uint olev = ocells.level[n];
+
+        int probe = probe_cache_lookup(&pc, oi, oj, olev);
+        if (probe >= 0) {
+            ocells.values[n] = icells.values[probe];
+            hits++;
+            continue;
+        }
+
+        uint probe_lev;
+        for (probe_lev = 0; probe_lev <= olev; probe_lev++){
+            int levdiff = olev - probe_lev;
+            uint key = (oj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
+            intintHash_QuerySingle(h_hashTable[probe_lev], key, &probe);
+            if (probe >= 0) break;
+        }
+
+        if (probe >= 0) {
+            ocells.values[n] = icells.values[probe];
+            probe_cache_set(&pc, probe, oi >> (olev - probe_lev), oj >> (olev - probe_lev), probe_lev);
+        } else {
+            ocells.values[n] = avg_sub_cells_h_compact (icells, oi, oj, olev, h_hashTable, icells.ibasesize);
+        }
+    }
+
+    h_hash_compact_free(h_hashTable, icells.levmax);
+
+    if (nhits != NULL) *nhits = hits;
+}
+
+// Pooled hash tables for remapping many small patches. Creating and
+// destroying a table set per patch costs more than the remap itself on a
+// patch of a thousand cells, so each slot keeps its tables and only grows
+// one when a patch needs more entries than it was sized for. There is one
+// slot per thread of the largest batch so far, so the tables are plain C
+// hashes with no locking.
+typedef struct {
+    uint nlevels;                 // number of levels with a table pointer
+    intintHash_Table **table;
+    uint *capacity;               // entries each table was created for
+    uint *num_at_level;
+} h_table_slot;
+
+struct h_table_pool {
+    intintHash_Factory *factory;
+    int nslots;
+    h_table_slot *slot;
+};
+
+// Adds empty slots so the pool has at least nslots. Called at the start of
+// each batch, since the thread count may have been raised since the last.
+static void h_table_pool_reserve (h_table_pool *pool, int nslots) {
+
+    if (nslots <= pool->nslots) return;
+    pool->slot = (h_table_slot *)realloc(pool->slot, nslots*sizeof(h_table_slot));
+    for (int s = pool->nslots; s < nslots; s++) {
+        pool->slot[s].nlevels      = 0;
+        pool->slot[s].table        = NULL;
+        pool->slot[s].capacity     = NULL;
+        pool->slot[s].num_at_level = NULL;
+    }
+    pool->nslots = nslots;
+}
+
+h_table_pool *h_table_pool_create (intintHash_Factory *factory) {
+
+    h_table_pool *pool = (h_table_pool *)malloc(sizeof(h_table_pool));
+    pool->factory = factory;
+    pool->nslots = 0;
+    pool->slot = NULL;
+    h_table_pool_reserve(pool, 1);
+    return pool;
+}
+
+void h_table_pool_destroy (h_table_pool *pool) {
+
+    for (int s = 0; s < pool->nslots; s++) {
+        h_table_slot *slot = &pool->slot[s];
+        for (uint i = 0; i < slot->nlevels; i++) {
+            if (slot->table[i] != NULL) intintHash_DestroyTable(slot->table[i]);
+        }
+        free(slot->table);
+        free(slot->capacity);
+        free(slot->num_at_level);
+    }
+    free(pool->slot);
+    free(pool);
+}
+
+// h_remap_compact for one patch on the tables of one pool slot
+static void h_remap_compact_patch (cell_list icells, cell_list ocells, h_table_slot *slot,
+    intintHash_Factory *factory) {
+
+    if (icells.levmax+1 > slot->nlevels) {
+        uint nlevels = icells.levmax+1;
+        slot->table        = (intintHash_Table **)realloc(slot->table, nlevels*sizeof(intintHash_Table *));
+        slot->capacity     = (uint *)realloc(slot->capacity, nlevels*sizeof(uint));
+        slot->num_at_level = (uint *)realloc(slot->num_at_level, nlevels*sizeof(uint));
+        for (uint i = slot->nlevels; i < nlevels; i++) {
+            slot->table[i]    = NULL;
+            slot->capacity[i] = 0;
+        }
+        slot->nlevels = nlevels;
+    }
+
+    uint *num_at_level = slot->num_at_level;
+    intintHash_Table **h_hashTable = slot->table;
+
+    h_hash_compact_count(icells, num_at_level);
+
+    for (uint i = 0; i <= icells.levmax; i++) {
+        if (h_hashTable[i] == NULL || num_at_level[i] > slot->capacity[i]) {
+            if (h_hashTable[i] != NULL) intintHash_DestroyTable(h_hashTable[i]);
+            size_t hash_size = icells.ibasesize*two_to_the(i)*icells.ibasesize*two_to_the(i);
+            h_hashTable[i] = intintHash_CreateTable(factory, HASH_TYPE, hash_size, num_at_level[i], HASH_LOAD_FACTOR);
+            slot->capacity[i] = num_at_level[i];
+        }
+        intintHash_EmptyTable(h_hashTable[i]);
+    }
+
+    for (uint n = 0; n < icells.ncells; n++) {
+        h_hash_compact_insert(icells, h_hashTable, n);
+    }
+
+    for (uint n = 0; n < ocells.ncells; n++) {
+        ocells.values[n] = h_compact_query(icells, h_hashTable, ocells.i[n], ocells.j[n], ocells.level[n]);
+    }
+}
+
+void h_remap_compact_batch (uint npatches, cell_list *icells, cell_list *ocells, h_table_pool *pool) {
+
+    for (uint p = 0; p < npatches; p++) {
+        h_remap_compact_patch(icells[p], ocells[p], &pool->slot[0], pool->factory);
+    }
 }
 
 #ifdef _OPENMP
-void h_remap_openMP (cell_list icells, cell_list ocells) {
+template <class Op>
+void h_remap_op_openMP (cell_list icells, const typename Op::value_type *ivalues,
+                        cell_list ocells, typename Op::value_type *ovalues, remap_diag *diag) {
     
+    double in_sum = 0.0, in_min = DBL_MAX, in_max = -DBL_MAX;
+    double out_sum = 0.0, out_min = DBL_MAX, out_max = -DBL_MAX;
+
     int** h_hash = (int **) malloc((icells.levmax+1)*sizeof(uint *));
 
     //initialize 2d array
     //worth checking for an empty level?
     for (uint i = 0; i <= icells.levmax; i++) {
         size_t hash_size = icells.ibasesize*two_to_the(i)*icells.ibasesize*two_to_the(i);
-        h_hash[i] = (int *) malloc(hash_size*sizeof(uint));
+        h_hash[i] = (int *) first_touch_malloc(hash_size, sizeof(int), FIRST_TOUCH_BLOCK);
         //memset(h_hash[i], -2, hash_size*sizeof(uint));
     }
 
-#pragma omp parallel default(none)  shared (h_hash, icells, ocells)
+#pragma omp parallel default(none)  shared (h_hash, icells, ocells, ivalues, ovalues, diag) \
+    shared(in_sum, in_min, in_max, out_sum, out_min, out_max)
     {
         uint ilength = icells.ncells;
         uint olength = ocells.ncells;
         uint ibasesize = icells.ibasesize;
 
     //place the cells and their breadcrumbs
-#pragma omp for
+#pragma omp for reduction(+:in_sum) reduction(min:in_min) reduction(max:in_max)
     for (uint n = 0; n < ilength; n++) {
         uint i = icells.i[n];
         uint j = icells.j[n];
         int lev = icells.level[n];
         uint key = j * ibasesize*two_to_the(lev) + i;
         h_hash[lev][key] = n;
+        if (diag != NULL) remap_diag_accum(ivalues[n], lev, &in_sum, &in_min, &in_max);
 
         while (i%2 == 0 && j%2 == 0 && lev > 0) {
             i /= 2;
@@ -454,25 +1046,29 @@ void h_remap_openMP (cell_list icells, cell_list ocells) {
         }
     }
     
-#pragma omp for
+#pragma omp for reduction(+:out_sum) reduction(min:out_min) reduction(max:out_max)
         for (uint n = 0; n < olength; n++) {
             uint oi = ocells.i[n];
             uint oj = ocells.j[n];
             uint olev = ocells.level[n];
         
             int probe = -1;
+            uint probe_lev;
             // loop until either we find a valid hash value or the probelev is the output cell level
-            for (uint probe_lev = 0; probe == -1 && probe_lev <= olev; probe_lev++){
+            for (probe_lev = 0; probe == -1 && probe_lev <= olev; probe_lev++){
                 int levdiff = olev - probe_lev;
                 uint key = (oj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
                 probe = h_hash[probe_lev][key];
             }
 
             if (probe >= 0) {
-                ocells.values[n] = icells.values[probe];
+                ovalues[n] = Op::split(ivalues[probe], olev - (probe_lev-1));
+            } else if (Op::point_sample) {
+                ovalues[n] = ivalues[probe_center_h(h_hash, oi, oj, olev, icells.ibasesize)];
             } else {
-                ocells.values[n] = avg_sub_cells_h (icells, oi, oj, olev, h_hash, icells.ibasesize);
+                ovalues[n] = avg_sub_cells_h_op<Op> (icells, ivalues, oi, oj, olev, h_hash, icells.ibasesize);
             }
+            if (diag != NULL) remap_diag_accum(ovalues[n], olev, &out_sum, &out_min, &out_max);
         }
     }
     
@@ -480,13 +1076,155 @@ void h_remap_openMP (cell_list icells, cell_list ocells) {
         free(h_hash[i]);
     }
     free(h_hash);
+
+    if (diag != NULL) remap_diag_set(diag, in_sum, in_min, in_max, out_sum, out_min, out_max);
+}
+
+void h_remap_openMP (cell_list icells, cell_list ocells) {
+    h_remap_op_openMP<ReduceMean>(icells, icells.values, ocells, ocells.values);
+}
+
+// The threads first find the covering input cell of every output cell and
+// flag the ones needing slopes, then compute the flagged slopes, then
+// prolong, so no slope is computed twice or written by two threads.
+void h_remap_2nd_order_openMP (cell_list icells, cell_list ocells) {
+
+    int **h_hash = h_hash_alloc(icells.ibasesize, icells.levmax);
+
+    double *sx = (double *)first_touch_malloc(icells.ncells, sizeof(double), FIRST_TOUCH_BLOCK);
+    double *sy = (double *)first_touch_malloc(icells.ncells, sizeof(double), FIRST_TOUCH_BLOCK);
+    char *need_slope = (char *)first_touch_malloc(icells.ncells, sizeof(char), FIRST_TOUCH_BLOCK);
+    int *oprobe = (int *)first_touch_malloc(ocells.ncells, sizeof(int), FIRST_TOUCH_BLOCK);
+
+#pragma omp parallel default(none) shared(h_hash, icells, ocells, sx, sy, need_slope, oprobe)
+    {
+        uint ibasesize = icells.ibasesize;
+
+#pragma omp for
+        for (uint n = 0; n < icells.ncells; n++) {
+            uint i = icells.i[n];
+            uint j = icells.j[n];
+            int lev = icells.level[n];
+            uint key = j * ibasesize*two_to_the(lev) + i;
+            h_hash[lev][key] = n;
+            need_slope[n] = 0;
+
+            while (i%2 == 0 && j%2 == 0 && lev > 0) {
+                i >>= 1;
+                j >>= 1;
+                lev--;
+                key = j * ibasesize*two_to_the(lev) + i;
+                h_hash[lev][key] = -1;
+            }
+        }
+
+#pragma omp for
+        for (uint n = 0; n < ocells.ncells; n++) {
+            uint oi = ocells.i[n];
+            uint oj = ocells.j[n];
+            uint olev = ocells.level[n];
+
+            int probe = -1;
+            uint probe_lev;
+            for (probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+                int levdiff = olev - probe_lev;
+                uint key = (oj >> levdiff)*ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
+                probe = h_hash[probe_lev][key];
+            }
+            oprobe[n] = probe;
+            if (probe >= 0 && olev == probe_lev-1) {
+                ocells.values[n] = icells.values[probe];
+            } else if (probe >= 0) {
+#pragma omp atomic write
+                need_slope[probe] = 1;
+            } else {
+                ocells.values[n] = avg_sub_cells_h (icells, oi, oj, olev, h_hash, ibasesize);
+            }
+        }
+
+#pragma omp for
+        for (uint n = 0; n < icells.ncells; n++) {
+            if (need_slope[n]) limited_slopes_h(icells, h_hash, n, &sx[n], &sy[n]);
+        }
+
+#pragma omp for
+        for (uint n = 0; n < ocells.ncells; n++) {
+            int probe = oprobe[n];
+            if (probe >= 0 && ocells.level[n] > icells.level[probe]) {
+                ocells.values[n] = prolong_h(icells, probe, sx[probe], sy[probe], ocells.i[n], ocells.j[n],
+                                             ocells.level[n] - icells.level[probe]);
+            }
+        }
+    }
+
+    free(sx);
+    free(sy);
+    free(need_slope);
+    free(oprobe);
+    h_hash_free(h_hash, icells.levmax);
+}
+
+void h_remap_cached_openMP (cell_list icells, cell_list ocells, uint *nhits) {
+
+    int **h_hash = h_hash_alloc_openMP(icells.ibasesize, icells.levmax);
+    h_remap_build_openMP(icells, h_hash);
+
+    uint hits = 0;
+
+#pragma omp parallel default(none) shared (h_hash, icells, ocells) reduction(+:hits)
+    {
+        uint olength = ocells.ncells;
+        uint ibasesize = icells.ibasesize;
+
+        probe_cache pc;
+        probe_cache_reset(&pc);
+
+#pragma omp for schedule(static)
+        for (uint n = 0; n < olength; n++) {
+            uint oi = ocells.i[n];
+            uint oj = ocells.j[n];
+            uint olev = ocells.level[n];
+
+            int probe = probe_cache_lookup(&pc, oi, oj, olev);
+            if (probe >= 0) {
+                ocells.values[n] = icells.values[probe];
+                hits++;
+                continue;
+            }
+
+            uint probe_lev;
+            for (probe_lev = 0; probe_lev <= olev; probe_lev++){
+                int levdiff = olev - probe_lev;
+                uint key = (oj >> levdiff)*ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
+                probe = h_hash[probe_lev][key];
+                if (probe >= 0) break;
+            }
+
+            if (probe >= 0) {
+                ocells.values[n] = icells.values[probe];
+                probe_cache_set(&pc, probe, oi >> (olev - probe_lev), oj >> (olev - probe_lev), probe_lev);
+            } else {
+                ocells.values[n] = avg_sub_cells_h (icells, oi, oj, olev, h_hash, ibasesize);
+            }
+        }
+    }
+
+    h_hash_free(h_hash, icells.levmax);
+
+    if (nhits != NULL) *nhits = hits;
 }
 
 //#define HASH_OPENMP_TYPE HASH_ALL_OPENMP_HASHES
 #define HASH_OPENMP_TYPE (LCG_QUADRATIC_OPEN_COMPACT_OPENMP_HASH_ID | IDENTITY_SENTINEL_PERFECT_OPENMP_HASH_ID)
 //#define HASH_OPENMP_TYPE LCG_QUADRATIC_OPEN_COMPACT_OPENMP_HASH_ID 
-void h_remap_compact_openMP (cell_list icells, cell_list ocells, intintHash_Factory *factory) {
+template <class Op>
+static void h_remap_compact_run_openMP (cell_list icells, const typename Op::value_type *ivalues,
+                                        cell_list ocells, typename Op::value_type *ovalues, intintHash_Factory *factory,
+                                        int hash_type, float load_factor, remap_diag *diag) {
     
+    double in_sum = 0.0, in_min = DBL_MAX, in_max = -DBL_MAX;
+    double out_sum = 0.0, out_min = DBL_MAX, out_max = -DBL_MAX;
+
 #ifdef DETAILED_TIMING
     struct timeval timer;
 
@@ -521,7 +1259,7 @@ void h_remap_compact_openMP (cell_list icells, cell_list ocells, intintHash_Fact
     for (uint i = 0; i <= icells.levmax; i++) {
         size_t hash_size = icells.ibasesize*two_to_the(i)*icells.ibasesize*two_to_the(i);
         //h_hashTable[i] = intintHash_CreateTable(factory, LCG_QUADRATIC_OPEN_COMPACT_OPENMP_HASH_ID, hash_size, num_at_level[i], HASH_LOAD_FACTOR);
-        h_hashTable[i] = intintHash_CreateTable(factory, HASH_OPENMP_TYPE, hash_size, num_at_level[i], HASH_LOAD_FACTOR);
+        h_hashTable[i] = intintHash_CreateTable(factory, hash_type, hash_size, num_at_level[i], load_factor);
         if (DEBUG >= 2) {
            h_hashtype[i] = intintHash_GetTableType(h_hashTable[i]);
            if (h_hashtype[i] == IDENTITY_SENTINEL_PERFECT_OPENMP_HASH_ID) {
@@ -554,15 +1292,17 @@ void h_remap_compact_openMP (cell_list icells, cell_list ocells, intintHash_Fact
 
     //place the cells and their breadcrumbs 
 #ifdef DETAILED_TIMING
-#pragma omp parallel default(none) shared(icells, ocells, h_hashTable) firstprivate(timer)
+#pragma omp parallel default(none) shared(icells, ocells, h_hashTable, diag, ivalues, ovalues) firstprivate(timer) \
+    shared(in_sum, in_min, in_max, out_sum, out_min, out_max)
 #else
-#pragma omp parallel default(none) shared(icells, ocells, h_hashTable)
+#pragma omp parallel default(none) shared(icells, ocells, h_hashTable, diag, ivalues, ovalues) \
+    shared(in_sum, in_min, in_max, out_sum, out_min, out_max)
 #endif
     {
         uint ilength = icells.ncells;
         uint olength = ocells.ncells;
 
-#pragma omp for
+#pragma omp for reduction(+:in_sum) reduction(min:in_min) reduction(max:in_max)
          for (uint n = 0; n < ilength; n++) {
              uint i = icells.i[n];
              uint j = icells.j[n];
@@ -571,6 +1311,7 @@ void h_remap_compact_openMP (cell_list icells, cell_list ocells, intintHash_Fact
              uint key = j * icells.ibasesize*two_to_the(lev) + i;
              intintHash_InsertSingle(h_hashTable[lev], key, n);
              //write_hash(n, key, h_hash[lev]);
+             if (diag != NULL) remap_diag_accum(ivalues[n], lev, &in_sum, &in_min, &in_max);
 
              while (i%2 == 0 && j%2 == 0 && lev > 0) {
                  i /= 2;
@@ -591,25 +1332,11 @@ void h_remap_compact_openMP (cell_list icells, cell_list ocells, intintHash_Fact
     cpu_timer_start(&timer);
 #endif
 
-#pragma omp for
+#pragma omp for reduction(+:out_sum) reduction(min:out_min) reduction(max:out_max)
          for (uint n = 0; n < olength; n++) {
-             uint oi = ocells.i[n];
-             uint oj = ocells.j[n];
              uint olev = ocells.level[n];
-        
-             int probe = -1;
-             for (uint probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
-                 int levdiff = olev - probe_lev;
-                 uint key = (oj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
-                 //probe = read_hash(key, h_hash[probe_lev]);
-                 intintHash_QuerySingle(h_hashTable[probe_lev], key, &probe);
-             }
-
-             if (probe >= 0) {
-                 ocells.values[n] = icells.values[probe];
-             } else {
-                 ocells.values[n] = avg_sub_cells_h_compact (icells, oi, oj, olev, h_hashTable, icells.ibasesize);
-             }
+             ovalues[n] = h_compact_query_op<Op>(icells, ivalues, h_hashTable, ocells.i[n], ocells.j[n], olev);
+             if (diag != NULL) remap_diag_accum(ovalues[n], olev, &out_sum, &out_min, &out_max);
         }
     } // end omp parallel
     
@@ -629,7 +1356,222 @@ void h_remap_compact_openMP (cell_list icells, cell_list ocells, intintHash_Fact
     double cleanup_time = cpu_timer_stop(timer);
     printf("cleanup time is %8.4f ms\n",cleanup_time*1000.0);
 #endif
+
+    if (diag != NULL) remap_diag_set(diag, in_sum, in_min, in_max, out_sum, out_min, out_max);
 }
 
+void h_remap_compact_openMP (cell_list icells, cell_list ocells, intintHash_Factory *factory, remap_diag *diag) {
+    h_remap_compact_run_openMP<ReduceMean>(icells, icells.values, ocells, ocells.values, factory, HASH_OPENMP_TYPE, HASH_LOAD_FACTOR, diag);
+}
+
+void h_remap_compact_config_openMP (cell_list icells, cell_list ocells, intintHash_Factory *factory,
+                                    int hash_type, float load_factor, remap_diag *diag) {
+    h_remap_compact_run_openMP<ReduceMean>(icells, icells.values, ocells, ocells.values, factory, hash_type, load_factor, diag);
+}
+
+template <class Op>
+void h_remap_compact_op_openMP (cell_list icells, const typename Op::value_type *ivalues,
+                                cell_list ocells, typename Op::value_type *ovalues, intintHash_Factory *factory,
+                                remap_diag *diag) {
+    h_remap_compact_run_openMP<Op>(icells, ivalues, ocells, ovalues, factory, HASH_OPENMP_TYPE, HASH_LOAD_FACTOR, diag);
+}
+
+void h_remap_compact_cached_openMP (cell_list icells, cell_list ocells, intintHash_Factory *factory, uint *nhits) {
+
+    intintHash_Table **h_hashTable = h_hash_compact_build_openMP(icells, factory, HASH_OPENMP_TYPE, HASH_LOAD_FACTOR);
+
+    uint hits = 0;
+
+#pragma omp parallel default(none) shared(icells, ocells, h_hashTable) reduction(+:hits)
+    {
+         uint olength = ocells.ncells;
+
+         probe_cache pc;
+         probe_cache_reset(&pc);
+
+#pragma omp for schedule(static)
+         for (uint n = 0; n < olength; n++) {
+             uint oi = ocells.i[n];
+             uint oj = ocells.j[n];
+             uint olev = ocells.level[n];
+
+             int probe = probe_cache_lookup(&pc, oi, oj, olev);
+             if (probe >= 0) {
+                 ocells.values[n] = icells.values[probe];
+                 hits++;
+                 continue;
+             }
+
+             uint probe_lev;
+             for (probe_lev = 0; probe_lev <= olev; probe_lev++){
+                 int levdiff = olev - probe_lev;
+                 uint key = (oj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
+                 intintHash_QuerySingle(h_hashTable[probe_lev], key, &probe);
+                 if (probe >= 0) break;
+             }
+
+             if (probe >= 0) {
+                 ocells.values[n] = icells.values[probe];
+                 probe_cache_set(&pc, probe, oi >> (olev - probe_lev), oj >> (olev - probe_lev), probe_lev);
+             } else {
+                 ocells.values[n] = avg_sub_cells_h_compact (icells, oi, oj, olev, h_hashTable, icells.ibasesize);
+             }
+        }
+    } // end omp parallel
+
+    h_hash_compact_free(h_hashTable, icells.levmax);
+
+    if (nhits != NULL) *nhits = hits;
+}
+
+// Whole patches are handed out to the threads, since a patch is too small
+// to split. Dynamic scheduling evens out the differing patch sizes.
+void h_remap_compact_batch_openMP (uint npatches, cell_list *icells, cell_list *ocells, h_table_pool *pool) {
+
+    int nthreads = omp_get_max_threads();
+    h_table_pool_reserve(pool, nthreads);
+
+#pragma omp parallel num_threads(nthreads) default(none) shared(icells, ocells, pool) firstprivate(npatches)
+    {
+        h_table_slot *slot = &pool->slot[omp_get_thread_num()];
+
+#pragma omp for schedule(dynamic, 16)
+        for (uint p = 0; p < npatches; p++) {
+            h_remap_compact_patch(icells[p], ocells[p], slot, pool->factory);
+        }
+    }
+}
+
+#endif
+
+// Chained compact remap. The output cells and their breadcrumbs are placed
+// in tables for the output mesh, so the next step, which takes this output
+// as its input, skips its build. Only the first step, passed NULL, builds
+// its input tables. By default the inserts run in a pass after the query;
+// with fused set they share the query loop, where the two sets of tables
+// compete for cache.
+static intintHash_Table **h_remap_compact_chain_run (cell_list icells, intintHash_Table **h_hashTable,
+                                                     cell_list ocells, intintHash_Factory *factory,
+                                                     int hash_type, int fused, int threaded) {
+
+    (void)threaded;
+    if (h_hashTable == NULL) {
+        h_hashTable = h_hash_compact_create(icells, factory, hash_type, HASH_LOAD_FACTOR);
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded)
+#endif
+        for (uint n = 0; n < icells.ncells; n++) {
+            h_hash_compact_insert(icells, h_hashTable, n);
+        }
+    }
+
+    intintHash_Table **o_hashTable = h_hash_compact_create(ocells, factory, hash_type, HASH_LOAD_FACTOR);
+
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded)
+#endif
+    for (uint n = 0; n < ocells.ncells; n++) {
+        uint oi = ocells.i[n];
+        uint oj = ocells.j[n];
+        uint olev = ocells.level[n];
+
+        int probe = -1;
+        for (uint probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+            int levdiff = olev - probe_lev;
+            uint key = (oj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
+            intintHash_QuerySingle(h_hashTable[probe_lev], key, &probe);
+        }
+
+        if (probe >= 0) {
+            ocells.values[n] = icells.values[probe];
+        } else {
+            ocells.values[n] = avg_sub_cells_h_compact (icells, oi, oj, olev, h_hashTable, icells.ibasesize);
+        }
+
+        if (fused) h_hash_compact_insert(ocells, o_hashTable, n);
+    }
+
+    if (! fused) {
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded)
 #endif
+        for (uint n = 0; n < ocells.ncells; n++) {
+            h_hash_compact_insert(ocells, o_hashTable, n);
+        }
+    }
 
+    h_hash_compact_free(h_hashTable, icells.levmax);
+    return o_hashTable;
+}
+
+intintHash_Table **h_remap_compact_chain (cell_list icells, intintHash_Table **h_hashTable,
+                                          cell_list ocells, intintHash_Factory *factory) {
+    return h_remap_compact_chain_run(icells, h_hashTable, ocells, factory, HASH_TYPE, 0, 0);
+}
+
+intintHash_Table **h_remap_compact_chain_fused (cell_list icells, intintHash_Table **h_hashTable,
+                                                cell_list ocells, intintHash_Factory *factory) {
+    return h_remap_compact_chain_run(icells, h_hashTable, ocells, factory, HASH_TYPE, 1, 0);
+}
+
+#ifdef _OPENMP
+intintHash_Table **h_remap_compact_chain_openMP (cell_list icells, intintHash_Table **h_hashTable,
+                                                 cell_list ocells, intintHash_Factory *factory) {
+    return h_remap_compact_chain_run(icells, h_hashTable, ocells, factory, HASH_OPENMP_TYPE, 0, 1);
+}
+
+intintHash_Table **h_remap_compact_chain_fused_openMP (cell_list icells, intintHash_Table **h_hashTable,
+                                                       cell_list ocells, intintHash_Factory *factory) {
+    return h_remap_compact_chain_run(icells, h_hashTable, ocells, factory, HASH_OPENMP_TYPE, 1, 1);
+}
+#endif
+
+#define INSTANTIATE_H_REMAP_OP(Op) \
+template void h_remap_op<Op> (cell_list icells, const Op::value_type *ivalues, \
+                              cell_list ocells, Op::value_type *ovalues, remap_diag *diag);
+#define INSTANTIATE_H_REMAP_OP_OPENMP(Op) \
+template void h_remap_op_openMP<Op> (cell_list icells, const Op::value_type *ivalues, \
+                                     cell_list ocells, Op::value_type *ovalues, remap_diag *diag);
+#define INSTANTIATE_H_REMAP_COMPACT_OP(Op) \
+template void h_remap_compact_op<Op> (cell_list icells, const Op::value_type *ivalues, \
+                                      cell_list ocells, Op::value_type *ovalues, \
+                                      intintHash_Factory *factory, remap_diag *diag);
+#define INSTANTIATE_H_REMAP_COMPACT_OP_OPENMP(Op) \
+template void h_remap_compact_op_openMP<Op> (cell_list icells, const Op::value_type *ivalues, \
+                                             cell_list ocells, Op::value_type *ovalues, \
+                                             intintHash_Factory *factory, remap_diag *diag);
+
+INSTANTIATE_H_REMAP_OP(ReduceMean)
+INSTANTIATE_H_REMAP_OP(ReduceMeanFloat)
+INSTANTIATE_H_REMAP_OP(ReduceSum)
+INSTANTIATE_H_REMAP_OP(ReduceMin)
+INSTANTIATE_H_REMAP_OP(ReduceMax)
+INSTANTIATE_H_REMAP_OP(ReduceVolumeWeighted)
+INSTANTIATE_H_REMAP_OP(ReduceMajority)
+INSTANTIATE_H_REMAP_OP(ReduceNearest)
+INSTANTIATE_H_REMAP_COMPACT_OP(ReduceMean)
+INSTANTIATE_H_REMAP_COMPACT_OP(ReduceMeanFloat)
+INSTANTIATE_H_REMAP_COMPACT_OP(ReduceSum)
+INSTANTIATE_H_REMAP_COMPACT_OP(ReduceMin)
+INSTANTIATE_H_REMAP_COMPACT_OP(ReduceMax)
+INSTANTIATE_H_REMAP_COMPACT_OP(ReduceVolumeWeighted)
+INSTANTIATE_H_REMAP_COMPACT_OP(ReduceMajority)
+INSTANTIATE_H_REMAP_COMPACT_OP(ReduceNearest)
+#ifdef _OPENMP
+INSTANTIATE_H_REMAP_OP_OPENMP(ReduceMean)
+INSTANTIATE_H_REMAP_OP_OPENMP(ReduceMeanFloat)
+INSTANTIATE_H_REMAP_OP_OPENMP(ReduceSum)
+INSTANTIATE_H_REMAP_OP_OPENMP(ReduceMin)
+INSTANTIATE_H_REMAP_OP_OPENMP(ReduceMax)
+INSTANTIATE_H_REMAP_OP_OPENMP(ReduceVolumeWeighted)
+INSTANTIATE_H_REMAP_OP_OPENMP(ReduceMajority)
+INSTANTIATE_H_REMAP_OP_OPENMP(ReduceNearest)
+INSTANTIATE_H_REMAP_COMPACT_OP_OPENMP(ReduceMean)
+INSTANTIATE_H_REMAP_COMPACT_OP_OPENMP(ReduceMeanFloat)
+INSTANTIATE_H_REMAP_COMPACT_OP_OPENMP(ReduceSum)
+INSTANTIATE_H_REMAP_COMPACT_OP_OPENMP(ReduceMin)
+INSTANTIATE_H_REMAP_COMPACT_OP_OPENMP(ReduceMax)
+INSTANTIATE_H_REMAP_COMPACT_OP_OPENMP(ReduceVolumeWeighted)
+INSTANTIATE_H_REMAP_COMPACT_OP_OPENMP(ReduceMajority)
+INSTANTIATE_H_REMAP_COMPACT_OP_OPENMP(ReduceNearest)
+#endif
@@ -33,10 +33,72 @@
 
 #include "meshgen/meshgen.h"
 #include "HashFactory/HashFactory.h"
+#include "reduction_ops.h"
+#include "remap_diag.h"
 
 void h_remap (cell_list icells, cell_list ocells);
-void h_remap_compact (cell_list icells, cell_list ocells, intintHash_Factory *factory);
+void h_remap_compact (cell_list icells, cell_list ocells, intintHash_Factory *factory, remap_diag *diag = NULL);
 void h_remap_openMP (cell_list icells, cell_list ocells);
-void h_remap_compact_openMP (cell_list icells, cell_list ocells, intintHash_Factory *factory);
+void h_remap_2nd_order (cell_list icells, cell_list ocells);
+void h_remap_2nd_order_openMP (cell_list icells, cell_list ocells);
+void h_remap_compact_openMP (cell_list icells, cell_list ocells, intintHash_Factory *factory, remap_diag *diag = NULL);
+void h_remap_compact_config (cell_list icells, cell_list ocells, intintHash_Factory *factory,
+                             int hash_type, float load_factor, remap_diag *diag = NULL);
+void h_remap_compact_config_openMP (cell_list icells, cell_list ocells, intintHash_Factory *factory,
+                                    int hash_type, float load_factor, remap_diag *diag = NULL);
+template <class Op> void h_remap_op (cell_list icells, const typename Op::value_type *ivalues,
+                                     cell_list ocells, typename Op::value_type *ovalues,
+                                     remap_diag *diag = NULL);
+template <class Op> void h_remap_op_openMP (cell_list icells, const typename Op::value_type *ivalues,
+                                            cell_list ocells, typename Op::value_type *ovalues,
+                                            remap_diag *diag = NULL);
+template <class Op> void h_remap_compact_op (cell_list icells, const typename Op::value_type *ivalues,
+                                             cell_list ocells, typename Op::value_type *ovalues,
+                                             intintHash_Factory *factory, remap_diag *diag = NULL);
+template <class Op> void h_remap_compact_op_openMP (cell_list icells, const typename Op::value_type *ivalues,
+                                                    cell_list ocells, typename Op::value_type *ovalues,
+                                                    intintHash_Factory *factory, remap_diag *diag = NULL);
+typedef struct h_table_pool h_table_pool;
+h_table_pool *h_table_pool_create (intintHash_Factory *factory);
+void h_table_pool_destroy (h_table_pool *pool);
+void h_remap_compact_batch (uint npatches, cell_list *icells, cell_list *ocells, h_table_pool *pool);
+void h_remap_compact_batch_openMP (uint npatches, cell_list *icells, cell_list *ocells, h_table_pool *pool);
+int **h_hash_alloc (uint ibasesize, uint levmax);
+void h_hash_free (int **h_hash, uint levmax);
+void h_remap_build (cell_list icells, int **h_hash);
+intintHash_Table **h_hash_compact_build (cell_list icells, intintHash_Factory *factory,
+                                         int hash_type, float load_factor);
+void h_hash_compact_free (intintHash_Table **h_hashTable, uint levmax);
+#ifdef _OPENMP
+int **h_hash_alloc_openMP (uint ibasesize, uint levmax);
+void h_remap_build_openMP (cell_list icells, int **h_hash);
+intintHash_Table **h_hash_compact_build_openMP (cell_list icells, intintHash_Factory *factory,
+                                                int hash_type, float load_factor);
+#endif
+// Average of the input cells under the refined cell (i, j, lev) in full or compact tables
+double avg_sub_cells_h (cell_list icells, uint i, uint j, uint lev, int **h_hash, uint ibasesize);
+double avg_sub_cells_h_compact (cell_list icells, uint i, uint j, uint lev, intintHash_Table** h_hashTable, uint ibasesize);
+// Remaps icells onto ocells through its compact tables, or through tables
+// built here when h_hashTable is NULL, and frees them. Returns the compact
+// tables of ocells for the next step in a chain whose input is this ocells;
+// free the last ones with h_hash_compact_free. The output tables are filled
+// in a pass after the query, or in the query loop itself by the fused
+// variants. Either way the build moves into the step before rather than
+// going away, so a chain step costs about as much as h_remap_compact.
+intintHash_Table **h_remap_compact_chain (cell_list icells, intintHash_Table **h_hashTable,
+                                          cell_list ocells, intintHash_Factory *factory);
+intintHash_Table **h_remap_compact_chain_fused (cell_list icells, intintHash_Table **h_hashTable,
+                                                cell_list ocells, intintHash_Factory *factory);
+#ifdef _OPENMP
+intintHash_Table **h_remap_compact_chain_openMP (cell_list icells, intintHash_Table **h_hashTable,
+                                                 cell_list ocells, intintHash_Factory *factory);
+intintHash_Table **h_remap_compact_chain_fused_openMP (cell_list icells, intintHash_Table **h_hashTable,
+                                                       cell_list ocells, intintHash_Factory *factory);
+#endif
+void h_remap_query (cell_list icells, int **h_hash, cell_list ocells, uint ostart, uint oend);
+void h_remap_cached (cell_list icells, cell_list ocells, uint *nhits);
+void h_remap_compact_cached (cell_list icells, cell_list ocells, intintHash_Factory *factory, uint *nhits);
+void h_remap_cached_openMP (cell_list icells, cell_list ocells, uint *nhits);
+void h_remap_compact_cached_openMP (cell_list icells, cell_list ocells, intintHash_Factory *factory, uint *nhits);
 
 #endif
@@ -0,0 +1,210 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "meshgen/meshgen.h"
+#include "genmalloc/first_touch.h"
+#include "inline_hash_remap.h"
+
+#define INLINE_EMPTY 0xFFFFFFFFu
+
+// Keys are the single-write keys of singlewrite_remap_compact: the lower
+// left corner of each input cell on the finest level. Lookups follow the
+// same path, coarsening the key of an output cell until it hits and
+// averaging the sub-cells when the hit is finer than the output cell, but
+// every step reads the level and value from the bucket it probed.
+
+int inline_hash_keys_fit (uint ibasesize, uint levmax) {
+    uint64_t i_max = (uint64_t)ibasesize << levmax;
+    // the largest key is i_max*i_max - 1 and must stay below INLINE_EMPTY
+    return i_max*i_max <= (uint64_t)INLINE_EMPTY;
+}
+
+static inline uint inline_slot (const inline_hash *h, uint key) {
+    return (uint)(((uint64_t)key * 0x9E3779B97F4A7C15ull) >> h->shift);
+}
+
+static inline const inline_bucket *inline_find (const inline_hash *h, uint key) {
+    uint slot = inline_slot(h, key);
+    while (h->bucket[slot].key != key) {
+        if (h->bucket[slot].key == INLINE_EMPTY) return(NULL);
+        slot = (slot+1) & (h->size-1);
+    }
+    return(&h->bucket[slot]);
+}
+
+static double avg_sub_cells_inline (const inline_hash *h, uint ji, uint ii, uint level) {
+
+    uint jump = two_to_the(h->levmax - level - 1);
+    double sum = 0.0;
+
+    for (int j = 0; j < 2; j++) {
+        for (int i = 0; i < 2; i++) {
+            uint key = ((ji + (j*jump)) * h->i_max) + (ii + (i*jump));
+            const inline_bucket *b = inline_find(h, key);
+            if (b->level == (level + 1)) {
+                sum += b->value;
+            } else {
+                sum += avg_sub_cells_inline(h, ji + (j*jump), ii + (i*jump), level + 1);
+            }
+        }
+    }
+
+    return sum/4.0;
+}
+
+static inline_hash inline_hash_run (cell_list icells, int threaded) {
+
+    (void)threaded;
+    inline_hash h;
+    h.bucket = NULL;
+    if (! inline_hash_keys_fit(icells.ibasesize, icells.levmax)) {
+        printf("inline_hash_build: the keys of a %u base mesh with %u levels do not fit a uint key\n",
+               icells.ibasesize, icells.levmax);
+        return(h);
+    }
+    h.i_max  = icells.ibasesize*two_to_the(icells.levmax);
+    h.levmax = icells.levmax;
+    // at most half full
+    h.size = 64;
+    h.shift = 58;
+    while (h.size < 2*icells.ncells) {
+        h.size *= 2;
+        h.shift--;
+    }
+    h.bucket = (inline_bucket *)first_touch_malloc(h.size, sizeof(inline_bucket),
+                                                threaded ? FIRST_TOUCH_BLOCK : FIRST_TOUCH_NONE);
+    if (h.bucket == NULL) {
+        printf("inline_hash_build: could not allocate %u buckets\n", h.size);
+        return(h);
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded)
+#endif
+    for (uint b = 0; b < h.size; b++) {
+        h.bucket[b].key = INLINE_EMPTY;
+    }
+
+    // Every cell has its own corner key, so a slot is claimed with a single
+    // compare and swap and the level and value are written after it
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded)
+#endif
+    for (uint n = 0; n < icells.ncells; n++) {
+        uint lev_mod = two_to_the(h.levmax - icells.level[n]);
+        uint key = ((icells.j[n] * lev_mod) * h.i_max) + (icells.i[n] * lev_mod);
+        uint slot = inline_slot(&h, key);
+#ifdef _OPENMP
+        if (threaded) {
+            while (! __sync_bool_compare_and_swap(&h.bucket[slot].key, INLINE_EMPTY, key)) {
+                slot = (slot+1) & (h.size-1);
+            }
+        } else
+#endif
+        {
+            while (h.bucket[slot].key != INLINE_EMPTY) {
+                slot = (slot+1) & (h.size-1);
+            }
+            h.bucket[slot].key = key;
+        }
+        h.bucket[slot].level = icells.level[n];
+        h.bucket[slot].value = icells.values[n];
+    }
+
+    return(h);
+}
+
+inline_hash inline_hash_build (cell_list icells) {
+    return(inline_hash_run(icells, 0));
+}
+
+void inline_hash_destroy (inline_hash h) {
+    free(h.bucket);
+}
+
+static void singlewrite_remap_inline_run (cell_list icells, cell_list ocells, int threaded) {
+
+    (void)threaded;
+    inline_hash h = inline_hash_run(icells, threaded);
+    if (h.bucket == NULL) return;
+    uint max_lev = h.levmax;
+
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded)
+#endif
+    for (uint n = 0; n < ocells.ncells; n++) {
+        uint olev = ocells.level[n];
+        uint lev = (olev < max_lev) ? olev : max_lev;
+        // output cells finer than the finest input level use their ancestor
+        uint ii = (ocells.i[n] >> (olev - lev)) << (max_lev - lev);
+        uint ji = (ocells.j[n] >> (olev - lev)) << (max_lev - lev);
+
+        const inline_bucket *b = inline_find(&h, ji*h.i_max + ii);
+        while (b == NULL && lev > 0) {
+            lev--;
+            uint lev_diff = max_lev - lev;
+            ii >>= lev_diff;
+            ii <<= lev_diff;
+            ji >>= lev_diff;
+            ji <<= lev_diff;
+            b = inline_find(&h, ji*h.i_max + ii);
+        }
+        if (lev >= b->level) {
+            ocells.values[n] = b->value;
+        } else {
+            ocells.values[n] = avg_sub_cells_inline(&h, ji, ii, lev);
+        }
+    }
+
+    inline_hash_destroy(h);
+}
+
+void singlewrite_remap_inline (cell_list icells, cell_list ocells) {
+    singlewrite_remap_inline_run(icells, ocells, 0);
+}
+
+#ifdef _OPENMP
+inline_hash inline_hash_build_openMP (cell_list icells) {
+    return(inline_hash_run(icells, 1));
+}
+
+void singlewrite_remap_inline_openMP (cell_list icells, cell_list ocells) {
+    singlewrite_remap_inline_run(icells, ocells, 1);
+}
+#endif
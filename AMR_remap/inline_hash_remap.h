@@ -0,0 +1,75 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#ifndef INLINE_HASH_REMAP_H
+#define INLINE_HASH_REMAP_H
+
+#include "meshgen/meshgen.h"
+
+// Compact single-write hash whose buckets hold the input cell level and
+// value next to the key, so a hit is answered from the bucket without a
+// dependent load of icells.level and icells.values. Buckets are 16 bytes,
+// four to a 64 byte line, and collisions are resolved by linear probing so
+// they mostly stay in the line of the first probe.
+typedef struct {
+    uint key;       // finest level key of the lower left corner of the cell
+    uint level;
+    double value;
+} inline_bucket;
+
+typedef struct {
+    uint size;      // number of buckets, a power of two
+    uint shift;     // 64 - log2(size), for the multiplicative hash
+    uint i_max;     // finest level cells across the mesh, the key stride
+    uint levmax;
+    inline_bucket *bucket;
+} inline_hash;
+
+// Keys are uint, with 0xFFFFFFFF marking an empty bucket, so a mesh fits
+// while (ibasesize * 2^levmax)^2 does not exceed it, up to 65535 finest
+// cells across.
+int inline_hash_keys_fit (uint ibasesize, uint levmax);
+
+// The remaps build and free their own table; these are for callers that
+// query the same input mesh many times. The build prints a message and
+// returns a table with a NULL bucket array when the mesh keys do not fit
+// or the buckets cannot be allocated; the remaps then leave ocells.values
+// untouched.
+inline_hash inline_hash_build (cell_list icells);
+void inline_hash_destroy (inline_hash h);
+
+void singlewrite_remap_inline (cell_list icells, cell_list ocells);
+#ifdef _OPENMP
+inline_hash inline_hash_build_openMP (cell_list icells);
+void singlewrite_remap_inline_openMP (cell_list icells, cell_list ocells);
+#endif
+
+#endif
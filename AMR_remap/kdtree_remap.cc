@@ -91,3 +91,63 @@ void remap_kDtree2d(cell_list icells, cell_list ocells) {
    return;
 
 }
+
+// Tree of the input cells on the finest level, for point location. Unlike
+// the remap tree the boxes are not shrunk, so every point falls in one.
+void kdtree_cell_tree2d(cell_list icells, TKDTree2d *tree) {
+
+    TBounds2d box;
+
+    KDTree_Initialize2d(tree);
+    for(uint ic = 0; ic < icells.ncells; ic++) {
+        uint ifactor = two_to_the(icells.levmax - icells.level[ic]);
+        box.min.x = icells.i[ic] * ifactor;
+        box.max.x = box.min.x    + ifactor;
+        box.min.y = icells.j[ic] * ifactor;
+        box.max.y = box.min.y    + ifactor;
+        KDTree_AddElement2d(tree, &box);
+    }
+    KDTree_CreateTree2d(tree);
+}
+
+// Cell containing each point, in base mesh cell units, by querying the
+// tree with a degenerate box. A point on a cell edge is reported by all
+// the cells sharing it, so the first one that holds it half open is kept.
+static inline int kdtree_locate_point(TKDTree2d *tree, cell_list icells, double x, double y) {
+
+    int num;
+    int index_list[8];
+    TBounds2d box;
+    double scale = two_to_the(icells.levmax);
+
+    box.min.x = box.max.x = x * scale;
+    box.min.y = box.max.y = y * scale;
+    KDTree_QueryBoxIntersect2d(tree, &num, &(index_list[0]), &box);
+
+    for(int jc = 0; jc < num; jc++) {
+        uint ifactor = two_to_the(icells.levmax - icells.level[index_list[jc]]);
+        double xmin = icells.i[index_list[jc]] * ifactor;
+        double ymin = icells.j[index_list[jc]] * ifactor;
+        if (box.min.x >= xmin && box.min.x < xmin + ifactor &&
+            box.min.y >= ymin && box.min.y < ymin + ifactor) return index_list[jc];
+    }
+    return -1;
+}
+
+void kdtree_locate2d(TKDTree2d *tree, cell_list icells, uint npoints, const double *x, const double *y, int *cell) {
+
+    for(uint n = 0; n < npoints; n++) {
+        cell[n] = kdtree_locate_point(tree, icells, x[n], y[n]);
+    }
+}
+
+#ifdef _OPENMP
+// The tree is built before the queries, which then only read it
+void kdtree_locate2d_openMP(TKDTree2d *tree, cell_list icells, uint npoints, const double *x, const double *y, int *cell) {
+
+#pragma omp parallel for
+    for(uint n = 0; n < npoints; n++) {
+        cell[n] = kdtree_locate_point(tree, icells, x[n], y[n]);
+    }
+}
+#endif
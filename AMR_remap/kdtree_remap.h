@@ -32,7 +32,11 @@
 #define KDTREE_REMAP_H
 
 #include "meshgen/meshgen.h"
+#include "KDTree/KDTree2d.h"
 
 void remap_kDtree2d(cell_list icells, cell_list ocells);
+void kdtree_cell_tree2d(cell_list icells, TKDTree2d *tree);
+void kdtree_locate2d(TKDTree2d *tree, cell_list icells, uint npoints, const double *x, const double *y, int *cell);
+void kdtree_locate2d_openMP(TKDTree2d *tree, cell_list icells, uint npoints, const double *x, const double *y, int *cell);
 
 #endif
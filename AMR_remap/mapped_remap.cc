@@ -0,0 +1,187 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#include <stdlib.h>
+#include <math.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "meshgen/meshgen.h"
+#include "HashFactory/HashFactory.h"
+#include "hierarchical_remap.h"
+#include "mapped_remap.h"
+
+#define HASH_TYPE (LCG_QUADRATIC_OPEN_COMPACT_HASH_ID)
+#define HASH_LOAD_FACTOR 0.3333333
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
+
+// An output cell becomes a box [x0,x1) x [y0,y1) in input base cell units.
+// At each level the box covers a range of input cells found with floor and
+// ceil. While that range is a single cell the walk either finds the cell or
+// a breadcrumb and moves down a level, as in the aligned remap. Otherwise
+// every cell in the range is known to be a cell or refined, since its
+// parent was refined, and the overlapping cells are gathered from there.
+
+h_remap_mapping h_remap_mapping_bases (uint ibasesize, uint obasesize, double offset_i, double offset_j) {
+    h_remap_mapping map;
+    map.scale_i  = (double)ibasesize/(double)obasesize;
+    map.scale_j  = (double)ibasesize/(double)obasesize;
+    map.offset_i = offset_i;
+    map.offset_j = offset_j;
+    return map;
+}
+
+static inline int mapped_probe (int **h_hash, intintHash_Table **h_hashTable, uint ibasesize,
+                                uint i, uint j, uint lev) {
+    uint key = j*ibasesize*two_to_the(lev) + i;
+    int probe;
+    if (h_hash != NULL) {
+        probe = h_hash[lev][key];
+    } else {
+        intintHash_QuerySingle(h_hashTable[lev], key, &probe);
+    }
+    return probe;
+}
+
+// Adds the input cells at or under (i, j, lev) that overlap the box,
+// weighted by the overlap area, skipping the children outside the box
+static void mapped_overlap (int **h_hash, intintHash_Table **h_hashTable, cell_list icells,
+                            uint i, uint j, uint lev, const double box[4], double *sum, double *area) {
+
+    int probe = mapped_probe(h_hash, h_hashTable, icells.ibasesize, i, j, lev);
+    if (probe >= 0) {
+        double size = 1.0/two_to_the(lev);
+        double w = (MIN(box[1], (i+1)*size) - MAX(box[0], i*size)) *
+                   (MIN(box[3], (j+1)*size) - MAX(box[2], j*size));
+        *sum  += icells.values[probe]*w;
+        *area += w;
+        return;
+    }
+
+    double xmid = (2*i+1)*0.5/two_to_the(lev);
+    double ymid = (2*j+1)*0.5/two_to_the(lev);
+    for (uint jc = 0; jc < 2; jc++) {
+        if (jc == 0 ? box[2] >= ymid : box[3] <= ymid) continue;
+        for (uint ic = 0; ic < 2; ic++) {
+            if (ic == 0 ? box[0] >= xmid : box[1] <= xmid) continue;
+            mapped_overlap(h_hash, h_hashTable, icells, 2*i+ic, 2*j+jc, lev+1, box, sum, area);
+        }
+    }
+}
+
+static double mapped_value (int **h_hash, intintHash_Table **h_hashTable, cell_list icells,
+                            const double box[4]) {
+
+    for (uint lev = 0; lev <= icells.levmax; lev++) {
+        double ncells = (double)icells.ibasesize*two_to_the(lev);
+        double scale = two_to_the(lev);
+        double i0 = MAX(floor(box[0]*scale), 0.0), i1 = MIN(ceil(box[1]*scale), ncells) - 1.0;
+        double j0 = MAX(floor(box[2]*scale), 0.0), j1 = MIN(ceil(box[3]*scale), ncells) - 1.0;
+        if (i0 > i1 || j0 > j1) return 0.0;
+
+        if (i0 == i1 && j0 == j1) {
+            int probe = mapped_probe(h_hash, h_hashTable, icells.ibasesize, (uint)i0, (uint)j0, lev);
+            if (probe >= 0) return icells.values[probe];
+            continue;
+        }
+
+        double sum = 0.0, area = 0.0;
+        for (uint j = (uint)j0; j <= (uint)j1; j++) {
+            for (uint i = (uint)i0; i <= (uint)i1; i++) {
+                mapped_overlap(h_hash, h_hashTable, icells, i, j, lev, box, &sum, &area);
+            }
+        }
+        return (area > 0.0) ? sum/area : 0.0;
+    }
+    return 0.0;
+}
+
+static void h_remap_mapped_run (cell_list icells, cell_list ocells, h_remap_mapping map,
+                                intintHash_Factory *factory, int threaded) {
+
+    (void)threaded;
+    int **h_hash = NULL;
+    intintHash_Table **h_hashTable = NULL;
+
+    if (factory != NULL) {
+        h_hashTable = h_hash_compact_build(icells, factory, HASH_TYPE, HASH_LOAD_FACTOR);
+    } else {
+        h_hash = h_hash_alloc(icells.ibasesize, icells.levmax);
+
+#ifdef _OPENMP
+        if (threaded) h_remap_build_openMP(icells, h_hash);
+        else
+#endif
+        h_remap_build(icells, h_hash);
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1024) if(threaded)
+#endif
+    for (uint n = 0; n < ocells.ncells; n++) {
+        double size = 1.0/two_to_the(ocells.level[n]);
+        double x0 = map.offset_i + map.scale_i*ocells.i[n]*size;
+        double x1 = map.offset_i + map.scale_i*(ocells.i[n]+1)*size;
+        double y0 = map.offset_j + map.scale_j*ocells.j[n]*size;
+        double y1 = map.offset_j + map.scale_j*(ocells.j[n]+1)*size;
+        // a negative scale mirrors the axis
+        double box[4] = {MIN(x0, x1), MAX(x0, x1), MIN(y0, y1), MAX(y0, y1)};
+        ocells.values[n] = mapped_value(h_hash, h_hashTable, icells, box);
+    }
+
+    if (h_hashTable != NULL) h_hash_compact_free(h_hashTable, icells.levmax);
+    if (h_hash != NULL) h_hash_free(h_hash, icells.levmax);
+}
+
+void h_remap_mapped (cell_list icells, cell_list ocells, h_remap_mapping map) {
+    h_remap_mapped_run(icells, ocells, map, NULL, 0);
+}
+
+void h_remap_mapped_compact (cell_list icells, cell_list ocells, h_remap_mapping map,
+                             intintHash_Factory *factory) {
+    h_remap_mapped_run(icells, ocells, map, factory, 0);
+}
+
+#ifdef _OPENMP
+void h_remap_mapped_openMP (cell_list icells, cell_list ocells, h_remap_mapping map) {
+    h_remap_mapped_run(icells, ocells, map, NULL, 1);
+}
+
+// The compact tables are built serially and queried by all threads
+void h_remap_mapped_compact_openMP (cell_list icells, cell_list ocells, h_remap_mapping map,
+                                    intintHash_Factory *factory) {
+    h_remap_mapped_run(icells, ocells, map, factory, 1);
+}
+#endif
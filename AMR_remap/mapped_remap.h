@@ -0,0 +1,69 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#ifndef MAPPED_REMAP_H
+#define MAPPED_REMAP_H
+
+#include "meshgen/meshgen.h"
+#include "HashFactory/HashFactory.h"
+
+// Axis-aligned affine map from the output index space to the input one, in
+// units of base mesh cells. The output point (x, y) lies at
+// (offset_i + scale_i*x, offset_j + scale_j*y) on the input mesh, so meshes
+// with different base sizes over the same domain have a scale of
+// ibasesize/obasesize, and a restart on a sub-domain adds its origin as the
+// offset.
+typedef struct {
+    double scale_i;
+    double scale_j;
+    double offset_i;
+    double offset_j;
+} h_remap_mapping;
+
+h_remap_mapping h_remap_mapping_bases (uint ibasesize, uint obasesize, double offset_i, double offset_j);
+
+// Conservative remap through the hierarchical tables between meshes whose
+// cells need not line up. Each output value is the average of the input
+// cells over the part of the output cell inside the input domain, weighted
+// by the overlap areas; output cells entirely outside it get zero. The
+// tables are walked down from level 0 while the output cell lies inside a
+// single input cell, so those output cells cost the same as in the aligned
+// remap, and only the others gather the overlapping input cells.
+void h_remap_mapped (cell_list icells, cell_list ocells, h_remap_mapping map);
+void h_remap_mapped_compact (cell_list icells, cell_list ocells, h_remap_mapping map,
+                             intintHash_Factory *factory);
+#ifdef _OPENMP
+void h_remap_mapped_openMP (cell_list icells, cell_list ocells, h_remap_mapping map);
+void h_remap_mapped_compact_openMP (cell_list icells, cell_list ocells, h_remap_mapping map,
+                                    intintHash_Factory *factory);
+#endif
+
+#endif
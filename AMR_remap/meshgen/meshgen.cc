@@ -33,13 +33,19 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "meshgen.h"
+#include "genmalloc/first_touch.h"
 
 static bool randomize = true;
 
 #define SQ(x) (( (x)*(x) ))
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
 
 void swap_double(double** a, double** b) {
   double* c = *a;
@@ -86,6 +92,27 @@ cell_list create_cell_list(cell_list a, uint length) {
     return(a);
 }
 
+// The arrays are placed with the first touch policy for the threads that
+// will loop over the cells
+cell_list create_cell_list_placed(cell_list a, uint length, int policy) {
+    a.ncells = length;
+    a.i      = (uint *)   first_touch_malloc(length, sizeof(uint),   policy);
+    a.j      = (uint *)   first_touch_malloc(length, sizeof(uint),   policy);
+    a.level  = (uint *)   first_touch_malloc(length, sizeof(uint),   policy);
+    a.values = (double *) first_touch_malloc(length, sizeof(double), policy);
+    return(a);
+}
+
+cell_list copy_cell_list(cell_list a) {
+    cell_list b = a;
+    b = create_cell_list(b, a.ncells);
+    memcpy(b.i,      a.i,      a.ncells*sizeof(uint));
+    memcpy(b.j,      a.j,      a.ncells*sizeof(uint));
+    memcpy(b.level,  a.level,  a.ncells*sizeof(uint));
+    memcpy(b.values, a.values, a.ncells*sizeof(double));
+    return(b);
+}
+
 void destroy(cell_list a) {
     free(a.i);
     free(a.j);
@@ -278,6 +305,359 @@ cell_list shuffle_cell_list(cell_list clist, uint num) {
     return clist;
 }
 
+// Spreads the lower 32 bits of val so that they occupy the even bits
+static uint64_t spread_bits(uint64_t val) {
+    val &= 0x00000000FFFFFFFFull;
+    val = (val | (val << 16)) & 0x0000FFFF0000FFFFull;
+    val = (val | (val <<  8)) & 0x00FF00FF00FF00FFull;
+    val = (val | (val <<  4)) & 0x0F0F0F0F0F0F0F0Full;
+    val = (val | (val <<  2)) & 0x3333333333333333ull;
+    val = (val | (val <<  1)) & 0x5555555555555555ull;
+    return val;
+}
+
+uint64_t morton_encode(uint i, uint j) {
+    return spread_bits(i) | (spread_bits(j) << 1);
+}
+
+// Inverse of spread_bits, gathers the even bits of val
+static uint compact_bits(uint64_t val) {
+    val &= 0x5555555555555555ull;
+    val = (val | (val >>  1)) & 0x3333333333333333ull;
+    val = (val | (val >>  2)) & 0x0F0F0F0F0F0F0F0Full;
+    val = (val | (val >>  4)) & 0x00FF00FF00FF00FFull;
+    val = (val | (val >>  8)) & 0x0000FFFF0000FFFFull;
+    val = (val | (val >> 16)) & 0x00000000FFFFFFFFull;
+    return (uint)val;
+}
+
+uint morton_decode_i(uint64_t key) {
+    return compact_bits(key);
+}
+
+uint morton_decode_j(uint64_t key) {
+    return compact_bits(key >> 1);
+}
+
+packed_cell_list pack_cell_list(cell_list clist) {
+    packed_cell_list plist;
+    plist.ncells    = clist.ncells;
+    plist.ibasesize = clist.ibasesize;
+    plist.levmax    = clist.levmax;
+    plist.dist      = clist.dist;
+    plist.key       = (uint64_t *)malloc(clist.ncells*sizeof(uint64_t));
+    plist.values    = (double *)  malloc(clist.ncells*sizeof(double));
+    for (uint ic = 0; ic < clist.ncells; ic++) {
+        plist.key[ic]    = packed_key(morton_encode(clist.i[ic], clist.j[ic]), clist.level[ic]);
+        plist.values[ic] = clist.values[ic];
+    }
+    return plist;
+}
+
+cell_list unpack_cell_list(packed_cell_list plist) {
+    cell_list clist;
+    clist.ibasesize = plist.ibasesize;
+    clist.levmax    = plist.levmax;
+    clist = create_cell_list(clist, plist.ncells);
+    clist.dist      = plist.dist;
+    for (uint ic = 0; ic < plist.ncells; ic++) {
+        uint64_t morton = packed_morton(plist.key[ic]);
+        clist.i[ic]      = morton_decode_i(morton);
+        clist.j[ic]      = morton_decode_j(morton);
+        clist.level[ic]  = packed_level(plist.key[ic]);
+        clist.values[ic] = plist.values[ic];
+    }
+    return clist;
+}
+
+void destroy_packed(packed_cell_list a) {
+    free(a.key);
+    free(a.values);
+}
+
+typedef struct {
+    uint64_t key;
+    uint     index;
+} sort_entry;
+
+static int compare_sort_entry(const void *a, const void *b) {
+    uint64_t ka = ((const sort_entry *)a)->key;
+    uint64_t kb = ((const sort_entry *)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+// Reorders the cells by the given key, which is filled in from each cell's
+// lower left corner on the finest level of the mesh
+static cell_list sort_cell_list_by(cell_list clist, bool morton) {
+    sort_entry *entry = (sort_entry *)malloc(clist.ncells*sizeof(sort_entry));
+    uint i_max = clist.ibasesize*two_to_the(clist.levmax);
+
+    for (uint ic = 0; ic < clist.ncells; ic++) {
+        uint lev_mod = two_to_the(clist.levmax - clist.level[ic]);
+        uint ii = clist.i[ic]*lev_mod;
+        uint jj = clist.j[ic]*lev_mod;
+        entry[ic].key   = morton ? morton_encode(ii, jj) : (uint64_t)jj*i_max + ii;
+        entry[ic].index = ic;
+    }
+    qsort(entry, clist.ncells, sizeof(sort_entry), compare_sort_entry);
+
+    uint   *itmp = (uint *)  malloc(clist.ncells*sizeof(uint));
+    double *vtmp = (double *)malloc(clist.ncells*sizeof(double));
+
+    for (uint ic = 0; ic < clist.ncells; ic++) itmp[ic] = clist.i[entry[ic].index];
+    memcpy(clist.i, itmp, clist.ncells*sizeof(uint));
+    for (uint ic = 0; ic < clist.ncells; ic++) itmp[ic] = clist.j[entry[ic].index];
+    memcpy(clist.j, itmp, clist.ncells*sizeof(uint));
+    for (uint ic = 0; ic < clist.ncells; ic++) itmp[ic] = clist.level[entry[ic].index];
+    memcpy(clist.level, itmp, clist.ncells*sizeof(uint));
+    for (uint ic = 0; ic < clist.ncells; ic++) vtmp[ic] = clist.values[entry[ic].index];
+    memcpy(clist.values, vtmp, clist.ncells*sizeof(double));
+
+    free(itmp);
+    free(vtmp);
+    free(entry);
+    return clist;
+}
+
+cell_list sort_cell_list_rowmajor(cell_list clist) {
+    return sort_cell_list_by(clist, false);
+}
+
+cell_list sort_cell_list_morton(cell_list clist) {
+    return sort_cell_list_by(clist, true);
+}
+
+// Coarse cells queued for 2:1 smoothing, bucketed by the level they were
+// queued at. A cell on level lev forces its face neighbours up to lev-1, so
+// only buckets 2 and above can raise anything and only those are kept.
+typedef struct {
+  uint nlev;
+  uint **cells;
+  size_t *count;
+  size_t *capacity;
+} level_worklist;
+
+static level_worklist worklist_create(uint levmax) {
+  level_worklist wl;
+  wl.nlev     = levmax+1;
+  wl.cells    = (uint **) calloc(wl.nlev, sizeof(uint *));
+  wl.count    = (size_t *)calloc(wl.nlev, sizeof(size_t));
+  wl.capacity = (size_t *)calloc(wl.nlev, sizeof(size_t));
+  return wl;
+}
+
+static void worklist_destroy(level_worklist wl) {
+  for (uint lev = 0; lev < wl.nlev; lev++) free(wl.cells[lev]);
+  free(wl.cells);
+  free(wl.count);
+  free(wl.capacity);
+}
+
+static void worklist_append(level_worklist *wl, uint lev, const uint *cells, size_t num) {
+  if (lev < 2 || num == 0) return;
+  if (wl->count[lev] + num > wl->capacity[lev]) {
+    size_t capacity = MAX(2*wl->capacity[lev], wl->count[lev] + num);
+    wl->cells[lev] = (uint *)realloc(wl->cells[lev], capacity*sizeof(uint));
+    wl->capacity[lev] = capacity;
+  }
+  memcpy(wl->cells[lev] + wl->count[lev], cells, num*sizeof(uint));
+  wl->count[lev] += num;
+}
+
+static void worklist_push(level_worklist *wl, uint lev, uint ic) {
+  worklist_append(wl, lev, &ic, 1);
+}
+
+// Queues coarse cell ic and its face neighbours at their current levels.
+// Queueing the cell covers an increase of its level; queueing the
+// neighbours covers a decrease, since they are the ones that may now force
+// it back up.
+static void worklist_push_changed(level_worklist *wl, const uint *level, uint n, uint ic) {
+  uint xc = ic % n, yc = ic / n;
+  worklist_push(wl, level[ic], ic);
+  if (yc > 0)   worklist_push(wl, level[ic-n], ic-n);
+  if (yc+1 < n) worklist_push(wl, level[ic+n], ic+n);
+  if (xc > 0)   worklist_push(wl, level[ic-1], ic-1);
+  if (xc+1 < n) worklist_push(wl, level[ic+1], ic+1);
+}
+
+// Raises levels on the n x n coarse grid until face neighbours differ by at
+// most one level. Buckets are drained from the finest level down; a cell on
+// level lev raises any neighbour below lev-1 to exactly lev-1 and queues it
+// in the next bucket, so every cell is settled before its bucket is reached
+// and the result is the same least fixed point the full Gauss-Seidel sweeps
+// converged to. Entries whose level has since been raised were already
+// handled from a finer bucket and are skipped.
+static void smooth_worklist(uint *level, uint n, level_worklist *wl) {
+  for (uint lev = wl->nlev-1; lev >= 2; lev--) {
+    const uint *cells = wl->cells[lev];
+    size_t count = wl->count[lev];
+    uint raise = lev-1;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      uint *raised = (uint *)malloc(64*sizeof(uint));
+      size_t nraised = 0, capacity = 64;
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (size_t k = 0; k < count; k++) {
+        uint ic = cells[k];
+        if (level[ic] != lev) continue;
+
+        uint xc = ic % n, yc = ic / n;
+        uint nbr[4];
+        int nnbr = 0;
+        if (yc > 0)   nbr[nnbr++] = ic-n;
+        if (yc+1 < n) nbr[nnbr++] = ic+n;
+        if (xc > 0)   nbr[nnbr++] = ic-1;
+        if (xc+1 < n) nbr[nnbr++] = ic+1;
+
+        for (int in = 0; in < nnbr; in++) {
+          uint nb = nbr[in], old;
+#ifdef _OPENMP
+#pragma omp atomic read
+#endif
+          old = level[nb];
+          if (old >= raise) continue;
+#ifdef _OPENMP
+#pragma omp atomic capture
+#endif
+          { old = level[nb]; level[nb] = raise; }
+          // Another thread may have raised it first; only one queues it
+          if (old >= raise) continue;
+          if (nraised == capacity) {
+            capacity *= 2;
+            raised = (uint *)realloc(raised, capacity*sizeof(uint));
+          }
+          raised[nraised++] = nb;
+        }
+      }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+      worklist_append(wl, raise, raised, nraised);
+      free(raised);
+    }
+
+    free(wl->cells[lev]);
+    wl->cells[lev] = NULL;
+    wl->count[lev] = 0;
+    wl->capacity[lev] = 0;
+  }
+}
+
+// Number of cells added by refining the coarse cells to their levels
+static uint refined_count(const uint *level, uint ncells) {
+  uint newcount = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:newcount)
+#endif
+  for (uint ic = 0; ic < ncells; ic++) {
+    newcount += four_to_the(level[ic]) - 1;
+  }
+  return newcount;
+}
+
+static uint64_t mix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+// Random permutation of the cell arrays. Each cell is scattered to a
+// bucket picked by hashing its index, then every bucket, small enough to
+// stay in cache, gets its own Fisher-Yates shuffle. Both random streams
+// come from the seed and the bucket and cell indices, so the order does
+// not depend on the thread count.
+static void shuffle_cells(uint **level, uint **i, uint **j, uint ncells, uint64_t seed) {
+  uint nbuckets = MAX(1u, ncells/16384u);
+  if (nbuckets > 4096u) nbuckets = 4096u;
+
+  uint *level_temp = (uint *)malloc(sizeof(uint)*ncells);
+  uint *i_temp     = (uint *)malloc(sizeof(uint)*ncells);
+  uint *j_temp     = (uint *)malloc(sizeof(uint)*ncells);
+  uint *bucket_start = (uint *)malloc(sizeof(uint)*(nbuckets+1));
+  uint *offsets = NULL;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    int nthreads = 1, thread_id = 0;
+#ifdef _OPENMP
+    nthreads = omp_get_num_threads();
+    thread_id = omp_get_thread_num();
+#pragma omp single
+#endif
+    offsets = (uint *)calloc((size_t)nthreads*nbuckets, sizeof(uint));
+
+    uint *my_offsets = offsets + (size_t)thread_id*nbuckets;
+    uint chunk = (ncells + nthreads - 1)/nthreads;
+    uint cstart = MIN(ncells, thread_id*chunk);
+    uint cend = MIN(ncells, cstart + chunk);
+
+    for (uint ic = cstart; ic < cend; ic++) {
+      my_offsets[(mix64(seed ^ ic) >> 32) * nbuckets >> 32]++;
+    }
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+    {
+      // Bucket-major, thread-minor so each bucket keeps the serial order
+      uint sum = 0;
+      for (uint b = 0; b < nbuckets; b++) {
+        bucket_start[b] = sum;
+        for (int t = 0; t < nthreads; t++) {
+          uint count = offsets[(size_t)t*nbuckets+b];
+          offsets[(size_t)t*nbuckets+b] = sum;
+          sum += count;
+        }
+      }
+      bucket_start[nbuckets] = sum;
+    }
+
+    for (uint ic = cstart; ic < cend; ic++) {
+      uint dest = my_offsets[(mix64(seed ^ ic) >> 32) * nbuckets >> 32]++;
+      level_temp[dest] = (*level)[ic];
+      i_temp[dest]     = (*i)[ic];
+      j_temp[dest]     = (*j)[ic];
+    }
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp for schedule(dynamic)
+#endif
+    for (uint b = 0; b < nbuckets; b++) {
+      uint64_t state = mix64(seed + 0x632be59bd9b4e019ull*(b+1));
+      uint base = bucket_start[b];
+      for (uint k = bucket_start[b+1] - base; k > 1; k--) {
+        state = mix64(state);
+        uint ic = base + k - 1;
+        uint jc = base + (uint)(((state >> 32) * (uint64_t)k) >> 32);
+        uint tmp;
+        tmp = level_temp[ic]; level_temp[ic] = level_temp[jc]; level_temp[jc] = tmp;
+        tmp = i_temp[ic];     i_temp[ic]     = i_temp[jc];     i_temp[jc]     = tmp;
+        tmp = j_temp[ic];     j_temp[ic]     = j_temp[jc];     j_temp[jc]     = tmp;
+      }
+    }
+  }
+
+  swap_uint(level, &level_temp);
+  swap_uint(i, &i_temp);
+  swap_uint(j, &j_temp);
+  free(level_temp);
+  free(i_temp);
+  free(j_temp);
+  free(bucket_start);
+  free(offsets);
+}
+
 // adaptiveMeshConstructor()
 // Inputs: n (width/height of the square mesh), l (maximum level of refinement),
 //         pointers for the level, x, and y arrays (should be NULL for all three)
@@ -319,57 +699,22 @@ cell_list adaptiveMeshConstructorWij(cell_list icells, const uint n, const uint
   //printf("Levels of refinement randomly set.\n");
 
   // Smooth the Refinement
-  int newcount = -1;
-  while(newcount != 0) {
-    newcount = 0;
-    uint lev = 0;
-    for(ic = 0; ic < ncells; ic++) {
-      lev = level[ic];
-      lev++;
-      // Check bottom neighbor
-      if((int)ic - (int)n >= 0) {
-        if(level[ic-n] > lev) {
-          level[ic] = lev;
-          newcount++;
-          continue;
-        }
-      }
-      // Check top neighbor
-      if(ic + n < ncells) {
-        if(level[ic+n] > lev) {
-          level[ic] = lev;
-          newcount++;
-          continue;
-        }
-      }
-      // Check left neighbor
-      if(((int)ic%(int)n)-1 >= 0) {
-        if(level[ic-1] > lev) {
-          level[ic] = lev;
-          newcount++;
-          continue;
-        }
-      }
-      // Check right neighbor
-      if((ic%n)+1 < n) {
-        if(level[ic+1] > lev) {
-          level[ic] = lev;
-          newcount++;
-          continue;
-        }
-      }
-    }
+  level_worklist worklist = worklist_create(levmax);
+  for(ic = 0; ic < ncells; ic++) {
+    worklist_push(&worklist, level[ic], ic);
   }
+  smooth_worklist(level, n, &worklist);
 
   //printf("\nDEBUG -- ncells %d target_ncells %ld fine mesh size %ld\n",ncells,target_ncells,n*two_to_the(levmax)*n*two_to_the(levmax));
   if (target_ncells > ncells && target_ncells < n*two_to_the(levmax)*n*two_to_the(levmax)) {
     uint icount = 0;
-    uint newcount = 0;
-    for(ic = 0; ic < ncells; ic++) {newcount += (powerOfFour(level[ic]) - 1);}
+    uint newcount = refined_count(level, ncells);
+    uint *changed = (uint *)malloc(sizeof(uint)*ncells);
 
     while ( (ncells+newcount) - target_ncells > MAX(5u,target_ncells/10000u) && icount < 40u) {
       icount++;
       //printf("DEBUG -- Adjusting cell count %ld target %ld diff %ld\n",ncells+newcount, target_ncells, abs(ncells+newcount - target_ncells));
+      uint nchanged = 0;
 
       if (ncells+newcount > target_ncells){
         int reduce_count = ((ncells+newcount) - target_ncells);
@@ -381,6 +726,7 @@ cell_list adaptiveMeshConstructorWij(cell_list icells, const uint n, const uint
              reduce_count-=4;
           //   printf("DEBUG reducing level for ic %d level %d reduce_count %d jj %d\n",jj,level[jj],reduce_count,jj);
              level[jj]--;
+             changed[nchanged++] = jj;
           }
           jcount++;
         }
@@ -394,58 +740,24 @@ cell_list adaptiveMeshConstructorWij(cell_list icells, const uint n, const uint
           if(jj>0 && jj<ncells && level[jj] < levmax) {
             increase_count-=4;
             level[jj]++;
+            changed[nchanged++] = jj;
           }
           jcount++;
         }
       }
 
-      // Smooth the Refinement
-      newcount = -1;
-      while(newcount != 0) {
-        newcount = 0;
-        uint lev = 0;
-        for(ic = 0; ic < ncells; ic++) {
-          lev = level[ic];
-          lev++;
-          // Check bottom neighbor
-          if((int)ic - (int)n >= 0) {
-            if(level[ic-n] > lev) {
-              level[ic] = lev;
-              newcount++;
-              continue;
-            }
-          }
-          // Check top neighbor
-          if(ic + n < ncells) {
-            if(level[ic+n] > lev) {
-              level[ic] = lev;
-              newcount++;
-              continue;
-            }
-          }
-          // Check left neighbor
-          if(((int)ic%(int)n)-1 >= 0) {
-            if(level[ic-1] > lev) {
-              level[ic] = lev;
-              newcount++;
-              continue;
-            }
-          }
-          // Check right neighbor
-          if((ic%n)+1 < n) {
-            if(level[ic+1] > lev) {
-              level[ic] = lev;
-              newcount++;
-              continue;
-            }
-          }
-        }
-      } // while(newcount != 0) {
-      newcount = 0;
-      for(ic = 0; ic < ncells; ic++) {newcount += (powerOfFour(level[ic]) - 1);}
+      // Smooth the Refinement, starting only from the changed cells
+      for(uint ichanged = 0; ichanged < nchanged; ichanged++) {
+        worklist_push_changed(&worklist, level, n, changed[ichanged]);
+      }
+      smooth_worklist(level, n, &worklist);
+
+      newcount = refined_count(level, ncells);
     } // while ( abs(ncells+newcount - target_ncells) > 10 && icount < 10) {
 
+    free(changed);
   } //if (target_ncells > 0) {
+  worklist_destroy(worklist);
 
   //printf("Refinement smoothed.\n");
   int small_cells = 0;
@@ -477,8 +789,15 @@ cell_list adaptiveMeshConstructorWij(cell_list icells, const uint n, const uint
   
   
   // Allocate Space for the Adaptive Mesh
-  newcount = 0;
-  for(ic = 0; ic < ncells; ic++) {newcount += (powerOfFour(level[ic]) - 1);}
+  // The fine cells of each coarse cell are stored together in coarse cell
+  // order, so a scan of the refined sizes gives every coarse cell its start
+  uint *start = (uint *)malloc(sizeof(uint)*ncells);
+  uint newncells = 0;
+  for(ic = 0; ic < ncells; ic++) {
+    start[ic] = newncells;
+    newncells += four_to_the(level[ic]);
+  }
+  uint newcount = newncells - ncells;
   //printf("DEBUG -- Exiting cell adjustment with ncells %ld target %ld diff %ld\n\n",ncells+newcount, target_ncells, abs(ncells+newcount - target_ncells));
 
   uint*  level_temp = (uint*)  malloc(sizeof(uint)*(ncells+newcount));
@@ -486,21 +805,22 @@ cell_list adaptiveMeshConstructorWij(cell_list icells, const uint n, const uint
   uint*  j_temp     = (uint*)  malloc(sizeof(uint)*(ncells+newcount));
 
   // Set the Adaptive Mesh
-  int offset = 0;
-  for(yc = 0; yc < n; yc++) {
-    for(xc = 0; xc < n; xc++) {
-      ic = n*yc + xc;
-      nlc = (int) sqrt( (double) powerOfFour(level[ic]) );
-      for(ylc = 0; ylc < nlc; ylc++) {
-        for(xlc = 0; xlc < nlc; xlc++) {
-          level_temp[ic + offset + (nlc*ylc + xlc)] = level[ic];
-          i_temp[ic + offset + (nlc*ylc + xlc)] = i[ic]*pow(2,level[ic]) + xlc;
-          j_temp[ic + offset + (nlc*ylc + xlc)] = j[ic]*pow(2,level[ic]) + ylc;
-        }         
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1024) private(xlc,ylc,nlc)
+#endif
+  for(ic = 0; ic < ncells; ic++) {
+    uint lev = level[ic];
+    uint offset = start[ic];
+    nlc = two_to_the(lev);
+    for(ylc = 0; ylc < nlc; ylc++) {
+      for(xlc = 0; xlc < nlc; xlc++) {
+        level_temp[offset + (nlc*ylc + xlc)] = lev;
+        i_temp[offset + (nlc*ylc + xlc)] = (i[ic] << lev) + xlc;
+        j_temp[offset + (nlc*ylc + xlc)] = (j[ic] << lev) + ylc;
       }
-      offset += powerOfFour(level[ic])-1;
     }
   }
+  free(start);
   //printf("Adaptive mesh built.\n");
 
   // Swap pointers and free memory used by Coarse Mesh
@@ -517,52 +837,9 @@ cell_list adaptiveMeshConstructorWij(cell_list icells, const uint n, const uint
   //printf("\tNew ncells: %d\n", ncells);
 
   if (randomize) {
-    // Randomize the order of the arrays
-
-    int* random = (int*) malloc(sizeof(int)*ncells);
-    uint* temp1 = (uint*) malloc(sizeof(uint)*ncells);
-    uint* temp2 = (uint*) malloc(sizeof(uint)*ncells*2);
-    // XXX Want better randomization? XXX
-    // XXX Why is the time between printf() statements the longest part? XXX
-    //printf("Shuffling");
-    //fflush(stdout);
-    for(ic = 0; ic < ncells; ic++) {random[ic] = ic;}
-    //iseed = (unsigned int)time(NULL);
-    //srand (iseed);
-    srand(0);
-    nlc = 0;
-    for(int ii = 0; ii < 7; ii++) {
-      for(ic = 0; ic < ncells; ic++) {
-    
-        uint jj = (int)( (double)ncells*((double)rand() / (double)(RAND_MAX+1.0) ) );
-        // occasionally jj will be ncells and random ratio is 1.0
-        if (jj >= ncells) jj=ncells-1;
-        nlc = random[jj];
-        random[jj] = random[ic];
-        random[ic] = nlc;
-         if (random[ic] >= (int)ncells) {
-           exit(0);
-         }
-      }
-      //printf(".");
-      //fflush(stdout);
-    }
-    //printf("\n");
-
-    for(ic = 0; ic < ncells; ic++) {
-      temp1[ic] = level[random[ic]];
-      temp2[2*ic] = i[random[ic]];
-      temp2[2*ic+1] = j[random[ic]];
-    }
-    for(ic = 0; ic < ncells; ic++) {
-      level[ic] = temp1[ic];
-      i[ic]     = temp2[2*ic];
-      j[ic]     = temp2[2*ic+1];
-    }
-
-    free(temp1);
-    free(temp2);
-    free(random);
+    // Randomize the order of the arrays, seeded from the rand() stream so
+    // successive meshes differ but each run is repeatable
+    shuffle_cells(&level, &i, &j, ncells, (uint64_t)rand());
     //printf("Adaptive mesh randomized.\n");
   } // End of if randomize
 
@@ -32,6 +32,7 @@
 #define MESHGEN_H
 
 #include <stdlib.h>
+#include <stdint.h>
 
 typedef unsigned int uint;
 
@@ -57,8 +58,29 @@ typedef struct {
     double *values;
 } cell_list;
 
+// Packed cell encoding: one 64 bit key per cell with the level in the top
+// six bits and the Morton interleave of i (even bits) and j (odd bits) on
+// that level in the low 58 bits. The key of the parent cell is the Morton
+// part shifted right by two, so hash keys for any coarser level are free.
+#define PACKED_LEVEL_SHIFT 58
+#define packed_level(key)        ( (uint)((key) >> PACKED_LEVEL_SHIFT) )
+#define packed_morton(key)       ( (key) & ((1ull << PACKED_LEVEL_SHIFT) - 1) )
+#define packed_key(morton, lev)  ( ((uint64_t)(lev) << PACKED_LEVEL_SHIFT) | (morton) )
+
+typedef struct {
+    uint ncells;    // number of cells in the mesh
+    uint ibasesize; // number of coarse cells across the x dimension for the minimum level of the mesh
+    uint levmax;    // number of refinement levels in addition to the base mesh
+    uint *dist;     // distribution of cells across levels of refinemnt
+    uint64_t *key;  // packed level and Morton key
+    double *values;
+} packed_cell_list;
+
 cell_list new_cell_list(uint *x, uint *y, uint *lev, double *val);
-cell_list create_cell_list(cell_list a, int length);
+cell_list create_cell_list(cell_list a, uint length);
+// policy is a FIRST_TOUCH_ placement from genmalloc/first_touch.h
+cell_list create_cell_list_placed(cell_list a, uint length, int policy);
+cell_list copy_cell_list(cell_list a);
 void destroy(cell_list a);
 
 cell_list mesh_maker (cell_list clist, uint levels_diff, uint *length,
@@ -69,6 +91,15 @@ void divide_cell (uint super_i, uint super_j, uint super_level, cell_list cells,
     uint cell_count, uint cell_id);
 void print_cell_list (cell_list cells, uint length);
 cell_list shuffle_cell_list(cell_list clist, uint num);
+cell_list sort_cell_list_rowmajor(cell_list clist);
+cell_list sort_cell_list_morton(cell_list clist);
+uint64_t morton_encode(uint i, uint j);
+uint morton_decode_i(uint64_t key);
+uint morton_decode_j(uint64_t key);
+
+packed_cell_list pack_cell_list(cell_list clist);
+cell_list unpack_cell_list(packed_cell_list plist);
+void destroy_packed(packed_cell_list a);
 
 #ifndef USE_MACROS
 int two_to_the (int val);
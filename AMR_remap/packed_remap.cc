@@ -0,0 +1,619 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+// Remaps on the packed cell encoding. All of the hash tables are indexed
+// by Morton key instead of j*isize+i. The base mesh is padded to the next
+// power of two so that the Morton keys on each level are dense, which
+// costs at most a factor of four in table size for an awkward base size.
+// In exchange the key of the covering cell on a coarser level is a shift,
+// and the block of fine cells under a coarse cell is one contiguous span.
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "meshgen/meshgen.h"
+#include "simplehash/simplehash.h"
+#include "packed_remap.h"
+
+//#define HASH_TYPE HASH_ALL_C_HASHES
+#define HASH_TYPE (LCG_QUADRATIC_OPEN_COMPACT_HASH_ID)
+#define HASH_OPENMP_TYPE (LCG_QUADRATIC_OPEN_COMPACT_OPENMP_HASH_ID | IDENTITY_SENTINEL_PERFECT_OPENMP_HASH_ID)
+#define HASH_LOAD_FACTOR 0.3333333
+
+// Private functions to this file
+static uint pow2_ceil(uint n);
+static uint64_t fine_key(uint64_t key, uint max_lev);
+static double avg_sub_cells_packed (packed_cell_list icells, uint64_t fine, uint lev, int *hash);
+static double avg_sub_cells_compact_packed (packed_cell_list icells, uint64_t fine, uint lev, int *hash);
+static double avg_sub_cells_h_packed (packed_cell_list icells, uint64_t morton, uint lev, uint startlev, int **h_hash);
+static double avg_sub_cells_h_compact_packed (packed_cell_list icells, uint64_t morton, uint lev, uint startlev,
+    intintHash_Table **h_hashTable);
+
+static uint pow2_ceil(uint n) {
+    uint p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+int packed_compact_keys_fit (uint ibasesize, uint levmax) {
+    uint64_t isize = pow2_ceil(ibasesize);
+    return isize*isize*((uint64_t)1 << (2*levmax)) <= (uint64_t)INT_MAX + 1;
+}
+
+static int packed_compact_check (packed_cell_list icells, const char *name) {
+    if (packed_compact_keys_fit(icells.ibasesize, icells.levmax)) return 1;
+    printf("%s: the padded Morton keys of a %u base mesh with %u levels do not fit an int key\n",
+           name, icells.ibasesize, icells.levmax);
+    return 0;
+}
+
+// Morton key on the finest input level of the lower left corner of a cell
+static uint64_t fine_key(uint64_t key, uint max_lev) {
+    uint lev = packed_level(key);
+    uint64_t morton = packed_morton(key);
+    if (lev <= max_lev) return morton << (2*(max_lev - lev));
+    return morton >> (2*(lev - max_lev));
+}
+
+// Children of the cell at fine key "fine" are the four quarter spans of its
+// Morton range, in the same i-then-j order as avg_sub_cells
+static double avg_sub_cells_packed (packed_cell_list icells, uint64_t fine, uint lev, int *hash) {
+
+    uint shift = 2*(icells.levmax - lev - 1);
+    double sum = 0.0;
+
+    for (uint64_t c = 0; c < 4; c++) {
+        uint64_t key = fine + (c << shift);
+        int ic = hash[key];
+        // Getting sub averages failed
+        assert(ic >= 0);
+        if (packed_level(icells.key[ic]) == (lev + 1)) {
+            sum += icells.values[ic];
+        } else {
+            sum += avg_sub_cells_packed(icells, key, lev + 1, hash);
+        }
+    }
+
+    return sum/4.0;
+}
+
+// The same through the compact single-write hash
+static double avg_sub_cells_compact_packed (packed_cell_list icells, uint64_t fine, uint lev, int *hash) {
+
+    uint shift = 2*(icells.levmax - lev - 1);
+    double sum = 0.0;
+
+    for (uint64_t c = 0; c < 4; c++) {
+        uint64_t key = fine + (c << shift);
+        int ic = read_hash(key, hash);
+        // Getting sub averages failed
+        assert(ic >= 0);
+        if (packed_level(icells.key[ic]) == (lev + 1)) {
+            sum += icells.values[ic];
+        } else {
+            sum += avg_sub_cells_compact_packed(icells, key, lev + 1, hash);
+        }
+    }
+
+    return sum/4.0;
+}
+
+static double avg_sub_cells_h_packed (packed_cell_list icells, uint64_t morton, uint lev, uint startlev, int **h_hash) {
+
+    double sum = 0.0;
+
+    for (uint64_t c = 0; c < 4; c++) {
+        uint64_t key = (morton << 2) | c;
+        int probe = h_hash[lev+1][key];
+        if (probe >= 0) {
+            sum += icells.values[probe]/four_to_the(lev+1-startlev);
+        } else {
+            sum += avg_sub_cells_h_packed(icells, key, lev + 1, startlev, h_hash);
+        }
+    }
+
+    return sum;
+}
+
+static double avg_sub_cells_h_compact_packed (packed_cell_list icells, uint64_t morton, uint lev, uint startlev,
+    intintHash_Table **h_hashTable) {
+
+    double sum = 0.0;
+
+    for (uint64_t c = 0; c < 4; c++) {
+        uint64_t key = (morton << 2) | c;
+        int probe;
+        intintHash_QuerySingle(h_hashTable[lev+1], (int)key, &probe);
+        if (probe >= 0) {
+            sum += icells.values[probe]/four_to_the(lev+1-startlev);
+        } else {
+            sum += avg_sub_cells_h_compact_packed(icells, key, lev + 1, startlev, h_hashTable);
+        }
+    }
+
+    return sum;
+}
+
+void full_perfect_remap_packed (packed_cell_list icells, packed_cell_list ocells) {
+
+    uint max_lev = icells.levmax;
+    uint isize = pow2_ceil(icells.ibasesize);
+    size_t hash_size = (size_t)isize*isize*four_to_the(max_lev);
+    int *hash = (int *) malloc(hash_size * sizeof(int));
+
+    // The fine cells under an input cell are one contiguous Morton span
+    for (uint ic = 0; ic < icells.ncells; ic++){
+        uint lev = packed_level(icells.key[ic]);
+        uint64_t start = fine_key(icells.key[ic], max_lev);
+        uint64_t end = start + ((uint64_t)1 << (2*(max_lev - lev)));
+        for (uint64_t key = start; key < end; key++) {
+            hash[key] = ic;
+        }
+    }
+
+    for (uint ic = 0; ic < ocells.ncells; ic++){
+        uint lev = packed_level(ocells.key[ic]);
+        uint64_t fine = fine_key(ocells.key[ic], max_lev);
+        int probe = hash[fine];
+
+        if (lev >= packed_level(icells.key[probe])) {
+            ocells.values[ic] = icells.values[probe];
+        } else {
+            ocells.values[ic] = avg_sub_cells_packed(icells, fine, lev, hash);
+        }
+    }
+
+    free(hash);
+}
+
+void singlewrite_remap_packed (packed_cell_list icells, packed_cell_list ocells) {
+
+    uint max_lev = icells.levmax;
+    uint isize = pow2_ceil(icells.ibasesize);
+    size_t hash_size = (size_t)isize*isize*four_to_the(max_lev);
+    int *hash = (int *) malloc(hash_size * sizeof(int));
+
+    memset(hash, 0xFFFFFFFF, hash_size*sizeof(int));
+
+    for (uint ic = 0; ic < icells.ncells; ic++) {
+        hash[fine_key(icells.key[ic], max_lev)] = ic;
+    }
+
+    for (uint n = 0; n < ocells.ncells; n++) {
+        uint lev = packed_level(ocells.key[n]);
+        uint64_t fine = fine_key(ocells.key[n], max_lev);
+        int ic = hash[fine];
+
+        if (lev > max_lev) lev = max_lev;
+        while (ic < 0 && lev > 0) {
+            lev--;
+            fine &= ~(((uint64_t)1 << (2*(max_lev - lev))) - 1);
+            ic = hash[fine];
+        }
+        if (lev >= packed_level(icells.key[ic])) {
+            ocells.values[n] = icells.values[ic];
+        } else {
+            ocells.values[n] = avg_sub_cells_packed(icells, fine, lev, hash);
+        }
+    }
+
+    free(hash);
+}
+
+void singlewrite_remap_compact_packed (packed_cell_list icells, packed_cell_list ocells) {
+
+    if (! packed_compact_check(icells, "singlewrite_remap_compact_packed")) return;
+
+    uint max_lev = icells.levmax;
+    uint i_max = pow2_ceil(icells.ibasesize)*two_to_the(max_lev);
+    int *hash = compact_hash_init(icells.ncells, i_max, i_max, 1, 0);
+
+    for (uint ic = 0; ic < icells.ncells; ic++) {
+        write_hash(ic, fine_key(icells.key[ic], max_lev), hash);
+    }
+
+    for (uint n = 0; n < ocells.ncells; n++) {
+        uint lev = packed_level(ocells.key[n]);
+        uint64_t fine = fine_key(ocells.key[n], max_lev);
+        int ic = read_hash(fine, hash);
+
+        if (lev > max_lev) lev = max_lev;
+        while (ic < 0 && lev > 0) {
+            lev--;
+            fine &= ~(((uint64_t)1 << (2*(max_lev - lev))) - 1);
+            ic = read_hash(fine, hash);
+        }
+        if (lev >= packed_level(icells.key[ic])) {
+            ocells.values[n] = icells.values[ic];
+        } else {
+            ocells.values[n] = avg_sub_cells_compact_packed(icells, fine, lev, hash);
+        }
+    }
+
+    compact_hash_delete(hash);
+}
+
+void h_remap_packed (packed_cell_list icells, packed_cell_list ocells) {
+
+    uint isize = pow2_ceil(icells.ibasesize);
+    int** h_hash = (int **) malloc((icells.levmax+1)*sizeof(int *));
+
+    for (uint i = 0; i <= icells.levmax; i++) {
+        size_t hash_size = (size_t)isize*isize*four_to_the(i);
+        h_hash[i] = (int *) malloc(hash_size*sizeof(int));
+    }
+
+    //place the cells and their breadcrumbs
+    for (uint n = 0; n < icells.ncells; n++) {
+        uint lev = packed_level(icells.key[n]);
+        uint64_t morton = packed_morton(icells.key[n]);
+        h_hash[lev][morton] = n;
+
+        // A lower left child has both low Morton bits clear
+        while ((morton & 3) == 0 && lev > 0) {
+            morton >>= 2;
+            lev--;
+            h_hash[lev][morton] = -1;
+        }
+    }
+
+    for (uint n = 0; n < ocells.ncells; n++) {
+        uint olev = packed_level(ocells.key[n]);
+        uint64_t morton = packed_morton(ocells.key[n]);
+
+        int probe = -1;
+        for (uint probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+            probe = h_hash[probe_lev][morton >> (2*(olev - probe_lev))];
+        }
+        if (probe >= 0) {
+            ocells.values[n] = icells.values[probe];
+        } else {
+            ocells.values[n] = avg_sub_cells_h_packed(icells, morton, olev, olev, h_hash);
+        }
+    }
+
+    for (uint i = 0; i <= icells.levmax; i++) {
+        free(h_hash[i]);
+    }
+    free(h_hash);
+}
+
+void h_remap_compact_packed (packed_cell_list icells, packed_cell_list ocells, intintHash_Factory *factory) {
+
+    if (! packed_compact_check(icells, "h_remap_compact_packed")) return;
+
+    uint isize = pow2_ceil(icells.ibasesize);
+    intintHash_Table** h_hashTable = (intintHash_Table **) malloc((icells.levmax+1)*sizeof(intintHash_Table *));
+    uint *num_at_level = (uint *)malloc((icells.levmax+1)*sizeof(uint));
+
+    for (uint i = 0; i <= icells.levmax; i++) {
+       num_at_level[i] = 0;
+    }
+
+    for (uint n = 0; n < icells.ncells; n++) {
+       num_at_level[packed_level(icells.key[n])]++;
+    }
+
+    // lev must be int (not uint) to allow -1 for exit
+    for (int lev = icells.levmax-1; lev >= 0; lev--) {
+       num_at_level[lev] += num_at_level[lev+1]/4;
+    }
+
+    for (uint i = 0; i <= icells.levmax; i++) {
+        size_t hash_size = (size_t)isize*isize*four_to_the(i);
+        h_hashTable[i] = intintHash_CreateTable(factory, HASH_TYPE, hash_size, num_at_level[i], HASH_LOAD_FACTOR);
+        intintHash_SetupTable(h_hashTable[i]);
+    }
+
+    free(num_at_level);
+
+    //place the cells and their breadcrumbs
+    for (uint n = 0; n < icells.ncells; n++) {
+        uint lev = packed_level(icells.key[n]);
+        uint64_t morton = packed_morton(icells.key[n]);
+        intintHash_InsertSingle(h_hashTable[lev], (int)morton, n);
+
+        while ((morton & 3) == 0 && lev > 0) {
+            morton >>= 2;
+            lev--;
+            intintHash_InsertSingle(h_hashTable[lev], (int)morton, -1);
+        }
+    }
+
+    for (uint n = 0; n < ocells.ncells; n++) {
+        uint olev = packed_level(ocells.key[n]);
+        uint64_t morton = packed_morton(ocells.key[n]);
+
+        int probe = -1;
+        for (uint probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+            intintHash_QuerySingle(h_hashTable[probe_lev], (int)(morton >> (2*(olev - probe_lev))), &probe);
+        }
+        if (probe >= 0) {
+            ocells.values[n] = icells.values[probe];
+        } else {
+            ocells.values[n] = avg_sub_cells_h_compact_packed(icells, morton, olev, olev, h_hashTable);
+        }
+    }
+
+    for (uint i = 0; i <= icells.levmax; i++) {
+        intintHash_DestroyTable(h_hashTable[i]);
+    }
+    free(h_hashTable);
+}
+
+#ifdef _OPENMP
+void full_perfect_remap_packed_openMP (packed_cell_list icells, packed_cell_list ocells) {
+
+    uint max_lev = icells.levmax;
+    uint isize = pow2_ceil(icells.ibasesize);
+    size_t hash_size = (size_t)isize*isize*four_to_the(max_lev);
+    int *hash = (int *) malloc(hash_size * sizeof(int));
+
+#pragma omp parallel default(none) shared(icells, ocells, hash) firstprivate(max_lev)
+    {
+#pragma omp for
+        for (uint ic = 0; ic < icells.ncells; ic++){
+            uint lev = packed_level(icells.key[ic]);
+            uint64_t start = fine_key(icells.key[ic], max_lev);
+            uint64_t end = start + ((uint64_t)1 << (2*(max_lev - lev)));
+            for (uint64_t key = start; key < end; key++) {
+                hash[key] = ic;
+            }
+        }
+
+#pragma omp for
+        for (uint ic = 0; ic < ocells.ncells; ic++){
+            uint lev = packed_level(ocells.key[ic]);
+            uint64_t fine = fine_key(ocells.key[ic], max_lev);
+            int probe = hash[fine];
+
+            if (lev >= packed_level(icells.key[probe])) {
+                ocells.values[ic] = icells.values[probe];
+            } else {
+                ocells.values[ic] = avg_sub_cells_packed(icells, fine, lev, hash);
+            }
+        }
+    }
+
+    free(hash);
+}
+
+void singlewrite_remap_packed_openMP (packed_cell_list icells, packed_cell_list ocells) {
+
+    uint max_lev = icells.levmax;
+    uint isize = pow2_ceil(icells.ibasesize);
+    size_t hash_size = (size_t)isize*isize*four_to_the(max_lev);
+    int *hash = (int *) malloc(hash_size * sizeof(int));
+
+#pragma omp parallel default(none) shared(icells, ocells, hash) firstprivate(max_lev, hash_size)
+    {
+#pragma omp for
+        for (size_t i = 0; i < hash_size; i++) {
+            hash[i] = -1;
+        }
+
+#pragma omp for
+        for (uint ic = 0; ic < icells.ncells; ic++) {
+            hash[fine_key(icells.key[ic], max_lev)] = ic;
+        }
+
+#pragma omp for
+        for (uint n = 0; n < ocells.ncells; n++) {
+            uint lev = packed_level(ocells.key[n]);
+            uint64_t fine = fine_key(ocells.key[n], max_lev);
+            int ic = hash[fine];
+
+            if (lev > max_lev) lev = max_lev;
+            while (ic < 0 && lev > 0) {
+                lev--;
+                fine &= ~(((uint64_t)1 << (2*(max_lev - lev))) - 1);
+                ic = hash[fine];
+            }
+            if (lev >= packed_level(icells.key[ic])) {
+                ocells.values[n] = icells.values[ic];
+            } else {
+                ocells.values[n] = avg_sub_cells_packed(icells, fine, lev, hash);
+            }
+        }
+    }
+
+    free(hash);
+}
+
+void singlewrite_remap_compact_packed_openMP (packed_cell_list icells, packed_cell_list ocells) {
+
+    if (! packed_compact_check(icells, "singlewrite_remap_compact_packed_openMP")) return;
+
+    uint max_lev = icells.levmax;
+    uint i_max = pow2_ceil(icells.ibasesize)*two_to_the(max_lev);
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
+    int *hash = compact_hash_init_openmp(icells.ncells, i_max, i_max, 1, 0);
+#pragma omp parallel default(none) shared(write_hash_openmp, read_hash) shared(icells, ocells, hash) firstprivate(max_lev)
+#else
+    omp_lock_t *lock = NULL;
+    int *hash = compact_hash_init_openmp(icells.ncells, i_max, i_max, 1, 0, &lock);
+#pragma omp parallel default(none) shared(write_hash_openmp, read_hash) shared(icells, ocells, hash, lock) firstprivate(max_lev)
+#endif
+    {
+#pragma omp for
+        for (uint ic = 0; ic < icells.ncells; ic++) {
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
+            write_hash_openmp(ic, fine_key(icells.key[ic], max_lev), hash);
+#else
+            write_hash_openmp(ic, fine_key(icells.key[ic], max_lev), hash, lock);
+#endif
+        }
+
+#pragma omp for
+        for (uint n = 0; n < ocells.ncells; n++) {
+            uint lev = packed_level(ocells.key[n]);
+            uint64_t fine = fine_key(ocells.key[n], max_lev);
+            int ic = read_hash(fine, hash);
+
+            if (lev > max_lev) lev = max_lev;
+            while (ic < 0 && lev > 0) {
+                lev--;
+                fine &= ~(((uint64_t)1 << (2*(max_lev - lev))) - 1);
+                ic = read_hash(fine, hash);
+            }
+            if (lev >= packed_level(icells.key[ic])) {
+                ocells.values[n] = icells.values[ic];
+            } else {
+                ocells.values[n] = avg_sub_cells_compact_packed(icells, fine, lev, hash);
+            }
+        }
+    }
+
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
+    compact_hash_delete_openmp(hash);
+#else
+    compact_hash_delete_openmp(hash, lock);
+#endif
+}
+
+void h_remap_packed_openMP (packed_cell_list icells, packed_cell_list ocells) {
+
+    uint isize = pow2_ceil(icells.ibasesize);
+    int** h_hash = (int **) malloc((icells.levmax+1)*sizeof(int *));
+
+    for (uint i = 0; i <= icells.levmax; i++) {
+        size_t hash_size = (size_t)isize*isize*four_to_the(i);
+        h_hash[i] = (int *) malloc(hash_size*sizeof(int));
+    }
+
+#pragma omp parallel default(none) shared(icells, ocells, h_hash)
+    {
+        //place the cells and their breadcrumbs
+#pragma omp for
+        for (uint n = 0; n < icells.ncells; n++) {
+            uint lev = packed_level(icells.key[n]);
+            uint64_t morton = packed_morton(icells.key[n]);
+            h_hash[lev][morton] = n;
+
+            while ((morton & 3) == 0 && lev > 0) {
+                morton >>= 2;
+                lev--;
+                h_hash[lev][morton] = -1;
+            }
+        }
+
+#pragma omp for
+        for (uint n = 0; n < ocells.ncells; n++) {
+            uint olev = packed_level(ocells.key[n]);
+            uint64_t morton = packed_morton(ocells.key[n]);
+
+            int probe = -1;
+            for (uint probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+                probe = h_hash[probe_lev][morton >> (2*(olev - probe_lev))];
+            }
+            if (probe >= 0) {
+                ocells.values[n] = icells.values[probe];
+            } else {
+                ocells.values[n] = avg_sub_cells_h_packed(icells, morton, olev, olev, h_hash);
+            }
+        }
+    }
+
+    for (uint i = 0; i <= icells.levmax; i++) {
+        free(h_hash[i]);
+    }
+    free(h_hash);
+}
+
+void h_remap_compact_packed_openMP (packed_cell_list icells, packed_cell_list ocells, intintHash_Factory *factory) {
+
+    if (! packed_compact_check(icells, "h_remap_compact_packed_openMP")) return;
+
+    uint isize = pow2_ceil(icells.ibasesize);
+    intintHash_Table** h_hashTable = (intintHash_Table **) malloc((icells.levmax+1)*sizeof(intintHash_Table *));
+    uint *num_at_level = (uint *)malloc((icells.levmax+1)*sizeof(uint));
+
+    for (uint i = 0; i <= icells.levmax; i++) {
+       num_at_level[i] = 0;
+    }
+
+    for (uint n = 0; n < icells.ncells; n++) {
+       num_at_level[packed_level(icells.key[n])]++;
+    }
+
+    // lev must be int (not uint) to allow -1 for exit
+    for (int lev = icells.levmax-1; lev >= 0; lev--) {
+       num_at_level[lev] += num_at_level[lev+1]/4;
+    }
+
+    for (uint i = 0; i <= icells.levmax; i++) {
+        size_t hash_size = (size_t)isize*isize*four_to_the(i);
+        h_hashTable[i] = intintHash_CreateTable(factory, HASH_OPENMP_TYPE, hash_size, num_at_level[i], HASH_LOAD_FACTOR);
+        intintHash_SetupTable(h_hashTable[i]);
+    }
+
+    free(num_at_level);
+
+#pragma omp parallel default(none) shared(icells, ocells, h_hashTable)
+    {
+        //place the cells and their breadcrumbs
+#pragma omp for
+        for (uint n = 0; n < icells.ncells; n++) {
+            uint lev = packed_level(icells.key[n]);
+            uint64_t morton = packed_morton(icells.key[n]);
+            intintHash_InsertSingle(h_hashTable[lev], (int)morton, n);
+
+            while ((morton & 3) == 0 && lev > 0) {
+                morton >>= 2;
+                lev--;
+                intintHash_InsertSingle(h_hashTable[lev], (int)morton, -1);
+            }
+        }
+
+#pragma omp for
+        for (uint n = 0; n < ocells.ncells; n++) {
+            uint olev = packed_level(ocells.key[n]);
+            uint64_t morton = packed_morton(ocells.key[n]);
+
+            int probe = -1;
+            for (uint probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+                intintHash_QuerySingle(h_hashTable[probe_lev], (int)(morton >> (2*(olev - probe_lev))), &probe);
+            }
+            if (probe >= 0) {
+                ocells.values[n] = icells.values[probe];
+            } else {
+                ocells.values[n] = avg_sub_cells_h_compact_packed(icells, morton, olev, olev, h_hashTable);
+            }
+        }
+    }
+
+    for (uint i = 0; i <= icells.levmax; i++) {
+        intintHash_DestroyTable(h_hashTable[i]);
+    }
+    free(h_hashTable);
+}
+#endif
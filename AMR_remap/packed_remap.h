@@ -0,0 +1,57 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+#ifndef PACKED_REMAP_H
+#define PACKED_REMAP_H
+
+#include "meshgen/meshgen.h"
+#include "HashFactory/HashFactory.h"
+
+// The compact tables take int keys, and the Morton keys of the finest
+// level are padded to a power of two of the base size, so they overflow
+// sooner than the row-major keys of the unpacked remaps. The compact
+// packed remaps print a message and leave the output untouched on meshes
+// for which this returns 0.
+int packed_compact_keys_fit (uint ibasesize, uint levmax);
+
+void full_perfect_remap_packed (packed_cell_list icells, packed_cell_list ocells);
+void singlewrite_remap_packed (packed_cell_list icells, packed_cell_list ocells);
+void singlewrite_remap_compact_packed (packed_cell_list icells, packed_cell_list ocells);
+void h_remap_packed (packed_cell_list icells, packed_cell_list ocells);
+void h_remap_compact_packed (packed_cell_list icells, packed_cell_list ocells, intintHash_Factory *factory);
+#ifdef _OPENMP
+void full_perfect_remap_packed_openMP (packed_cell_list icells, packed_cell_list ocells);
+void singlewrite_remap_packed_openMP (packed_cell_list icells, packed_cell_list ocells);
+void singlewrite_remap_compact_packed_openMP (packed_cell_list icells, packed_cell_list ocells);
+void h_remap_packed_openMP (packed_cell_list icells, packed_cell_list ocells);
+void h_remap_compact_packed_openMP (packed_cell_list icells, packed_cell_list ocells, intintHash_Factory *factory);
+#endif
+
+#endif
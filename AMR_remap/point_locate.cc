@@ -0,0 +1,222 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "meshgen/meshgen.h"
+#include "HashFactory/HashFactory.h"
+#include "point_locate.h"
+
+// Points become finest level indices, and the index at a coarser level is
+// a shift. A walk probes from level 0 down until it reaches a cell. A
+// bisection probes the middle level: a missing key means the point is in a
+// coarser cell, a breadcrumb (-1) that it is in a finer one.
+
+// Bins per side for the Morton binning of the points
+#define LOCATE_BIN_BITS 8
+
+static inline int locate_walk (cell_list icells, int **h_hash, uint ix, uint iy) {
+    int probe = -1;
+    for (uint lev = 0; probe < 0 && lev <= icells.levmax; lev++) {
+        uint levdiff = icells.levmax - lev;
+        uint key = (iy >> levdiff)*icells.ibasesize*two_to_the(lev) + (ix >> levdiff);
+        probe = h_hash[lev][key];
+    }
+    return probe;
+}
+
+static inline int locate_walk_compact (cell_list icells, intintHash_Table **h_hashTable, uint ix, uint iy) {
+    int probe = -1;
+    for (uint lev = 0; probe < 0 && lev <= icells.levmax; lev++) {
+        uint levdiff = icells.levmax - lev;
+        uint key = (iy >> levdiff)*icells.ibasesize*two_to_the(lev) + (ix >> levdiff);
+        intintHash_QuerySingle(h_hashTable[lev], key, &probe);
+    }
+    return probe;
+}
+
+static inline int locate_bisect_compact (cell_list icells, intintHash_Table **h_hashTable, uint ix, uint iy) {
+    int lo = 0;
+    int hi = icells.levmax;
+    while (lo <= hi) {
+        int lev = (lo + hi)/2;
+        uint levdiff = icells.levmax - lev;
+        uint key = (iy >> levdiff)*icells.ibasesize*two_to_the(lev) + (ix >> levdiff);
+        int probe;
+        if (intintHash_QuerySingle(h_hashTable[lev], key, &probe) != HASH_EXIT_CODE_NORMAL) {
+            hi = lev - 1;
+        } else if (probe < 0) {
+            lo = lev + 1;
+        } else {
+            return probe;
+        }
+    }
+    return -1;
+}
+
+// Finest level indices of a point, or 0 if it is outside the mesh
+static inline int locate_index (cell_list icells, double x, double y, uint *ix, uint *iy) {
+    if (! (x >= 0.0 && y >= 0.0 && x < icells.ibasesize && y < icells.ibasesize)) return 0;
+    double scale = two_to_the(icells.levmax);
+    *ix = (uint)(x*scale);
+    *iy = (uint)(y*scale);
+    return 1;
+}
+
+// Order of the points by the Morton key of their bin, by a counting sort.
+// Each thread counts and places the points of its own static chunk, so
+// the order is the same for any number of threads.
+static uint *locate_order (cell_list icells, uint npoints, const double *x, const double *y, int threaded) {
+
+    (void)threaded;
+    uint nbins = four_to_the(LOCATE_BIN_BITS);
+    double scale = (double)two_to_the(LOCATE_BIN_BITS)/icells.ibasesize;
+    uint *bin   = (uint *)malloc(npoints*sizeof(uint));
+    uint *order = (uint *)malloc(npoints*sizeof(uint));
+
+    // per thread counts, sized for the largest team
+    int nthreads = 1;
+#ifdef _OPENMP
+    if (threaded) nthreads = omp_get_max_threads();
+#endif
+    uint *count = (uint *)calloc((size_t)nthreads*nbins, sizeof(uint));
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads) if(threaded)
+#endif
+    {
+        int tid = 0;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+#endif
+        uint *my_count = count + (size_t)tid*nbins;
+        uint max_bin = two_to_the(LOCATE_BIN_BITS) - 1;
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for (uint n = 0; n < npoints; n++) {
+            double bx = x[n]*scale;
+            double by = y[n]*scale;
+            uint ibx = (bx >= 0.0 && bx < max_bin) ? (uint)bx : ((bx >= max_bin) ? max_bin : 0);
+            uint iby = (by >= 0.0 && by < max_bin) ? (uint)by : ((by >= max_bin) ? max_bin : 0);
+            bin[n] = (uint)morton_encode(ibx, iby);
+            my_count[bin[n]]++;
+        }
+
+#ifdef _OPENMP
+#pragma omp single
+#endif
+        {
+            uint offset = 0;
+            for (uint b = 0; b < nbins; b++) {
+                for (int t = 0; t < nthreads; t++) {
+                    uint c = count[(size_t)t*nbins + b];
+                    count[(size_t)t*nbins + b] = offset;
+                    offset += c;
+                }
+            }
+        }
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for (uint n = 0; n < npoints; n++) {
+            order[my_count[bin[n]]++] = n;
+        }
+    }
+
+    free(count);
+    free(bin);
+    return order;
+}
+
+static void h_locate_run (cell_list icells, int **h_hash, intintHash_Table **h_hashTable, uint npoints,
+                          const double *x, const double *y, int *cell, int flags, int threaded) {
+
+    (void)threaded;
+    uint *order = NULL;
+    if (flags & H_LOCATE_SORTED) order = locate_order(icells, npoints, x, y, threaded);
+
+    // bisection needs every table to report missing keys
+    int bisect = (h_hashTable != NULL) && (flags & H_LOCATE_BISECT);
+    for (uint lev = 0; bisect && lev <= icells.levmax; lev++) {
+        if (intintHash_GetTableType(h_hashTable[lev]) & HASH_SENTINEL_PERFECT_HASHES) bisect = 0;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded)
+#endif
+    for (uint k = 0; k < npoints; k++) {
+        uint n = order ? order[k] : k;
+        uint ix, iy;
+        int probe = -1;
+        if (locate_index(icells, x[n], y[n], &ix, &iy)) {
+            if (h_hash != NULL) {
+                probe = locate_walk(icells, h_hash, ix, iy);
+            } else if (bisect) {
+                probe = locate_bisect_compact(icells, h_hashTable, ix, iy);
+            } else {
+                probe = locate_walk_compact(icells, h_hashTable, ix, iy);
+            }
+        }
+        cell[n] = probe;
+    }
+
+    free(order);
+}
+
+void h_locate (cell_list icells, int **h_hash, uint npoints, const double *x, const double *y,
+               int *cell, int flags) {
+    h_locate_run(icells, h_hash, NULL, npoints, x, y, cell, flags, 0);
+}
+
+void h_locate_compact (cell_list icells, intintHash_Table **h_hashTable, uint npoints,
+                       const double *x, const double *y, int *cell, int flags) {
+    h_locate_run(icells, NULL, h_hashTable, npoints, x, y, cell, flags, 0);
+}
+
+#ifdef _OPENMP
+void h_locate_openMP (cell_list icells, int **h_hash, uint npoints, const double *x, const double *y,
+                      int *cell, int flags) {
+    h_locate_run(icells, h_hash, NULL, npoints, x, y, cell, flags, 1);
+}
+
+void h_locate_compact_openMP (cell_list icells, intintHash_Table **h_hashTable, uint npoints,
+                              const double *x, const double *y, int *cell, int flags) {
+    h_locate_run(icells, NULL, h_hashTable, npoints, x, y, cell, flags, 1);
+}
+#endif
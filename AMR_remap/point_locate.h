@@ -0,0 +1,57 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#ifndef POINT_LOCATE_H
+#define POINT_LOCATE_H
+
+#include "meshgen/meshgen.h"
+#include "HashFactory/HashFactory.h"
+
+// Point location flags
+#define H_LOCATE_SORTED 1   // bin the points by Morton key before the lookups
+#define H_LOCATE_BISECT 2   // binary search over the levels (compact tables only)
+
+// Finds the input cell containing each point (x[n], y[n]), in units of
+// base mesh cells so that 0 <= x, y < ibasesize, using the per-level tables
+// already built for the hierarchical remap. cell[n] is -1 for a point
+// outside the mesh. The full tables are always walked from level 0 since
+// their unwritten entries cannot be told apart; compact tables that report
+// missing keys can be searched by bisection over the levels instead.
+void h_locate (cell_list icells, int **h_hash, uint npoints, const double *x, const double *y,
+               int *cell, int flags);
+void h_locate_openMP (cell_list icells, int **h_hash, uint npoints, const double *x, const double *y,
+                      int *cell, int flags);
+void h_locate_compact (cell_list icells, intintHash_Table **h_hashTable, uint npoints,
+                       const double *x, const double *y, int *cell, int flags);
+void h_locate_compact_openMP (cell_list icells, intintHash_Table **h_hashTable, uint npoints,
+                              const double *x, const double *y, int *cell, int flags);
+
+#endif
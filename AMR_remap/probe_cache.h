@@ -0,0 +1,67 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+#ifndef PROBE_CACHE_H
+#define PROBE_CACHE_H
+
+#include "meshgen/meshgen.h"
+
+// Memo of the last input cell that fully covered an output cell. When the
+// output cells are spatially ordered, the next output cell very often lies
+// in the same coarse input cell and can be answered without a hash probe.
+// Each thread keeps its own copy so there is no sharing between threads.
+typedef struct {
+    int  ic;     // input cell index, -1 when the memo is empty
+    uint i;      // input cell coordinates at its own level
+    uint j;
+    uint level;
+} probe_cache;
+
+static inline void probe_cache_reset(probe_cache *pc) {
+    pc->ic = -1;
+}
+
+// Returns the memoized input cell if the output cell (oi, oj, olev) lies
+// inside its footprint and is at the same or a finer level, otherwise -1
+static inline int probe_cache_lookup(const probe_cache *pc, uint oi, uint oj, uint olev) {
+    if (pc->ic < 0 || olev < pc->level) return(-1);
+    uint levdiff = olev - pc->level;
+    if ((oi >> levdiff) != pc->i || (oj >> levdiff) != pc->j) return(-1);
+    return(pc->ic);
+}
+
+static inline void probe_cache_set(probe_cache *pc, int ic, uint i, uint j, uint level) {
+    pc->ic    = ic;
+    pc->i     = i;
+    pc->j     = j;
+    pc->level = level;
+}
+
+#endif
@@ -0,0 +1,268 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "meshgen/meshgen.h"
+#include "ray_traverse.h"
+
+// Rays are traced in finest level units, where every cell edge is an
+// integer. The ray position is carried as the finest level index just
+// ahead of it, with points on an edge assigned to the cell the ray is
+// heading into. On leaving a cell, every level on which the new position
+// still shares a region with the cell is refined, so the probe walk for
+// the next cell can start at the first level where they differ. The
+// entries there are written, and the walk usually ends in one or two
+// probes instead of starting over from level 0.
+
+typedef struct {
+    size_t  n, size;
+    int    *cell;
+    double *t_in;
+    double *t_out;
+} ray_buffer;
+
+static void ray_buffer_push (ray_buffer *b, int cell, double t_in, double t_out) {
+    if (b->n == b->size) {
+        b->size = b->size ? 2*b->size : 1024;
+        b->cell  = (int *)realloc(b->cell, b->size*sizeof(int));
+        b->t_in  = (double *)realloc(b->t_in, b->size*sizeof(double));
+        b->t_out = (double *)realloc(b->t_out, b->size*sizeof(double));
+    }
+    b->cell[b->n]  = cell;
+    b->t_in[b->n]  = t_in;
+    b->t_out[b->n] = t_out;
+    b->n++;
+}
+
+// Cell holding finest level index (fx, fy) by the probe walk from level
+// start, which must be 0 or a level whose parent region is refined
+static inline int ray_walk (cell_list icells, int **h_hash, uint fx, uint fy, uint start) {
+    int probe = -1;
+    for (uint lev = start; probe < 0 && lev <= icells.levmax; lev++) {
+        uint levdiff = icells.levmax - lev;
+        uint key = (fy >> levdiff)*icells.ibasesize*two_to_the(lev) + (fx >> levdiff);
+        probe = h_hash[lev][key];
+    }
+    return probe;
+}
+
+// Next cell after leaving the cell holding (oldx, oldy) for (fx, fy)
+static inline int ray_find (cell_list icells, int **h_hash, uint fx, uint fy, uint oldx, uint oldy, int fresh) {
+    uint start = 0;
+    if (! fresh) {
+        uint diffx = fx ^ oldx;
+        uint diffy = fy ^ oldy;
+        while (start < icells.levmax && (diffx >> (icells.levmax - start)) == 0 &&
+                                        (diffy >> (icells.levmax - start)) == 0) start++;
+    }
+    return ray_walk(icells, h_hash, fx, fy, start);
+}
+
+// Finest level index of coordinate p for a ray moving with direction d,
+// kept within lo to hi
+static inline uint ray_index (double p, double d, long lo, long hi) {
+    double f = floor(p);
+    long k = (long)f;
+    if (p == f && d < 0.0) k--;
+    if (k < lo) k = lo;
+    if (k > hi) k = hi;
+    return (uint)k;
+}
+
+static void ray_trace_one (cell_list icells, int **h_hash, double ox, double oy, double dx, double dy,
+                           double tmax, int fresh, ray_buffer *b) {
+
+    double scale = two_to_the(icells.levmax);
+    double size = (double)icells.ibasesize*scale;
+    long nfine = (long)size;
+    ox *= scale;
+    oy *= scale;
+    dx *= scale;
+    dy *= scale;
+
+    // clip to the mesh
+    double t0 = 0.0, t1 = tmax;
+    if (dx != 0.0) {
+        double ta = (0.0 - ox)/dx, tb = (size - ox)/dx;
+        t0 = fmax(t0, fmin(ta, tb));
+        t1 = fmin(t1, fmax(ta, tb));
+    } else if (ox < 0.0 || ox >= size) {
+        return;
+    }
+    if (dy != 0.0) {
+        double ta = (0.0 - oy)/dy, tb = (size - oy)/dy;
+        t0 = fmax(t0, fmin(ta, tb));
+        t1 = fmin(t1, fmax(ta, tb));
+    } else if (oy < 0.0 || oy >= size) {
+        return;
+    }
+    if (t0 >= t1) return;
+
+    uint fx = ray_index(ox + t0*dx, dx, 0, nfine-1);
+    uint fy = ray_index(oy + t0*dy, dy, 0, nfine-1);
+    int c = ray_walk(icells, h_hash, fx, fy, 0);
+    double t = t0;
+    double inv_dx = 1.0/dx;
+    double inv_dy = 1.0/dy;
+
+    for (;;) {
+        uint lev = icells.level[c];
+        long f = two_to_the(icells.levmax - lev);
+        long xlo = icells.i[c]*f, ylo = icells.j[c]*f;
+
+        double tx = (dx > 0.0) ? (xlo + f - ox)*inv_dx : (dx < 0.0) ? (xlo - ox)*inv_dx : INFINITY;
+        double ty = (dy > 0.0) ? (ylo + f - oy)*inv_dy : (dy < 0.0) ? (ylo - oy)*inv_dy : INFINITY;
+        double t_exit = fmin(fmin(tx, ty), t1);
+        if (t_exit < t) t_exit = t;
+        ray_buffer_push(b, c, t, t_exit);
+        if (t_exit >= t1) break;
+
+        // the next index is signed so a step off the low edge shows as -1
+        long nx, ny;
+        if (tx <= ty) {
+            nx = (dx > 0.0) ? xlo + f : xlo - 1;
+        } else {
+            nx = ray_index(ox + t_exit*dx, dx, xlo, xlo + f - 1);
+        }
+        if (ty <= tx) {
+            ny = (dy > 0.0) ? ylo + f : ylo - 1;
+        } else {
+            ny = ray_index(oy + t_exit*dy, dy, ylo, ylo + f - 1);
+        }
+        if (nx < 0 || nx >= nfine || ny < 0 || ny >= nfine) break;
+        fx = (uint)nx;
+        fy = (uint)ny;
+
+        c = ray_find(icells, h_hash, fx, fy, xlo, ylo, fresh);
+        t = t_exit;
+    }
+}
+
+static ray_segments h_ray_traverse_run (cell_list icells, int **h_hash, uint nrays, const double *ox, const double *oy,
+                                        const double *dx, const double *dy, double tmax, int flags, int threaded) {
+
+    (void)threaded;
+    ray_segments s;
+    s.nrays = nrays;
+    s.start = (uint *)malloc((nrays+1)*sizeof(uint));
+    int fresh = (flags & H_RAY_FRESH_SEARCH) != 0;
+
+    // Each thread traces into its own buffer, noting where each ray
+    // starts, and the buffers are then gathered in ray order. The buffer
+    // is kept on the thread's stack while tracing and stored once at the
+    // end, since the counters of neighbouring threads share a cache line.
+    int nthreads = 1;
+#ifdef _OPENMP
+    if (threaded) nthreads = omp_get_max_threads();
+#endif
+    ray_buffer *buf = (ray_buffer *)calloc(nthreads, sizeof(ray_buffer));
+    int    *ray_thread = (int *)malloc(nrays*sizeof(int));
+    size_t *ray_offset = (size_t *)malloc(nrays*sizeof(size_t));
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads) if(threaded)
+#endif
+    {
+        int tid = 0;
+        ray_buffer b;
+        memset(&b, 0, sizeof(b));
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+#pragma omp for schedule(dynamic, 64)
+#endif
+        for (uint r = 0; r < nrays; r++) {
+            ray_thread[r] = tid;
+            ray_offset[r] = b.n;
+            ray_trace_one(icells, h_hash, ox[r], oy[r], dx[r], dy[r], tmax, fresh, &b);
+            s.start[r] = b.n - ray_offset[r];
+        }
+        buf[tid] = b;
+    }
+
+    uint total = 0;
+    for (uint r = 0; r < nrays; r++) {
+        uint count = s.start[r];
+        s.start[r] = total;
+        total += count;
+    }
+    s.start[nrays] = total;
+
+    s.cell  = (int *)malloc(total*sizeof(int));
+    s.t_in  = (double *)malloc(total*sizeof(double));
+    s.t_out = (double *)malloc(total*sizeof(double));
+
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded)
+#endif
+    for (uint r = 0; r < nrays; r++) {
+        ray_buffer *b = &buf[ray_thread[r]];
+        uint count = s.start[r+1] - s.start[r];
+        memcpy(&s.cell[s.start[r]],  &b->cell[ray_offset[r]],  count*sizeof(int));
+        memcpy(&s.t_in[s.start[r]],  &b->t_in[ray_offset[r]],  count*sizeof(double));
+        memcpy(&s.t_out[s.start[r]], &b->t_out[ray_offset[r]], count*sizeof(double));
+    }
+
+    for (int t = 0; t < nthreads; t++) {
+        free(buf[t].cell);
+        free(buf[t].t_in);
+        free(buf[t].t_out);
+    }
+    free(buf);
+    free(ray_thread);
+    free(ray_offset);
+    return s;
+}
+
+ray_segments h_ray_traverse (cell_list icells, int **h_hash, uint nrays, const double *ox, const double *oy,
+                             const double *dx, const double *dy, double tmax, int flags) {
+    return h_ray_traverse_run(icells, h_hash, nrays, ox, oy, dx, dy, tmax, flags, 0);
+}
+
+#ifdef _OPENMP
+ray_segments h_ray_traverse_openMP (cell_list icells, int **h_hash, uint nrays, const double *ox, const double *oy,
+                                    const double *dx, const double *dy, double tmax, int flags) {
+    return h_ray_traverse_run(icells, h_hash, nrays, ox, oy, dx, dy, tmax, flags, 1);
+}
+#endif
+
+void ray_segments_destroy (ray_segments s) {
+    free(s.start);
+    free(s.cell);
+    free(s.t_in);
+    free(s.t_out);
+}
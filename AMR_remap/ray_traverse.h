@@ -0,0 +1,61 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#ifndef RAY_TRAVERSE_H
+#define RAY_TRAVERSE_H
+
+#include "meshgen/meshgen.h"
+
+// Ray traversal flags
+#define H_RAY_FRESH_SEARCH 1   // start every probe walk at level 0
+
+// Cells crossed by each ray, in order. Ray r crosses cell[k] between the
+// ray parameters t_in[k] and t_out[k] for k from start[r] to start[r+1]-1.
+typedef struct {
+    uint    nrays;
+    uint   *start;
+    int    *cell;
+    double *t_in;
+    double *t_out;
+} ray_segments;
+
+// Traces the rays origin + t*direction for 0 <= t <= tmax, in units of base
+// mesh cells, through the input mesh using the per-level tables from
+// h_remap_build. The part of a ray outside the mesh is skipped. Each step
+// finds the next cell with a probe walk that starts below the last level
+// the next cell shares with the current one.
+ray_segments h_ray_traverse (cell_list icells, int **h_hash, uint nrays, const double *ox, const double *oy,
+                             const double *dx, const double *dy, double tmax, int flags);
+ray_segments h_ray_traverse_openMP (cell_list icells, int **h_hash, uint nrays, const double *ox, const double *oy,
+                                    const double *dx, const double *dy, double tmax, int flags);
+void ray_segments_destroy (ray_segments s);
+
+#endif
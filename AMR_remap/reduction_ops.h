@@ -0,0 +1,220 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+#ifndef REDUCTION_OPS_H
+#define REDUCTION_OPS_H
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "meshgen/meshgen.h"
+
+// Reduction policies used when an output cell is coarser than the input
+// cells it covers. The remap kernels are templated on one of these, so the
+// choice is made at compile time and every call inlines away. The _op
+// templates cover the brute force, full perfect, singlewrite, compact
+// singlewrite, hierarchical and compact hierarchical remaps; the remaining
+// variants (lazy, cached, rowfill, packed and the rest) stay on the mean.
+//
+//   value_type    type of the remapped field
+//   point_sample  take the input cell under the output cell center instead
+//                 of reducing over all of the covered cells
+//   acc_type      partial result carried up the levels
+//   identity      empty partial result
+//   load          contribution of a single input cell
+//   combine       merge two partial results
+//   quad          applied to the merged result of a quartet of sibling cells
+//   scale         applied to a contribution levdiff levels finer than the
+//                 output cell when the kernel flattens the levels
+//   result        final output value from a partial result
+//   split         value of an output cell levdiff levels finer than the
+//                 input cell that covers it
+
+// Defaults shared by the double precision reductions
+struct ReduceBase {
+    typedef double value_type;
+    static const bool point_sample = false;
+};
+
+// Arithmetic mean, for intensive quantities (the original remap). Single
+// precision fields still accumulate in double.
+template <typename T>
+struct ReduceMeanT {
+    typedef T value_type;
+    static const bool point_sample = false;
+    typedef double acc_type;
+    static inline acc_type identity() { return 0.0; }
+    static inline acc_type load(const cell_list &icells, const T *values, uint ic) { (void)icells; return values[ic]; }
+    static inline acc_type combine(acc_type a, acc_type b) { return a + b; }
+    static inline acc_type quad(acc_type a) { return a/4.0; }
+    static inline acc_type scale(acc_type a, uint levdiff) { return a/four_to_the(levdiff); }
+    static inline T result(acc_type a) { return (T)a; }
+    static inline T split(T val, uint levdiff) { (void)levdiff; return val; }
+};
+
+typedef ReduceMeanT<double> ReduceMean;
+typedef ReduceMeanT<float>  ReduceMeanFloat;
+
+// Sum, for extensive quantities such as mass. A finer output cell gets its
+// share of the covering input cell.
+struct ReduceSum : ReduceBase {
+    typedef double acc_type;
+    static inline acc_type identity() { return 0.0; }
+    static inline acc_type load(const cell_list &icells, const double *values, uint ic) { (void)icells; return values[ic]; }
+    static inline acc_type combine(acc_type a, acc_type b) { return a + b; }
+    static inline acc_type quad(acc_type a) { return a; }
+    static inline acc_type scale(acc_type a, uint levdiff) { (void)levdiff; return a; }
+    static inline double result(acc_type a) { return a; }
+    static inline double split(double val, uint levdiff) { return val/four_to_the(levdiff); }
+};
+
+struct ReduceMin : ReduceBase {
+    typedef double acc_type;
+    static inline acc_type identity() { return DBL_MAX; }
+    static inline acc_type load(const cell_list &icells, const double *values, uint ic) { (void)icells; return values[ic]; }
+    static inline acc_type combine(acc_type a, acc_type b) { return b < a ? b : a; }
+    static inline acc_type quad(acc_type a) { return a; }
+    static inline acc_type scale(acc_type a, uint levdiff) { (void)levdiff; return a; }
+    static inline double result(acc_type a) { return a; }
+    static inline double split(double val, uint levdiff) { (void)levdiff; return val; }
+};
+
+struct ReduceMax : ReduceBase {
+    typedef double acc_type;
+    static inline acc_type identity() { return -DBL_MAX; }
+    static inline acc_type load(const cell_list &icells, const double *values, uint ic) { (void)icells; return values[ic]; }
+    static inline acc_type combine(acc_type a, acc_type b) { return b > a ? b : a; }
+    static inline acc_type quad(acc_type a) { return a; }
+    static inline acc_type scale(acc_type a, uint levdiff) { (void)levdiff; return a; }
+    static inline double result(acc_type a) { return a; }
+    static inline double split(double val, uint levdiff) { (void)levdiff; return val; }
+};
+
+// Volume weighted mean for axisymmetric (r-z) meshes with i along r. The
+// volume of a cell grows with its radius, (2i+1)/2^(3*level) in units of
+// the base cell, so the sub cells nearer the axis count for less.
+typedef struct {
+    double vsum;  // sum of value*volume
+    double vol;   // sum of volume
+} vol_acc;
+
+struct ReduceVolumeWeighted : ReduceBase {
+    typedef vol_acc acc_type;
+    static inline acc_type identity() { vol_acc a = {0.0, 0.0}; return a; }
+    static inline acc_type load(const cell_list &icells, const double *values, uint ic) {
+        double vol = ldexp(2.0*icells.i[ic] + 1.0, -3*(int)icells.level[ic]);
+        vol_acc a = {values[ic]*vol, vol};
+        return a;
+    }
+    static inline acc_type combine(acc_type a, acc_type b) {
+        a.vsum += b.vsum;
+        a.vol  += b.vol;
+        return a;
+    }
+    static inline acc_type quad(acc_type a) { return a; }
+    static inline acc_type scale(acc_type a, uint levdiff) { (void)levdiff; return a; }
+    static inline double result(acc_type a) { return a.vsum/a.vol; }
+    static inline double split(double val, uint levdiff) { (void)levdiff; return val; }
+};
+
+// Majority by area, for integer material ids. The tally holds up to
+// MAJORITY_MAX_IDS distinct ids under one output cell; ids beyond that are
+// dropped. Ties go to the smaller id.
+#define MAJORITY_MAX_IDS 16
+
+typedef struct {
+    uint    n;
+    int32_t id[MAJORITY_MAX_IDS];
+    double  area[MAJORITY_MAX_IDS];   // in units of the output cell
+} id_tally;
+
+struct ReduceMajority {
+    typedef int32_t value_type;
+    static const bool point_sample = false;
+    typedef id_tally acc_type;
+    static inline acc_type identity() { id_tally a; a.n = 0; return a; }
+    static inline acc_type load(const cell_list &icells, const int32_t *values, uint ic) {
+        (void)icells;
+        id_tally a;
+        a.n = 1;
+        a.id[0] = values[ic];
+        a.area[0] = 1.0;
+        return a;
+    }
+    static inline acc_type combine(acc_type a, const acc_type &b) {
+        for (uint m = 0; m < b.n; m++) {
+            uint k = 0;
+            while (k < a.n && a.id[k] != b.id[m]) k++;
+            if (k < a.n) {
+                a.area[k] += b.area[m];
+            } else if (a.n < MAJORITY_MAX_IDS) {
+                a.id[a.n]   = b.id[m];
+                a.area[a.n] = b.area[m];
+                a.n++;
+            }
+        }
+        return a;
+    }
+    static inline acc_type quad(acc_type a) {
+        for (uint k = 0; k < a.n; k++) a.area[k] *= 0.25;
+        return a;
+    }
+    static inline acc_type scale(acc_type a, uint levdiff) {
+        for (uint k = 0; k < a.n; k++) a.area[k] /= four_to_the(levdiff);
+        return a;
+    }
+    static inline int32_t result(const acc_type &a) {
+        uint best = 0;
+        for (uint k = 1; k < a.n; k++) {
+            if (a.area[k] > a.area[best] || (a.area[k] == a.area[best] && a.id[k] < a.id[best])) best = k;
+        }
+        return a.id[best];
+    }
+    static inline int32_t split(int32_t val, uint levdiff) { (void)levdiff; return val; }
+};
+
+// Nearest cell, for integer material ids. A coarse output cell takes the id
+// of the input cell that holds its center point, i.e. the cell whose lower
+// left corner is at or below and left of the center.
+struct ReduceNearest {
+    typedef int32_t value_type;
+    static const bool point_sample = true;
+    typedef int32_t acc_type;
+    static inline acc_type identity() { return -1; }
+    static inline acc_type load(const cell_list &icells, const int32_t *values, uint ic) { (void)icells; return values[ic]; }
+    static inline acc_type combine(acc_type a, acc_type b) { (void)a; return b; }
+    static inline acc_type quad(acc_type a) { return a; }
+    static inline acc_type scale(acc_type a, uint levdiff) { (void)levdiff; return a; }
+    static inline int32_t result(acc_type a) { return a; }
+    static inline int32_t split(int32_t val, uint levdiff) { (void)levdiff; return val; }
+};
+
+#endif
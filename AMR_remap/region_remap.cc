@@ -0,0 +1,373 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#include <stdlib.h>
+#include <math.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "meshgen/meshgen.h"
+#include "HashFactory/HashFactory.h"
+#include "hierarchical_remap.h"
+#include "region_remap.h"
+
+#define HASH_TYPE (LCG_QUADRATIC_OPEN_COMPACT_HASH_ID)
+#ifdef _OPENMP
+#define HASH_OPENMP_TYPE (LCG_QUADRATIC_OPEN_COMPACT_OPENMP_HASH_ID | IDENTITY_SENTINEL_PERFECT_OPENMP_HASH_ID)
+#endif
+#define HASH_LOAD_FACTOR 0.3333333
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
+
+// The two meshes share their base mesh, so every input cell overlapping an
+// output cell, and every breadcrumb above it, lies in the base cell of that
+// output cell. The base cells are the coarse tiles: the output cells of the
+// region flag theirs, and the input cells in flagged base cells are all the
+// tables need to answer the queries of the region.
+
+struct region_index {
+    uint ibasesize;
+    uint *start;     // first entry of each base cell in cell, then the end
+    uint *cell;
+};
+
+static inline uint base_cell_of (cell_list cells, uint n) {
+    uint lev = cells.level[n];
+    return (cells.j[n] >> lev)*cells.ibasesize + (cells.i[n] >> lev);
+}
+
+// A counting sort of the cells by base cell. Each thread counts its block of
+// the mesh, and then fills its part of each bucket, keeping mesh order.
+static region_index *region_index_run (cell_list cells, int threaded) {
+
+    (void)threaded;
+    uint ntiles = cells.ibasesize*cells.ibasesize;
+    uint nthreads = 1;
+#ifdef _OPENMP
+    if (threaded) nthreads = omp_get_max_threads();
+#endif
+    region_index *index = (region_index *)malloc(sizeof(region_index));
+    index->ibasesize = cells.ibasesize;
+    index->start = (uint *)malloc((ntiles+1)*sizeof(uint));
+    index->cell  = (uint *)malloc((cells.ncells > 0 ? cells.ncells : 1)*sizeof(uint));
+    uint *count = (uint *)calloc((size_t)nthreads*ntiles, sizeof(uint));
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads) if(threaded)
+#endif
+    {
+#ifdef _OPENMP
+        uint t = omp_get_thread_num();
+        uint nt = omp_get_num_threads();
+#else
+        uint t = 0;
+        uint nt = 1;
+#endif
+        uint nstart = (uint)((size_t)cells.ncells*t/nt);
+        uint nend   = (uint)((size_t)cells.ncells*(t+1)/nt);
+        uint *mine = count + (size_t)t*ntiles;
+
+        for (uint n = nstart; n < nend; n++) {
+            mine[base_cell_of(cells, n)]++;
+        }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+        {
+            // the counts become where each thread starts in each bucket
+            uint offset = 0;
+            for (uint tile = 0; tile < ntiles; tile++) {
+                index->start[tile] = offset;
+                for (uint k = 0; k < nt; k++) {
+                    uint c = count[(size_t)k*ntiles + tile];
+                    count[(size_t)k*ntiles + tile] = offset;
+                    offset += c;
+                }
+            }
+            index->start[ntiles] = offset;
+        }
+
+        for (uint n = nstart; n < nend; n++) {
+            index->cell[mine[base_cell_of(cells, n)]++] = n;
+        }
+    }
+
+    free(count);
+    return index;
+}
+
+region_index *region_index_create (cell_list cells) {
+    return region_index_run(cells, 0);
+}
+
+void region_index_destroy (region_index *index) {
+    free(index->start);
+    free(index->cell);
+    free(index);
+}
+
+// Only the buckets of the base cells under the box are searched
+static uint *region_select_run (cell_list ocells, const region_index *oindex, region_box box, uint *nlist,
+                                int threaded) {
+
+    (void)threaded;
+    uint ibasesize = oindex->ibasesize;
+    double ti0 = MAX(floor(box.xmin), 0.0), ti1 = MIN(ceil(box.xmax), (double)ibasesize) - 1.0;
+    double tj0 = MAX(floor(box.ymin), 0.0), tj1 = MIN(ceil(box.ymax), (double)ibasesize) - 1.0;
+    if (ti0 > ti1 || tj0 > tj1) {
+        *nlist = 0;
+        return (uint *)malloc(sizeof(uint));
+    }
+    uint ncols = (uint)(ti1 - ti0) + 1;
+    uint nbox = ncols*((uint)(tj1 - tj0) + 1);
+
+    uint nthreads = 1;
+#ifdef _OPENMP
+    if (threaded) nthreads = omp_get_max_threads();
+#endif
+    uint *start = (uint *)calloc(nthreads+1, sizeof(uint));
+    uint *olist = NULL;
+    uint total = 0;
+
+    // each thread counts its block of the base cells, then fills its part of
+    // the list from the prefix sum of the counts
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads) if(threaded)
+#endif
+    {
+#ifdef _OPENMP
+        uint t = omp_get_thread_num();
+        uint nt = omp_get_num_threads();
+#else
+        uint t = 0;
+        uint nt = 1;
+#endif
+        uint kstart = (uint)((size_t)nbox*t/nt);
+        uint kend   = (uint)((size_t)nbox*(t+1)/nt);
+
+        uint count = 0;
+        for (uint k = kstart; k < kend; k++) {
+            uint tile = ((uint)tj0 + k/ncols)*ibasesize + (uint)ti0 + k%ncols;
+            for (uint e = oindex->start[tile]; e < oindex->start[tile+1]; e++) {
+                uint n = oindex->cell[e];
+                double size = 1.0/two_to_the(ocells.level[n]);
+                if (ocells.i[n]*size < box.xmax && (ocells.i[n]+1)*size > box.xmin &&
+                    ocells.j[n]*size < box.ymax && (ocells.j[n]+1)*size > box.ymin) count++;
+            }
+        }
+        start[t+1] = count;
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+        {
+            for (uint k = 0; k < nt; k++) {
+                start[k+1] += start[k];
+            }
+            total = start[nt];
+            olist = (uint *)malloc((total > 0 ? total : 1)*sizeof(uint));
+        }
+
+        uint m = start[t];
+        for (uint k = kstart; k < kend; k++) {
+            uint tile = ((uint)tj0 + k/ncols)*ibasesize + (uint)ti0 + k%ncols;
+            for (uint e = oindex->start[tile]; e < oindex->start[tile+1]; e++) {
+                uint n = oindex->cell[e];
+                double size = 1.0/two_to_the(ocells.level[n]);
+                if (ocells.i[n]*size < box.xmax && (ocells.i[n]+1)*size > box.xmin &&
+                    ocells.j[n]*size < box.ymax && (ocells.j[n]+1)*size > box.ymin) olist[m++] = n;
+            }
+        }
+    }
+
+    free(start);
+    *nlist = total;
+    return olist;
+}
+
+uint *region_select (cell_list ocells, const region_index *oindex, region_box box, uint *nlist) {
+    return region_select_run(ocells, oindex, box, nlist, 0);
+}
+
+static void h_remap_region_run (cell_list icells, const region_index *iindex, cell_list ocells,
+                                const uint *olist, uint nlist, intintHash_Factory *factory,
+                                int hash_type, int threaded) {
+
+    (void)threaded;
+    uint ibasesize = icells.ibasesize;
+
+    // list the base cells of the requested output cells, each once
+    char *mark = (char *)calloc((size_t)ibasesize*ibasesize, sizeof(char));
+    uint *tile = (uint *)malloc((nlist > 0 ? nlist : 1)*sizeof(uint));
+    uint ntile = 0;
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded)
+#endif
+    for (uint k = 0; k < nlist; k++) {
+        uint t = base_cell_of(ocells, olist[k]);
+        if (! mark[t] && __sync_bool_compare_and_swap(&mark[t], 0, 1)) {
+            tile[__sync_fetch_and_add(&ntile, 1)] = t;
+        }
+    }
+    free(mark);
+
+    // count the input cells in the listed base cells to size the tables
+    uint *num_at_level = (uint *)calloc(icells.levmax+1, sizeof(uint));
+#ifdef _OPENMP
+#pragma omp parallel if(threaded)
+#endif
+    {
+        uint *local = (uint *)calloc(icells.levmax+1, sizeof(uint));
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,16)
+#endif
+        for (uint k = 0; k < ntile; k++) {
+            for (uint e = iindex->start[tile[k]]; e < iindex->start[tile[k]+1]; e++) {
+                local[icells.level[iindex->cell[e]]]++;
+            }
+        }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        for (uint lev = 0; lev <= icells.levmax; lev++) {
+            num_at_level[lev] += local[lev];
+        }
+        free(local);
+    }
+    // lev must be int (not uint) to allow -1 for exit
+    for (int lev = icells.levmax-1; lev >= 0; lev--) {
+        num_at_level[lev] += num_at_level[lev+1]/4;
+    }
+
+    // a level can be empty in the region, but the compact hashes need entries
+    intintHash_Table **h_hashTable = (intintHash_Table **)malloc((icells.levmax+1)*sizeof(intintHash_Table *));
+    for (uint lev = 0; lev <= icells.levmax; lev++) {
+        size_t hash_size = ibasesize*two_to_the(lev)*ibasesize*two_to_the(lev);
+        uint num_entries = (num_at_level[lev] > 0) ? num_at_level[lev] : 1;
+        h_hashTable[lev] = intintHash_CreateTable(factory, hash_type, hash_size, num_entries, HASH_LOAD_FACTOR);
+        intintHash_SetupTable(h_hashTable[lev]);
+    }
+    free(num_at_level);
+
+    //place the cells of the listed base cells and their breadcrumbs
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,16) if(threaded)
+#endif
+    for (uint k = 0; k < ntile; k++) {
+        for (uint e = iindex->start[tile[k]]; e < iindex->start[tile[k]+1]; e++) {
+            uint n = iindex->cell[e];
+            uint i = icells.i[n];
+            uint j = icells.j[n];
+            int lev = icells.level[n];
+
+            uint key = j * ibasesize*two_to_the(lev) + i;
+            intintHash_InsertSingle(h_hashTable[lev], key, n);
+
+            while (i%2 == 0 && j%2 == 0 && lev > 0) {
+                i /= 2;
+                j /= 2;
+                lev--;
+                key = j * ibasesize*two_to_the(lev) + i;
+                intintHash_InsertSingle(h_hashTable[lev], key, -1);
+            }
+        }
+    }
+    free(tile);
+
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded)
+#endif
+    for (uint k = 0; k < nlist; k++) {
+        uint n = olist[k];
+        uint oi = ocells.i[n];
+        uint oj = ocells.j[n];
+        uint olev = ocells.level[n];
+
+        int probe = -1;
+        for (uint probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+            int levdiff = olev - probe_lev;
+            uint key = (oj >> levdiff)*ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
+            intintHash_QuerySingle(h_hashTable[probe_lev], key, &probe);
+        }
+
+        if (probe >= 0) {
+            ocells.values[n] = icells.values[probe];
+        } else {
+            ocells.values[n] = avg_sub_cells_h_compact (icells, oi, oj, olev, h_hashTable, ibasesize);
+        }
+    }
+
+    h_hash_compact_free(h_hashTable, icells.levmax);
+}
+
+void h_remap_region (cell_list icells, const region_index *iindex, cell_list ocells,
+                     const uint *olist, uint nlist, intintHash_Factory *factory) {
+    h_remap_region_run(icells, iindex, ocells, olist, nlist, factory, HASH_TYPE, 0);
+}
+
+uint h_remap_region_box (cell_list icells, const region_index *iindex, cell_list ocells,
+                         const region_index *oindex, region_box box, intintHash_Factory *factory) {
+    uint nlist;
+    uint *olist = region_select_run(ocells, oindex, box, &nlist, 0);
+    h_remap_region_run(icells, iindex, ocells, olist, nlist, factory, HASH_TYPE, 0);
+    free(olist);
+    return nlist;
+}
+
+#ifdef _OPENMP
+region_index *region_index_create_openMP (cell_list cells) {
+    return region_index_run(cells, 1);
+}
+
+uint *region_select_openMP (cell_list ocells, const region_index *oindex, region_box box, uint *nlist) {
+    return region_select_run(ocells, oindex, box, nlist, 1);
+}
+
+void h_remap_region_openMP (cell_list icells, const region_index *iindex, cell_list ocells,
+                            const uint *olist, uint nlist, intintHash_Factory *factory) {
+    h_remap_region_run(icells, iindex, ocells, olist, nlist, factory, HASH_OPENMP_TYPE, 1);
+}
+
+uint h_remap_region_box_openMP (cell_list icells, const region_index *iindex, cell_list ocells,
+                                const region_index *oindex, region_box box, intintHash_Factory *factory) {
+    uint nlist;
+    uint *olist = region_select_run(ocells, oindex, box, &nlist, 1);
+    h_remap_region_run(icells, iindex, ocells, olist, nlist, factory, HASH_OPENMP_TYPE, 1);
+    free(olist);
+    return nlist;
+}
+#endif
@@ -0,0 +1,82 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#ifndef REGION_REMAP_H
+#define REGION_REMAP_H
+
+#include "meshgen/meshgen.h"
+#include "HashFactory/HashFactory.h"
+
+// Axis-aligned region of the domain in units of base mesh cells, the same
+// for both meshes since they share a base mesh
+typedef struct {
+    double xmin;
+    double xmax;
+    double ymin;
+    double ymax;
+} region_box;
+
+// The cells of a mesh bucketed by the base cell they lie in, in mesh order
+// within each. Building it is one pass over the mesh; it is made once for a
+// mesh and reused by every region selection and remap on that mesh, which
+// then touch only the buckets of the base cells under the region.
+typedef struct region_index region_index;
+region_index *region_index_create (cell_list cells);
+void region_index_destroy (region_index *index);
+
+// Indices of the output cells overlapping the box, grouped by base cell in
+// row-major order, and their count in nlist. The list is malloc'd for the
+// caller to free.
+uint *region_select (cell_list ocells, const region_index *oindex, region_box box, uint *nlist);
+
+// Compact hierarchical remap onto only the output cells in olist, leaving
+// the other output values untouched. The output cells mark the base cells
+// they lie in, and only the input cells in the buckets of marked base cells,
+// with their breadcrumbs, are placed in tables sized for them. With the
+// indexes built, the hash work, the tables and the queries grow with the
+// region rather than the mesh; only the byte per base cell marking them
+// grows with the base mesh.
+void h_remap_region (cell_list icells, const region_index *iindex, cell_list ocells,
+                     const uint *olist, uint nlist, intintHash_Factory *factory);
+// Selects the output cells overlapping the box and remaps onto them,
+// returning how many there were
+uint h_remap_region_box (cell_list icells, const region_index *iindex, cell_list ocells,
+                         const region_index *oindex, region_box box, intintHash_Factory *factory);
+#ifdef _OPENMP
+region_index *region_index_create_openMP (cell_list cells);
+uint *region_select_openMP (cell_list ocells, const region_index *oindex, region_box box, uint *nlist);
+void h_remap_region_openMP (cell_list icells, const region_index *iindex, cell_list ocells,
+                            const uint *olist, uint nlist, intintHash_Factory *factory);
+uint h_remap_region_box_openMP (cell_list icells, const region_index *iindex, cell_list ocells,
+                                const region_index *oindex, region_box box, intintHash_Factory *factory);
+#endif
+
+#endif
@@ -0,0 +1,369 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "meshgen/meshgen.h"
+#include "hierarchical_remap.h"
+#include "regrid.h"
+
+// The regrid runs on the per-level hash of the hierarchical remap. Every
+// cell gets a target level; refine flags raise it by one, then sweeps raise
+// the targets of cells more than one level coarser than a face neighbor
+// until the mesh is 2:1 balanced. Complete quartets of sibling leaves
+// flagged for coarsening are then merged when no neighbor of the parent
+// would end up more than one level finer. Both the serial and the OpenMP
+// versions run the same code; the loops are parallel only when threaded.
+
+// Sides of a region, as seen from the cell across the face
+enum { SIDE_RIGHT = 0, SIDE_LEFT, SIDE_TOP, SIDE_BOTTOM };
+
+// Largest target among the cells covering the side of the refined level
+// lev region (ri, rj)
+static uint refined_face_max (int **h_hash, uint ibasesize, const uint *target, uint ri, uint rj, uint lev, int side) {
+
+    uint best = 0;
+    for (int k = 0; k < 2; k++) {
+        uint ci = 2*ri + ((side == SIDE_RIGHT) ? 1 : (side == SIDE_LEFT)   ? 0 : k);
+        uint cj = 2*rj + ((side == SIDE_TOP)   ? 1 : (side == SIDE_BOTTOM) ? 0 : k);
+        int probe = h_hash[lev+1][cj*ibasesize*two_to_the(lev+1) + ci];
+        uint t = (probe >= 0) ? target[probe] : refined_face_max(h_hash, ibasesize, target, ci, cj, lev+1, side);
+        if (t > best) best = t;
+    }
+    return best;
+}
+
+// Largest target among the cells covering the side of the level lev
+// region (ni, nj) that faces a neighbor, or -1 outside the mesh
+static int face_max_target (cell_list icells, int **h_hash, const uint *target, int ni, int nj, uint lev, int side) {
+
+    int size = icells.ibasesize*two_to_the(lev);
+    if (ni < 0 || nj < 0 || ni >= size || nj >= size) return -1;
+
+    int probe = -1;
+    for (uint probe_lev = 0; probe < 0 && probe_lev <= lev; probe_lev++){
+        int levdiff = lev - probe_lev;
+        uint key = (nj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (ni >> levdiff);
+        probe = h_hash[probe_lev][key];
+    }
+    if (probe >= 0) return target[probe];
+    return refined_face_max(h_hash, icells.ibasesize, target, ni, nj, lev, side);
+}
+
+// Largest target across the four faces of the level lev region (i, j)
+static int neighbor_max_target (cell_list icells, int **h_hash, const uint *target, int i, int j, uint lev) {
+
+    int m = face_max_target(icells, h_hash, target, i-1, j, lev, SIDE_RIGHT);
+    int t = face_max_target(icells, h_hash, target, i+1, j, lev, SIDE_LEFT);
+    if (t > m) m = t;
+    t = face_max_target(icells, h_hash, target, i, j-1, lev, SIDE_TOP);
+    if (t > m) m = t;
+    t = face_max_target(icells, h_hash, target, i, j+1, lev, SIDE_BOTTOM);
+    if (t > m) m = t;
+    return m;
+}
+
+// The other three cells of the quartet whose lower left cell is ic, or
+// 0 if any of them is refined
+static inline int quartet_siblings (cell_list icells, int **h_hash, uint ic, int *sib) {
+
+    uint i = icells.i[ic];
+    uint j = icells.j[ic];
+    uint lev = icells.level[ic];
+    uint istride = icells.ibasesize*two_to_the(lev);
+    uint key = j*istride + i;
+
+    sib[0] = h_hash[lev][key + 1];
+    sib[1] = h_hash[lev][key + istride];
+    sib[2] = h_hash[lev][key + istride + 1];
+    return sib[0] >= 0 && sib[1] >= 0 && sib[2] >= 0;
+}
+
+typedef struct {
+    uint64_t key;
+    uint     index;
+} regrid_sort_entry;
+
+static int compare_regrid_sort_entry(const void *a, const void *b) {
+    uint64_t ka = ((const regrid_sort_entry *)a)->key;
+    uint64_t kb = ((const regrid_sort_entry *)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+// Reorders the new cells and their map by the Morton key of each cell's
+// lower left corner on the finest level
+static void regrid_sort_morton (regrid_result *r) {
+
+    cell_list c = r->cells;
+    regrid_sort_entry *entry = (regrid_sort_entry *)malloc(c.ncells*sizeof(regrid_sort_entry));
+    for (uint n = 0; n < c.ncells; n++) {
+        uint lev_mod = two_to_the(c.levmax - c.level[n]);
+        entry[n].key   = morton_encode(c.i[n]*lev_mod, c.j[n]*lev_mod);
+        entry[n].index = n;
+    }
+    qsort(entry, c.ncells, sizeof(regrid_sort_entry), compare_regrid_sort_entry);
+
+    cell_list s = c;
+    s = create_cell_list(s, c.ncells);
+    uint *map_start = (uint *)malloc((c.ncells+1)*sizeof(uint));
+    uint *map_src   = (uint *)malloc(r->map_start[c.ncells]*sizeof(uint));
+
+    map_start[0] = 0;
+    for (uint n = 0; n < c.ncells; n++) {
+        uint p = entry[n].index;
+        s.i[n]     = c.i[p];
+        s.j[n]     = c.j[p];
+        s.level[n] = c.level[p];
+        uint nsrc = r->map_start[p+1] - r->map_start[p];
+        memcpy(&map_src[map_start[n]], &r->map_src[r->map_start[p]], nsrc*sizeof(uint));
+        map_start[n+1] = map_start[n] + nsrc;
+    }
+
+    destroy(c);
+    free(r->map_start);
+    free(r->map_src);
+    free(entry);
+    r->cells     = s;
+    r->map_start = map_start;
+    r->map_src   = map_src;
+}
+
+static regrid_result regrid_run (cell_list icells, const int *flags, uint max_level, int morton_order, int threaded) {
+
+    (void)threaded;
+    regrid_result r;
+    uint ncells = icells.ncells;
+
+    int **h_hash = h_hash_alloc(icells.ibasesize, icells.levmax);
+    uint *target     = (uint *)malloc(ncells*sizeof(uint));
+    uint *target_new = (uint *)malloc(ncells*sizeof(uint));
+    uint *count      = (uint *)malloc(ncells*sizeof(uint));
+    uint *nsrc       = (uint *)malloc(ncells*sizeof(uint));
+    uint *offset     = (uint *)malloc(ncells*sizeof(uint));
+    uint *src_offset = (uint *)malloc(ncells*sizeof(uint));
+
+#ifdef _OPENMP
+    if (threaded) h_remap_build_openMP(icells, h_hash);
+    else
+#endif
+    h_remap_build(icells, h_hash);
+
+    // the starting targets
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded)
+#endif
+    for (uint n = 0; n < ncells; n++) {
+        target[n] = icells.level[n];
+        if (flags[n] == REGRID_REFINE && icells.level[n] < max_level) target[n]++;
+    }
+
+    // Balance sweeps. Each cell pulls its target up to one below the
+    // finest target across its faces.
+    r.balance_sweeps = 0;
+    uint nchanged = 1;
+    while (nchanged > 0) {
+        nchanged = 0;
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded) reduction(+:nchanged)
+#endif
+        for (uint n = 0; n < ncells; n++) {
+            uint t = target[n];
+            int m = neighbor_max_target(icells, h_hash, target, icells.i[n], icells.j[n], icells.level[n]);
+            if (m > (int)t + 1) {
+                t = m - 1;
+                nchanged++;
+            }
+            target_new[n] = t;
+        }
+        uint *tmp = target;
+        target = target_new;
+        target_new = tmp;
+        r.balance_sweeps++;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded)
+#endif
+    for (uint n = 0; n < ncells; n++) {
+        count[n] = four_to_the(target[n] - icells.level[n]);
+        nsrc[n]  = count[n];
+    }
+
+    // Coarsening, decided by the lower left cell of each quartet
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded)
+#endif
+    for (uint n = 0; n < ncells; n++) {
+        uint lev = icells.level[n];
+        if (flags[n] != REGRID_COARSEN || lev == 0 || target[n] != lev) continue;
+        if (icells.i[n]%2 != 0 || icells.j[n]%2 != 0) continue;
+
+        int sib[3];
+        if (! quartet_siblings(icells, h_hash, n, sib)) continue;
+        int all_flagged = 1;
+        for (int k = 0; k < 3; k++) {
+            if (flags[sib[k]] != REGRID_COARSEN || target[sib[k]] != lev) all_flagged = 0;
+        }
+        if (! all_flagged) continue;
+        if (neighbor_max_target(icells, h_hash, target, icells.i[n]/2, icells.j[n]/2, lev-1) > (int)lev) continue;
+
+        count[n] = 1;
+        nsrc[n]  = 4;
+        for (int k = 0; k < 3; k++) {
+            count[sib[k]] = 0;
+            nsrc[sib[k]]  = 0;
+        }
+    }
+
+    uint new_ncells = 0;
+    uint new_nsrc = 0;
+    for (uint n = 0; n < ncells; n++) {
+        offset[n]     = new_ncells;
+        src_offset[n] = new_nsrc;
+        new_ncells += count[n];
+        new_nsrc   += nsrc[n];
+    }
+
+    r.cells.ibasesize = icells.ibasesize;
+    r.cells = create_cell_list(r.cells, new_ncells);
+    r.map_start = (uint *)malloc((new_ncells+1)*sizeof(uint));
+    r.map_src   = (uint *)malloc(new_nsrc*sizeof(uint));
+    r.map_start[new_ncells] = new_nsrc;
+
+    uint levmax = 0;
+#ifdef _OPENMP
+#pragma omp parallel for if(threaded) reduction(max:levmax)
+#endif
+    for (uint n = 0; n < ncells; n++) {
+        if (count[n] == 0) continue;
+        uint o  = offset[n];
+        uint so = src_offset[n];
+        if (nsrc[n] == 4 && count[n] == 1) {
+            int sib[3];
+            quartet_siblings(icells, h_hash, n, sib);
+            r.cells.i[o]     = icells.i[n]/2;
+            r.cells.j[o]     = icells.j[n]/2;
+            r.cells.level[o] = icells.level[n] - 1;
+            r.map_start[o] = so;
+            r.map_src[so]  = n;
+            for (int k = 0; k < 3; k++) {
+                r.map_src[so+1+k] = sib[k];
+            }
+            if (icells.level[n] - 1 > levmax) levmax = icells.level[n] - 1;
+        } else {
+            uint lev_mod = two_to_the(target[n] - icells.level[n]);
+            for (uint jj = 0; jj < lev_mod; jj++) {
+                for (uint ii = 0; ii < lev_mod; ii++) {
+                    uint k = jj*lev_mod + ii;
+                    r.cells.i[o+k]     = icells.i[n]*lev_mod + ii;
+                    r.cells.j[o+k]     = icells.j[n]*lev_mod + jj;
+                    r.cells.level[o+k] = target[n];
+                    r.map_start[o+k]   = so + k;
+                    r.map_src[so+k]    = n;
+                }
+            }
+            if (target[n] > levmax) levmax = target[n];
+        }
+    }
+    r.cells.levmax = levmax;
+
+    r.cells.dist = (uint *)calloc(levmax+1, sizeof(uint));
+    for (uint n = 0; n < new_ncells; n++) {
+        r.cells.dist[r.cells.level[n]]++;
+    }
+
+    if (morton_order) regrid_sort_morton(&r);
+
+    free(target);
+    free(target_new);
+    free(count);
+    free(nsrc);
+    free(offset);
+    free(src_offset);
+    h_hash_free(h_hash, icells.levmax);
+
+    return r;
+}
+
+// New mesh from the flags, at most max_level, with its values remapped
+// from the old mesh
+regrid_result regrid (cell_list icells, const int *flags, uint max_level, int morton_order) {
+
+    regrid_result r = regrid_run(icells, flags, max_level, morton_order, 0);
+    regrid_remap(r, icells.values, r.cells.values);
+    return r;
+}
+
+// First order remap over the regrid map: kept and refined cells take the
+// value of their old cell, coarsened cells the mean of the old children
+void regrid_remap (regrid_result r, const double *ivalues, double *ovalues) {
+
+    for (uint n = 0; n < r.cells.ncells; n++) {
+        uint start = r.map_start[n];
+        uint end   = r.map_start[n+1];
+        double sum = 0.0;
+        for (uint k = start; k < end; k++) {
+            sum += ivalues[r.map_src[k]];
+        }
+        ovalues[n] = sum/(end - start);
+    }
+}
+
+#ifdef _OPENMP
+regrid_result regrid_openMP (cell_list icells, const int *flags, uint max_level, int morton_order) {
+
+    regrid_result r = regrid_run(icells, flags, max_level, morton_order, 1);
+    regrid_remap_openMP(r, icells.values, r.cells.values);
+    return r;
+}
+
+void regrid_remap_openMP (regrid_result r, const double *ivalues, double *ovalues) {
+
+#pragma omp parallel for
+    for (uint n = 0; n < r.cells.ncells; n++) {
+        uint start = r.map_start[n];
+        uint end   = r.map_start[n+1];
+        double sum = 0.0;
+        for (uint k = start; k < end; k++) {
+            sum += ivalues[r.map_src[k]];
+        }
+        ovalues[n] = sum/(end - start);
+    }
+}
+#endif
+
+void regrid_destroy (regrid_result r) {
+    destroy(r.cells);
+    free(r.cells.dist);
+    free(r.map_start);
+    free(r.map_src);
+}
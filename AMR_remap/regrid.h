@@ -0,0 +1,59 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#ifndef REGRID_H
+#define REGRID_H
+
+#include "meshgen/meshgen.h"
+
+// Per cell regrid flags
+#define REGRID_COARSEN -1
+#define REGRID_KEEP     0
+#define REGRID_REFINE   1
+
+// New mesh from a regrid and the map from each new cell back to the old
+// cells it is made from: the one old cell it came from when kept or
+// refined, the four old children when coarsened. New cell n is made from
+// old cells map_src[map_start[n]] through map_src[map_start[n+1]-1].
+typedef struct {
+    cell_list cells;
+    uint *map_start;
+    uint *map_src;
+    uint balance_sweeps;   // sweeps needed to reach 2:1 balance
+} regrid_result;
+
+regrid_result regrid (cell_list icells, const int *flags, uint max_level, int morton_order);
+regrid_result regrid_openMP (cell_list icells, const int *flags, uint max_level, int morton_order);
+void regrid_remap (regrid_result r, const double *ivalues, double *ovalues);
+void regrid_remap_openMP (regrid_result r, const double *ivalues, double *ovalues);
+void regrid_destroy (regrid_result r);
+
+#endif
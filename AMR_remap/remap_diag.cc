@@ -0,0 +1,69 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#include "remap_diag.h"
+
+void remap_diag_sweep(cell_list icells, const double *ivalues, cell_list ocells, const double *ovalues,
+                      remap_diag *diag) {
+
+    remap_diag_reset(diag);
+
+    for (uint ic = 0; ic < icells.ncells; ic++) {
+        remap_diag_accum(ivalues[ic], icells.level[ic], &diag->in_integral, &diag->in_min, &diag->in_max);
+    }
+    for (uint ic = 0; ic < ocells.ncells; ic++) {
+        remap_diag_accum(ovalues[ic], ocells.level[ic], &diag->out_integral, &diag->out_min, &diag->out_max);
+    }
+}
+
+#ifdef _OPENMP
+void remap_diag_sweep_openMP(cell_list icells, const double *ivalues, cell_list ocells, const double *ovalues,
+                             remap_diag *diag) {
+
+    double in_sum = 0.0, in_min = DBL_MAX, in_max = -DBL_MAX;
+    double out_sum = 0.0, out_min = DBL_MAX, out_max = -DBL_MAX;
+
+#pragma omp parallel default(none) shared(icells, ocells, ivalues, ovalues) \
+    shared(in_sum, in_min, in_max, out_sum, out_min, out_max)
+    {
+#pragma omp for reduction(+:in_sum) reduction(min:in_min) reduction(max:in_max)
+        for (uint ic = 0; ic < icells.ncells; ic++) {
+            remap_diag_accum(ivalues[ic], icells.level[ic], &in_sum, &in_min, &in_max);
+        }
+#pragma omp for reduction(+:out_sum) reduction(min:out_min) reduction(max:out_max)
+        for (uint ic = 0; ic < ocells.ncells; ic++) {
+            remap_diag_accum(ovalues[ic], ocells.level[ic], &out_sum, &out_min, &out_max);
+        }
+    }
+
+    remap_diag_set(diag, in_sum, in_min, in_max, out_sum, out_min, out_max);
+}
+#endif
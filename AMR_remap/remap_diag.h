@@ -0,0 +1,101 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#ifndef REMAP_DIAG_H
+#define REMAP_DIAG_H
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "meshgen/meshgen.h"
+
+// Conservation and bounds diagnostics gathered by the remap kernels while
+// they already have each value in hand. Cell areas are measured in units of
+// a base cell, so a cell at level lev has area 4^-lev. Passing NULL for the
+// diagnostics turns the accumulation off.
+typedef struct {
+    double in_integral;
+    double out_integral;
+    double in_min, in_max;
+    double out_min, out_max;
+} remap_diag;
+
+static inline void remap_diag_reset(remap_diag *diag) {
+    diag->in_integral  = 0.0;
+    diag->out_integral = 0.0;
+    diag->in_min  =  DBL_MAX;
+    diag->in_max  = -DBL_MAX;
+    diag->out_min =  DBL_MAX;
+    diag->out_max = -DBL_MAX;
+}
+
+// Area 4^-lev of a cell at level lev, built directly from the exponent
+// bits since ldexp is a library call in the inner loop
+static inline double remap_diag_area(uint lev) {
+    union { uint64_t bits; double area; } u;
+    u.bits = (uint64_t)(1023 - 2*lev) << 52;
+    return u.area;
+}
+
+// Adds one cell to a running integral and min/max
+static inline void remap_diag_accum(double val, uint lev, double *integral, double *vmin, double *vmax) {
+    *integral += val*remap_diag_area(lev);
+    if (val < *vmin) *vmin = val;
+    if (val > *vmax) *vmax = val;
+}
+
+static inline void remap_diag_set(remap_diag *diag, double in_integral, double in_min, double in_max,
+                                  double out_integral, double out_min, double out_max) {
+    diag->in_integral  = in_integral;
+    diag->out_integral = out_integral;
+    diag->in_min  = in_min;
+    diag->in_max  = in_max;
+    diag->out_min = out_min;
+    diag->out_max = out_max;
+}
+
+// Relative conservation error |out - in| / |in|
+static inline double remap_diag_rel_error(const remap_diag *diag) {
+    if (diag->in_integral == 0.0) return fabs(diag->out_integral);
+    return fabs(diag->out_integral - diag->in_integral)/fabs(diag->in_integral);
+}
+
+// The same quantities computed in a separate sweep over both meshes after
+// the remap, for comparison with the fused accumulation
+void remap_diag_sweep(cell_list icells, const double *ivalues, cell_list ocells, const double *ovalues,
+                      remap_diag *diag);
+#ifdef _OPENMP
+void remap_diag_sweep_openMP(cell_list icells, const double *ivalues, cell_list ocells, const double *ovalues,
+                             remap_diag *diag);
+#endif
+
+#endif
@@ -0,0 +1,183 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+#include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "remap_matrix.h"
+#include "hierarchical_remap.h"
+
+// Private functions to this file
+static uint sub_cells_h (int **h_hash, uint ibasesize, uint i, uint j, uint lev, uint startlev,
+    uint *col, double *weight);
+static void apply_row_block (remap_matrix m, uint nfields, const double *ivalues, double *ovalues,
+    uint rstart, uint rend);
+
+// Walks the input cells under output cell (i, j, lev) in the same order as
+// avg_sub_cells_h, so the SpMV sums in the same order as h_remap. Returns
+// the count, and also stores the entries when col is not NULL.
+static uint sub_cells_h (int **h_hash, uint ibasesize, uint i, uint j, uint lev, uint startlev,
+    uint *col, double *weight) {
+
+    uint count = 0;
+    uint istride = ibasesize*two_to_the(lev+1);
+
+    for (uint jj = 2*j; jj < 2*j+2; jj++) {
+        for (uint ii = 2*i; ii < 2*i+2; ii++) {
+            int probe = h_hash[lev+1][jj*istride + ii];
+            if (probe >= 0) {
+                if (col != NULL) {
+                    col[count]    = probe;
+                    weight[count] = 1.0/four_to_the(lev+1-startlev);
+                }
+                count++;
+            } else {
+                count += sub_cells_h(h_hash, ibasesize, ii, jj, lev+1, startlev,
+                    col == NULL ? NULL : col + count, weight == NULL ? NULL : weight + count);
+            }
+        }
+    }
+    return count;
+}
+
+remap_matrix remap_matrix_build (cell_list icells, cell_list ocells) {
+
+    remap_matrix m;
+    m.nrows = ocells.ncells;
+    m.ncols = icells.ncells;
+    m.row_ptr = (uint *)malloc((m.nrows+1)*sizeof(uint));
+
+    int **h_hash = h_hash_alloc(icells.ibasesize, icells.levmax);
+    h_remap_build(icells, h_hash);
+
+    // First pass finds the row lengths, the second fills them in
+    int *found = (int *)malloc(m.nrows*sizeof(int));
+    m.row_ptr[0] = 0;
+    for (uint n = 0; n < m.nrows; n++) {
+        uint oi = ocells.i[n];
+        uint oj = ocells.j[n];
+        uint olev = ocells.level[n];
+
+        int probe = -1;
+        for (uint probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+            int levdiff = olev - probe_lev;
+            uint key = (oj >> levdiff)*icells.ibasesize*two_to_the(probe_lev) + (oi >> levdiff);
+            probe = h_hash[probe_lev][key];
+        }
+        found[n] = probe;
+        uint len = (probe >= 0) ? 1 : sub_cells_h(h_hash, icells.ibasesize, oi, oj, olev, olev, NULL, NULL);
+        m.row_ptr[n+1] = m.row_ptr[n] + len;
+    }
+
+    m.nnz    = m.row_ptr[m.nrows];
+    m.col    = (uint *)  malloc(m.nnz*sizeof(uint));
+    m.weight = (double *)malloc(m.nnz*sizeof(double));
+
+    for (uint n = 0; n < m.nrows; n++) {
+        uint start = m.row_ptr[n];
+        if (found[n] >= 0) {
+            m.col[start]    = found[n];
+            m.weight[start] = 1.0;
+        } else {
+            sub_cells_h(h_hash, icells.ibasesize, ocells.i[n], ocells.j[n], ocells.level[n], ocells.level[n],
+                m.col + start, m.weight + start);
+        }
+    }
+
+    free(found);
+    h_hash_free(h_hash, icells.levmax);
+
+    return m;
+}
+
+void remap_matrix_destroy (remap_matrix m) {
+    free(m.row_ptr);
+    free(m.col);
+    free(m.weight);
+}
+
+static void apply_row_block (remap_matrix m, uint nfields, const double *ivalues, double *ovalues,
+    uint rstart, uint rend) {
+
+    const uint   * __restrict__ row_ptr = m.row_ptr;
+    const uint   * __restrict__ col     = m.col;
+    const double * __restrict__ weight  = m.weight;
+    const double * __restrict__ in      = ivalues;
+    double       * __restrict__ out     = ovalues;
+
+    if (nfields == 1) {
+        for (uint n = rstart; n < rend; n++) {
+            double sum = 0.0;
+            for (uint k = row_ptr[n]; k < row_ptr[n+1]; k++) {
+                sum += weight[k]*in[col[k]];
+            }
+            out[n] = sum;
+        }
+        return;
+    }
+
+    for (uint n = rstart; n < rend; n++) {
+        double *orow = out + (size_t)n*nfields;
+        for (uint f = 0; f < nfields; f++) {
+            orow[f] = 0.0;
+        }
+        for (uint k = row_ptr[n]; k < row_ptr[n+1]; k++) {
+            const double *irow = in + (size_t)col[k]*nfields;
+            double w = weight[k];
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+            for (uint f = 0; f < nfields; f++) {
+                orow[f] += w*irow[f];
+            }
+        }
+    }
+}
+
+void remap_matrix_apply (remap_matrix m, uint nfields, const double *ivalues, double *ovalues) {
+    apply_row_block(m, nfields, ivalues, ovalues, 0, m.nrows);
+}
+
+#ifdef _OPENMP
+void remap_matrix_apply_openMP (remap_matrix m, uint nfields, const double *ivalues, double *ovalues) {
+
+#pragma omp parallel default(none) shared(m, ivalues, ovalues) firstprivate(nfields)
+    {
+        // Contiguous row blocks keep each thread's output writes together
+        int nthreads = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        uint rstart = (uint)((size_t)m.nrows*tid/nthreads);
+        uint rend   = (uint)((size_t)m.nrows*(tid+1)/nthreads);
+        apply_row_block(m, nfields, ivalues, ovalues, rstart, rend);
+    }
+}
+#endif
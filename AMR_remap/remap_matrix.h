@@ -0,0 +1,62 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+#ifndef REMAP_MATRIX_H
+#define REMAP_MATRIX_H
+
+#include "meshgen/meshgen.h"
+
+// The remap from one mesh to another as a sparse matrix in CSR form, one
+// row per output cell. A row has a single entry of weight one when the
+// output cell is the same size or finer than the input cell covering it,
+// and one entry per covered input cell, weighted by its area fraction,
+// when the output cell is coarser. For meshes that stay fixed over many
+// steps the hash work is done once and each field is remapped with an
+// SpMV.
+typedef struct {
+    uint nrows;       // number of output cells
+    uint ncols;       // number of input cells
+    uint nnz;         // number of stored entries
+    uint *row_ptr;    // nrows+1 offsets into col and weight
+    uint *col;        // input cell index
+    double *weight;   // area fraction of the output cell
+} remap_matrix;
+
+remap_matrix remap_matrix_build (cell_list icells, cell_list ocells);
+void remap_matrix_destroy (remap_matrix m);
+
+// Fields are interleaved, ivalues[ic*nfields + f] and ovalues[oc*nfields + f],
+// so the innermost loop runs over contiguous fields and vectorizes
+void remap_matrix_apply (remap_matrix m, uint nfields, const double *ivalues, double *ovalues);
+#ifdef _OPENMP
+void remap_matrix_apply_openMP (remap_matrix m, uint nfields, const double *ivalues, double *ovalues);
+#endif
+
+#endif
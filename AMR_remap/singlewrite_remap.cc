@@ -34,17 +34,21 @@
 
 #include "meshgen/meshgen.h"
 #include "simplehash/simplehash.h"
+#include "genmalloc/first_touch.h"
 #include "singlewrite_remap.h"
+#include "probe_cache.h"
 
 // These subroutines are private to this file
 double avg_sub_cells (cell_list icells, uint jo, uint io, uint lev, int *hash);
 double avg_sub_cells_compact (cell_list icells, uint ji, uint ii, uint level, int *hash);
-double avg_sub_cells_compact_openMP (cell_list icells, uint ji, uint ii, uint level, int *hash, uint max_lev);
+double avg_sub_cells_lazy (cell_list icells, uint ji, uint ii, uint level, int *hash);
 
-double avg_sub_cells (cell_list icells, uint ji, uint ii, uint level, int *hash) {
+template <class Op>
+typename Op::acc_type avg_sub_cells_op (cell_list icells, const typename Op::value_type *values, uint ji, uint ii,
+    uint level, int *hash) {
 
     uint key, i_max, jump;
-    double sum = 0.0;
+    typename Op::acc_type sum = Op::identity();
     i_max = icells.ibasesize*two_to_the(icells.levmax);
     jump = two_to_the(icells.levmax - level - 1);
     
@@ -55,20 +59,89 @@ double avg_sub_cells (cell_list icells, uint ji, uint ii, uint level, int *hash)
             // Getting sub averages failed
             assert(ic >= 0);
             if (icells.level[ic] == (level + 1)) {
-                sum += icells.values[ic];
+                sum = Op::combine(sum, Op::load(icells, values, ic));
             } else {
-                sum += avg_sub_cells(icells, ji + (j*jump), ii + (i*jump), level + 1, hash);
+                sum = Op::combine(sum, avg_sub_cells_op<Op>(icells, values, ji + (j*jump), ii + (i*jump), level + 1, hash));
             }
         }
     }
     
-    return sum/4.0;
+    return Op::quad(sum);
 }
 
-double avg_sub_cells_compact (cell_list icells, uint ji, uint ii, uint level, int *hash) {
+double avg_sub_cells (cell_list icells, uint ji, uint ii, uint level, int *hash) {
+    return avg_sub_cells_op<ReduceMean>(icells, icells.values, ji, ii, level, hash);
+}
+
+// Input cell holding the fine grid point (ii, ji). Walks coarser from the
+// finest level until it lands on the lower left corner of a cell.
+static inline int probe_point (int *hash, uint ji, uint ii, uint max_lev, uint i_max) {
+
+    int ic = hash[ji*i_max + ii];
+    for (uint lev_diff = 1; ic < 0 && lev_diff <= max_lev; lev_diff++) {
+        ii >>= lev_diff;
+        ii <<= lev_diff;
+        ji >>= lev_diff;
+        ji <<= lev_diff;
+        ic = hash[ji*i_max + ii];
+    }
+    return ic;
+}
+
+// The finest level table with each input cell at its lower left corner and
+// -1 at the other points
+static int *singlewrite_hash_build (cell_list icells) {
+
+    size_t hash_size = (size_t)icells.ibasesize*two_to_the(icells.levmax)*
+                       icells.ibasesize*two_to_the(icells.levmax);
+    int *hash = (int *) malloc(hash_size * sizeof(int));
+    uint i_max = icells.ibasesize*two_to_the(icells.levmax);
+
+    memset(hash, 0xFFFFFFFF, hash_size*sizeof(uint));
+
+    for (uint i = 0; i < icells.ncells; i++) {
+        uint lev_mod = two_to_the(icells.levmax - icells.level[i]);
+        hash[((icells.j[i] * lev_mod) * i_max) + (icells.i[i] * lev_mod)] = i;
+    }
+    return hash;
+}
+
+#ifdef _OPENMP
+static int *singlewrite_hash_build_openMP (cell_list icells) {
+
+    size_t hash_size = (size_t)icells.ibasesize*two_to_the(icells.levmax)*
+                       icells.ibasesize*two_to_the(icells.levmax);
+    int *hash = (int *) first_touch_malloc(hash_size, sizeof(int), FIRST_TOUCH_BLOCK);
+
+#pragma omp parallel default(none) firstprivate(hash_size) shared(icells, hash)
+    {
+        uint max_lev = icells.levmax;
+        uint i_max = icells.ibasesize*two_to_the(max_lev);
+
+#pragma omp for
+        for (size_t i = 0; i < hash_size; i++) {
+            hash[i] = -1;
+        }
+
+#pragma omp for
+        for (uint i = 0; i < icells.ncells; i++) {
+            uint lev_mod = two_to_the(max_lev - icells.level[i]);
+            hash[((icells.j[i] * lev_mod) * i_max) + (icells.i[i] * lev_mod)] = i;
+        }
+    }
+    return hash;
+}
+#endif
+
+// The compact variants go through simplehash, which keeps its table state
+// at file scope, so they are left out of the reentrant library build
+#ifndef AMRREMAP_LIBRARY
+template <class Op>
+typename Op::acc_type avg_sub_cells_compact_op (cell_list icells, const typename Op::value_type *values,
+    uint ji, uint ii, uint level, int *hash) {
 
     uint key, i_max, jump;
-    double sum = 0.0;
+    typename Op::acc_type sum = Op::identity();
     i_max = icells.ibasesize*two_to_the(icells.levmax);
     jump = two_to_the(icells.levmax - level - 1);
     
@@ -79,44 +152,69 @@ double avg_sub_cells_compact (cell_list icells, uint ji, uint ii, uint level, in
             // Getting sub averages failed
             assert(ic >= 0);
             if (icells.level[ic] == (level + 1)) {
-                sum += icells.values[ic];
+                sum = Op::combine(sum, Op::load(icells, values, ic));
             } else {
-                sum += avg_sub_cells_compact(icells, ji + (j*jump), ii + (i*jump), level + 1, hash);
+                sum = Op::combine(sum, avg_sub_cells_compact_op<Op>(icells, values, ji + (j*jump), ii + (i*jump), level + 1, hash));
             }
         }
     }
     
-    return sum/4.0;
+    return Op::quad(sum);
+}
+
+double avg_sub_cells_compact (cell_list icells, uint ji, uint ii, uint level, int *hash) {
+    return avg_sub_cells_compact_op<ReduceMean>(icells, icells.values, ji, ii, level, hash);
 }
 
-double avg_sub_cells_compact_openMP (cell_list icells, uint ji, uint ii, uint level, int *hash, uint max_lev) {
+// probe_point through the compact hash
+static inline int probe_point_compact (int *hash, uint ji, uint ii, uint max_lev, uint i_max) {
+
+    int ic = read_hash(ji*i_max + ii, hash);
+    for (uint lev_diff = 1; ic < 0 && lev_diff <= max_lev; lev_diff++) {
+        ii >>= lev_diff;
+        ii <<= lev_diff;
+        ji >>= lev_diff;
+        ji <<= lev_diff;
+        ic = read_hash(ji*i_max + ii, hash);
+    }
+    return ic;
+}
+#endif
+
+
+// Same as avg_sub_cells, but for a hash that stores ic+1 so zero means empty
+double avg_sub_cells_lazy (cell_list icells, uint ji, uint ii, uint level, int *hash) {
 
     uint key, i_max, jump;
-    double sum = 0;
-    i_max = two_to_the(max_lev);
-    jump = two_to_the(max_lev - level - 1);
-    
+    double sum = 0.0;
+    i_max = icells.ibasesize*two_to_the(icells.levmax);
+    jump = two_to_the(icells.levmax - level - 1);
+
     for (int j = 0; j < 2; j++) {
         for (int i = 0; i < 2; i++) {
             key = ((ji + (j*jump)) * i_max) + (ii + (i*jump));
-            int ic = read_hash(key, hash);
+            int ic = hash[key] - 1;
             // Getting sub averages failed
             assert(ic >= 0);
             if (icells.level[ic] == (level + 1)) {
                 sum += icells.values[ic];
             } else {
-                sum += avg_sub_cells_compact_openMP(icells, ji + (j*jump), ii + (i*jump), level + 1, 
-                    hash, max_lev);
+                sum += avg_sub_cells_lazy(icells, ji + (j*jump), ii + (i*jump), level + 1, hash);
             }
         }
     }
-    
-    return sum/4;
+
+    return sum/4.0;
 }
 
 
-void singlewrite_remap (cell_list icells, cell_list ocells) {
+template <class Op>
+void singlewrite_remap_op (cell_list icells, const typename Op::value_type *ivalues,
+                           cell_list ocells, typename Op::value_type *ovalues, remap_diag *diag) {
     
+    double in_sum = 0.0, in_min = DBL_MAX, in_max = -DBL_MAX;
+    double out_sum = 0.0, out_min = DBL_MAX, out_max = -DBL_MAX;
+
     size_t hash_size = icells.ibasesize*two_to_the(icells.levmax)*
                        icells.ibasesize*two_to_the(icells.levmax);
     int *hash = (int *) malloc(hash_size * sizeof(int));
@@ -127,6 +225,7 @@ void singlewrite_remap (cell_list icells, cell_list ocells) {
     for (uint i = 0; i < icells.ncells; i++) {
         uint lev_mod = two_to_the(icells.levmax - icells.level[i]);
         hash[((icells.j[i] * lev_mod) * i_max) + (icells.i[i] * lev_mod)] = i;
+        if (diag != NULL) remap_diag_accum(ivalues[i], icells.level[i], &in_sum, &in_min, &in_max);
     }
     
     for (uint i = 0; i < ocells.ncells; i++) {
@@ -154,15 +253,144 @@ void singlewrite_remap (cell_list icells, cell_list ocells) {
             probe = hash[key];
         }
         if (lev >= icells.level[probe]) {
-            ocells.values[i] = icells.values[probe];
+            ovalues[i] = Op::split(ivalues[probe], ocells.level[i] - icells.level[probe]);
+        } else if (Op::point_sample) {
+            uint half = two_to_the(icells.levmax - lev - 1);
+            ovalues[i] = ivalues[probe_point(hash, ji + half, ii + half, icells.levmax, i_max)];
+        } else {
+            ovalues[i] = Op::result(avg_sub_cells_op<Op>(icells, ivalues, ji, ii, lev, hash));
+        }
+        if (diag != NULL) remap_diag_accum(ovalues[i], ocells.level[i], &out_sum, &out_min, &out_max);
+    }
+    free(hash);
+
+    if (diag != NULL) remap_diag_set(diag, in_sum, in_min, in_max, out_sum, out_min, out_max);
+}
+
+void singlewrite_remap (cell_list icells, cell_list ocells) {
+    singlewrite_remap_op<ReduceMean>(icells, icells.values, ocells, ocells.values);
+}
+
+// Lazy-zero variant of the singlewrite remap. The hash stores ic+1 so that
+// zero marks an empty slot and the table can come straight from calloc,
+// which hands back untouched zero pages from the OS for large allocations.
+// Only the pages that are actually written or read are ever faulted in,
+// so the full-table -1 initialization drops out on sparse meshes.
+void singlewrite_remap_lazy (cell_list icells, cell_list ocells) {
+
+    size_t hash_size = (size_t)icells.ibasesize*two_to_the(icells.levmax)*
+                       icells.ibasesize*two_to_the(icells.levmax);
+    int *hash = (int *) calloc(hash_size, sizeof(int));
+    uint max_lev = icells.levmax;
+    uint i_max = icells.ibasesize*two_to_the(max_lev);
+
+    for (uint i = 0; i < icells.ncells; i++) {
+        uint lev_mod = two_to_the(max_lev - icells.level[i]);
+        hash[((icells.j[i] * lev_mod) * i_max) + (icells.i[i] * lev_mod)] = i+1;
+    }
+
+    for (uint i = 0; i < ocells.ncells; i++) {
+        uint ii, ji, lev_mod;
+        uint io = ocells.i[i];
+        uint jo = ocells.j[i];
+        int lev = ocells.level[i];
+
+        if (lev < (int)max_lev) {
+            lev_mod = two_to_the(max_lev - lev);
+            ii = io*lev_mod;
+            ji = jo*lev_mod;
+        } else {
+            lev_mod = two_to_the(lev - max_lev);
+            ii = io/lev_mod;
+            ji = jo/lev_mod;
+        }
+
+        uint key = ji*i_max + ii;
+        int ic = hash[key] - 1;
+
+        if (lev > (int)max_lev) lev = max_lev;
+        while(ic < 0 && lev > 0) {
+            lev--;
+            uint lev_diff = max_lev - lev;
+            ii >>= lev_diff;
+            ii <<= lev_diff;
+            ji >>= lev_diff;
+            ji <<= lev_diff;
+            key = ji*i_max + ii;
+            ic = hash[key] - 1;
+        }
+        if (lev >= (int)icells.level[ic]) {
+            ocells.values[i] = icells.values[ic];
+        } else {
+            ocells.values[i] = avg_sub_cells_lazy(icells, ji, ii, lev, hash);
+        }
+    }
+    free(hash);
+}
+
+void singlewrite_remap_cached (cell_list icells, cell_list ocells, uint *nhits) {
+
+    int *hash = singlewrite_hash_build(icells);
+    uint max_lev = icells.levmax;
+    uint i_max = icells.ibasesize*two_to_the(max_lev);
+
+    probe_cache pc;
+    probe_cache_reset(&pc);
+    uint hits = 0;
+
+    for (uint i = 0; i < ocells.ncells; i++) {
+        uint ii, ji, lev_mod;
+        uint io = ocells.i[i];
+        uint jo = ocells.j[i];
+        int lev = ocells.level[i];
+
+        int ic = probe_cache_lookup(&pc, io, jo, lev);
+        if (ic >= 0) {
+            ocells.values[i] = icells.values[ic];
+            hits++;
+            continue;
+        }
+
+        if (lev < (int)max_lev) {
+            lev_mod = two_to_the(max_lev - lev);
+            ii = io*lev_mod;
+            ji = jo*lev_mod;
+        } else {
+            lev_mod = two_to_the(lev - max_lev);
+            ii = io/lev_mod;
+            ji = jo/lev_mod;
+        }
+
+        uint key = ji*i_max + ii;
+        ic = hash[key];
+
+        if (lev > (int)max_lev) lev = max_lev;
+        while(ic < 0 && lev > 0) {
+            lev--;
+            uint lev_diff = max_lev - lev;
+            ii >>= lev_diff;
+            ii <<= lev_diff;
+            ji >>= lev_diff;
+            ji <<= lev_diff;
+            key = ji*i_max + ii;
+            ic = hash[key];
+        }
+        if (lev >= (int)icells.level[ic]) {
+            ocells.values[i] = icells.values[ic];
+            probe_cache_set(&pc, ic, icells.i[ic], icells.j[ic], icells.level[ic]);
         } else {
             ocells.values[i] = avg_sub_cells(icells, ji, ii, lev, hash);
         }
     }
     free(hash);
+
+    if (nhits != NULL) *nhits = hits;
 }
 
-void singlewrite_remap_compact (cell_list icells, cell_list ocells) {
+#ifndef AMRREMAP_LIBRARY
+template <class Op>
+void singlewrite_remap_compact_op (cell_list icells, const typename Op::value_type *ivalues,
+                                   cell_list ocells, typename Op::value_type *ovalues) {
     
     uint i_max = icells.ibasesize*two_to_the(icells.levmax);
     uint j_max = icells.ibasesize*two_to_the(icells.levmax);
@@ -201,22 +429,36 @@ void singlewrite_remap_compact (cell_list icells, cell_list ocells) {
             ic = read_hash(key, hash);
         }
         if (lev >= (int)icells.level[ic]) {
-            ocells.values[i] = icells.values[ic];
+            ovalues[i] = Op::split(ivalues[ic], ocells.level[i] - icells.level[ic]);
+        } else if (Op::point_sample) {
+            uint half = two_to_the(ocells.levmax - lev - 1);
+            ovalues[i] = ivalues[probe_point_compact(hash, ji + half, ii + half, icells.levmax, i_max)];
         } else {
-            ocells.values[i] = avg_sub_cells_compact(icells, ji, ii, lev, hash);
+            ovalues[i] = Op::result(avg_sub_cells_compact_op<Op>(icells, ivalues, ji, ii, lev, hash));
         }
     }
     compact_hash_delete(hash);
 }
 
+void singlewrite_remap_compact (cell_list icells, cell_list ocells) {
+    singlewrite_remap_compact_op<ReduceMean>(icells, icells.values, ocells, ocells.values);
+}
+#endif
+
 #ifdef _OPENMP
-void singlewrite_remap_openMP (cell_list icells, cell_list ocells) {
+template <class Op>
+void singlewrite_remap_op_openMP (cell_list icells, const typename Op::value_type *ivalues,
+                                  cell_list ocells, typename Op::value_type *ovalues, remap_diag *diag) {
+
+    double in_sum = 0.0, in_min = DBL_MAX, in_max = -DBL_MAX;
+    double out_sum = 0.0, out_min = DBL_MAX, out_max = -DBL_MAX;
 
     size_t hash_size = icells.ibasesize*two_to_the(icells.levmax)*
                        icells.ibasesize*two_to_the(icells.levmax);
-    int *hash = (int *) malloc(hash_size * sizeof(int));
+    int *hash = (int *) first_touch_malloc(hash_size, sizeof(int), FIRST_TOUCH_BLOCK);
 
-#pragma omp parallel default(none) firstprivate(hash_size) shared(ocells, icells, hash)
+#pragma omp parallel default(none) firstprivate(hash_size) shared(ocells, icells, hash, ivalues, ovalues, diag) \
+    shared(in_sum, in_min, in_max, out_sum, out_min, out_max)
     {
         uint ilength = icells.ncells;
         uint olength = ocells.ncells;
@@ -229,13 +471,14 @@ void singlewrite_remap_openMP (cell_list icells, cell_list ocells) {
             hash[i] = -1;
         }
     
-#pragma omp for
+#pragma omp for reduction(+:in_sum) reduction(min:in_min) reduction(max:in_max)
         for (uint i = 0; i < ilength; i++) {
             uint lev_mod = two_to_the(max_lev - icells.level[i]);
             hash[((icells.j[i] * lev_mod) * i_max) + (icells.i[i] * lev_mod)] = i;
+            if (diag != NULL) remap_diag_accum(ivalues[i], icells.level[i], &in_sum, &in_min, &in_max);
         }
     
-#pragma omp for
+#pragma omp for reduction(+:out_sum) reduction(min:out_min) reduction(max:out_max)
         for (uint i = 0; i < olength; i++) {
             uint ii, ji, lev_mod;
             uint io = ocells.i[i];
@@ -255,6 +498,145 @@ void singlewrite_remap_openMP (cell_list icells, cell_list ocells) {
             uint key = ji*i_max + ii;
             int ic = hash[key];
 
+            if (lev > (int)max_lev) lev = max_lev;
+            while(ic < 0 && lev > 0) {
+                lev--;
+                uint lev_diff = max_lev - lev;
+                ii >>= lev_diff;
+                ii <<= lev_diff;
+                ji >>= lev_diff;
+                ji <<= lev_diff;
+                key = ji*i_max + ii;
+                ic = hash[key];
+            }
+            if (lev >= (int)icells.level[ic]) {
+                ovalues[i] = Op::split(ivalues[ic], ocells.level[i] - icells.level[ic]);
+            } else if (Op::point_sample) {
+                uint half = two_to_the(max_lev - lev - 1);
+                ovalues[i] = ivalues[probe_point(hash, ji + half, ii + half, max_lev, i_max)];
+            } else {
+                ovalues[i] = Op::result(avg_sub_cells_op<Op>(icells, ivalues, ji, ii, lev, hash));
+            }
+            if (diag != NULL) remap_diag_accum(ovalues[i], ocells.level[i], &out_sum, &out_min, &out_max);
+        }
+    }
+    free(hash);
+
+    if (diag != NULL) remap_diag_set(diag, in_sum, in_min, in_max, out_sum, out_min, out_max);
+}
+
+void singlewrite_remap_openMP (cell_list icells, cell_list ocells) {
+    singlewrite_remap_op_openMP<ReduceMean>(icells, icells.values, ocells, ocells.values);
+}
+
+// OpenMP version of the lazy-zero singlewrite remap. There is no parallel
+// initialization pass, so pages are first touched by the thread that
+// inserts the input cells landing on them.
+void singlewrite_remap_lazy_openMP (cell_list icells, cell_list ocells) {
+
+    size_t hash_size = (size_t)icells.ibasesize*two_to_the(icells.levmax)*
+                       icells.ibasesize*two_to_the(icells.levmax);
+    int *hash = (int *) calloc(hash_size, sizeof(int));
+
+#pragma omp parallel default(none) shared(ocells, icells, hash)
+    {
+        uint ilength = icells.ncells;
+        uint olength = ocells.ncells;
+        uint max_lev = icells.levmax;
+
+        uint i_max = icells.ibasesize*two_to_the(max_lev);
+
+#pragma omp for
+        for (uint i = 0; i < ilength; i++) {
+            uint lev_mod = two_to_the(max_lev - icells.level[i]);
+            hash[((icells.j[i] * lev_mod) * i_max) + (icells.i[i] * lev_mod)] = i+1;
+        }
+
+#pragma omp for
+        for (uint i = 0; i < olength; i++) {
+            uint ii, ji, lev_mod;
+            uint io = ocells.i[i];
+            uint jo = ocells.j[i];
+            int lev = ocells.level[i];
+
+            if (lev < (int)max_lev) {
+                lev_mod = two_to_the(max_lev - lev);
+                ii = io*lev_mod;
+                ji = jo*lev_mod;
+            } else {
+                lev_mod = two_to_the(lev - max_lev);
+                ii = io/lev_mod;
+                ji = jo/lev_mod;
+            }
+
+            uint key = ji*i_max + ii;
+            int ic = hash[key] - 1;
+
+            if (lev > (int)max_lev) lev = max_lev;
+            while(ic < 0 && lev > 0) {
+                lev--;
+                uint lev_diff = max_lev - lev;
+                ii >>= lev_diff;
+                ii <<= lev_diff;
+                ji >>= lev_diff;
+                ji <<= lev_diff;
+                key = ji*i_max + ii;
+                ic = hash[key] - 1;
+            }
+            if (lev >= (int)icells.level[ic]) {
+                ocells.values[i] = icells.values[ic];
+            } else {
+                ocells.values[i] = avg_sub_cells_lazy(icells, ji, ii, lev, hash);
+            }
+        }
+    }
+    free(hash);
+}
+
+void singlewrite_remap_cached_openMP (cell_list icells, cell_list ocells, uint *nhits) {
+
+    int *hash = singlewrite_hash_build_openMP(icells);
+    uint hits = 0;
+
+#pragma omp parallel default(none) shared(ocells, icells, hash) reduction(+:hits)
+    {
+        uint olength = ocells.ncells;
+        uint max_lev = icells.levmax;
+
+        uint i_max = icells.ibasesize*two_to_the(max_lev);
+
+        // Each thread keeps its own memo so a static schedule hands it a
+        // contiguous, spatially coherent run of output cells
+        probe_cache pc;
+        probe_cache_reset(&pc);
+
+#pragma omp for schedule(static)
+        for (uint i = 0; i < olength; i++) {
+            uint ii, ji, lev_mod;
+            uint io = ocells.i[i];
+            uint jo = ocells.j[i];
+            int lev = ocells.level[i];
+
+            int ic = probe_cache_lookup(&pc, io, jo, lev);
+            if (ic >= 0) {
+                ocells.values[i] = icells.values[ic];
+                hits++;
+                continue;
+            }
+
+            if (lev < (int)max_lev) {
+                lev_mod = two_to_the(max_lev - lev);
+                ii = io*lev_mod;
+                ji = jo*lev_mod;
+            } else {
+                lev_mod = two_to_the(lev - max_lev);
+                ii = io/lev_mod;
+                ji = jo/lev_mod;
+            }
+
+            uint key = ji*i_max + ii;
+            ic = hash[key];
+
             if (lev > (int)max_lev) lev = max_lev;
             while(ic < 0 && lev > 0) {
                 lev--;
@@ -268,15 +650,21 @@ void singlewrite_remap_openMP (cell_list icells, cell_list ocells) {
             }
             if (lev >= (int)icells.level[ic]) {
                 ocells.values[i] = icells.values[ic];
+                probe_cache_set(&pc, ic, icells.i[ic], icells.j[ic], icells.level[ic]);
             } else {
                 ocells.values[i] = avg_sub_cells(icells, ji, ii, lev, hash);
             }
         }
     }
     free(hash);
+
+    if (nhits != NULL) *nhits = hits;
 }
 
-void singlewrite_remap_compact_openMP (cell_list icells, cell_list ocells) {
+#ifndef AMRREMAP_LIBRARY
+template <class Op>
+void singlewrite_remap_compact_op_openMP (cell_list icells, const typename Op::value_type *ivalues,
+                                          cell_list ocells, typename Op::value_type *ovalues) {
     
     uint i_max = icells.ibasesize*two_to_the(icells.levmax);
     uint j_max = icells.ibasesize*two_to_the(icells.levmax);
@@ -288,9 +676,9 @@ void singlewrite_remap_compact_openMP (cell_list icells, cell_list ocells) {
 #endif
 
 #ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
-#pragma omp parallel default(none) firstprivate(i_max, j_max) shared(write_hash_openmp, read_hash) shared(ocells, icells, hash)
+#pragma omp parallel default(none) firstprivate(i_max, j_max) shared(write_hash_openmp, read_hash) shared(ocells, icells, hash, ivalues, ovalues)
 #else
-#pragma omp parallel default(none) firstprivate(i_max, j_max) shared(write_hash_openmp, read_hash) shared(ocells, icells, hash, lock)
+#pragma omp parallel default(none) firstprivate(i_max, j_max) shared(write_hash_openmp, read_hash) shared(ocells, icells, hash, lock, ivalues, ovalues)
 #endif
     {
         uint ilength = icells.ncells;
@@ -356,9 +744,12 @@ void singlewrite_remap_compact_openMP (cell_list icells, cell_list ocells) {
                 ic = read_hash(key, hash);
             }
             if (lev >= (int)icells.level[ic]) {
-                ocells.values[i] = icells.values[ic];
+                ovalues[i] = Op::split(ivalues[ic], ocells.level[i] - icells.level[ic]);
+            } else if (Op::point_sample) {
+                uint half = two_to_the(max_lev - lev - 1);
+                ovalues[i] = ivalues[probe_point_compact(hash, ji + half, ii + half, max_lev, i_max)];
             } else {
-                ocells.values[i] = avg_sub_cells_compact(icells, ji, ii, lev, hash);
+                ovalues[i] = Op::result(avg_sub_cells_compact_op<Op>(icells, ivalues, ji, ii, lev, hash));
             }
             //printf("%i\t%i\t%i\t%f\n", ocells[i].i, ocells[i].j, ocells[i].lev, ocells[i].values);
             //print_cell(ocells[i]);
@@ -372,4 +763,63 @@ void singlewrite_remap_compact_openMP (cell_list icells, cell_list ocells) {
     compact_hash_delete_openmp(hash, lock);
 #endif
 }
+
+void singlewrite_remap_compact_openMP (cell_list icells, cell_list ocells) {
+    singlewrite_remap_compact_op_openMP<ReduceMean>(icells, icells.values, ocells, ocells.values);
+}
+#endif
+#endif
+
+#define INSTANTIATE_SINGLEWRITE_OP(Op) \
+template void singlewrite_remap_op<Op> (cell_list icells, const Op::value_type *ivalues, \
+                                        cell_list ocells, Op::value_type *ovalues, remap_diag *diag);
+#define INSTANTIATE_SINGLEWRITE_OP_OPENMP(Op) \
+template void singlewrite_remap_op_openMP<Op> (cell_list icells, const Op::value_type *ivalues, \
+                                               cell_list ocells, Op::value_type *ovalues, remap_diag *diag);
+
+INSTANTIATE_SINGLEWRITE_OP(ReduceMean)
+INSTANTIATE_SINGLEWRITE_OP(ReduceMeanFloat)
+INSTANTIATE_SINGLEWRITE_OP(ReduceSum)
+INSTANTIATE_SINGLEWRITE_OP(ReduceMin)
+INSTANTIATE_SINGLEWRITE_OP(ReduceMax)
+INSTANTIATE_SINGLEWRITE_OP(ReduceVolumeWeighted)
+INSTANTIATE_SINGLEWRITE_OP(ReduceMajority)
+INSTANTIATE_SINGLEWRITE_OP(ReduceNearest)
+#ifdef _OPENMP
+INSTANTIATE_SINGLEWRITE_OP_OPENMP(ReduceMean)
+INSTANTIATE_SINGLEWRITE_OP_OPENMP(ReduceMeanFloat)
+INSTANTIATE_SINGLEWRITE_OP_OPENMP(ReduceSum)
+INSTANTIATE_SINGLEWRITE_OP_OPENMP(ReduceMin)
+INSTANTIATE_SINGLEWRITE_OP_OPENMP(ReduceMax)
+INSTANTIATE_SINGLEWRITE_OP_OPENMP(ReduceVolumeWeighted)
+INSTANTIATE_SINGLEWRITE_OP_OPENMP(ReduceMajority)
+INSTANTIATE_SINGLEWRITE_OP_OPENMP(ReduceNearest)
+#endif
+
+#ifndef AMRREMAP_LIBRARY
+#define INSTANTIATE_SINGLEWRITE_COMPACT_OP(Op) \
+template void singlewrite_remap_compact_op<Op> (cell_list icells, const Op::value_type *ivalues, \
+                                                cell_list ocells, Op::value_type *ovalues);
+#define INSTANTIATE_SINGLEWRITE_COMPACT_OP_OPENMP(Op) \
+template void singlewrite_remap_compact_op_openMP<Op> (cell_list icells, const Op::value_type *ivalues, \
+                                                       cell_list ocells, Op::value_type *ovalues);
+
+INSTANTIATE_SINGLEWRITE_COMPACT_OP(ReduceMean)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP(ReduceMeanFloat)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP(ReduceSum)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP(ReduceMin)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP(ReduceMax)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP(ReduceVolumeWeighted)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP(ReduceMajority)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP(ReduceNearest)
+#ifdef _OPENMP
+INSTANTIATE_SINGLEWRITE_COMPACT_OP_OPENMP(ReduceMean)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP_OPENMP(ReduceMeanFloat)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP_OPENMP(ReduceSum)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP_OPENMP(ReduceMin)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP_OPENMP(ReduceMax)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP_OPENMP(ReduceVolumeWeighted)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP_OPENMP(ReduceMajority)
+INSTANTIATE_SINGLEWRITE_COMPACT_OP_OPENMP(ReduceNearest)
+#endif
 #endif
@@ -32,10 +32,26 @@
 #define SINGLEWRITE_REMAP_H
 
 #include "meshgen/meshgen.h"
+#include "reduction_ops.h"
+#include "remap_diag.h"
 
 void singlewrite_remap (cell_list icells, cell_list ocells);
 void singlewrite_remap_openMP (cell_list icells, cell_list ocells);
 void singlewrite_remap_compact (cell_list icells, cell_list ocells);
 void singlewrite_remap_compact_openMP (cell_list icells, cell_list ocells);
+template <class Op> void singlewrite_remap_compact_op (cell_list icells, const typename Op::value_type *ivalues,
+                                                       cell_list ocells, typename Op::value_type *ovalues);
+template <class Op> void singlewrite_remap_compact_op_openMP (cell_list icells, const typename Op::value_type *ivalues,
+                                                              cell_list ocells, typename Op::value_type *ovalues);
+template <class Op> void singlewrite_remap_op (cell_list icells, const typename Op::value_type *ivalues,
+                                               cell_list ocells, typename Op::value_type *ovalues,
+                                               remap_diag *diag = NULL);
+template <class Op> void singlewrite_remap_op_openMP (cell_list icells, const typename Op::value_type *ivalues,
+                                                      cell_list ocells, typename Op::value_type *ovalues,
+                                                      remap_diag *diag = NULL);
+void singlewrite_remap_lazy (cell_list icells, cell_list ocells);
+void singlewrite_remap_lazy_openMP (cell_list icells, cell_list ocells);
+void singlewrite_remap_cached (cell_list icells, cell_list ocells, uint *nhits);
+void singlewrite_remap_cached_openMP (cell_list icells, cell_list ocells, uint *nhits);
 
 #endif
@@ -0,0 +1,336 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "meshgen/meshgen.h"
+#include "amrex_plotfile.h"
+#include "tiled_remap.h"
+#include "stream_remap.h"
+#include "timer.h"
+
+#define NUM_STREAM_BUFFERS 2
+#define STREAM_PATH_MAX 4096
+
+typedef struct {
+    cell_list cells;    // ncells 0 when the read failed
+    int full;
+} dump_slot;
+
+typedef struct {
+    double *values;
+    uint dump;
+    int full;
+} value_slot;
+
+typedef struct {
+    const char **files;
+    uint nfiles;
+    const char *component;
+    const char *outdir;
+    cell_list ocells;
+    stream_stats *stats;
+    int threaded;
+    tiled_plan *plan;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  changed;    // a slot was filled or emptied
+    dump_slot  in[NUM_STREAM_BUFFERS];
+    value_slot out[NUM_STREAM_BUFFERS];
+    uint nqueued;               // results handed to the writer
+    int  remap_done;            // no more results will be queued
+} stream_state;
+
+// Private functions to this file
+static cell_list read_dump(stream_state *s, uint d);
+static int dump_fits(stream_state *s, cell_list icells, uint d);
+static void remap_dump(stream_state *s, cell_list icells, double *values);
+static void write_result(stream_state *s, const double *values, uint d);
+static void *reader_main(void *arg);
+static void *writer_main(void *arg);
+
+static cell_list read_dump(stream_state *s, uint d) {
+    struct timeval timer;
+    cpu_timer_start(&timer);
+    cell_list c = read_amrex_plotfile(s->files[d], s->component);
+    s->stats->read_time += cpu_timer_stop(timer);
+    return c;
+}
+
+static int dump_fits(stream_state *s, cell_list icells, uint d) {
+    if (icells.ncells == 0) {
+        printf("Skipping dump %s, it could not be read\n", s->files[d]);
+        return 0;
+    }
+    if (icells.ibasesize != s->ocells.ibasesize || icells.levmax < s->ocells.levmax) {
+        printf("Skipping dump %s, base mesh %u with %u levels does not fit the output mesh %u with %u levels\n",
+               s->files[d], icells.ibasesize, icells.levmax, s->ocells.ibasesize, s->ocells.levmax);
+        return 0;
+    }
+    return 1;
+}
+
+// Only called from the thread driving the series
+static void remap_dump(stream_state *s, cell_list icells, double *values) {
+    struct timeval timer;
+    cpu_timer_start(&timer);
+
+    cell_list ocells = s->ocells;
+    ocells.values = values;
+#ifdef _OPENMP
+    if (s->threaded) {
+        if (s->plan == NULL) s->plan = tiled_plan_create_openMP(ocells, icells.ibasesize, icells.levmax);
+        h_remap_tiled_plan_openMP(icells, ocells, s->plan);
+    } else
+#endif
+    {
+        if (s->plan == NULL) s->plan = tiled_plan_create(ocells, icells.ibasesize, icells.levmax);
+        h_remap_tiled_plan(icells, ocells, s->plan);
+    }
+
+    s->stats->remap_time += cpu_timer_stop(timer);
+}
+
+// Results are written in dump order, so the checksum does not depend on
+// whether the series is pipelined
+static void write_result(stream_state *s, const double *values, uint d) {
+    struct timeval timer;
+    cpu_timer_start(&timer);
+
+    uint ncells = s->ocells.ncells;
+    double sum = 0.0;
+    for (uint n = 0; n < ncells; n++) {
+        sum += values[n];
+    }
+    s->stats->checksum += sum;
+
+    if (s->outdir != NULL) {
+        // the last component of the dump path, without trailing slashes
+        const char *name = s->files[d];
+        size_t len = strlen(name);
+        while (len > 1 && name[len-1] == '/') len--;
+        size_t first = len;
+        while (first > 0 && name[first-1] != '/') first--;
+
+        char path[STREAM_PATH_MAX];
+        snprintf(path, STREAM_PATH_MAX, "%s/%.*s.remap", s->outdir, (int)(len-first), name+first);
+        FILE *fp = fopen(path, "wb");
+        if (fp == NULL) {
+            printf("Could not open %s for the remap of dump %s\n", path, s->files[d]);
+        } else {
+            if (fwrite(&ncells, sizeof(uint), 1, fp) != 1 ||
+                fwrite(values, sizeof(double), ncells, fp) != ncells) {
+                printf("Could not write %s\n", path);
+            }
+            fclose(fp);
+        }
+    }
+
+    s->stats->write_time += cpu_timer_stop(timer);
+}
+
+// The reader is a plain pthread, so nothing it calls may start OpenMP work
+// that would compete with the remap team: it uses the serial plotfile
+// reader, whose cell lists come from create_cell_list without a first
+// touch policy, and the pages land where the reader fills them
+static void *reader_main(void *arg) {
+    stream_state *s = (stream_state *)arg;
+
+    for (uint d = 0; d < s->nfiles; d++) {
+        dump_slot *slot = &s->in[d % NUM_STREAM_BUFFERS];
+
+        pthread_mutex_lock(&s->lock);
+        while (slot->full) {
+            pthread_cond_wait(&s->changed, &s->lock);
+        }
+        pthread_mutex_unlock(&s->lock);
+
+        cell_list c = read_dump(s, d);
+
+        pthread_mutex_lock(&s->lock);
+        slot->cells = c;
+        slot->full = 1;
+        pthread_cond_broadcast(&s->changed);
+        pthread_mutex_unlock(&s->lock);
+    }
+    return NULL;
+}
+
+static void *writer_main(void *arg) {
+    stream_state *s = (stream_state *)arg;
+
+    for (uint w = 0; ; w++) {
+        value_slot *slot = &s->out[w % NUM_STREAM_BUFFERS];
+
+        pthread_mutex_lock(&s->lock);
+        while (! slot->full && ! (s->remap_done && w == s->nqueued)) {
+            pthread_cond_wait(&s->changed, &s->lock);
+        }
+        int more = slot->full;
+        pthread_mutex_unlock(&s->lock);
+        if (! more) break;
+
+        write_result(s, slot->values, slot->dump);
+
+        pthread_mutex_lock(&s->lock);
+        slot->full = 0;
+        pthread_cond_broadcast(&s->changed);
+        pthread_mutex_unlock(&s->lock);
+    }
+    return NULL;
+}
+
+static void stream_remap_run(const char **files, uint nfiles, const char *component, cell_list ocells,
+                             const char *outdir, int pipelined, stream_stats *stats, int threaded) {
+    struct timeval total_timer, timer;
+    cpu_timer_start(&total_timer);
+
+    memset(stats, 0, sizeof(stream_stats));
+
+    stream_state s;
+    memset(&s, 0, sizeof(s));
+    s.files     = files;
+    s.nfiles    = nfiles;
+    s.component = component;
+    s.outdir    = outdir;
+    s.ocells    = ocells;
+    s.stats     = stats;
+    s.threaded  = threaded;
+    s.plan      = NULL;
+    for (int b = 0; b < NUM_STREAM_BUFFERS; b++) {
+        s.out[b].values = (double *)malloc((ocells.ncells > 0 ? ocells.ncells : 1)*sizeof(double));
+    }
+    const double *last = NULL;
+
+    if (! pipelined) {
+        for (uint d = 0; d < nfiles; d++) {
+            cell_list icells = read_dump(&s, d);
+            if (dump_fits(&s, icells, d)) {
+                remap_dump(&s, icells, s.out[0].values);
+                write_result(&s, s.out[0].values, d);
+                last = s.out[0].values;
+                stats->ndumps++;
+            } else {
+                stats->nskipped++;
+            }
+            destroy(icells);
+            free(icells.dist);
+        }
+    } else {
+        pthread_mutex_init(&s.lock, NULL);
+        pthread_cond_init(&s.changed, NULL);
+
+        pthread_t reader, writer;
+        pthread_create(&reader, NULL, reader_main, &s);
+        pthread_create(&writer, NULL, writer_main, &s);
+
+        for (uint d = 0; d < nfiles; d++) {
+            dump_slot *in = &s.in[d % NUM_STREAM_BUFFERS];
+
+            pthread_mutex_lock(&s.lock);
+            cpu_timer_start(&timer);
+            while (! in->full) {
+                pthread_cond_wait(&s.changed, &s.lock);
+            }
+            stats->read_wait += cpu_timer_stop(timer);
+            cell_list icells = in->cells;
+            pthread_mutex_unlock(&s.lock);
+
+            if (dump_fits(&s, icells, d)) {
+                value_slot *out = &s.out[s.nqueued % NUM_STREAM_BUFFERS];
+
+                pthread_mutex_lock(&s.lock);
+                cpu_timer_start(&timer);
+                while (out->full) {
+                    pthread_cond_wait(&s.changed, &s.lock);
+                }
+                stats->write_wait += cpu_timer_stop(timer);
+                pthread_mutex_unlock(&s.lock);
+
+                remap_dump(&s, icells, out->values);
+                last = out->values;
+                stats->ndumps++;
+
+                pthread_mutex_lock(&s.lock);
+                out->dump = d;
+                out->full = 1;
+                s.nqueued++;
+                pthread_cond_broadcast(&s.changed);
+                pthread_mutex_unlock(&s.lock);
+            } else {
+                stats->nskipped++;
+            }
+
+            destroy(icells);
+            free(icells.dist);
+
+            pthread_mutex_lock(&s.lock);
+            in->full = 0;
+            pthread_cond_broadcast(&s.changed);
+            pthread_mutex_unlock(&s.lock);
+        }
+
+        pthread_mutex_lock(&s.lock);
+        s.remap_done = 1;
+        pthread_cond_broadcast(&s.changed);
+        pthread_mutex_unlock(&s.lock);
+
+        pthread_join(reader, NULL);
+        pthread_join(writer, NULL);
+
+        pthread_cond_destroy(&s.changed);
+        pthread_mutex_destroy(&s.lock);
+    }
+
+    if (last != NULL) memcpy(ocells.values, last, ocells.ncells*sizeof(double));
+
+    for (int b = 0; b < NUM_STREAM_BUFFERS; b++) {
+        free(s.out[b].values);
+    }
+    if (s.plan != NULL) tiled_plan_destroy(s.plan);
+
+    stats->total_time = cpu_timer_stop(total_timer);
+}
+
+void stream_remap (const char **files, uint nfiles, const char *component, cell_list ocells,
+                   const char *outdir, int pipelined, stream_stats *stats) {
+    stream_remap_run(files, nfiles, component, ocells, outdir, pipelined, stats, 0);
+}
+
+#ifdef _OPENMP
+void stream_remap_openMP (const char **files, uint nfiles, const char *component, cell_list ocells,
+                          const char *outdir, int pipelined, stream_stats *stats) {
+    stream_remap_run(files, nfiles, component, ocells, outdir, pipelined, stats, 1);
+}
+#endif
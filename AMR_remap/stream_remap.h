@@ -0,0 +1,71 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#ifndef STREAM_REMAP_H
+#define STREAM_REMAP_H
+
+#include "meshgen/meshgen.h"
+
+// Remaps a time series of AMReX plotfile dumps onto one fixed output mesh.
+// With pipelined set, a reader thread reads the next dump while the calling
+// thread remaps the current one, and a writer thread writes the result of
+// the previous one, so the series runs at the speed of the slowest of the
+// three. Two dumps and two output value buffers are in flight at a time.
+// The output side, the cell coordinates and the tiled_plan of the tiled
+// remap, is set up once for the whole series. Without pipelined the same
+// steps run one after another on the calling thread.
+//
+// Dumps that cannot be read, or whose base mesh or levels do not fit the
+// output mesh, are skipped with a message. When outdir is not NULL the
+// values of each dump go to <outdir>/<dump name>.remap, the cell count as
+// a uint followed by the doubles in output cell order. On return
+// ocells.values holds the values of the last dump remapped.
+
+typedef struct {
+    uint   ndumps;       // dumps remapped
+    uint   nskipped;     // dumps skipped
+    double read_time;    // time spent reading dumps
+    double remap_time;   // time spent remapping, with the plan setup
+    double write_time;   // time spent writing results
+    double read_wait;    // time the remap waited on the reader
+    double write_wait;   // time the remap waited for a free output buffer
+    double total_time;
+    double checksum;     // sum of the remapped values over all dumps
+} stream_stats;
+
+void stream_remap (const char **files, uint nfiles, const char *component, cell_list ocells,
+                   const char *outdir, int pipelined, stream_stats *stats);
+#ifdef _OPENMP
+void stream_remap_openMP (const char **files, uint nfiles, const char *component, cell_list ocells,
+                          const char *outdir, int pipelined, stream_stats *stats);
+#endif
+
+#endif
@@ -0,0 +1,866 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "meshgen/meshgen.h"
+#include "HashFactory/HashFactory.h"
+#include "simplehash/simplehash.h"
+#include "hierarchical_remap.h"
+#include "task_remap.h"
+
+#define HASH_TYPE (LCG_QUADRATIC_OPEN_COMPACT_HASH_ID)
+#ifdef _OPENMP
+#define HASH_OPENMP_TYPE (LCG_QUADRATIC_OPEN_COMPACT_OPENMP_HASH_ID | IDENTITY_SENTINEL_PERFECT_OPENMP_HASH_ID)
+#endif
+#define HASH_LOAD_FACTOR 0.3333333
+
+#define DEQUE_SIZE 4096          // a power of two; a full deque runs new tasks in place
+#define CALLER_SLOTS 8           // deques for threads from outside the pool
+#define STEAL_ROUNDS 64          // passes over the deques before a worker sleeps
+#define POOL_GRAIN 256           // cells run between checks for waiting thieves
+#define CHUNKS_PER_THREAD 8      // OpenMP task chunks per thread
+#define AVG_SPLIT_LEVELS 3       // averaging this many levels deep or less runs as one task
+
+// The thread running a task. It is NULL under OpenMP tasks, where the
+// runtime does the stealing, and has no deque when a remap runs in place
+// on a caller the pool has no room for.
+typedef struct task_ctx task_ctx;
+typedef void (*task_fn)(task_ctx *ctx, void *arg, uint lo, uint hi);
+
+typedef struct {
+    task_fn fn;
+    void *arg;
+    uint lo, hi;
+    int *pending;    // unfinished children of the spawning task
+} task;
+
+// The owner pushes and pops at the bottom, thieves take the oldest and
+// largest tasks from the top
+typedef struct {
+    pthread_mutex_t lock;
+    task buf[DEQUE_SIZE];
+    uint top, bottom;
+    volatile int count;
+} task_deque;
+
+struct task_ctx {
+    task_pool *pool;
+    task_deque *deque;
+    uint id;
+    uint seed;
+};
+
+struct task_pool {
+    uint nthreads;
+    uint nslots;            // the worker deques, then the caller deques
+    pthread_t *threads;
+    task_deque *deque;
+    task_ctx *ctx;
+    int *slot_busy;
+    pthread_mutex_t lock;
+    pthread_cond_t  work_ready;
+    volatile int nsleeping;
+    volatile int queued;    // tasks in all of the deques
+    int shutdown;
+};
+
+// Set while a thread works in a pool, so a remap called from a task joins
+// the pool in place instead of claiming a new deque
+static __thread task_ctx *current_ctx = NULL;
+
+typedef struct task_remap_job task_remap_job;
+
+// The input cell at exactly (i, j, lev), or -1 where the input mesh is finer
+typedef int (*task_probe_fn)(task_remap_job *job, uint i, uint j, uint lev);
+// The input cell holding the output cell (i, j, lev), or -1 where the input
+// mesh is finer
+typedef int (*task_locate_fn)(task_remap_job *job, uint i, uint j, uint lev);
+typedef void (*task_run_fn)(task_ctx *ctx, task_remap_job *job);
+
+struct task_remap_job {
+    cell_list icells;
+    cell_list ocells;
+    task_probe_fn probe;
+    task_locate_fn locate;
+    // hierarchical remaps
+    int **h_hash;
+    intintHash_Table **h_hashTable;
+    uint *num_at_level;
+    intintHash_Factory *factory;
+    int hash_type;
+    int concurrent;      // the tables take concurrent inserts
+    // full perfect and single-write remaps, on the finest level
+    int *hash;
+    uint i_max;
+    int compact;         // hash is a simplehash table
+};
+
+// Range of a parallel loop with the body run on each chunk
+typedef struct {
+    task_fn body;
+    void *arg;
+    uint grain;
+} task_range;
+
+// A child of a coarse output cell whose average is split over subtasks
+typedef struct {
+    task_remap_job *job;
+    uint i, j, lev;
+    double sum;
+} task_avg_part;
+
+// Private functions to this file
+static int deque_push(task_deque *d, task t);
+static int deque_pop(task_deque *d, task *t);
+static int deque_steal(task_deque *d, task *t);
+static int find_task(task_ctx *ctx, task *t);
+static void run_task(task_ctx *ctx, task *t);
+static void task_spawn(task_ctx *ctx, task_fn fn, void *arg, uint lo, uint hi, int *pending);
+static void task_join(task_ctx *ctx, int *pending);
+static void *worker_main(void *arg);
+static void range_task(task_ctx *ctx, void *arg, uint lo, uint hi);
+static void task_for(task_ctx *ctx, task_fn body, void *arg, uint n);
+static void avg_part_task(task_ctx *ctx, void *arg, uint lo, uint hi);
+static double task_avg(task_ctx *ctx, task_remap_job *job, uint i, uint j, uint lev);
+
+static int deque_push(task_deque *d, task t) {
+    pthread_mutex_lock(&d->lock);
+    if (d->count == DEQUE_SIZE) {
+        pthread_mutex_unlock(&d->lock);
+        return 0;
+    }
+    d->buf[d->bottom % DEQUE_SIZE] = t;
+    d->bottom++;
+    d->count++;
+    pthread_mutex_unlock(&d->lock);
+    return 1;
+}
+
+static int deque_pop(task_deque *d, task *t) {
+    if (d->count == 0) return 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->count == 0) {
+        pthread_mutex_unlock(&d->lock);
+        return 0;
+    }
+    d->bottom--;
+    *t = d->buf[d->bottom % DEQUE_SIZE];
+    d->count--;
+    pthread_mutex_unlock(&d->lock);
+    return 1;
+}
+
+static int deque_steal(task_deque *d, task *t) {
+    if (d->count == 0) return 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->count == 0) {
+        pthread_mutex_unlock(&d->lock);
+        return 0;
+    }
+    *t = d->buf[d->top % DEQUE_SIZE];
+    d->top++;
+    d->count--;
+    pthread_mutex_unlock(&d->lock);
+    return 1;
+}
+
+// The newest task of this thread, or else the oldest task of another,
+// starting from a random victim
+static int find_task(task_ctx *ctx, task *t) {
+    task_pool *pool = ctx->pool;
+
+    int found = deque_pop(ctx->deque, t);
+    if (! found) {
+        ctx->seed = ctx->seed*1103515245 + 12345;
+        uint start = (ctx->seed >> 16) % pool->nslots;
+        for (uint k = 0; k < pool->nslots && ! found; k++) {
+            uint victim = (start + k) % pool->nslots;
+            if (victim != ctx->id) found = deque_steal(&pool->deque[victim], t);
+        }
+    }
+    if (found) __sync_fetch_and_sub(&pool->queued, 1);
+    return found;
+}
+
+static void run_task(task_ctx *ctx, task *t) {
+    t->fn(ctx, t->arg, t->lo, t->hi);
+    __sync_fetch_and_sub(t->pending, 1);
+}
+
+static void task_spawn(task_ctx *ctx, task_fn fn, void *arg, uint lo, uint hi, int *pending) {
+    if (ctx == NULL) {
+#ifdef _OPENMP
+#pragma omp task firstprivate(fn, arg, lo, hi)
+#endif
+        fn(NULL, arg, lo, hi);
+        return;
+    }
+    if (ctx->deque == NULL) {
+        fn(ctx, arg, lo, hi);
+        return;
+    }
+
+    task_pool *pool = ctx->pool;
+    task t;
+    t.fn      = fn;
+    t.arg     = arg;
+    t.lo      = lo;
+    t.hi      = hi;
+    t.pending = pending;
+
+    // counted before the push so a sleeping worker cannot miss it
+    __sync_fetch_and_add(pending, 1);
+    __sync_fetch_and_add(&pool->queued, 1);
+    if (! deque_push(ctx->deque, t)) {
+        __sync_fetch_and_sub(&pool->queued, 1);
+        run_task(ctx, &t);
+        return;
+    }
+    if (pool->nsleeping > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->work_ready);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// Runs other tasks, its own children first, until the children are done
+static void task_join(task_ctx *ctx, int *pending) {
+    if (ctx == NULL) {
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+        return;
+    }
+
+    while (*(volatile int *)pending > 0) {
+        task t;
+        if (find_task(ctx, &t)) {
+            run_task(ctx, &t);
+        } else {
+            sched_yield();
+        }
+    }
+    __sync_synchronize();
+}
+
+static void *worker_main(void *arg) {
+    task_ctx *ctx = (task_ctx *)arg;
+    task_pool *pool = ctx->pool;
+    current_ctx = ctx;
+
+    for (;;) {
+        task t;
+        int found = 0;
+        for (int r = 0; r < STEAL_ROUNDS && ! found; r++) {
+            found = find_task(ctx, &t);
+            if (! found) sched_yield();
+        }
+        if (found) {
+            run_task(ctx, &t);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        __sync_fetch_and_add(&pool->nsleeping, 1);
+        while (pool->queued <= 0 && ! pool->shutdown) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        __sync_fetch_and_sub(&pool->nsleeping, 1);
+        int quit = pool->shutdown && pool->queued <= 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (quit) break;
+    }
+    return NULL;
+}
+
+task_pool *task_pool_create(uint nthreads) {
+    task_pool *pool = (task_pool *)malloc(sizeof(task_pool));
+
+    pool->nthreads  = nthreads;
+    pool->nslots    = nthreads + CALLER_SLOTS;
+    pool->nsleeping = 0;
+    pool->queued    = 0;
+    pool->shutdown  = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+
+    pool->deque     = (task_deque *)malloc(pool->nslots*sizeof(task_deque));
+    pool->ctx       = (task_ctx *)malloc(pool->nslots*sizeof(task_ctx));
+    pool->slot_busy = (int *)calloc(pool->nslots, sizeof(int));
+    for (uint s = 0; s < pool->nslots; s++) {
+        pthread_mutex_init(&pool->deque[s].lock, NULL);
+        pool->deque[s].top    = 0;
+        pool->deque[s].bottom = 0;
+        pool->deque[s].count  = 0;
+        pool->ctx[s].pool  = pool;
+        pool->ctx[s].deque = &pool->deque[s];
+        pool->ctx[s].id    = s;
+        pool->ctx[s].seed  = s + 1;
+    }
+
+    pool->threads = (pthread_t *)malloc((nthreads > 0 ? nthreads : 1)*sizeof(pthread_t));
+    for (uint t = 0; t < nthreads; t++) {
+        pool->slot_busy[t] = 1;
+        pthread_create(&pool->threads[t], NULL, worker_main, &pool->ctx[t]);
+    }
+    return pool;
+}
+
+// No remap may still be running in the pool
+void task_pool_destroy(task_pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (uint t = 0; t < pool->nthreads; t++) {
+        pthread_join(pool->threads[t], NULL);
+    }
+    free(pool->threads);
+
+    for (uint s = 0; s < pool->nslots; s++) {
+        pthread_mutex_destroy(&pool->deque[s].lock);
+    }
+    free(pool->deque);
+    free(pool->ctx);
+    free(pool->slot_busy);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    free(pool);
+}
+
+// Runs a chunk of grain cells at a time. Under the pool, whenever the deque
+// of this thread runs dry other threads may be looking for work, so the
+// rest of the range is halved and the upper half left for them to steal.
+// The chunks stolen are large while everyone is busy and shrink as the
+// loop runs out. OpenMP gives no view of its queues, so there the range is
+// halved down to the grain up front.
+static void range_task(task_ctx *ctx, void *arg, uint lo, uint hi) {
+    task_range *r = (task_range *)arg;
+    int pending = 0;
+
+    if (ctx == NULL || ctx->deque == NULL) {
+        while (ctx == NULL && hi - lo > r->grain) {
+            uint mid = lo + (hi - lo)/2;
+            task_spawn(ctx, range_task, arg, mid, hi, &pending);
+            hi = mid;
+        }
+        r->body(ctx, r->arg, lo, hi);
+    } else {
+        while (hi - lo > r->grain) {
+            if (ctx->deque->count == 0) {
+                uint mid = lo + (hi - lo)/2;
+                task_spawn(ctx, range_task, arg, mid, hi, &pending);
+                hi = mid;
+                continue;
+            }
+            r->body(ctx, r->arg, lo, lo + r->grain);
+            lo += r->grain;
+        }
+        r->body(ctx, r->arg, lo, hi);
+    }
+    task_join(ctx, &pending);
+}
+
+// Parallel loop over n items, returning when all of them are done
+static void task_for(task_ctx *ctx, task_fn body, void *arg, uint n) {
+    task_range r;
+    r.body  = body;
+    r.arg   = arg;
+    r.grain = POOL_GRAIN;
+#ifdef _OPENMP
+    if (ctx == NULL) {
+        uint grain = n/(omp_get_num_threads()*CHUNKS_PER_THREAD);
+        if (grain > r.grain) r.grain = grain;
+    }
+#endif
+    range_task(ctx, &r, 0, n);
+}
+
+// Cell of the hierarchical tables at (i, j, lev), or -1 for a breadcrumb
+static int probe_levels(task_remap_job *job, uint i, uint j, uint lev) {
+    uint key = j*job->icells.ibasesize*two_to_the(lev) + i;
+    return job->h_hash[lev][key];
+}
+
+static int probe_levels_compact(task_remap_job *job, uint i, uint j, uint lev) {
+    uint key = j*job->icells.ibasesize*two_to_the(lev) + i;
+    int probe = -1;
+    intintHash_QuerySingle(job->h_hashTable[lev], key, &probe);
+    return probe;
+}
+
+// Finest level point at the lower left corner of (i, j, lev)
+static inline uint fine_key(task_remap_job *job, uint i, uint j, uint lev) {
+    uint levmax = job->icells.levmax;
+    if (lev <= levmax) {
+        i <<= levmax - lev;
+        j <<= levmax - lev;
+    } else {
+        i >>= lev - levmax;
+        j >>= lev - levmax;
+    }
+    return j*job->i_max + i;
+}
+
+static inline int read_fine(task_remap_job *job, uint key) {
+#ifndef AMRREMAP_LIBRARY
+    if (job->compact) return read_hash(key, job->hash);
+#endif
+    return job->hash[key];
+}
+
+// The full perfect table holds the cell covering each point and the
+// single-write tables the cell starting at it, so either way the cell at
+// the corner is the one sought if it is on the same level
+static int probe_fine(task_remap_job *job, uint i, uint j, uint lev) {
+    int ic = read_fine(job, fine_key(job, i, j, lev));
+    if (ic >= 0 && job->icells.level[ic] == lev) return ic;
+    return -1;
+}
+
+// Walks from the coarsest level until a level holds a cell over the point
+static int locate_levels(task_remap_job *job, uint oi, uint oj, uint olev) {
+    int probe = -1;
+    for (uint probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+        int levdiff = olev - probe_lev;
+        probe = job->probe(job, oi >> levdiff, oj >> levdiff, probe_lev);
+    }
+    return probe;
+}
+
+static int locate_full_perfect(task_remap_job *job, uint oi, uint oj, uint olev) {
+    int ic = job->hash[fine_key(job, oi, oj, olev)];
+    if (olev >= job->icells.level[ic]) return ic;
+    return -1;
+}
+
+// Walks coarser from the output cell until it lands on the lower left
+// corner of an input cell
+static int locate_fine_corner(task_remap_job *job, uint oi, uint oj, uint olev) {
+    uint lev = olev;
+    if (lev > job->icells.levmax) {
+        oi >>= lev - job->icells.levmax;
+        oj >>= lev - job->icells.levmax;
+        lev = job->icells.levmax;
+    }
+    int ic = read_fine(job, fine_key(job, oi, oj, lev));
+    while (ic < 0 && lev > 0) {
+        oi >>= 1;
+        oj >>= 1;
+        lev--;
+        ic = read_fine(job, fine_key(job, oi, oj, lev));
+    }
+    if (lev >= job->icells.level[ic]) return ic;
+    return -1;
+}
+
+// Average of the input cells under (i, j, lev) on this thread
+static double avg_children(task_remap_job *job, uint i, uint j, uint lev) {
+    double sum = 0.0;
+    for (int k = 0; k < 4; k++) {
+        uint ci = 2*i + (k%2);
+        uint cj = 2*j + (k/2);
+        int probe = job->probe(job, ci, cj, lev + 1);
+        if (probe >= 0) {
+            sum += job->icells.values[probe];
+        } else {
+            sum += avg_children(job, ci, cj, lev + 1);
+        }
+    }
+    return 0.25*sum;
+}
+
+static void avg_part_task(task_ctx *ctx, void *arg, uint lo, uint hi) {
+    task_avg_part *p = (task_avg_part *)arg;
+    task_remap_job *job = p->job;
+    (void)lo;
+    (void)hi;
+
+    // the parent is refined, so each child is a cell or refined in turn
+    int probe = job->probe(job, p->i, p->j, p->lev);
+    if (probe >= 0) {
+        p->sum = job->icells.values[probe];
+    } else {
+        p->sum = task_avg(ctx, job, p->i, p->j, p->lev);
+    }
+}
+
+// Average of the input cells under the refined cell (i, j, lev). When the
+// input mesh has more than AVG_SPLIT_LEVELS levels below it the children
+// are averaged as subtasks, so a few very coarse output cells do not leave
+// one thread walking a large tree while the others wait.
+static double task_avg(task_ctx *ctx, task_remap_job *job, uint i, uint j, uint lev) {
+    if (job->icells.levmax - lev <= AVG_SPLIT_LEVELS) return avg_children(job, i, j, lev);
+
+    task_avg_part part[4];
+    for (int k = 0; k < 4; k++) {
+        part[k].job = job;
+        part[k].i   = 2*i + (k%2);
+        part[k].j   = 2*j + (k/2);
+        part[k].lev = lev + 1;
+        part[k].sum = 0.0;
+    }
+    int pending = 0;
+    for (int k = 1; k < 4; k++) {
+        task_spawn(ctx, avg_part_task, &part[k], 0, 0, &pending);
+    }
+    avg_part_task(ctx, &part[0], 0, 0);
+    task_join(ctx, &pending);
+
+    return 0.25*(part[0].sum + part[1].sum + part[2].sum + part[3].sum);
+}
+
+//place the cells and their breadcrumbs
+static void build_task(task_ctx *ctx, void *arg, uint lo, uint hi) {
+    task_remap_job *job = (task_remap_job *)arg;
+    cell_list icells = job->icells;
+    (void)ctx;
+
+    for (uint n = lo; n < hi; n++) {
+        uint i = icells.i[n];
+        uint j = icells.j[n];
+        int lev = icells.level[n];
+        uint key = j * icells.ibasesize*two_to_the(lev) + i;
+        job->h_hash[lev][key] = n;
+
+        while (i%2 == 0 && j%2 == 0 && lev > 0) {
+            i >>= 1;
+            j >>= 1;
+            lev--;
+            key = j * icells.ibasesize*two_to_the(lev) + i;
+            job->h_hash[lev][key] = -1;
+        }
+    }
+}
+
+static void count_compact_task(task_ctx *ctx, void *arg, uint lo, uint hi) {
+    task_remap_job *job = (task_remap_job *)arg;
+    uint local[32] = {0};
+    (void)ctx;
+
+    for (uint n = lo; n < hi; n++) {
+        local[job->icells.level[n]]++;
+    }
+    for (uint lev = 0; lev <= job->icells.levmax; lev++) {
+        if (local[lev] > 0) __sync_fetch_and_add(&job->num_at_level[lev], local[lev]);
+    }
+}
+
+static void build_compact_task(task_ctx *ctx, void *arg, uint lo, uint hi) {
+    task_remap_job *job = (task_remap_job *)arg;
+    cell_list icells = job->icells;
+    (void)ctx;
+
+    for (uint n = lo; n < hi; n++) {
+        uint i = icells.i[n];
+        uint j = icells.j[n];
+        int lev = icells.level[n];
+        uint key = j * icells.ibasesize*two_to_the(lev) + i;
+        intintHash_InsertSingle(job->h_hashTable[lev], key, n);
+
+        while (i%2 == 0 && j%2 == 0 && lev > 0) {
+            i /= 2;
+            j /= 2;
+            lev--;
+            key = j * icells.ibasesize*two_to_the(lev) + i;
+            intintHash_InsertSingle(job->h_hashTable[lev], key, -1);
+        }
+    }
+}
+
+// Sets the square block of finest level points under each cell
+static void build_full_perfect_task(task_ctx *ctx, void *arg, uint lo, uint hi) {
+    task_remap_job *job = (task_remap_job *)arg;
+    cell_list icells = job->icells;
+    (void)ctx;
+
+    for (uint n = lo; n < hi; n++) {
+        uint lev_mod = two_to_the(icells.levmax - icells.level[n]);
+        uint key = fine_key(job, icells.i[n], icells.j[n], icells.level[n]);
+        for (uint jj = 0; jj < lev_mod; jj++, key += job->i_max) {
+            for (uint ii = 0; ii < lev_mod; ii++) {
+                job->hash[key + ii] = n;
+            }
+        }
+    }
+}
+
+static void clear_fine_task(task_ctx *ctx, void *arg, uint lo, uint hi) {
+    task_remap_job *job = (task_remap_job *)arg;
+    (void)ctx;
+
+    for (uint k = lo; k < hi; k++) {
+        job->hash[k] = -1;
+    }
+}
+
+// Writes each cell at its lower left corner only
+static void build_fine_task(task_ctx *ctx, void *arg, uint lo, uint hi) {
+    task_remap_job *job = (task_remap_job *)arg;
+    cell_list icells = job->icells;
+    (void)ctx;
+
+    for (uint n = lo; n < hi; n++) {
+        uint key = fine_key(job, icells.i[n], icells.j[n], icells.level[n]);
+#ifndef AMRREMAP_LIBRARY
+        if (job->compact) {
+            write_hash(n, key, job->hash);
+            continue;
+        }
+#endif
+        job->hash[key] = n;
+    }
+}
+
+static void query_task(task_ctx *ctx, void *arg, uint lo, uint hi) {
+    task_remap_job *job = (task_remap_job *)arg;
+    cell_list icells = job->icells;
+    cell_list ocells = job->ocells;
+
+    for (uint n = lo; n < hi; n++) {
+        uint oi = ocells.i[n];
+        uint oj = ocells.j[n];
+        uint olev = ocells.level[n];
+
+        int probe = job->locate(job, oi, oj, olev);
+        if (probe >= 0) {
+            ocells.values[n] = icells.values[probe];
+        } else {
+            ocells.values[n] = task_avg(ctx, job, oi, oj, olev);
+        }
+    }
+}
+
+static void h_remap_task_run(task_ctx *ctx, task_remap_job *job) {
+    job->h_hash = h_hash_alloc(job->icells.ibasesize, job->icells.levmax);
+    job->probe  = probe_levels;
+    job->locate = locate_levels;
+
+    task_for(ctx, build_task, job, job->icells.ncells);
+    task_for(ctx, query_task, job, job->ocells.ncells);
+
+    h_hash_free(job->h_hash, job->icells.levmax);
+}
+
+// The tables must take concurrent inserts for the build to be split
+static void h_remap_compact_task_run(task_ctx *ctx, task_remap_job *job) {
+    cell_list icells = job->icells;
+
+    job->num_at_level = (uint *)calloc(icells.levmax+1, sizeof(uint));
+    task_for(ctx, count_compact_task, job, icells.ncells);
+    // lev must be int (not uint) to allow -1 for exit
+    for (int lev = icells.levmax-1; lev >= 0; lev--) {
+        job->num_at_level[lev] += job->num_at_level[lev+1]/4;
+    }
+
+    job->h_hashTable = (intintHash_Table **)malloc((icells.levmax+1)*sizeof(intintHash_Table *));
+    for (uint lev = 0; lev <= icells.levmax; lev++) {
+        size_t hash_size = icells.ibasesize*two_to_the(lev)*icells.ibasesize*two_to_the(lev);
+        job->h_hashTable[lev] = intintHash_CreateTable(job->factory, job->hash_type, hash_size, job->num_at_level[lev], HASH_LOAD_FACTOR);
+        intintHash_SetupTable(job->h_hashTable[lev]);
+    }
+    free(job->num_at_level);
+    job->probe  = probe_levels_compact;
+    job->locate = locate_levels;
+
+    if (job->concurrent) {
+        task_for(ctx, build_compact_task, job, icells.ncells);
+    } else {
+        build_compact_task(ctx, job, 0, icells.ncells);
+    }
+    task_for(ctx, query_task, job, job->ocells.ncells);
+
+    h_hash_compact_free(job->h_hashTable, icells.levmax);
+}
+
+static void full_perfect_task_run(task_ctx *ctx, task_remap_job *job) {
+    job->i_max   = job->icells.ibasesize*two_to_the(job->icells.levmax);
+    job->hash    = (int *)malloc((size_t)job->i_max*job->i_max*sizeof(int));
+    job->compact = 0;
+    job->probe   = probe_fine;
+    job->locate  = locate_full_perfect;
+
+    task_for(ctx, build_full_perfect_task, job, job->icells.ncells);
+    task_for(ctx, query_task, job, job->ocells.ncells);
+
+    free(job->hash);
+}
+
+static void singlewrite_task_run(task_ctx *ctx, task_remap_job *job) {
+    job->i_max   = job->icells.ibasesize*two_to_the(job->icells.levmax);
+    job->hash    = (int *)malloc((size_t)job->i_max*job->i_max*sizeof(int));
+    job->compact = 0;
+    job->probe   = probe_fine;
+    job->locate  = locate_fine_corner;
+
+    task_for(ctx, clear_fine_task, job, job->i_max*job->i_max);
+    task_for(ctx, build_fine_task, job, job->icells.ncells);
+    task_for(ctx, query_task, job, job->ocells.ncells);
+
+    free(job->hash);
+}
+
+#ifndef AMRREMAP_LIBRARY
+// The simplehash inserts are not safe to run concurrently outside of its
+// OpenMP init, which opens a parallel region of its own, so the build
+// stays on the calling thread
+static void singlewrite_compact_task_run(task_ctx *ctx, task_remap_job *job) {
+    job->i_max   = job->icells.ibasesize*two_to_the(job->icells.levmax);
+    job->hash    = compact_hash_init(job->icells.ncells, job->i_max, job->i_max, 1, 0);
+    job->compact = 1;
+    job->probe   = probe_fine;
+    job->locate  = locate_fine_corner;
+
+    build_fine_task(ctx, job, 0, job->icells.ncells);
+    task_for(ctx, query_task, job, job->ocells.ncells);
+
+    compact_hash_delete(job->hash);
+}
+#endif
+
+// The calling thread takes a caller deque of the pool and works in it for
+// the remap, or stays in the deque it has when called from a pool task. If
+// every caller deque is taken, the remap runs in place on this thread.
+static task_ctx *task_pool_enter(task_pool *pool, task_ctx *serial) {
+    if (current_ctx != NULL && current_ctx->pool == pool) return current_ctx;
+
+    task_ctx *ctx = serial;
+    pthread_mutex_lock(&pool->lock);
+    for (uint s = pool->nthreads; s < pool->nslots; s++) {
+        if (! pool->slot_busy[s]) {
+            pool->slot_busy[s] = 1;
+            ctx = &pool->ctx[s];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    serial->pool  = pool;
+    serial->deque = NULL;
+    serial->id    = pool->nslots;
+    serial->seed  = 1;
+    return ctx;
+}
+
+static void task_pool_leave(task_ctx *ctx, task_ctx *prev) {
+    current_ctx = prev;
+    if (ctx->deque == NULL || ctx == prev) return;
+
+    task_pool *pool = ctx->pool;
+    pthread_mutex_lock(&pool->lock);
+    pool->slot_busy[ctx->id] = 0;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+
+// Runs the remap on the backend. Under OpenMP tasks it opens a parallel
+// region when there is none to join; without OpenMP the tasks run in
+// order on the calling thread.
+static void task_remap_run(task_pool *pool, task_run_fn run, task_remap_job *job) {
+    if (pool == TASK_OPENMP) {
+#ifdef _OPENMP
+        if (! omp_in_parallel()) {
+#pragma omp parallel
+#pragma omp single
+            run(NULL, job);
+            return;
+        }
+#endif
+        run(NULL, job);
+        return;
+    }
+
+    task_ctx serial;
+    task_ctx *prev = current_ctx;
+    task_ctx *ctx = task_pool_enter(pool, &serial);
+    current_ctx = ctx;
+    run(ctx, job);
+    task_pool_leave(ctx, prev);
+}
+
+static void task_remap_job_init(task_remap_job *job, cell_list icells, cell_list ocells) {
+    job->icells       = icells;
+    job->ocells       = ocells;
+    job->h_hash       = NULL;
+    job->h_hashTable  = NULL;
+    job->num_at_level = NULL;
+    job->factory      = NULL;
+    job->hash         = NULL;
+    job->compact      = 0;
+}
+
+void full_perfect_remap_task(cell_list icells, cell_list ocells, task_pool *pool) {
+    task_remap_job job;
+    task_remap_job_init(&job, icells, ocells);
+    task_remap_run(pool, full_perfect_task_run, &job);
+}
+
+void singlewrite_remap_task(cell_list icells, cell_list ocells, task_pool *pool) {
+    task_remap_job job;
+    task_remap_job_init(&job, icells, ocells);
+    task_remap_run(pool, singlewrite_task_run, &job);
+}
+
+#ifndef AMRREMAP_LIBRARY
+void singlewrite_remap_compact_task(cell_list icells, cell_list ocells, task_pool *pool) {
+    task_remap_job job;
+    task_remap_job_init(&job, icells, ocells);
+    task_remap_run(pool, singlewrite_compact_task_run, &job);
+}
+#endif
+
+void h_remap_task(cell_list icells, cell_list ocells, task_pool *pool) {
+    task_remap_job job;
+    task_remap_job_init(&job, icells, ocells);
+    task_remap_run(pool, h_remap_task_run, &job);
+}
+
+void h_remap_compact_task(cell_list icells, cell_list ocells, intintHash_Factory *factory, task_pool *pool) {
+    task_remap_job job;
+    task_remap_job_init(&job, icells, ocells);
+    job.factory = factory;
+#ifdef _OPENMP
+    job.hash_type  = HASH_OPENMP_TYPE;
+    job.concurrent = 1;
+#else
+    job.hash_type  = HASH_TYPE;
+    job.concurrent = 0;
+#endif
+    task_remap_run(pool, h_remap_compact_task_run, &job);
+}
@@ -0,0 +1,80 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#ifndef TASK_REMAP_H
+#define TASK_REMAP_H
+
+#include "meshgen/meshgen.h"
+#include "HashFactory/HashFactory.h"
+
+// The remaps written as tasks rather than flat parallel loops, so they can
+// be called from inside an application's own threads without
+// oversubscribing the cores or falling back to one thread. Each remap takes
+// the backend to run its tasks on:
+//
+//   a task_pool   a work-stealing pool of pthreads with a deque per thread.
+//                 A thread calling a remap works in the pool until its
+//                 remap is done, and remaps called from pool tasks, or from
+//                 several application threads at once, share the workers.
+//   TASK_OPENMP   OpenMP tasks. Outside a parallel region the remap opens
+//                 one; inside one its tasks go to the enclosing team, so the
+//                 threads waiting at the next barrier run them. Without
+//                 OpenMP the tasks run in order on the calling thread.
+//
+// The input cells and then the output cells are split into chunks that
+// adapt to how busy the other threads are, and the averaging for output
+// cells far coarser than the input mesh under them is split into subtasks
+// over the four children. The averages are summed in a different order
+// than the flat remaps, so they match to rounding.
+//
+// The compact single-write remap builds its simplehash table on the calling
+// thread, since the concurrent simplehash inserts need the OpenMP init with
+// its own parallel region, and like the flat version it keeps the table in
+// global state: one may run at a time, and it is not in the library build.
+
+typedef struct task_pool task_pool;
+
+#define TASK_OPENMP ((task_pool *)NULL)
+
+// A pool of nthreads workers; the threads calling the remaps join them, so
+// nthreads is the number of cores to leave for the callers less one
+task_pool *task_pool_create (uint nthreads);
+void task_pool_destroy (task_pool *pool);
+
+void full_perfect_remap_task (cell_list icells, cell_list ocells, task_pool *pool);
+void singlewrite_remap_task (cell_list icells, cell_list ocells, task_pool *pool);
+#ifndef AMRREMAP_LIBRARY
+void singlewrite_remap_compact_task (cell_list icells, cell_list ocells, task_pool *pool);
+#endif
+void h_remap_task (cell_list icells, cell_list ocells, task_pool *pool);
+void h_remap_compact_task (cell_list icells, cell_list ocells, intintHash_Factory *factory, task_pool *pool);
+
+#endif
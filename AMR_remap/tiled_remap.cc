@@ -0,0 +1,326 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#include <stdlib.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "meshgen/meshgen.h"
+#include "hierarchical_remap.h"
+#include "tiled_remap.h"
+
+// The side of a tile in base cells is the largest power of two whose
+// finest level is no more than TILE_FINE_CELLS across, so the tables of a
+// tile take about 4/3 TILE_FINE_CELLS^2 ints (85 KB)
+#define TILE_FINE_CELLS 128
+
+typedef struct {
+    uint tshift;     // log2 of the tile side in base cells
+    uint tsize;      // tile side in base cells
+    uint ntx;        // tiles per side
+    uint ntiles;
+    uint *rank;      // curve position of each tile, by row-major tile index
+    uint *tile_x;    // tile coordinates at each curve position
+    uint *tile_y;
+} tile_grid;
+
+typedef struct {
+    uint64_t key;
+    uint     index;
+} tile_entry;
+
+static int compare_tile_entry(const void *a, const void *b) {
+    uint64_t ka = ((const tile_entry *)a)->key;
+    uint64_t kb = ((const tile_entry *)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+static void tile_grid_create(tile_grid *g, uint ibasesize, uint levmax) {
+    g->tshift = 0;
+    while (two_to_the(g->tshift+1) <= ibasesize &&
+           two_to_the(g->tshift+1+levmax) <= TILE_FINE_CELLS) {
+        g->tshift++;
+    }
+    g->tsize  = two_to_the(g->tshift);
+    g->ntx    = (ibasesize + g->tsize - 1) >> g->tshift;
+    g->ntiles = g->ntx*g->ntx;
+
+    tile_entry *entry = (tile_entry *)malloc(g->ntiles*sizeof(tile_entry));
+    for (uint t = 0; t < g->ntiles; t++) {
+        entry[t].key   = morton_encode(t % g->ntx, t / g->ntx);
+        entry[t].index = t;
+    }
+    qsort(entry, g->ntiles, sizeof(tile_entry), compare_tile_entry);
+
+    g->rank   = (uint *)malloc(g->ntiles*sizeof(uint));
+    g->tile_x = (uint *)malloc(g->ntiles*sizeof(uint));
+    g->tile_y = (uint *)malloc(g->ntiles*sizeof(uint));
+    for (uint k = 0; k < g->ntiles; k++) {
+        g->rank[entry[k].index] = k;
+        g->tile_x[k] = entry[k].index % g->ntx;
+        g->tile_y[k] = entry[k].index / g->ntx;
+    }
+    free(entry);
+}
+
+static void tile_grid_free(tile_grid *g) {
+    free(g->rank);
+    free(g->tile_x);
+    free(g->tile_y);
+}
+
+static inline uint tile_of(cell_list cells, uint n, const tile_grid *g) {
+    uint lev = cells.level[n];
+    uint tx = cells.i[n] >> (lev + g->tshift);
+    uint ty = cells.j[n] >> (lev + g->tshift);
+    return g->rank[ty*g->ntx + tx];
+}
+
+// Buckets the cells by tile in curve order, keeping mesh order within a
+// tile. The cells of tile k are list[start[k]] to list[start[k+1]-1]. When
+// the mesh is already in tile order no list is made and NULL is returned,
+// and the cells of tile k are start[k] to start[k+1]-1 themselves.
+static uint *tile_cells(cell_list cells, const tile_grid *g, uint *start, int threaded) {
+
+    (void)threaded;
+    uint nthreads = 1;
+#ifdef _OPENMP
+    if (threaded) nthreads = omp_get_max_threads();
+#endif
+    uint ntiles = g->ntiles;
+    uint *count = (uint *)calloc((size_t)nthreads*ntiles, sizeof(uint));
+    uint *list = NULL;
+    int sorted = 1;
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads) if(threaded)
+#endif
+    {
+#ifdef _OPENMP
+        uint t = omp_get_thread_num();
+        uint nt = omp_get_num_threads();
+#else
+        uint t = 0;
+        uint nt = 1;
+#endif
+        uint nstart = (uint)((size_t)cells.ncells*t/nt);
+        uint nend   = (uint)((size_t)cells.ncells*(t+1)/nt);
+        uint *mycount = count + (size_t)t*ntiles;
+
+        uint prev = (nstart > 0 && nstart < nend) ? tile_of(cells, nstart-1, g) : 0;
+        int mysorted = 1;
+        for (uint n = nstart; n < nend; n++) {
+            uint r = tile_of(cells, n, g);
+            mycount[r]++;
+            if (r < prev) mysorted = 0;
+            prev = r;
+        }
+        if (! mysorted) {
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+            sorted = 0;
+        }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+        {
+            // offsets by tile and then by thread, so the fill keeps mesh order
+            uint sum = 0;
+            for (uint r = 0; r < ntiles; r++) {
+                start[r] = sum;
+                for (uint k = 0; k < nt; k++) {
+                    uint c = count[(size_t)k*ntiles + r];
+                    count[(size_t)k*ntiles + r] = sum;
+                    sum += c;
+                }
+            }
+            start[ntiles] = sum;
+            if (! sorted) list = (uint *)malloc((cells.ncells > 0 ? cells.ncells : 1)*sizeof(uint));
+        }
+
+        if (list != NULL) {
+            for (uint n = nstart; n < nend; n++) {
+                list[mycount[tile_of(cells, n, g)]++] = n;
+            }
+        }
+    }
+
+    free(count);
+    return list;
+}
+
+// The tile grid and the output cells bucketed on it
+struct tiled_plan {
+    uint ibasesize;
+    uint levmax;
+    tile_grid g;
+    uint *ostart;
+    uint *olist;
+};
+
+static void tiled_plan_init(tiled_plan *plan, cell_list ocells, uint ibasesize, uint levmax, int threaded) {
+    plan->ibasesize = ibasesize;
+    plan->levmax    = levmax;
+    tile_grid_create(&plan->g, ibasesize, levmax);
+    plan->ostart = (uint *)malloc((plan->g.ntiles+1)*sizeof(uint));
+    plan->olist  = tile_cells(ocells, &plan->g, plan->ostart, threaded);
+}
+
+static void tiled_plan_free(tiled_plan *plan) {
+    free(plan->ostart);
+    free(plan->olist);
+    tile_grid_free(&plan->g);
+}
+
+static void h_remap_tiled_run(cell_list icells, cell_list ocells, const tiled_plan *plan, int threaded) {
+
+    (void)threaded;
+    const tile_grid &g = plan->g;
+    const uint *ostart = plan->ostart;
+    const uint *olist  = plan->olist;
+
+    uint *istart = (uint *)malloc((g.ntiles+1)*sizeof(uint));
+    uint *ilist = tile_cells(icells, &g, istart, threaded);
+    uint tsize = g.tsize;
+
+#ifdef _OPENMP
+#pragma omp parallel if(threaded)
+#endif
+    {
+        // tables for one tile in tile coordinates, reused for each tile
+        int **h_hash = h_hash_alloc(tsize, icells.levmax);
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,1)
+#endif
+        for (uint k = 0; k < g.ntiles; k++) {
+            uint x0 = g.tile_x[k] << g.tshift;
+            uint y0 = g.tile_y[k] << g.tshift;
+
+            //place the cells of the tile and their breadcrumbs
+            for (uint m = istart[k]; m < istart[k+1]; m++) {
+                uint n = (ilist != NULL) ? ilist[m] : m;
+                int lev = icells.level[n];
+                uint i = icells.i[n] - (x0 << lev);
+                uint j = icells.j[n] - (y0 << lev);
+                uint key = j * tsize*two_to_the(lev) + i;
+                h_hash[lev][key] = n;
+
+                while (i%2 == 0 && j%2 == 0 && lev > 0) {
+                    i >>= 1;
+                    j >>= 1;
+                    lev--;
+                    key = j * tsize*two_to_the(lev) + i;
+                    h_hash[lev][key] = -1;
+                }
+            }
+
+            for (uint m = ostart[k]; m < ostart[k+1]; m++) {
+                uint n = (olist != NULL) ? olist[m] : m;
+                uint olev = ocells.level[n];
+                uint oi = ocells.i[n] - (x0 << olev);
+                uint oj = ocells.j[n] - (y0 << olev);
+
+                int probe = -1;
+                for (uint probe_lev = 0; probe < 0 && probe_lev <= olev; probe_lev++){
+                    int levdiff = olev - probe_lev;
+                    uint key = (oj >> levdiff)*tsize*two_to_the(probe_lev) + (oi >> levdiff);
+                    probe = h_hash[probe_lev][key];
+                }
+                if (probe >= 0) {
+                    ocells.values[n] = icells.values[probe];
+                } else {
+                    ocells.values[n] = avg_sub_cells_h (icells, oi, oj, olev, h_hash, tsize);
+                }
+            }
+        }
+
+        h_hash_free(h_hash, icells.levmax);
+    }
+
+    free(istart);
+    free(ilist);
+}
+
+static void h_remap_tiled_once(cell_list icells, cell_list ocells, int threaded) {
+    tiled_plan plan;
+    tiled_plan_init(&plan, ocells, icells.ibasesize, icells.levmax, threaded);
+    h_remap_tiled_run(icells, ocells, &plan, threaded);
+    tiled_plan_free(&plan);
+}
+
+void h_remap_tiled (cell_list icells, cell_list ocells) {
+    h_remap_tiled_once(icells, ocells, 0);
+}
+
+tiled_plan *tiled_plan_create (cell_list ocells, uint ibasesize, uint levmax) {
+    tiled_plan *plan = (tiled_plan *)malloc(sizeof(tiled_plan));
+    tiled_plan_init(plan, ocells, ibasesize, levmax, 0);
+    return plan;
+}
+
+void tiled_plan_destroy (tiled_plan *plan) {
+    tiled_plan_free(plan);
+    free(plan);
+}
+
+void h_remap_tiled_plan (cell_list icells, cell_list ocells, const tiled_plan *plan) {
+    if (icells.ibasesize != plan->ibasesize || icells.levmax != plan->levmax) {
+        h_remap_tiled_once(icells, ocells, 0);
+    } else {
+        h_remap_tiled_run(icells, ocells, plan, 0);
+    }
+}
+
+#ifdef _OPENMP
+void h_remap_tiled_openMP (cell_list icells, cell_list ocells) {
+    h_remap_tiled_once(icells, ocells, 1);
+}
+
+tiled_plan *tiled_plan_create_openMP (cell_list ocells, uint ibasesize, uint levmax) {
+    tiled_plan *plan = (tiled_plan *)malloc(sizeof(tiled_plan));
+    tiled_plan_init(plan, ocells, ibasesize, levmax, 1);
+    return plan;
+}
+
+void h_remap_tiled_plan_openMP (cell_list icells, cell_list ocells, const tiled_plan *plan) {
+    if (icells.ibasesize != plan->ibasesize || icells.levmax != plan->levmax) {
+        h_remap_tiled_once(icells, ocells, 1);
+    } else {
+        h_remap_tiled_run(icells, ocells, plan, 1);
+    }
+}
+#endif
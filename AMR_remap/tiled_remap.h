@@ -0,0 +1,68 @@
+/* Copyright 2015-19.  Triad National Security, LLC. This material was produced
+ * under U.S. Government contract 89233218CNA000001 for Los Alamos National 
+ * Laboratory (LANL), which is operated by Triad National Security, LLC
+ * for the U.S. Department of Energy. The U.S. Government has rights to use,
+ * reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ * TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ * ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ * to produce derivative works, such modified software should be clearly marked,
+ * so as not to confuse it with the version available from LANL.   
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at 
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ * Under this license, it is required to include a reference to this work.
+ *
+ * This is LANL Copyright Disclosure C16017/LA-CC-15-102
+ *
+ * Authors: Bob Robey         XCP-2   brobey@lanl.gov
+ *          Gerald Collom     XCP-2   gcollom@lanl.gov
+ *          Colin Redman      XCP-2   credman@lanl.gov 
+ */
+
+
+#ifndef TILED_REMAP_H
+#define TILED_REMAP_H
+
+#include "meshgen/meshgen.h"
+
+// Hierarchical remap done tile by tile instead of as one build over the
+// whole input mesh followed by one query pass over the whole output mesh.
+// A tile is a square block of base cells, and every input cell under an
+// output cell, along with its breadcrumbs, lies in the same base cell, so
+// a tile needs no halo. Each thread takes the next tile in Morton order,
+// builds tables for just that tile, and queries them right away. The
+// tables are sized for one tile and reused for the next, so they stay in
+// cache, and the build of one tile runs while other threads query theirs
+// with no barrier between the phases.
+//
+// The cells are first bucketed by tile. Meshes already in Morton order,
+// as from sort_cell_list_morton, are found to be in tile order and are
+// used in place. The values match h_remap exactly.
+void h_remap_tiled (cell_list icells, cell_list ocells);
+#ifdef _OPENMP
+void h_remap_tiled_openMP (cell_list icells, cell_list ocells);
+#endif
+
+// For many remaps onto the same output mesh, such as a series of dumps
+// remapped onto one analysis mesh, the tiles and the bucketing of the
+// output cells can be done once. The plan is for input meshes with the
+// given base size and levmax; others are remapped as by h_remap_tiled.
+typedef struct tiled_plan tiled_plan;
+tiled_plan *tiled_plan_create (cell_list ocells, uint ibasesize, uint levmax);
+void tiled_plan_destroy (tiled_plan *plan);
+void h_remap_tiled_plan (cell_list icells, cell_list ocells, const tiled_plan *plan);
+#ifdef _OPENMP
+tiled_plan *tiled_plan_create_openMP (cell_list ocells, uint ibasesize, uint levmax);
+void h_remap_tiled_plan_openMP (cell_list icells, cell_list ocells, const tiled_plan *plan);
+#endif
+
+#endif
@@ -0,0 +1,14 @@
+#!/bin/sh
+
+# Lazy-zero singlewrite remap against the -1 initialized table across
+# compressibility values from 1 to 100 (compressibility is about 1/sparsity)
+
+set -v
+
+AMR_remap/AMR_remap_openMP 6 100000 6 100000 10 -no-brute -no-tree -lazy-zero -sparsity 1.00
+AMR_remap/AMR_remap_openMP 6 100000 6 100000 10 -no-brute -no-tree -lazy-zero -sparsity 0.50
+AMR_remap/AMR_remap_openMP 6 100000 6 100000 10 -no-brute -no-tree -lazy-zero -sparsity 0.20
+AMR_remap/AMR_remap_openMP 6 100000 6 100000 10 -no-brute -no-tree -lazy-zero -sparsity 0.10
+AMR_remap/AMR_remap_openMP 6 100000 6 100000 10 -no-brute -no-tree -lazy-zero -sparsity 0.05
+AMR_remap/AMR_remap_openMP 6 100000 6 100000 10 -no-brute -no-tree -lazy-zero -sparsity 0.02
+AMR_remap/AMR_remap_openMP 6 100000 6 100000 10 -no-brute -no-tree -lazy-zero -sparsity 0.01
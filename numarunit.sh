@@ -0,0 +1,20 @@
+#!/bin/sh
+
+# First touch placement on one socket against two. The one socket runs are
+# held to node 0 for threads and memory with numactl, the two socket runs
+# spread the threads over both sockets. Interleave only differs from block
+# placement when there is more than one node, so it is run on two sockets.
+# CORES is the number of cores on one socket.
+
+CORES=${CORES:-`lscpu -p=SOCKET,CORE | grep -v '^#' | awk -F, '$1 == 0' | sort -u | wc -l`}
+ARGS="6 4000000 6 4000000 10 -no-brute -no-tree"
+
+set -v
+
+OMP_NUM_THREADS=$CORES OMP_PROC_BIND=close OMP_PLACES=cores numactl --cpunodebind=0 --membind=0 AMR_remap/AMR_remap_openMP $ARGS -numa-policy none
+OMP_NUM_THREADS=$CORES OMP_PROC_BIND=close OMP_PLACES=cores numactl --cpunodebind=0 --membind=0 AMR_remap/AMR_remap_openMP $ARGS -numa-policy block
+
+OMP_NUM_THREADS=`expr 2 \* $CORES` OMP_PROC_BIND=spread OMP_PLACES=cores AMR_remap/AMR_remap_openMP $ARGS -numa-policy none
+OMP_NUM_THREADS=`expr 2 \* $CORES` OMP_PROC_BIND=spread OMP_PLACES=cores AMR_remap/AMR_remap_openMP $ARGS -numa-policy block
+OMP_NUM_THREADS=`expr 2 \* $CORES` OMP_PROC_BIND=spread OMP_PLACES=cores AMR_remap/AMR_remap_openMP $ARGS -numa-policy interleave
+OMP_NUM_THREADS=`expr 2 \* $CORES` OMP_PROC_BIND=spread OMP_PLACES=cores AMR_remap/AMR_remap_openMP $ARGS -numa-policy block -huge-pages